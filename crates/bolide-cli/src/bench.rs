@@ -0,0 +1,124 @@
+//! 基准测试：`bolide bench`
+//!
+//! JIT 编译程序后先运行一次顶层代码（初始化全局变量），然后对每个无参数的 `bench_*` 函数
+//! 预热若干次、再重复计时，报告中位数和 p99。程序里没有 `bench_*` 函数时对整个程序计时。
+
+use std::time::{Duration, Instant};
+
+use bolide_compiler::{CompileOptions, JitCompiler};
+use bolide_parser::{Program, Statement};
+
+/// 一个基准函数的计时结果
+pub struct BenchResult {
+    name: String,
+    /// 升序排列的每次耗时
+    samples: Vec<Duration>,
+}
+
+impl BenchResult {
+    fn new(name: String, mut samples: Vec<Duration>) -> Self {
+        samples.sort();
+        Self { name, samples }
+    }
+
+    /// 第 p 百分位（最近秩法）
+    fn percentile(&self, p: f64) -> Duration {
+        let n = self.samples.len();
+        let rank = ((p / 100.0) * n as f64).ceil() as usize;
+        self.samples[rank.clamp(1, n) - 1]
+    }
+
+    fn median(&self) -> Duration {
+        let n = self.samples.len();
+        if n % 2 == 1 {
+            self.samples[n / 2]
+        } else {
+            (self.samples[n / 2 - 1] + self.samples[n / 2]) / 2
+        }
+    }
+
+    fn mean(&self) -> Duration {
+        self.samples.iter().sum::<Duration>() / self.samples.len() as u32
+    }
+}
+
+/// 程序中的基准函数（顶层、无参数、以 bench_ 开头），按定义顺序
+fn bench_functions(ast: &Program) -> Vec<String> {
+    ast.statements.iter()
+        .filter_map(|stmt| match stmt {
+            Statement::FuncDef(func) if func.name.starts_with("bench_") && func.params.is_empty() => {
+                Some(func.name.clone())
+            }
+            _ => None,
+        })
+        .collect()
+}
+
+/// 预热后重复调用 f 并记录每次耗时
+fn measure(f: fn() -> i64, warmup: usize, iterations: usize) -> Vec<Duration> {
+    for _ in 0..warmup {
+        std::hint::black_box(f());
+    }
+    (0..iterations)
+        .map(|_| {
+            let start = Instant::now();
+            std::hint::black_box(f());
+            start.elapsed()
+        })
+        .collect()
+}
+
+/// 编译并运行基准测试
+pub fn run(ast: &Program, options: CompileOptions, warmup: usize, iterations: usize) -> Result<Vec<BenchResult>, String> {
+    let iterations = iterations.max(1);
+    let mut compiler = JitCompiler::with_options(options);
+    let main_ptr = compiler.compile(ast)?;
+    let main_fn: fn() -> i64 = unsafe { std::mem::transmute(main_ptr) };
+
+    let names = bench_functions(ast);
+    if names.is_empty() {
+        let samples = measure(main_fn, warmup, iterations);
+        bolide_runtime::bolide_print_flush();
+        return Ok(vec![BenchResult::new("main".to_string(), samples)]);
+    }
+
+    main_fn();
+    let mut results = Vec::new();
+    for name in names {
+        let ptr = compiler.get_function(&name)
+            .ok_or_else(|| format!("Benchmark {} not compiled", name))?;
+        let f: fn() -> i64 = unsafe { std::mem::transmute(ptr) };
+        let samples = measure(f, warmup, iterations);
+        bolide_runtime::bolide_print_flush();
+        results.push(BenchResult::new(name, samples));
+    }
+    Ok(results)
+}
+
+/// 按量级选择单位
+fn format_duration(d: Duration) -> String {
+    let ns = d.as_nanos();
+    if ns < 1_000 {
+        format!("{} ns", ns)
+    } else if ns < 1_000_000 {
+        format!("{:.2} us", ns as f64 / 1e3)
+    } else if ns < 1_000_000_000 {
+        format!("{:.2} ms", ns as f64 / 1e6)
+    } else {
+        format!("{:.3} s", ns as f64 / 1e9)
+    }
+}
+
+/// 打印结果表
+pub fn report(results: &[BenchResult]) {
+    println!("{:<32} {:>8} {:>12} {:>12} {:>12} {:>12}", "benchmark", "iters", "median", "p99", "min", "mean");
+    for r in results {
+        println!("{:<32} {:>8} {:>12} {:>12} {:>12} {:>12}",
+            r.name,
+            r.samples.len(),
+            format_duration(r.median()),
+            format_duration(r.percentile(99.0)),
+            format_duration(r.samples[0]),
+            format_duration(r.mean()));
+    }
+}
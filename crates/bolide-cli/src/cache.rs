@@ -0,0 +1,133 @@
+//! 编译缓存：`bolide run --cache`
+//!
+//! 把 AOT 编译并链接好的可执行文件按内容哈希缓存到磁盘。源文件和导入的模块都没变时
+//! 直接运行缓存的程序，跳过解析、导入处理、内置函数注册和代码生成。
+//!
+//! 每个源文件对应两级条目：
+//! - `<源码哈希>.deps`：导入的模块路径，每行一个（命中时不需要解析源码就能找到依赖）
+//! - `<源码哈希+依赖内容哈希>`：可执行文件
+//!
+//! 哈希包含 bolide 可执行文件本身的大小和修改时间，编译器或运行时重新构建后缓存自动失效。
+
+use std::fs;
+use std::path::{Path, PathBuf};
+
+use bolide_compiler::CompileOptions;
+use bolide_parser::{Program, Statement};
+
+/// 缓存格式版本，改变条目布局时递增
+const CACHE_VERSION: u32 = 1;
+
+/// FNV-1a 64 位哈希（跨进程、跨版本稳定）
+struct Fnv64(u64);
+
+impl Fnv64 {
+    fn new() -> Self {
+        Fnv64(0xcbf2_9ce4_8422_2325)
+    }
+
+    fn write(&mut self, bytes: &[u8]) {
+        for &b in bytes {
+            self.0 ^= b as u64;
+            self.0 = self.0.wrapping_mul(0x0000_0100_0000_01b3);
+        }
+    }
+
+    /// 带长度前缀写入，避免相邻字段拼接产生歧义
+    fn write_field(&mut self, bytes: &[u8]) {
+        self.write(&(bytes.len() as u64).to_le_bytes());
+        self.write(bytes);
+    }
+}
+
+/// 缓存目录：BOLIDE_CACHE_DIR，否则为系统缓存目录下的 bolide/
+pub fn cache_dir() -> PathBuf {
+    if let Some(dir) = std::env::var_os("BOLIDE_CACHE_DIR") {
+        return PathBuf::from(dir);
+    }
+    let base = std::env::var_os("XDG_CACHE_HOME").map(PathBuf::from)
+        .or_else(|| std::env::var_os("LOCALAPPDATA").map(PathBuf::from))
+        .or_else(|| std::env::var_os("HOME").map(|home| PathBuf::from(home).join(".cache")))
+        .unwrap_or_else(std::env::temp_dir);
+    base.join("bolide")
+}
+
+/// 一个源文件在缓存中的位置
+pub struct CacheEntry {
+    dir: PathBuf,
+    source_hash: u64,
+}
+
+impl CacheEntry {
+    /// 由源码内容、编译选项和编译器自身计算第一级哈希
+    pub fn new(source: &str, options: &CompileOptions) -> Self {
+        let mut h = Fnv64::new();
+        h.write(&CACHE_VERSION.to_le_bytes());
+        h.write_field(env!("CARGO_PKG_VERSION").as_bytes());
+        if let Some(meta) = std::env::current_exe().ok().and_then(|exe| fs::metadata(exe).ok()) {
+            h.write(&meta.len().to_le_bytes());
+            if let Ok(mtime) = meta.modified() {
+                if let Ok(since) = mtime.duration_since(std::time::UNIX_EPOCH) {
+                    h.write(&since.as_nanos().to_le_bytes());
+                }
+            }
+        }
+        h.write_field(format!("{:?}", options).as_bytes());
+        h.write_field(source.as_bytes());
+        Self { dir: cache_dir(), source_hash: h.0 }
+    }
+
+    fn deps_path(&self) -> PathBuf {
+        self.dir.join(format!("{:016x}.deps", self.source_hash))
+    }
+
+    /// 第二级哈希：加入每个依赖模块的路径和内容，依赖缺失时返回 None
+    fn full_hash(&self, deps: &[String]) -> Option<u64> {
+        let mut h = Fnv64(self.source_hash);
+        for dep in deps {
+            h.write_field(dep.as_bytes());
+            h.write_field(&fs::read(dep).ok()?);
+        }
+        Some(h.0)
+    }
+
+    fn exe_path(&self, full_hash: u64) -> PathBuf {
+        let name = format!("{:016x}", full_hash);
+        self.dir.join(Path::new(&name).with_extension(std::env::consts::EXE_EXTENSION))
+    }
+
+    /// 查找可用的缓存程序
+    pub fn lookup(&self) -> Option<PathBuf> {
+        let deps = fs::read_to_string(self.deps_path()).ok()?;
+        let deps: Vec<String> = deps.lines().map(str::to_string).collect();
+        let exe = self.exe_path(self.full_hash(&deps)?);
+        exe.is_file().then_some(exe)
+    }
+
+    /// 写入依赖清单并返回可执行文件的目标路径，由调用者链接到这里
+    pub fn prepare(&self, ast: &Program) -> Result<PathBuf, String> {
+        fs::create_dir_all(&self.dir)
+            .map_err(|e| format!("Failed to create cache directory {}: {}", self.dir.display(), e))?;
+        let deps = imported_files(ast);
+        let full_hash = self.full_hash(&deps)
+            .ok_or_else(|| "Failed to read imported module".to_string())?;
+        fs::write(self.deps_path(), deps.join("\n"))
+            .map_err(|e| format!("Failed to write cache manifest: {}", e))?;
+        Ok(self.exe_path(full_hash))
+    }
+}
+
+/// 程序直接导入的模块文件（与编译器的 process_imports 一致，只看顶层 import）
+fn imported_files(ast: &Program) -> Vec<String> {
+    let mut files: Vec<String> = Vec::new();
+    for stmt in &ast.statements {
+        if let Statement::Import(import) = stmt {
+            if let Some(ref file_path) = import.file_path {
+                if !files.contains(file_path) {
+                    files.push(file_path.clone());
+                }
+            }
+        }
+    }
+    files
+}
@@ -1,69 +1,42 @@
-use clap::{Parser, Subcommand};
+use clap::{Args, Parser, Subcommand};
 use std::path::{Path, PathBuf};
 use std::fs;
 use std::io::{self, Write};
 use std::process::Command;
 
-use bolide_parser::parse_source;
-use bolide_compiler::{JitCompiler, AotCompiler};
+use bolide_parser::{parse_source, Program};
+use bolide_compiler::{JitCompiler, AotCompiler, CompileOptions, OptLevel};
 
-/// REPL 状态，维护累积的代码
+mod bench;
+mod cache;
+use cache::CacheEntry;
+
+/// REPL 状态：整个会话共用一个 JIT 编译器，每次输入只增量编译新增的定义和语句，
+/// 之前定义的函数、类和全局变量（包括它们的值）一直保留
 struct ReplState {
-    /// 函数定义
-    functions: Vec<String>,
-    /// 全局变量声明
-    globals: Vec<String>,
+    compiler: JitCompiler,
 }
 
 impl ReplState {
     fn new() -> Self {
         Self {
-            functions: Vec::new(),
-            globals: Vec::new(),
-        }
-    }
-
-    /// 判断输入类型并添加到状态
-    fn add_input(&mut self, input: &str) -> InputType {
-        let trimmed = input.trim();
-
-        if trimmed.starts_with("fn ") {
-            self.functions.push(input.to_string());
-            InputType::FuncDef
-        } else if trimmed.starts_with("let ") {
-            self.globals.push(input.to_string());
-            InputType::VarDecl
-        } else if trimmed.starts_with("class ") {
-            self.functions.push(input.to_string());
-            InputType::ClassDef
-        } else {
-            InputType::Expr
+            compiler: JitCompiler::new(),
         }
     }
+}
 
-    /// 生成完整的程序代码
-    fn build_program(&self, expr: Option<&str>) -> String {
-        let mut code = String::new();
-
-        // 添加函数/类定义
-        for func in &self.functions {
-            code.push_str(func);
-            code.push('\n');
-        }
-
-        // 添加全局变量
-        for var in &self.globals {
-            code.push_str(var);
-            code.push('\n');
-        }
-
-        // 添加表达式/语句
-        if let Some(e) = expr {
-            code.push_str(e);
-            code.push('\n');
-        }
+/// 判断输入类型
+fn classify_input(input: &str) -> InputType {
+    let trimmed = input.trim();
 
-        code
+    if trimmed.starts_with("fn ") {
+        InputType::FuncDef
+    } else if trimmed.starts_with("let ") {
+        InputType::VarDecl
+    } else if trimmed.starts_with("class ") {
+        InputType::ClassDef
+    } else {
+        InputType::Expr
     }
 }
 
@@ -90,6 +63,11 @@ enum Commands {
     Run {
         /// Source file path
         file: PathBuf,
+        /// Cache the compiled program on disk and reuse it while the source and imports are unchanged
+        #[arg(long)]
+        cache: bool,
+        #[command(flatten)]
+        codegen: CodegenArgs,
     },
     /// Compile a Bolide source file to executable (AOT)
     Compile {
@@ -98,19 +76,64 @@ enum Commands {
         /// Output file path
         #[arg(short, long)]
         output: Option<PathBuf>,
+        /// Link extern libraries statically (libfoo.so -> libfoo.a) so FFI calls need no dynamic loading
+        #[arg(long)]
+        static_ffi: bool,
+        #[command(flatten)]
+        codegen: CodegenArgs,
+    },
+    /// Time the bench_* functions of a Bolide source file (JIT)
+    Bench {
+        /// Source file path
+        file: PathBuf,
+        /// Untimed runs before measuring
+        #[arg(long, default_value_t = 3)]
+        warmup: usize,
+        /// Timed runs per benchmark
+        #[arg(short = 'n', long, default_value_t = 20)]
+        iterations: usize,
+        #[command(flatten)]
+        codegen: CodegenArgs,
     },
 }
 
+/// 代码生成选项（run 与 compile 共用）
+#[derive(Args)]
+struct CodegenArgs {
+    /// Optimization level: -O0 (fastest compile), -O1, -O2 (release)
+    #[arg(short = 'O', value_name = "LEVEL", default_value_t = 0,
+          value_parser = clap::value_parser!(u8).range(0..=2))]
+    opt_level: u8,
+    /// Target CPU: generic (portable) or native (use all host CPU features)
+    #[arg(long = "target-cpu", value_name = "CPU", default_value = "generic",
+          value_parser = ["generic", "native"])]
+    target_cpu: String,
+    /// Count calls and time every function, plus runtime allocation/RC/channel/spawn counters; report at exit
+    #[arg(long)]
+    profile: bool,
+}
+
+impl CodegenArgs {
+    fn options(&self) -> CompileOptions {
+        // 取值范围已由 clap 校验
+        let opt_level = OptLevel::from_level(self.opt_level).unwrap_or_default();
+        CompileOptions::new(opt_level, self.target_cpu == "native").with_profile(self.profile)
+    }
+}
+
 fn main() -> miette::Result<()> {
     let cli = Cli::parse();
 
     match cli.command {
-        Some(Commands::Run { file }) => {
-            run_file(&file)?;
+        Some(Commands::Run { file, cache, codegen }) => {
+            run_file(&file, codegen.options(), cache)?;
         }
-        Some(Commands::Compile { file, output }) => {
+        Some(Commands::Compile { file, output, static_ffi, codegen }) => {
             let out = output.unwrap_or_else(|| file.with_extension("exe"));
-            compile_file(&file, &out)?;
+            compile_file(&file, &out, codegen.options(), static_ffi)?;
+        }
+        Some(Commands::Bench { file, warmup, iterations, codegen }) => {
+            bench_file(&file, codegen.options(), warmup, iterations)?;
         }
         None => {
             run_repl()?;
@@ -120,26 +143,84 @@ fn main() -> miette::Result<()> {
     Ok(())
 }
 
-fn run_file(file: &PathBuf) -> miette::Result<()> {
+fn run_file(file: &PathBuf, options: CompileOptions, use_cache: bool) -> miette::Result<()> {
     println!("Running: {}", file.display());
     let source = fs::read_to_string(file)
         .map_err(|e| miette::miette!("Failed to read file: {}", e))?;
 
+    // 缓存命中：直接运行之前编译好的程序，不解析也不编译
+    let cache = use_cache.then(|| CacheEntry::new(&source, &options));
+    if let Some(exe) = cache.as_ref().and_then(|c| c.lookup()) {
+        return run_executable(&exe);
+    }
+
     let ast = parse_source(&source)
         .map_err(|e| miette::miette!("Parse error: {}", e))?;
 
-    let mut compiler = JitCompiler::new();
+    // 缓存未命中：AOT 编译到缓存目录后运行，失败时退回 JIT
+    if let Some(ref cache) = cache {
+        match build_cached(cache, &ast, options) {
+            Ok(exe) => return run_executable(&exe),
+            Err(e) => eprintln!("Compile cache unavailable, falling back to JIT: {}", e),
+        }
+    }
+
+    let mut compiler = JitCompiler::with_options(options);
     let main_ptr = compiler.compile(&ast)
         .map_err(|e| miette::miette!("Compile error: {}", e))?;
 
     let main_fn: fn() -> i64 = unsafe { std::mem::transmute(main_ptr) };
     let result = main_fn();
+    // 运行时输出按线程缓冲，先刷出程序输出再打印结果
+    bolide_runtime::bolide_print_flush();
     println!("Result: {}", result);
     Ok(())
 }
 
+/// 运行基准测试
+fn bench_file(file: &PathBuf, options: CompileOptions, warmup: usize, iterations: usize) -> miette::Result<()> {
+    println!("Benchmarking: {}", file.display());
+    let source = fs::read_to_string(file)
+        .map_err(|e| miette::miette!("Failed to read file: {}", e))?;
+    let ast = parse_source(&source)
+        .map_err(|e| miette::miette!("Parse error: {}", e))?;
+
+    let results = bench::run(&ast, options, warmup, iterations)
+        .map_err(|e| miette::miette!("Compile error: {}", e))?;
+    bench::report(&results);
+    Ok(())
+}
+
+/// 编译并链接到缓存目录，返回可执行文件路径
+fn build_cached(cache: &CacheEntry, ast: &Program, options: CompileOptions) -> miette::Result<PathBuf> {
+    let exe = cache.prepare(ast).map_err(|e| miette::miette!("{}", e))?;
+    // 先链接到临时文件再改名，并发运行的进程不会看到写了一半的程序
+    let file_name = exe.file_name().unwrap_or_default().to_string_lossy().into_owned();
+    let tmp = exe.with_file_name(format!("{}.{}.tmp", file_name, std::process::id()));
+    // 缓存路径只输出程序自己的内容，不打印编译/链接过程
+    build_executable(ast, &tmp, options, false, true)?;
+    fs::rename(&tmp, &exe)
+        .map_err(|e| miette::miette!("Failed to store cached program: {}", e))?;
+    Ok(exe)
+}
+
+/// 运行缓存的程序
+///
+/// main 的返回值只能经由进程退出码传回（只剩低 8 位），与 JIT 打印的完整 i64 不同，
+/// 因此这里不打印 `Result:`，而是把非零退出码原样作为 bolide 的退出码。
+fn run_executable(exe: &Path) -> miette::Result<()> {
+    let status = Command::new(exe)
+        .status()
+        .map_err(|e| miette::miette!("Failed to run cached program: {}", e))?;
+    match status.code() {
+        Some(0) => Ok(()),
+        Some(code) => std::process::exit(code),
+        None => Err(miette::miette!("Cached program terminated by signal")),
+    }
+}
+
 /// AOT 编译文件
-fn compile_file(file: &PathBuf, output: &PathBuf) -> miette::Result<()> {
+fn compile_file(file: &PathBuf, output: &PathBuf, options: CompileOptions, static_ffi: bool) -> miette::Result<()> {
     println!("Compiling: {} -> {}", file.display(), output.display());
 
     // 读取源文件
@@ -150,15 +231,23 @@ fn compile_file(file: &PathBuf, output: &PathBuf) -> miette::Result<()> {
     let ast = parse_source(&source)
         .map_err(|e| miette::miette!("Parse error: {}", e))?;
 
+    build_executable(&ast, output, options, static_ffi, false)?;
+
+    println!("Successfully compiled: {}", output.display());
+    Ok(())
+}
+
+/// AOT 编译并链接为可执行文件（static_ffi: extern 库静态链接；quiet: 不打印编译过程信息）
+fn build_executable(ast: &Program, output: &PathBuf, options: CompileOptions, static_ffi: bool, quiet: bool) -> miette::Result<()> {
     // AOT 编译
-    let compiler = AotCompiler::new()
+    let compiler = AotCompiler::with_options(options)
         .map_err(|e| miette::miette!("Compiler init error: {}", e))?;
 
-    let result = compiler.compile(&ast)
+    let result = compiler.compile(ast)
         .map_err(|e| miette::miette!("Compile error: {}", e))?;
 
     // 打印外部库信息
-    if !result.extern_libs.is_empty() {
+    if !quiet && !result.extern_libs.is_empty() {
         println!("External libraries: {:?}", result.extern_libs);
     }
 
@@ -167,20 +256,20 @@ fn compile_file(file: &PathBuf, output: &PathBuf) -> miette::Result<()> {
     fs::write(&obj_path, &result.object_code)
         .map_err(|e| miette::miette!("Failed to write object file: {}", e))?;
 
-    println!("Generated object file: {}", obj_path.display());
+    if !quiet {
+        println!("Generated object file: {}", obj_path.display());
+    }
 
     // 链接
-    link_executable(&obj_path, output, &result.extern_libs)?;
+    link_executable(&obj_path, output, &result.extern_libs, static_ffi, quiet)?;
 
     // 清理目标文件
     let _ = fs::remove_file(&obj_path);
-
-    println!("Successfully compiled: {}", output.display());
     Ok(())
 }
 
 /// 查找运行时库路径
-fn find_runtime_lib() -> miette::Result<String> {
+fn find_runtime_lib(quiet: bool) -> miette::Result<String> {
     // 获取当前可执行文件路径
     let exe_path = std::env::current_exe()
         .map_err(|e| miette::miette!("Failed to get executable path: {}", e))?;
@@ -195,7 +284,9 @@ fn find_runtime_lib() -> miette::Result<String> {
 
     let lib_path = exe_dir.join(lib_name);
     if lib_path.exists() {
-        println!("Found runtime library: {}", lib_path.display());
+        if !quiet {
+            println!("Found runtime library: {}", lib_path.display());
+        }
         return Ok(lib_path.display().to_string());
     }
 
@@ -203,7 +294,9 @@ fn find_runtime_lib() -> miette::Result<String> {
     let debug_path = exe_dir.join("..").join(lib_name);
     if debug_path.exists() {
         let path = debug_path.canonicalize().unwrap();
-        println!("Found runtime library: {}", path.display());
+        if !quiet {
+            println!("Found runtime library: {}", path.display());
+        }
         return Ok(path.display().to_string());
     }
 
@@ -211,7 +304,9 @@ fn find_runtime_lib() -> miette::Result<String> {
     let cwd_path = PathBuf::from("target/debug").join(lib_name);
     if cwd_path.exists() {
         let path = cwd_path.canonicalize().unwrap();
-        println!("Found runtime library: {}", path.display());
+        if !quiet {
+            println!("Found runtime library: {}", path.display());
+        }
         return Ok(path.display().to_string());
     }
 
@@ -219,27 +314,33 @@ fn find_runtime_lib() -> miette::Result<String> {
 }
 
 /// 链接可执行文件
-fn link_executable(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) -> miette::Result<()> {
+///
+/// extern 函数由链接器直接绑定，调用与普通函数相同。static_ffi 只影响 Unix：
+/// Windows 上给出的 .lib 本身决定是静态库还是 DLL 导入库。
+fn link_executable(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String], static_ffi: bool, quiet: bool) -> miette::Result<()> {
     #[cfg(target_os = "windows")]
     {
-        link_windows(obj_path, output, extern_libs)
+        let _ = static_ffi;
+        link_windows(obj_path, output, extern_libs, quiet)
     }
 
     #[cfg(not(target_os = "windows"))]
     {
-        link_unix(obj_path, output, extern_libs)
+        link_unix(obj_path, output, extern_libs, static_ffi, quiet)
     }
 }
 
 #[cfg(target_os = "windows")]
-fn link_windows(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) -> miette::Result<()> {
+fn link_windows(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String], quiet: bool) -> miette::Result<()> {
     // 查找运行时库
-    let runtime_lib_path = PathBuf::from(find_runtime_lib()?);
+    let runtime_lib_path = PathBuf::from(find_runtime_lib(quiet)?);
     let runtime_lib_dir = runtime_lib_path.parent().unwrap().display().to_string();
     let runtime_lib_name = runtime_lib_path.file_name().unwrap().to_str().unwrap();
 
-    println!("Runtime lib dir: {}", runtime_lib_dir);
-    println!("Runtime lib name: {}", runtime_lib_name);
+    if !quiet {
+        println!("Runtime lib dir: {}", runtime_lib_dir);
+        println!("Runtime lib name: {}", runtime_lib_name);
+    }
 
     // 构建链接参数
     let libpath_arg = format!("/LIBPATH:{}", runtime_lib_dir);
@@ -272,11 +373,15 @@ fn link_windows(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) ->
         } else {
             lib.clone()
         };
-        println!("Adding external library: {}", lib_name);
+        if !quiet {
+            println!("Adding external library: {}", lib_name);
+        }
         args.push(lib_name);
     }
 
-    println!("Running lld-link...");
+    if !quiet {
+        println!("Running lld-link...");
+    }
     let status = Command::new("lld-link")
         .args(&args)
         .status()
@@ -290,8 +395,8 @@ fn link_windows(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) ->
 }
 
 #[cfg(not(target_os = "windows"))]
-fn link_unix(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) -> miette::Result<()> {
-    let runtime_lib = find_runtime_lib()?;
+fn link_unix(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String], static_ffi: bool, quiet: bool) -> miette::Result<()> {
+    let runtime_lib = find_runtime_lib(quiet)?;
 
     let mut args = vec![
         "-o".to_string(),
@@ -305,7 +410,10 @@ fn link_unix(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) -> mi
 
     // 添加外部库 (将 .so 转换为 -l 参数)
     for lib in extern_libs {
-        let lib_name = if lib.starts_with("lib") && lib.ends_with(".so") {
+        let lib_name = if static_ffi && lib.ends_with(".so") {
+            // libfoo.so -> -l:libfoo.a
+            format!("-l:{}.a", &lib[..lib.len()-3])
+        } else if lib.starts_with("lib") && lib.ends_with(".so") {
             // libfoo.so -> -lfoo
             format!("-l{}", &lib[3..lib.len()-3])
         } else if lib.ends_with(".so") {
@@ -315,7 +423,9 @@ fn link_unix(obj_path: &PathBuf, output: &PathBuf, extern_libs: &[String]) -> mi
             // 直接使用
             lib.clone()
         };
-        println!("Adding external library: {}", lib_name);
+        if !quiet {
+            println!("Adding external library: {}", lib_name);
+        }
         args.push(lib_name);
     }
 
@@ -424,59 +534,22 @@ fn print_help() {
 }
 
 fn eval_input(state: &mut ReplState, input: &str) -> Result<String, String> {
-    let input_type = state.add_input(input);
+    let input_type = classify_input(input);
+    let ast = parse_source(input).map_err(|e| e.to_string())?;
+    let entry = state.compiler.compile_incremental(&ast).map_err(|e| e.to_string())?;
 
     match input_type {
-        InputType::FuncDef => {
-            // 验证函数定义是否有效
-            let code = state.build_program(None);
-            let ast = parse_source(&code).map_err(|e| {
-                state.functions.pop();
-                e.to_string()
-            })?;
-            let mut compiler = JitCompiler::new();
-            compiler.compile(&ast).map_err(|e| {
-                state.functions.pop();
-                e.to_string()
-            })?;
-            Ok("Function defined.".to_string())
-        }
-        InputType::ClassDef => {
-            let code = state.build_program(None);
-            let ast = parse_source(&code).map_err(|e| {
-                state.functions.pop();
-                e.to_string()
-            })?;
-            let mut compiler = JitCompiler::new();
-            compiler.compile(&ast).map_err(|e| {
-                state.functions.pop();
-                e.to_string()
-            })?;
-            Ok("Class defined.".to_string())
-        }
-        InputType::VarDecl => {
-            // 验证变量声明是否有效
-            let code = state.build_program(None);
-            let ast = parse_source(&code).map_err(|e| {
-                state.globals.pop();
-                e.to_string()
-            })?;
-            let mut compiler = JitCompiler::new();
-            compiler.compile(&ast).map_err(|e| {
-                state.globals.pop();
-                e.to_string()
-            })?;
-            Ok("Variable declared.".to_string())
-        }
-        InputType::Expr => {
-            let code = state.build_program(Some(input));
-            let ast = parse_source(&code).map_err(|e| e.to_string())?;
-            let mut compiler = JitCompiler::new();
-            let main_ptr = compiler.compile(&ast).map_err(|e| e.to_string())?;
-            let main_fn: fn() -> i64 = unsafe { std::mem::transmute(main_ptr) };
+        InputType::FuncDef => Ok("Function defined.".to_string()),
+        InputType::ClassDef => Ok("Class defined.".to_string()),
+        InputType::VarDecl | InputType::Expr => {
+            // 变量声明在这里求值一次，值保存在全局数据段里供之后的输入使用
+            let main_fn: fn() -> i64 = unsafe { std::mem::transmute(entry) };
             let result = main_fn();
-            // 只有非零结果才显示（print等语句返回0）
-            if result != 0 {
+            bolide_runtime::bolide_print_flush();
+            if input_type == InputType::VarDecl {
+                Ok("Variable declared.".to_string())
+            } else if result != 0 {
+                // 只有非零结果才显示（print等语句返回0）
                 Ok(result.to_string())
             } else {
                 Ok(String::new())
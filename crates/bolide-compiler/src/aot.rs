@@ -5,10 +5,14 @@
 use cranelift::prelude::*;
 use cranelift::prelude::isa::{TargetIsa, CallConv};
 use cranelift_object::{ObjectBuilder, ObjectModule};
-use cranelift_module::{DataDescription, Linkage, Module, FuncId, DataId};
+use cranelift_module::{DataDescription, Linkage, Module, ModuleReloc, FuncId, DataId};
 use cranelift_codegen::ir::{FuncRef, StackSlotData, StackSlotKind};
+use cranelift_codegen::control::ControlPlane;
 use std::collections::{HashMap, HashSet};
 use std::path::Path;
+use std::sync::Mutex;
+use crate::options::CompileOptions;
+use crate::last_use::{self, LastUses};
 use bolide_parser::{Program, Statement, Expr, Type as BolideType, FuncDef, Param, ParamMode, ExternBlock, ExternDecl, CType, BinOp, UnaryOp};
 
 /// AOT 编译结果
@@ -27,6 +31,13 @@ struct TrampolineInfo {
     env_size: i64,
 }
 
+/// 已生成 IR、等待编译为机器码的函数
+struct PendingFunction {
+    name: String,
+    func_id: FuncId,
+    ctx: codegen::Context,
+}
+
 /// 类字段信息
 #[derive(Clone)]
 struct FieldInfo {
@@ -74,6 +85,12 @@ pub struct AotCompiler {
     lifetime_funcs: HashSet<String>,
     /// 字符串常量数据
     string_data: HashMap<String, DataId>,
+    /// 待编译为机器码的函数（IR 串行生成，机器码并行编译）
+    pending: Vec<PendingFunction>,
+    /// 剖析模式
+    profile: bool,
+    /// 剖析槽位 -> 函数名
+    profile_names: Vec<String>,
 }
 
 /// 运行时符号列表
@@ -83,9 +100,13 @@ pub const RUNTIME_SYMBOLS: &[&str] = &[
     "print_decimal", "print_string", "print_dynamic",
     // 用户输入
     "input", "input_prompt",
+    // 文件读写
+    "file_open", "file_create", "file_read_line", "file_eof",
+    "file_write", "file_write_line", "file_flush", "file_close",
     // BigInt
     "bigint_from_i64", "bigint_from_str", "bigint_add", "bigint_sub",
     "bigint_mul", "bigint_div", "bigint_rem", "bigint_neg",
+    "bigint_add_assign", "bigint_sub_assign", "bigint_mul_assign",
     "bigint_eq", "bigint_lt", "bigint_le", "bigint_gt", "bigint_ge",
     "bigint_to_i64", "bigint_clone", "bigint_debug_stats",
     // Decimal
@@ -97,15 +118,17 @@ pub const RUNTIME_SYMBOLS: &[&str] = &[
     "dynamic_from_int", "dynamic_from_float", "dynamic_from_bool",
     "dynamic_from_string", "dynamic_from_list", "dynamic_from_bigint",
     "dynamic_from_decimal", "dynamic_add", "dynamic_sub", "dynamic_mul",
-    "dynamic_div", "dynamic_neg", "dynamic_eq", "dynamic_lt", "dynamic_clone",
+    "dynamic_div", "dynamic_neg", "dynamic_eq", "dynamic_lt", "dynamic_le",
+    "dynamic_gt", "dynamic_ge", "dynamic_is_truthy", "dynamic_clone",
     // String
     "string_from_slice", "string_literal", "string_as_cstr", "string_concat",
+    "string_append", "string_len", "string_builder_new", "string_builder_append", "string_builder_finish",
     "string_eq", "string_from_int", "string_from_float", "string_from_bool",
     "string_from_bigint", "string_from_decimal", "string_to_int", "string_to_float",
     // Memory
     "bolide_alloc", "bolide_free",
     // Object
-    "object_alloc", "object_retain", "object_release", "object_clone",
+    "object_alloc", "object_retain", "object_release", "object_clone", "object_mark_shared", "object_share_field",
     // Thread
     "thread_spawn_int", "thread_spawn_float", "thread_spawn_ptr",
     "thread_spawn_int_with_env", "thread_spawn_float_with_env", "thread_spawn_ptr_with_env",
@@ -132,33 +155,41 @@ pub const RUNTIME_SYMBOLS: &[&str] = &[
     "tuple_new", "tuple_free", "tuple_set", "tuple_get", "tuple_len", "print_tuple",
     // FFI
     "ffi_load_library", "ffi_get_symbol", "ffi_cleanup", "test_callback", "map_int",
+    // Slab
+    "slab_debug_stats", "arena_enter", "arena_exit",
+    // Print
+    "print_flush",
+    // Profile
+    "profile_begin", "profile_enter", "profile_exit",
     // RC
     "string_retain", "string_release", "string_clone",
     "bigint_retain", "bigint_release",
     "decimal_retain", "decimal_release",
     "list_retain", "list_release", "list_clone",
+    "value_mark_shared",
     "list_new", "list_push", "list_pop", "list_len", "list_get", "list_set",
     "list_insert", "list_remove", "list_clear", "list_reverse", "list_extend",
     "list_contains", "list_index_of", "list_count", "list_sort", "list_slice",
     "list_is_empty", "list_first", "list_last", "print_list",
+    "list_sum_int", "list_sum_float", "list_min_int", "list_min_float",
+    "list_max_int", "list_max_float", "list_dot_int", "list_dot_float",
     // Dict
     "dict_new", "dict_retain", "dict_release", "dict_clone",
     "dict_set", "dict_get", "dict_contains", "dict_remove",
     "dict_len", "dict_is_empty", "dict_clear", "dict_keys", "dict_values",
-    "dict_iter", "print_dict",
+    "dict_iter", "dict_iter_next", "dict_key_at", "dict_value_at", "print_dict",
     "dynamic_retain", "dynamic_release",
 ];
 
 impl AotCompiler {
     /// 创建新的 AOT 编译器
     pub fn new() -> Result<Self, String> {
-        let isa_builder = cranelift_native::builder()
-            .map_err(|e| format!("Failed to create ISA builder: {}", e))?;
+        Self::with_options(CompileOptions::default())
+    }
 
-        let flag_builder = settings::builder();
-        let flags = settings::Flags::new(flag_builder);
-        let isa = isa_builder.finish(flags)
-            .map_err(|e| format!("Failed to create ISA: {}", e))?;
+    /// 按优化选项创建 AOT 编译器
+    pub fn with_options(options: CompileOptions) -> Result<Self, String> {
+        let isa = options.isa(false)?;
 
         let builder = ObjectBuilder::new(
             isa,
@@ -187,6 +218,9 @@ impl AotCompiler {
             modules: HashMap::new(),
             lifetime_funcs: HashSet::new(),
             string_data: HashMap::new(),
+            pending: Vec::new(),
+            profile: options.profile,
+            profile_names: Vec::new(),
         })
     }
 
@@ -369,6 +403,9 @@ impl AotCompiler {
             .into_iter()
             .collect();
 
+        // 并行编译所有函数的机器码
+        self.emit_pending()?;
+
         // 生成目标文件
         let product = self.module.finish();
         let object_code = product.emit().map_err(|e| format!("Emit error: {}", e))?;
@@ -594,6 +631,47 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("string_concat".to_string(), id);
 
+        // bolide_string_append(ptr, ptr) -> ptr (消费第一个参数，独占时原地追加)
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_string_append", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_append".to_string(), id);
+
+        // bolide_string_len(ptr) -> i64
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("bolide_string_len", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_len".to_string(), id);
+
+        // bolide_string_builder_new(i64) -> ptr
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(types::I64));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_string_builder_new", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_new".to_string(), id);
+
+        // bolide_string_builder_append(ptr, ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_string_builder_append", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_append".to_string(), id);
+
+        // bolide_string_builder_finish(ptr) -> ptr
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_string_builder_finish", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_finish".to_string(), id);
+
         // bolide_string_eq(ptr, ptr) -> i64
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -618,6 +696,13 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("string_clone".to_string(), id);
 
+        // bolide_value_mark_shared(ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_value_mark_shared", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("value_mark_shared".to_string(), id);
+
         // bolide_string_to_int(ptr) -> i64
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -658,7 +743,8 @@ impl AotCompiler {
         self.functions.insert("bigint_from_str".to_string(), id);
 
         // bigint 二元运算: add, sub, mul, div, rem
-        for op in &["add", "sub", "mul", "div", "rem"] {
+        // 原地运算 add_assign, sub_assign, mul_assign 签名相同（消费第一个参数）
+        for op in &["add", "sub", "mul", "div", "rem", "add_assign", "sub_assign", "mul_assign"] {
             let mut sig = self.module.make_signature();
             sig.params.push(AbiParam::new(ptr));
             sig.params.push(AbiParam::new(ptr));
@@ -703,9 +789,65 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("bigint_debug_stats".to_string(), id);
 
+        // bolide_slab_debug_stats() / bolide_arena_enter() / bolide_arena_exit() / bolide_print_flush() -> void
+        for (symbol, name) in [
+            ("bolide_slab_debug_stats", "slab_debug_stats"),
+            ("bolide_arena_enter", "arena_enter"),
+            ("bolide_arena_exit", "arena_exit"),
+            ("bolide_print_flush", "print_flush"),
+        ] {
+            let sig = self.module.make_signature();
+            let id = self.module.declare_function(symbol, Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        if self.profile {
+            self.register_profile_builtins()?;
+        }
+
         self.register_list_builtins()
     }
 
+    /// 剖析模式的运行时函数
+    fn register_profile_builtins(&mut self) -> Result<(), String> {
+        let ptr = self.ptr_type;
+
+        // bolide_profile_begin(names: ptr, len: i64) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("bolide_profile_begin", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("profile_begin".to_string(), id);
+
+        // bolide_profile_enter(slot: i64) -> i64
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(types::I64));
+        sig.returns.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("bolide_profile_enter", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("profile_enter".to_string(), id);
+
+        // bolide_profile_exit(slot: i64, start: i64) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(types::I64));
+        sig.params.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("bolide_profile_exit", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("profile_exit".to_string(), id);
+        Ok(())
+    }
+
+    /// 剖析模式下为函数分配槽位
+    fn profile_slot(&mut self, name: &str) -> Option<i64> {
+        if !self.profile {
+            return None;
+        }
+        self.profile_names.push(name.to_string());
+        Some(self.profile_names.len() as i64 - 1)
+    }
+
     fn register_list_builtins(&mut self) -> Result<(), String> {
         let ptr = self.ptr_type;
 
@@ -758,6 +900,29 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("list_release".to_string(), id);
 
+        // bolide_list_sort(ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("bolide_list_sort", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("list_sort".to_string(), id);
+
+        // bolide_list_{sum,min,max}_{int,float}(ptr) -> i64/f64, bolide_list_dot_*(ptr, ptr) -> i64/f64
+        for (suffix, ret) in [("int", types::I64), ("float", types::F64)] {
+            for op in ["sum", "min", "max", "dot"] {
+                let mut sig = self.module.make_signature();
+                sig.params.push(AbiParam::new(ptr));
+                if op == "dot" {
+                    sig.params.push(AbiParam::new(ptr));
+                }
+                sig.returns.push(AbiParam::new(ret));
+                let name = format!("list_{}_{}", op, suffix);
+                let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                    .map_err(|e| format!("{}", e))?;
+                self.functions.insert(name, id);
+            }
+        }
+
         self.register_memory_builtins()
     }
 
@@ -780,9 +945,10 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("bolide_free".to_string(), id);
 
-        // object_alloc(i64) -> ptr
+        // object_alloc(i64, ptr) -> ptr
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(types::I64));
+        sig.params.push(AbiParam::new(ptr));
         sig.returns.push(AbiParam::new(ptr));
         let id = self.module.declare_function("object_alloc", Linkage::Import, &sig)
             .map_err(|e| format!("{}", e))?;
@@ -795,6 +961,22 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("object_release".to_string(), id);
 
+        // object_mark_shared(ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("object_mark_shared", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("object_mark_shared".to_string(), id);
+
+        // object_share_field(obj, value, is_object) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("object_share_field", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("object_share_field".to_string(), id);
+
         self.register_tuple_builtins()
     }
 
@@ -873,6 +1055,83 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("dict_get".to_string(), id);
 
+        // 游标迭代: bolide_dict_iter_next / key_at / value_at(ptr, pos) -> i64
+        for name in ["dict_iter_next", "dict_key_at", "dict_value_at"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(types::I64));
+            sig.returns.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        self.register_dynamic_builtins()
+    }
+
+    fn register_dynamic_builtins(&mut self) -> Result<(), String> {
+        let ptr = self.ptr_type;
+
+        // bolide_dynamic_from_int / from_bool(i64) -> ptr, bolide_dynamic_from_float(f64) -> ptr
+        for (name, param) in [("dynamic_from_int", types::I64), ("dynamic_from_bool", types::I64), ("dynamic_from_float", types::F64)] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(param));
+            sig.returns.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // 装箱、一元运算与 RC: (ptr) -> ptr
+        for name in ["dynamic_from_string", "dynamic_from_list", "dynamic_from_bigint", "dynamic_from_decimal",
+                     "dynamic_neg", "dynamic_retain", "dynamic_clone"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // dynamic 算术(ptr, ptr) -> ptr
+        for name in ["dynamic_add", "dynamic_sub", "dynamic_mul", "dynamic_div"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // dynamic 比较(ptr, ptr) -> i64
+        for name in ["dynamic_eq", "dynamic_lt", "dynamic_le", "dynamic_gt", "dynamic_ge"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // bolide_dynamic_is_truthy(ptr) -> i64
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("bolide_dynamic_is_truthy", Linkage::Import, &sig)
+            .map_err(|e| format!("{}", e))?;
+        self.functions.insert("dynamic_is_truthy".to_string(), id);
+
+        // bolide_dynamic_release(ptr) / bolide_print_dynamic(ptr) -> void
+        for (linker_name, name) in [("bolide_dynamic_release", "dynamic_release"), ("bolide_print_dynamic", "print_dynamic")] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(linker_name, Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
         self.register_decimal_builtins()
     }
 
@@ -1025,6 +1284,42 @@ impl AotCompiler {
             .map_err(|e| format!("{}", e))?;
         self.functions.insert("scope_exit".to_string(), id);
 
+        self.register_file_builtins()
+    }
+
+    fn register_file_builtins(&mut self) -> Result<(), String> {
+        let ptr = self.ptr_type;
+
+        // bolide_file_open(ptr) / bolide_file_create(ptr) -> ptr
+        // bolide_file_read_line(ptr) -> ptr, bolide_file_eof(ptr) -> i64
+        for (name, returns) in [("file_open", ptr), ("file_create", ptr), ("file_read_line", ptr), ("file_eof", types::I64)] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(returns));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // bolide_file_write(ptr, ptr) / bolide_file_write_line(ptr, ptr) -> void
+        for name in ["file_write", "file_write_line"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // bolide_file_flush(ptr) / bolide_file_close(ptr) -> void
+        for name in ["file_flush", "file_close"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(&format!("bolide_{}", name), Linkage::Import, &sig)
+                .map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
         Ok(())
     }
 
@@ -1325,9 +1620,7 @@ impl AotCompiler {
 
         builder.finalize();
 
-        self.module.define_function(trampoline_id, &mut self.ctx)
-            .map_err(|e| format!("Define trampoline error: {}", e))?;
-        self.module.clear_context(&mut self.ctx);
+        self.defer_function(&trampoline_name, trampoline_id);
 
         self.trampolines.insert(func_name.to_string(), TrampolineInfo {
             func_id: trampoline_id,
@@ -1354,6 +1647,8 @@ impl AotCompiler {
         }
         sig.returns.push(AbiParam::new(self.ptr_type));
 
+        let layout_data = self.define_object_layout(&class_info)?;
+
         self.ctx.func.signature = sig;
         let mut fbc = FunctionBuilderContext::new();
         let mut builder = FunctionBuilder::new(&mut self.ctx.func, &mut fbc);
@@ -1367,7 +1662,14 @@ impl AotCompiler {
             .ok_or("object_alloc not found")?;
         let alloc_ref = self.module.declare_func_in_func(alloc_id, builder.func);
         let size = builder.ins().iconst(types::I64, class_info.size as i64);
-        let call = builder.ins().call(alloc_ref, &[size]);
+        let layout = match layout_data {
+            Some(data_id) => {
+                let gv = self.module.declare_data_in_func(data_id, builder.func);
+                builder.ins().symbol_value(self.ptr_type, gv)
+            }
+            None => builder.ins().iconst(self.ptr_type, 0),
+        };
+        let call = builder.ins().call(alloc_ref, &[size, layout]);
         let obj_ptr = builder.inst_results(call)[0];
 
         // 设置字段值
@@ -1380,12 +1682,44 @@ impl AotCompiler {
         builder.ins().return_(&[obj_ptr]);
         builder.finalize();
 
-        self.module.define_function(func_id, &mut self.ctx)
-            .map_err(|e| format!("Define constructor error: {}", e))?;
-        self.module.clear_context(&mut self.ctx);
+        self.defer_function(class_name, func_id);
         Ok(())
     }
 
+    /// 生成类的字段布局表：[条目数, (偏移 << 1 | 是否类对象)...]
+    /// 跨线程传递对象时 object_mark_shared 据此标记 RC 字段；没有 RC 字段时返回 None
+    fn define_object_layout(&mut self, class_info: &ClassInfo) -> Result<Option<DataId>, String> {
+        let mut entries = Vec::new();
+        for field in &class_info.fields {
+            let offset = (field.offset as u32) << 1;
+            match &field.ty {
+                BolideType::Custom(_) => entries.push(offset | bolide_runtime::LAYOUT_FIELD_OBJECT),
+                BolideType::Tuple(_) => {}
+                ty if AotCompileContext::is_rc_type(ty) => entries.push(offset),
+                _ => {}
+            }
+        }
+        if entries.is_empty() {
+            return Ok(None);
+        }
+
+        let big_endian = self.module.isa().endianness() == cranelift_codegen::ir::Endianness::Big;
+        let mut bytes = Vec::with_capacity((entries.len() + 1) * 4);
+        for word in std::iter::once(entries.len() as u32).chain(entries) {
+            let word = if big_endian { word.to_be_bytes() } else { word.to_le_bytes() };
+            bytes.extend_from_slice(&word);
+        }
+
+        let data_id = self.module.declare_anonymous_data(false, false)
+            .map_err(|e| format!("Failed to declare layout of '{}': {}", class_info.name, e))?;
+        self.data_desc.clear();
+        self.data_desc.define(bytes.into_boxed_slice());
+        self.data_desc.set_align(4);
+        self.module.define_data(data_id, &self.data_desc)
+            .map_err(|e| format!("Failed to define layout of '{}': {}", class_info.name, e))?;
+        Ok(Some(data_id))
+    }
+
     /// 编译类方法
     fn compile_class_methods(&mut self, program: &Program) -> Result<(), String> {
         for stmt in &program.statements {
@@ -1402,6 +1736,7 @@ impl AotCompiler {
         let method_name = format!("{}_{}", class_name, method.name);
         let func_id = *self.functions.get(&method_name)
             .ok_or_else(|| format!("Method {} not declared", method_name))?;
+        let profile_slot = self.profile_slot(&method_name);
 
         // Collect string literals and create data objects
         let strings = self.collect_strings_from_stmts(&method.body);
@@ -1456,6 +1791,11 @@ impl AotCompiler {
                 self.modules.clone(),
             );
 
+            ctx.last_uses = last_use::analyze(&method.body);
+            if let Some(slot) = profile_slot {
+                ctx.emit_profile_enter(slot, None)?;
+            }
+
             // 设置 self 参数
             let params: Vec<_> = ctx.builder.block_params(entry).to_vec();
             let self_var = ctx.declare_variable("self", self.ptr_type);
@@ -1482,6 +1822,7 @@ impl AotCompiler {
 
             // 如果没有显式返回，添加默认返回
             if !returned {
+                ctx.emit_profile_exit()?;
                 if method.return_type.is_some() {
                     let zero = ctx.builder.ins().iconst(types::I64, 0);
                     ctx.builder.ins().return_(&[zero]);
@@ -1492,9 +1833,7 @@ impl AotCompiler {
         }
 
         builder.finalize();
-        self.module.define_function(func_id, &mut self.ctx)
-            .map_err(|e| format!("Define method error: {}", e))?;
-        self.module.clear_context(&mut self.ctx);
+        self.defer_function(&method_name, func_id);
         Ok(())
     }
 
@@ -1503,6 +1842,15 @@ impl AotCompiler {
         let func_id = *self.functions.get(&func.name)
             .ok_or_else(|| format!("Function {} not declared", func.name))?;
 
+        // 剖析模式：main 最后编译，此时所有槽位都已分配，由它注册函数名表
+        let profile_slot = self.profile_slot(&func.name);
+        let profile_names = if profile_slot.is_some() && func.name == "main" {
+            let names = self.profile_names.join("\n");
+            Some((self.get_or_create_string_data(&names)?, names.len()))
+        } else {
+            None
+        };
+
         // Collect string literals and create data objects
         let strings = self.collect_strings_from_stmts(&func.body);
         let mut string_data_ids: HashMap<String, DataId> = HashMap::new();
@@ -1541,6 +1889,8 @@ impl AotCompiler {
             let gv = self.module.declare_data_in_func(*data_id, builder.func);
             string_globals.insert(s.clone(), (gv, s.len()));
         }
+        let profile_names = profile_names
+            .map(|(data_id, len)| (self.module.declare_data_in_func(data_id, builder.func), len));
 
         // 使用作用域来确保 ctx 在 finalize 之前被释放
         {
@@ -1555,6 +1905,11 @@ impl AotCompiler {
                 self.modules.clone(),
             );
 
+            ctx.last_uses = last_use::analyze(&func.body);
+            if let Some(slot) = profile_slot {
+                ctx.emit_profile_enter(slot, profile_names)?;
+            }
+
             // 设置参数变量
             let params: Vec<_> = ctx.builder.block_params(entry).to_vec();
             for (i, param) in func.params.iter().enumerate() {
@@ -1576,6 +1931,7 @@ impl AotCompiler {
 
             // 如果没有显式返回，添加默认返回
             if !returned {
+                ctx.emit_profile_exit()?;
                 if func.return_type.is_some() {
                     let zero = ctx.builder.ins().iconst(types::I64, 0);
                     ctx.builder.ins().return_(&[zero]);
@@ -1592,9 +1948,73 @@ impl AotCompiler {
             println!("{}", self.ctx.func.display());
         }
 
-        self.module.define_function(func_id, &mut self.ctx)
-            .map_err(|e| format!("Define function error in {}: {}", func.name, e))?;
-        self.module.clear_context(&mut self.ctx);
+        self.defer_function(&func.name, func_id);
+        Ok(())
+    }
+
+    /// 取走 ctx 中已生成的 IR，留到 emit_pending 统一编译
+    fn defer_function(&mut self, name: &str, func_id: FuncId) {
+        let ctx = std::mem::replace(&mut self.ctx, self.module.make_context());
+        self.pending.push(PendingFunction { name: name.to_string(), func_id, ctx });
+    }
+
+    /// 在线程池上把所有待编译函数的 IR 编译为机器码，再按声明顺序写入 ObjectModule
+    /// 各函数的编译互不依赖（调用关系只体现为重定位），只有写入模块需要串行
+    fn emit_pending(&mut self) -> Result<(), String> {
+        let mut pending = std::mem::take(&mut self.pending);
+        let threads = std::thread::available_parallelism()
+            .map_or(1, |n| n.get())
+            .min(pending.len());
+        let isa = self.module.isa();
+
+        let compile_one = |pf: &mut PendingFunction, ctrl_plane: &mut ControlPlane| {
+            pf.ctx.compile(isa, ctrl_plane)
+                .map(|_| ())
+                .map_err(|e| format!("Compile error in {}: {}", pf.name, e.inner))
+        };
+
+        if threads <= 1 {
+            let mut ctrl_plane = ControlPlane::default();
+            for pf in &mut pending {
+                compile_one(pf, &mut ctrl_plane)?;
+            }
+        } else {
+            // 工作队列：函数大小差别很大，按需领取比静态分块更均衡
+            let queue = Mutex::new(pending.iter_mut());
+            let results: Vec<Result<(), String>> = std::thread::scope(|scope| {
+                let workers: Vec<_> = (0..threads).map(|_| {
+                    scope.spawn(|| {
+                        let mut ctrl_plane = ControlPlane::default();
+                        loop {
+                            let next = queue.lock().unwrap().next();
+                            let Some(pf) = next else { return Ok(()) };
+                            compile_one(pf, &mut ctrl_plane)?;
+                        }
+                    })
+                }).collect();
+                workers.into_iter()
+                    .map(|w| w.join().unwrap_or_else(|_| Err("Codegen thread panicked".to_string())))
+                    .collect()
+            });
+            for result in results {
+                result?;
+            }
+        }
+
+        for pf in &pending {
+            let code = pf.ctx.compiled_code()
+                .ok_or_else(|| format!("Missing machine code for {}", pf.name))?;
+            let relocs: Vec<ModuleReloc> = code.buffer.relocs().iter()
+                .map(|reloc| ModuleReloc::from_mach_reloc(reloc, &pf.ctx.func, pf.func_id))
+                .collect();
+            self.module.define_function_bytes(
+                pf.func_id,
+                &pf.ctx.func,
+                code.buffer.alignment as u64,
+                code.code_buffer(),
+                &relocs,
+            ).map_err(|e| format!("Define function error in {}: {}", pf.name, e))?;
+        }
         Ok(())
     }
 }
@@ -1618,6 +2038,10 @@ struct AotCompileContext<'a, 'b> {
     rc_variables: Vec<(Variable, BolideType)>,
     /// Temporary RC values from expressions (to be released at statement end)
     temp_rc_values: Vec<(Value, BolideType)>,
+    /// 最后一次使用的变量读取（直接转移所有权，不 clone）
+    last_uses: LastUses,
+    /// 剖析模式：函数槽位和入口时间戳
+    profile: Option<(i64, Value)>,
 }
 
 impl<'a, 'b> AotCompileContext<'a, 'b> {
@@ -1645,9 +2069,42 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             modules,
             rc_variables: Vec::new(),
             temp_rc_values: Vec::new(),
+            last_uses: LastUses::new(),
+            profile: None,
         }
     }
 
+    /// 剖析模式的函数入口：计数一次调用并记下起始时间戳，
+    /// names 为函数名表时（只有 main）先开始剖析
+    fn emit_profile_enter(
+        &mut self,
+        slot: i64,
+        names: Option<(cranelift_codegen::ir::GlobalValue, usize)>,
+    ) -> Result<(), String> {
+        if let Some((gv, len)) = names {
+            let begin = *self.func_refs.get("profile_begin").ok_or("profile_begin not found")?;
+            let ptr = self.builder.ins().symbol_value(self.ptr_type, gv);
+            let len = self.builder.ins().iconst(types::I64, len as i64);
+            self.builder.ins().call(begin, &[ptr, len]);
+        }
+        let enter = *self.func_refs.get("profile_enter").ok_or("profile_enter not found")?;
+        let slot_val = self.builder.ins().iconst(types::I64, slot);
+        let call = self.builder.ins().call(enter, &[slot_val]);
+        let start = self.builder.inst_results(call)[0];
+        self.profile = Some((slot, start));
+        Ok(())
+    }
+
+    /// 剖析模式的函数返回：累加本次调用的耗时（在 return 指令之前调用）
+    fn emit_profile_exit(&mut self) -> Result<(), String> {
+        if let Some((slot, start)) = self.profile {
+            let exit = *self.func_refs.get("profile_exit").ok_or("profile_exit not found")?;
+            let slot_val = self.builder.ins().iconst(types::I64, slot);
+            self.builder.ins().call(exit, &[slot_val, start]);
+        }
+        Ok(())
+    }
+
     fn enter_scope(&self) -> usize {
         self.rc_variables.len()
     }
@@ -1695,6 +2152,52 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         }
     }
 
+    /// 跨线程传递时需要打 SHARED 标志的类型（参数不做 clone，与原线程共享）
+    /// 类对象自身是原子计数，但其 list/dict 等字段需要沿布局表标记
+    fn needs_share_mark(ty: &BolideType) -> bool {
+        Self::is_rc_type(ty) && !matches!(ty, BolideType::Tuple(_))
+    }
+
+    /// 参数值在传给其他线程后，是否仍可能被当前线程访问
+    /// 只有字面量和一元运算结果是新建的临时值；二元运算（如列表拼接）的结果与操作数共享元素，
+    /// 其余（变量、成员、索引、调用结果）也都视为逃逸
+    fn arg_escapes(expr: &Expr) -> bool {
+        match expr {
+            Expr::Int(_) | Expr::Float(_) | Expr::Bool(_) | Expr::None
+            | Expr::String(_) | Expr::BigInt(_) | Expr::Decimal(_)
+            | Expr::UnaryOp(..) => false,
+            Expr::List(items) | Expr::Tuple(items) => items.iter().any(Self::arg_escapes),
+            Expr::Dict(pairs) => pairs.iter().any(|(k, v)| Self::arg_escapes(k) || Self::arg_escapes(v)),
+            _ => true,
+        }
+    }
+
+    /// 对可能跨线程共享的 RC 值调用 value_mark_shared（类对象用 object_mark_shared），
+    /// 之后其计数走原子路径
+    fn emit_mark_shared(&mut self, val: Value, ty: &BolideType) -> Result<(), String> {
+        let mark_func = match ty {
+            BolideType::Custom(_) => "object_mark_shared",
+            _ => "value_mark_shared",
+        };
+        let mark_ref = *self.func_refs.get(mark_func)
+            .ok_or_else(|| format!("{} not found", mark_func))?;
+        self.builder.ins().call(mark_ref, &[val]);
+        Ok(())
+    }
+
+    /// 存入对象字段后调用 object_share_field：对象已跨线程共享时同时标记新值
+    /// （只处理布局表记录的字段，元组不带 RC 头）
+    fn emit_share_field(&mut self, obj: Value, val: Value, ty: &BolideType) -> Result<(), String> {
+        if matches!(ty, BolideType::Tuple(_)) || !Self::is_rc_type(ty) {
+            return Ok(());
+        }
+        let share_ref = *self.func_refs.get("object_share_field")
+            .ok_or("object_share_field not found")?;
+        let is_object = self.builder.ins().iconst(types::I64, matches!(ty, BolideType::Custom(_)) as i64);
+        self.builder.ins().call(share_ref, &[obj, val, is_object]);
+        Ok(())
+    }
+
     /// 检查类型是否需要 RC 管理
     fn is_rc_type(ty: &BolideType) -> bool {
         match ty {
@@ -1797,7 +2300,12 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         } else {
             if let Some(func_name) = Self::get_release_func_name(ty) {
                 if let Some(&func_ref) = self.func_refs.get(func_name) {
-                    self.builder.ins().call(func_ref, &[val]);
+                    // 剖析模式下释放都经过运行时，计数才完整
+                    if Self::has_inline_header(ty) && self.profile.is_none() {
+                        self.emit_inline_release(val, func_ref, ty);
+                    } else {
+                        self.builder.ins().call(func_ref, &[val]);
+                    }
                 }
             }
         }
@@ -1829,6 +2337,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             Expr::String(s) => self.compile_string_literal(s),
             Expr::BigInt(s) => self.compile_bigint_literal(s),
             Expr::Decimal(s) => self.compile_decimal_literal(s),
+            Expr::Ident(name) if self.last_uses.contains(&(expr as *const Expr)) => self.compile_last_use(name),
             Expr::Ident(name) => self.compile_ident(name),
             Expr::BinOp(left, op, right) => self.compile_binop(left, op, right),
             Expr::UnaryOp(op, operand) => self.compile_unary(op, operand),
@@ -2016,6 +2525,35 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         Err(format!("Undefined variable: {}", name))
     }
 
+    /// 变量的最后一次使用：本函数拥有的 RC 变量直接交出当前值并置空，
+    /// 代替 clone + 作用域结束时的 release；值作为临时值，没被消费就在语句末释放
+    fn compile_last_use(&mut self, name: &str) -> Result<Value, String> {
+        let owned = self.variables.get(name).copied()
+            .filter(|var| self.rc_variables.iter().any(|(v, _)| v == var));
+        let ty = self.var_types.get(name).cloned();
+        match (owned, ty) {
+            (Some(var), Some(ty)) if Self::is_rc_type(&ty) => {
+                let val = self.builder.use_var(var);
+                let null = self.builder.ins().iconst(self.ptr_type, 0);
+                self.builder.def_var(var, null);
+                self.track_temp_rc_value(val, &ty);
+                Ok(val)
+            }
+            _ => self.compile_ident(name),
+        }
+    }
+
+    /// 只读使用的操作数（方法接收者、下标/成员的基址、print 参数）：
+    /// 局部变量直接借用当前值，省掉 clone 和语句末的 release
+    fn compile_borrowed(&mut self, expr: &Expr) -> Result<Value, String> {
+        if let Expr::Ident(name) = expr {
+            if let Some(&var) = self.variables.get(name) {
+                return Ok(self.builder.use_var(var));
+            }
+        }
+        self.compile_expr(expr)
+    }
+
     /// 编译二元运算
     fn compile_binop(&mut self, left: &Expr, op: &BinOp, right: &Expr) -> Result<Value, String> {
         // 检查操作数类型以决定使用整数还是浮点运算
@@ -2030,6 +2568,13 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         let is_decimal = matches!(left_type, Some(BolideType::Decimal))
             || matches!(right_type, Some(BolideType::Decimal));
 
+        // Dynamic 运算：另一侧的静态类型值先装箱
+        if left_type == Some(BolideType::Dynamic) || right_type == Some(BolideType::Dynamic) {
+            let lhs = self.compile_dynamic_operand(left, &left_type)?;
+            let rhs = self.compile_dynamic_operand(right, &right_type)?;
+            return self.compile_dynamic_binop(lhs, op, rhs);
+        }
+
         // 字符串操作
         if is_string {
             return self.compile_string_binop(left, op, right);
@@ -2132,8 +2677,101 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         }
     }
 
+    /// 展开字符串 `+` 拼接链: ((a + b) + c) -> [a, b, c]
+    fn collect_concat_parts<'e>(&self, expr: &'e Expr, parts: &mut Vec<&'e Expr>) {
+        if let Expr::BinOp(left, BinOp::Add, right) = expr {
+            if self.infer_expr_type(left) == Some(BolideType::Str)
+                && self.infer_expr_type(right) == Some(BolideType::Str)
+            {
+                self.collect_concat_parts(left, parts);
+                self.collect_concat_parts(right, parts);
+                return;
+            }
+        }
+        parts.push(expr);
+    }
+
+    /// 识别 x = x op y（op 为 + - *，y 是 bigint 且不读取 x），返回对应的原地运算函数和 y
+    fn bigint_self_update<'e>(&self, var_name: &str, value: &'e Expr) -> Option<(&'static str, &'e Expr)> {
+        if let Expr::BinOp(left, op, right) = value {
+            let func_name = match op {
+                BinOp::Add => "bigint_add_assign",
+                BinOp::Sub => "bigint_sub_assign",
+                BinOp::Mul => "bigint_mul_assign",
+                _ => return None,
+            };
+            if matches!(left.as_ref(), Expr::Ident(name) if name == var_name)
+                && !Self::expr_refers_to(right, var_name)
+                && self.infer_expr_type(right) == Some(BolideType::BigInt)
+            {
+                return Some((func_name, right));
+            }
+        }
+        None
+    }
+
+    /// 表达式中是否引用了变量 name
+    fn expr_refers_to(expr: &Expr, name: &str) -> bool {
+        match expr {
+            Expr::Ident(n) | Expr::Recv(n) => n == name,
+            Expr::BinOp(left, _, right) | Expr::Index(left, right) => {
+                Self::expr_refers_to(left, name) || Self::expr_refers_to(right, name)
+            }
+            Expr::UnaryOp(_, inner) | Expr::Member(inner, _) | Expr::Await(inner) => {
+                Self::expr_refers_to(inner, name)
+            }
+            Expr::Call(callee, args) => {
+                Self::expr_refers_to(callee, name) || args.iter().any(|a| Self::expr_refers_to(a, name))
+            }
+            Expr::Spawn(_, items) | Expr::List(items) | Expr::Tuple(items) | Expr::AwaitAll(items) => {
+                items.iter().any(|e| Self::expr_refers_to(e, name))
+            }
+            Expr::Dict(pairs) => pairs.iter()
+                .any(|(k, v)| Self::expr_refers_to(k, name) || Self::expr_refers_to(v, name)),
+            _ => false,
+        }
+    }
+
+    /// 编译多段字符串拼接: 先求各段总长度，再用 StringBuilder 一次分配
+    fn compile_concat_chain(&mut self, parts: &[&Expr]) -> Result<Value, String> {
+        let new_ref = *self.func_refs.get("string_builder_new").ok_or("string_builder_new not found")?;
+        let append_ref = *self.func_refs.get("string_builder_append").ok_or("string_builder_append not found")?;
+        let finish_ref = *self.func_refs.get("string_builder_finish").ok_or("string_builder_finish not found")?;
+
+        let mut vals = Vec::with_capacity(parts.len());
+        for part in parts {
+            vals.push(self.compile_expr(part)?);
+        }
+
+        let mut total = self.builder.ins().iconst(types::I64, 0);
+        for &val in &vals {
+            let len = self.emit_len_field(val, bolide_runtime::STRING_LEN_OFFSET);
+            total = self.builder.ins().iadd(total, len);
+        }
+
+        let call = self.builder.ins().call(new_ref, &[total]);
+        let sb = self.builder.inst_results(call)[0];
+        for &val in &vals {
+            self.builder.ins().call(append_ref, &[sb, val]);
+        }
+        let call = self.builder.ins().call(finish_ref, &[sb]);
+        let result = self.builder.inst_results(call)[0];
+        self.track_temp_rc_value(result, &BolideType::Str);
+        Ok(result)
+    }
+
     /// 编译字符串二元运算
     fn compile_string_binop(&mut self, left: &Expr, op: &BinOp, right: &Expr) -> Result<Value, String> {
+        // 三段及以上的拼接链降级为 StringBuilder，只分配一次
+        if matches!(op, BinOp::Add) {
+            let mut parts = Vec::new();
+            self.collect_concat_parts(left, &mut parts);
+            self.collect_concat_parts(right, &mut parts);
+            if parts.len() >= 3 {
+                return self.compile_concat_chain(&parts);
+            }
+        }
+
         let lhs = self.compile_expr(left)?;
         let rhs = self.compile_expr(right)?;
 
@@ -2249,15 +2887,205 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         Ok(result)
     }
 
+    /// 编译赋给 target 类型的值：目标是 dynamic 而值是静态类型时先装箱
+    fn compile_expr_for(&mut self, value: &Expr, target: Option<&BolideType>) -> Result<Value, String> {
+        if target == Some(&BolideType::Dynamic) {
+            let value_ty = self.infer_expr_type(value);
+            if value_ty != Some(BolideType::Dynamic) {
+                return self.compile_dynamic_operand(value, &value_ty);
+            }
+        }
+        self.compile_expr(value)
+    }
+
+    /// 编译 dynamic 运算的操作数：int 字面量和 none 直接编码为立即数，其他静态类型值装箱
+    fn compile_dynamic_operand(&mut self, expr: &Expr, ty: &Option<BolideType>) -> Result<Value, String> {
+        match expr {
+            Expr::Int(n) if (i64::MIN >> 1..=i64::MAX >> 1).contains(n) => {
+                return Ok(self.builder.ins().iconst(self.ptr_type, (n << 1) | bolide_runtime::DYNAMIC_INT_TAG));
+            }
+            Expr::None => return Ok(self.builder.ins().iconst(self.ptr_type, bolide_runtime::DYNAMIC_NONE)),
+            _ => {}
+        }
+        let ty = ty.clone().unwrap_or(BolideType::Int);
+        let val = self.compile_expr(expr)?;
+        let func_name = match ty {
+            BolideType::Dynamic => return Ok(val),
+            BolideType::Int => return self.emit_dynamic_from_int(val),
+            BolideType::Float => "dynamic_from_float",
+            BolideType::Bool => "dynamic_from_bool",
+            BolideType::Str => "dynamic_from_string",
+            BolideType::BigInt => "dynamic_from_bigint",
+            BolideType::Decimal => "dynamic_from_decimal",
+            BolideType::List(_) => "dynamic_from_list",
+            _ => return Err(format!("Cannot convert {:?} to dynamic", ty)),
+        };
+        // 装箱后由 dynamic 持有引用：临时值直接交出，变量的值先 clone
+        let owned = if !Self::is_rc_type(&ty) {
+            val
+        } else if self.temp_rc_values.iter().any(|(v, _)| *v == val) {
+            self.remove_temp_rc_value(val);
+            val
+        } else if let Some(&clone_ref) = Self::get_clone_func_name(&ty).and_then(|name| self.func_refs.get(name)) {
+            let call = self.builder.ins().call(clone_ref, &[val]);
+            self.builder.inst_results(call)[0]
+        } else {
+            val
+        };
+        let func_ref = *self.func_refs.get(func_name)
+            .ok_or_else(|| format!("{} not found", func_name))?;
+        let call = self.builder.ins().call(func_ref, &[owned]);
+        let result = self.builder.inst_results(call)[0];
+        self.track_temp_rc_value(result, &BolideType::Dynamic);
+        Ok(result)
+    }
+
+    /// int 装箱为 dynamic：能放进 63 位时内联编码为立即数，否则调用 dynamic_from_int
+    fn emit_dynamic_from_int(&mut self, val: Value) -> Result<Value, String> {
+        let box_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, self.ptr_type);
+
+        let shifted = self.builder.ins().ishl_imm(val, 1);
+        let restored = self.builder.ins().sshr_imm(shifted, 1);
+        let fits = self.builder.ins().icmp(IntCC::Equal, restored, val);
+        let tagged = self.builder.ins().bor_imm(shifted, bolide_runtime::DYNAMIC_INT_TAG);
+        self.builder.ins().brif(fits, done_block, &[tagged], box_block, &[]);
+
+        self.builder.switch_to_block(box_block);
+        self.builder.seal_block(box_block);
+        let func_ref = *self.func_refs.get("dynamic_from_int")
+            .ok_or("dynamic_from_int not found")?;
+        let call = self.builder.ins().call(func_ref, &[val]);
+        let boxed = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[boxed]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        let result = self.builder.block_params(done_block)[0];
+        self.track_temp_rc_value(result, &BolideType::Dynamic);
+        Ok(result)
+    }
+
+    /// 编译 Dynamic 二元操作
+    ///
+    /// 两个操作数都是 int 立即数时直接在标记值上计算（与 bigint 小整数相同的恒等式，
+    /// 比较直接比较标记值），只有加减乘溢出、除法或其他类型组合才调用运行时。
+    fn compile_dynamic_binop(&mut self, lhs: Value, op: &BinOp, rhs: Value) -> Result<Value, String> {
+        let func_name = match op {
+            BinOp::Add => "dynamic_add",
+            BinOp::Sub => "dynamic_sub",
+            BinOp::Mul => "dynamic_mul",
+            BinOp::Div => "dynamic_div",
+            BinOp::Eq | BinOp::Ne => "dynamic_eq",
+            BinOp::Lt => "dynamic_lt",
+            BinOp::Le => "dynamic_le",
+            BinOp::Gt => "dynamic_gt",
+            BinOp::Ge => "dynamic_ge",
+            BinOp::Mod | BinOp::And | BinOp::Or => {
+                return Err(format!("Unsupported dynamic operation: {:?}", op));
+            }
+        };
+        let func_ref = *self.func_refs.get(func_name)
+            .ok_or_else(|| format!("{} not found", func_name))?;
+        let is_arithmetic = matches!(op, BinOp::Add | BinOp::Sub | BinOp::Mul | BinOp::Div);
+        let result_ty = if is_arithmetic { self.ptr_type } else { types::I64 };
+
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, result_ty);
+
+        if !matches!(op, BinOp::Div) {
+            let fast_block = self.builder.create_block();
+            let both = self.builder.ins().band(lhs, rhs);
+            let tag = self.builder.ins().band_imm(both, bolide_runtime::DYNAMIC_INT_TAG);
+            self.builder.ins().brif(tag, fast_block, &[], slow_block, &[]);
+
+            self.builder.switch_to_block(fast_block);
+            self.builder.seal_block(fast_block);
+            if is_arithmetic {
+                let (raw, overflow) = match op {
+                    // (2a+1) - 1 + (2b+1) = 2(a+b)+1
+                    BinOp::Add => {
+                        let untagged = self.builder.ins().bxor_imm(lhs, 1);
+                        self.builder.ins().sadd_overflow(untagged, rhs)
+                    }
+                    // (2a+1) - 2b = 2(a-b)+1
+                    BinOp::Sub => {
+                        let untagged = self.builder.ins().bxor_imm(rhs, 1);
+                        self.builder.ins().ssub_overflow(lhs, untagged)
+                    }
+                    // a * 2b + 1 = 2ab+1
+                    _ => {
+                        let a = self.builder.ins().sshr_imm(lhs, 1);
+                        let untagged = self.builder.ins().bxor_imm(rhs, 1);
+                        let (prod, overflow) = self.builder.ins().smul_overflow(a, untagged);
+                        (self.builder.ins().bor_imm(prod, 1), overflow)
+                    }
+                };
+                self.builder.ins().brif(overflow, slow_block, &[], done_block, &[raw]);
+            } else {
+                let cc = match op {
+                    BinOp::Lt => IntCC::SignedLessThan,
+                    BinOp::Le => IntCC::SignedLessThanOrEqual,
+                    BinOp::Gt => IntCC::SignedGreaterThan,
+                    BinOp::Ge => IntCC::SignedGreaterThanOrEqual,
+                    _ => IntCC::Equal,
+                };
+                let cmp = self.builder.ins().icmp(cc, lhs, rhs);
+                let res = self.builder.ins().uextend(types::I64, cmp);
+                self.builder.ins().jump(done_block, &[res]);
+            }
+        } else {
+            self.builder.ins().jump(slow_block, &[]);
+        }
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(func_ref, &[lhs, rhs]);
+        let res = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[res]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        let result = self.builder.block_params(done_block)[0];
+
+        if is_arithmetic {
+            self.track_temp_rc_value(result, &BolideType::Dynamic);
+            Ok(result)
+        } else if matches!(op, BinOp::Ne) {
+            let one = self.builder.ins().iconst(types::I64, 1);
+            Ok(self.builder.ins().isub(one, result))
+        } else {
+            Ok(result)
+        }
+    }
+
     /// 编译一元运算
     fn compile_unary(&mut self, op: &UnaryOp, operand: &Expr) -> Result<Value, String> {
         let operand_type = self.infer_expr_type(operand);
         let val = self.compile_expr(operand)?;
 
         match op {
+            UnaryOp::Not if operand_type == Some(BolideType::Dynamic) => {
+                let func_ref = *self.func_refs.get("dynamic_is_truthy")
+                    .ok_or("dynamic_is_truthy not found")?;
+                let call = self.builder.ins().call(func_ref, &[val]);
+                let truthy = self.builder.inst_results(call)[0];
+                let one = self.builder.ins().iconst(types::I64, 1);
+                Ok(self.builder.ins().isub(one, truthy))
+            }
             UnaryOp::Neg => {
                 match operand_type {
                     Some(BolideType::Float) => Ok(self.builder.ins().fneg(val)),
+                    Some(BolideType::Dynamic) => {
+                        let func_ref = *self.func_refs.get("dynamic_neg")
+                            .ok_or("dynamic_neg not found")?;
+                        let call = self.builder.ins().call(func_ref, &[val]);
+                        let result = self.builder.inst_results(call)[0];
+                        self.track_temp_rc_value(result, &BolideType::Dynamic);
+                        Ok(result)
+                    },
                     Some(BolideType::BigInt) => {
                         let func_ref = *self.func_refs.get("bigint_neg")
                             .ok_or("bigint_neg not found")?;
@@ -2355,44 +3183,254 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
 
     /// 编译列表方法
     fn compile_list_method(&mut self, base: &Expr, method_name: &str, args: &[Expr]) -> Result<Value, String> {
-        let list_val = self.compile_expr(base)?;
+        let elem_ty = match self.infer_expr_type(base) {
+            Some(BolideType::List(elem)) => *elem,
+            _ => BolideType::Int,
+        };
+        let list_val = self.compile_borrowed(base)?;
 
         match method_name {
             "len" => {
-                let func_ref = *self.func_refs.get("list_len").ok_or("list_len not found")?;
-                let call = self.builder.ins().call(func_ref, &[list_val]);
-                Ok(self.builder.inst_results(call)[0])
+                Ok(self.emit_len_field(list_val, bolide_runtime::LIST_LEN_OFFSET))
             }
             "push" => {
                 let func_ref = *self.func_refs.get("list_push").ok_or("list_push not found")?;
                 let val = self.compile_expr(&args[0])?;
                 // Consume value ownership
                 self.remove_temp_rc_value(val);
+                let val = self.to_list_slot(val);
                 self.builder.ins().call(func_ref, &[list_val, val]);
                 Ok(self.builder.ins().iconst(types::I64, 0))
             }
             "get" => {
-                let func_ref = *self.func_refs.get("list_get").ok_or("list_get not found")?;
                 let idx = self.compile_expr(&args[0])?;
-                let call = self.builder.ins().call(func_ref, &[list_val, idx]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.emit_list_get(list_val, idx)?;
+                Ok(self.from_list_slot(val, &elem_ty))
             }
             "set" => {
-                let func_ref = *self.func_refs.get("list_set").ok_or("list_set not found")?;
                 let idx = self.compile_expr(&args[0])?;
                 let val = self.compile_expr(&args[1])?;
                 // Consume value ownership
                 self.remove_temp_rc_value(val);
-                self.builder.ins().call(func_ref, &[list_val, idx, val]);
+                let val = self.to_list_slot(val);
+                self.emit_list_set(list_val, idx, val, &elem_ty)?;
                 Ok(self.builder.ins().iconst(types::I64, 0))
             }
+            "sort" => {
+                let func_ref = *self.func_refs.get("list_sort").ok_or("list_sort not found")?;
+                self.builder.ins().call(func_ref, &[list_val]);
+                Ok(self.builder.ins().iconst(types::I64, 0))
+            }
+            "sum" | "min" | "max" => self.compile_list_reduce(method_name, list_val, &elem_ty, None),
+            "dot" => {
+                if args.len() != 1 {
+                    return Err("dot expects 1 argument".to_string());
+                }
+                self.compile_list_reduce("dot", list_val, &elem_ty, Some(&args[0]))
+            }
             _ => Err(format!("Unknown list method: {}", method_name)),
         }
     }
 
+    // ==================== 内联快速路径 ====================
+    //
+    // len/下标读写和 RC 释放的常见情况按运行时 #[repr(C)] 布局的字段偏移直接生成 IR，
+    // null、越界、RC 元素写入、跨线程共享对象和最后一个引用仍调用运行时函数。
+
+    /// 内联读取对象的长度字段（列表/字典/字符串），null 视为 0
+    fn emit_len_field(&mut self, ptr: Value, offset: i32) -> Value {
+        let load_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+
+        let zero = self.builder.ins().iconst(types::I64, 0);
+        self.builder.ins().brif(ptr, load_block, &[], done_block, &[zero]);
+
+        self.builder.switch_to_block(load_block);
+        self.builder.seal_block(load_block);
+        let len = self.builder.ins().load(types::I64, MemFlags::trusted(), ptr, offset);
+        self.builder.ins().jump(done_block, &[len]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        self.builder.block_params(done_block)[0]
+    }
+
+    /// 列表元素槽位地址: data + index * 8
+    fn emit_list_slot_addr(&mut self, list: Value, index: Value) -> Value {
+        let data = self.builder.ins().load(self.ptr_type, MemFlags::trusted(), list, bolide_runtime::LIST_DATA_OFFSET);
+        let offset = self.builder.ins().ishl_imm(index, 3);
+        self.builder.ins().iadd(data, offset)
+    }
+
+    /// 内联 list[index]：下标在 [0, len) 内时直接读槽位，否则调用 list_get（越界返回 0）
+    fn emit_list_get(&mut self, list: Value, index: Value) -> Result<Value, String> {
+        let list_get = *self.func_refs.get("list_get").ok_or("list_get not found")?;
+        // 无符号比较同时排除负下标；null 列表长度为 0，也走慢路径
+        let len = self.emit_len_field(list, bolide_runtime::LIST_LEN_OFFSET);
+        let in_bounds = self.builder.ins().icmp(IntCC::UnsignedLessThan, index, len);
+
+        let fast_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+        self.builder.ins().brif(in_bounds, fast_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(fast_block);
+        self.builder.seal_block(fast_block);
+        let addr = self.emit_list_slot_addr(list, index);
+        let val = self.builder.ins().load(types::I64, MemFlags::trusted(), addr, 0);
+        self.builder.ins().jump(done_block, &[val]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(list_get, &[list, index]);
+        let val = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[val]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        Ok(self.builder.block_params(done_block)[0])
+    }
+
+    /// 内联 list[index] = value，返回是否成功
+    /// RC 元素要 retain 新值、release 旧值，和越界一样交给 list_set
+    fn emit_list_set(&mut self, list: Value, index: Value, value: Value, elem_ty: &BolideType) -> Result<Value, String> {
+        let list_set = *self.func_refs.get("list_set").ok_or("list_set not found")?;
+        if Self::is_rc_type(elem_ty) {
+            let call = self.builder.ins().call(list_set, &[list, index, value]);
+            return Ok(self.builder.inst_results(call)[0]);
+        }
+        let len = self.emit_len_field(list, bolide_runtime::LIST_LEN_OFFSET);
+        let in_bounds = self.builder.ins().icmp(IntCC::UnsignedLessThan, index, len);
+
+        let fast_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+        self.builder.ins().brif(in_bounds, fast_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(fast_block);
+        self.builder.seal_block(fast_block);
+        let addr = self.emit_list_slot_addr(list, index);
+        self.builder.ins().store(MemFlags::trusted(), value, addr, 0);
+        let one = self.builder.ins().iconst(types::I64, 1);
+        self.builder.ins().jump(done_block, &[one]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(list_set, &[list, index, value]);
+        let ok = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[ok]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        Ok(self.builder.block_params(done_block)[0])
+    }
+
+    /// 内联 RC 释放：对象未跨线程共享且计数大于 1 时直接减一；
+    /// 共享对象（原子计数）和最后一个引用（需要析构）调用运行时 release
+    fn emit_inline_release(&mut self, val: Value, release_ref: FuncRef, ty: &BolideType) {
+        let header_block = self.builder.create_block();
+        let unshared_block = self.builder.create_block();
+        let dec_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+
+        // null、内联小整数 bigint（最低位为 1）以及 dynamic 立即数（低 3 位非 0）没有对象头
+        let tag_mask = match ty {
+            BolideType::BigInt => Some(1),
+            BolideType::Dynamic => Some(bolide_runtime::DYNAMIC_TAG_MASK),
+            _ => None,
+        };
+        if let Some(mask) = tag_mask {
+            let tag_block = self.builder.create_block();
+            self.builder.ins().brif(val, tag_block, &[], done_block, &[]);
+            self.builder.switch_to_block(tag_block);
+            self.builder.seal_block(tag_block);
+            let tag = self.builder.ins().band_imm(val, mask);
+            self.builder.ins().brif(tag, done_block, &[], header_block, &[]);
+        } else {
+            self.builder.ins().brif(val, header_block, &[], done_block, &[]);
+        }
+
+        self.builder.switch_to_block(header_block);
+        self.builder.seal_block(header_block);
+        let flags = self.builder.ins().uload8(types::I32, MemFlags::trusted(), val, bolide_runtime::RC_FLAGS_OFFSET);
+        let shared = self.builder.ins().band_imm(flags, bolide_runtime::flags::SHARED as i64);
+        self.builder.ins().brif(shared, slow_block, &[], unshared_block, &[]);
+
+        self.builder.switch_to_block(unshared_block);
+        self.builder.seal_block(unshared_block);
+        let count = self.builder.ins().load(types::I32, MemFlags::trusted(), val, bolide_runtime::RC_STRONG_OFFSET);
+        let more = self.builder.ins().icmp_imm(IntCC::UnsignedGreaterThan, count, 1);
+        self.builder.ins().brif(more, dec_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(dec_block);
+        self.builder.seal_block(dec_block);
+        let dec = self.builder.ins().iadd_imm(count, -1);
+        self.builder.ins().store(MemFlags::trusted(), dec, val, bolide_runtime::RC_STRONG_OFFSET);
+        self.builder.ins().jump(done_block, &[]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        self.builder.ins().call(release_ref, &[val]);
+        self.builder.ins().jump(done_block, &[]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+    }
+
+    /// 可以内联释放的类型：对象头在指针处、与 RcHeader 布局相同
+    fn has_inline_header(ty: &BolideType) -> bool {
+        matches!(
+            ty,
+            BolideType::Str
+                | BolideType::BigInt
+                | BolideType::Decimal
+                | BolideType::List(_)
+                | BolideType::Dict(_, _)
+                | BolideType::Dynamic
+        )
+    }
+
+    /// 值写入列表槽位前的转换：槽位是 i64，float 按位存放
+    fn to_list_slot(&mut self, val: Value) -> Value {
+        if self.builder.func.dfg.value_type(val) == types::F64 {
+            self.builder.ins().bitcast(types::I64, MemFlags::new(), val)
+        } else {
+            val
+        }
+    }
+
+    /// 从列表槽位读出的值转换为元素类型
+    fn from_list_slot(&mut self, val: Value, elem_ty: &BolideType) -> Value {
+        if *elem_ty == BolideType::Float {
+            self.builder.ins().bitcast(types::F64, MemFlags::new(), val)
+        } else {
+            val
+        }
+    }
+
+    /// 编译列表归约: sum/min/max(list)、dot(a, b)，按元素类型选择 int/float 内核
+    fn compile_list_reduce(&mut self, op: &str, list_val: Value, elem_ty: &BolideType, other: Option<&Expr>) -> Result<Value, String> {
+        let suffix = if *elem_ty == BolideType::Float { "float" } else { "int" };
+        let name = format!("list_{}_{}", op, suffix);
+        let func_ref = *self.func_refs.get(&name)
+            .ok_or_else(|| format!("{} not found", name))?;
+        let call = if op == "dot" {
+            let other = other.ok_or("dot expects 2 lists")?;
+            let other_val = self.compile_expr(other)?;
+            self.builder.ins().call(func_ref, &[list_val, other_val])
+        } else {
+            self.builder.ins().call(func_ref, &[list_val])
+        };
+        Ok(self.builder.inst_results(call)[0])
+    }
+
     /// 编译字符串方法
     fn compile_string_method(&mut self, base: &Expr, method_name: &str, _args: &[Expr]) -> Result<Value, String> {
-        let _str_val = self.compile_expr(base)?;
+        let _str_val = self.compile_borrowed(base)?;
 
         match method_name {
             // 可以添加更多字符串方法
@@ -2417,6 +3455,23 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             "input" => return self.compile_input(args),
             "join" => return self.compile_join(args),
             "channel" => return self.compile_channel_create(args),
+            // sum/min/max(list)、dot(a, b) - 列表数值归约（不覆盖同名的用户函数）
+            "sum" | "min" | "max" | "dot" if !self.func_return_types.contains_key(name) => {
+                let expected = if name == "dot" { 2 } else { 1 };
+                if args.len() != expected {
+                    return Err(format!("{} expects {} argument(s)", name, expected));
+                }
+                let elem_ty = match self.infer_expr_type(&args[0]) {
+                    Some(BolideType::List(elem)) => *elem,
+                    other => return Err(format!("{} expects a list, got {:?}", name, other)),
+                };
+                let list_val = self.compile_expr(&args[0])?;
+                return self.compile_list_reduce(name, list_val, &elem_ty, args.get(1));
+            }
+            // 文件读写 - 句柄是不透明指针（ptr），不覆盖同名的用户函数
+            _ if Self::file_builtin_arity(name).is_some() && !self.func_return_types.contains_key(name) => {
+                return self.compile_file_call(name, args);
+            }
             _ => {}
         }
 
@@ -2471,7 +3526,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
 
     /// 编译 print 函数
     fn compile_print(&mut self, arg: &Expr) -> Result<Value, String> {
-        let val = self.compile_expr(arg)?;
+        let val = self.compile_borrowed(arg)?;
 
         // 使用类型推断来选择正确的打印函数
         let inferred_type = self.infer_expr_type(arg);
@@ -2723,6 +3778,40 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         }
     }
 
+    /// 文件读写内置函数的参数个数
+    fn file_builtin_arity(name: &str) -> Option<usize> {
+        match name {
+            "file_open" | "file_create" | "file_read_line" | "file_eof" | "file_flush" | "file_close" => Some(1),
+            "file_write" | "file_write_line" => Some(2),
+            _ => None,
+        }
+    }
+
+    /// 编译文件读写函数调用（参数都是借用）
+    fn compile_file_call(&mut self, name: &str, args: &[Expr]) -> Result<Value, String> {
+        let arity = Self::file_builtin_arity(name).ok_or_else(|| format!("{} not found", name))?;
+        if args.len() != arity {
+            return Err(format!("{}() expects {} argument(s)", name, arity));
+        }
+        let mut arg_vals = Vec::new();
+        for arg in args {
+            arg_vals.push(self.compile_borrowed(arg)?);
+        }
+        let func_ref = *self.func_refs.get(name)
+            .ok_or_else(|| format!("{} not found", name))?;
+        let call = self.builder.ins().call(func_ref, &arg_vals);
+        match self.builder.inst_results(call).first() {
+            Some(&result) => {
+                // 读到的行是新的字符串引用（借用文件内容），需要 RC 跟踪
+                if name == "file_read_line" {
+                    self.track_temp_rc_value(result, &BolideType::Str);
+                }
+                Ok(result)
+            }
+            None => Ok(self.builder.ins().iconst(types::I64, 0)),
+        }
+    }
+
     /// 编译 join() 函数
     fn compile_join(&mut self, args: &[Expr]) -> Result<Value, String> {
         if args.len() != 1 {
@@ -2756,23 +3845,20 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
     /// 编译索引访问
     fn compile_index(&mut self, base: &Expr, index: &Expr) -> Result<Value, String> {
         let base_type = self.infer_expr_type(base);
-        let base_val = self.compile_expr(base)?;
+        let base_val = self.compile_borrowed(base)?;
         let index_val = self.compile_expr(index)?;
 
         // 根据类型选择不同的索引函数
         // 根据类型选择不同的索引函数
         match base_type {
             Some(BolideType::List(elem_ty)) => {
-                let func_ref = *self.func_refs.get("list_get")
-                    .ok_or("list_get not found")?;
-                let call = self.builder.ins().call(func_ref, &[base_val, index_val]);
-                let val = self.builder.inst_results(call)[0];
+                let val = self.emit_list_get(base_val, index_val)?;
                 if Self::is_rc_type(&elem_ty) {
                     let retained = self.emit_retain(val, &elem_ty);
                     self.track_temp_rc_value(retained, &elem_ty);
                     Ok(retained)
                 } else {
-                    Ok(val)
+                    Ok(self.from_list_slot(val, &elem_ty))
                 }
             }
             Some(BolideType::Dict(_, val_ty)) => {
@@ -2827,7 +3913,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
 
     /// 编译成员访问
     fn compile_member(&mut self, base: &Expr, member: &str) -> Result<Value, String> {
-        let base_val = self.compile_expr(base)?;
+        let base_val = self.compile_borrowed(base)?;
 
         // 尝试获取基础表达式的类型
         let base_type = self.infer_expr_type(base);
@@ -2931,11 +4017,39 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
                         "float" => Some(BolideType::Float),
                         "str" => Some(BolideType::Str),
                         "input" => Some(BolideType::Str),
+                        file_fn if Self::file_builtin_arity(file_fn).is_some()
+                            && !self.func_return_types.contains_key(file_fn) =>
+                        {
+                            match file_fn {
+                                "file_open" | "file_create" => Some(BolideType::Ptr),
+                                "file_read_line" => Some(BolideType::Str),
+                                "file_eof" => Some(BolideType::Bool),
+                                _ => Some(BolideType::Int),
+                            }
+                        }
+                        "sum" | "min" | "max" | "dot"
+                            if !self.func_return_types.contains_key(name.as_str()) =>
+                        {
+                            match _args.first().and_then(|a| self.infer_expr_type(a)) {
+                                Some(BolideType::List(elem)) if *elem == BolideType::Float => Some(BolideType::Float),
+                                _ => Some(BolideType::Int),
+                            }
+                        }
                         _ => {
                             // Check user-defined function return types
                             self.func_return_types.get(name.as_str()).cloned().flatten()
                         }
                     }
+                } else if let Expr::Member(base, method) = callee.as_ref() {
+                    // 列表方法：取值与归约返回元素类型
+                    match self.infer_expr_type(base) {
+                        Some(BolideType::List(elem)) => match method.as_str() {
+                            "get" | "sum" | "min" | "max" | "dot" => Some(*elem),
+                            "len" => Some(BolideType::Int),
+                            _ => None,
+                        },
+                        _ => None,
+                    }
                 } else {
                     None
                 }
@@ -2951,6 +4065,12 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
                             _ => Some(BolideType::Int),
                         }
                     }
+                    (Some(BolideType::Dynamic), _) | (_, Some(BolideType::Dynamic)) => {
+                        match op {
+                            BinOp::Add | BinOp::Sub | BinOp::Mul | BinOp::Div | BinOp::Mod => Some(BolideType::Dynamic),
+                            _ => Some(BolideType::Bool),
+                        }
+                    }
                     (Some(BolideType::BigInt), _) | (_, Some(BolideType::BigInt)) => {
                         match op {
                             BinOp::Eq | BinOp::Ne | BinOp::Lt | BinOp::Le | BinOp::Gt | BinOp::Ge => Some(BolideType::Bool),
@@ -3011,7 +4131,12 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
     fn compile_list(&mut self, items: &[Expr]) -> Result<Value, String> {
         let func_ref = *self.func_refs.get("list_new")
             .ok_or("list_new not found")?;
-        let elem_type = self.builder.ins().iconst(types::I8, 0);
+        // 元素类型标签（与运行时 ElementType 一致），决定排序/归约内核
+        let elem_code = match items.first().and_then(|item| self.infer_expr_type(item)) {
+            Some(BolideType::Float) => 1,
+            _ => 0,
+        };
+        let elem_type = self.builder.ins().iconst(types::I8, elem_code);
         let call = self.builder.ins().call(func_ref, &[elem_type]);
         let list_ptr = self.builder.inst_results(call)[0];
 
@@ -3020,6 +4145,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         for item in items {
             let val = self.compile_expr(item)?;
             self.remove_temp_rc_value(val); // Consume value
+            let val = self.to_list_slot(val);
             self.builder.ins().call(push_ref, &[list_ptr, val]);
         }
 
@@ -3097,9 +4223,16 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         let env_ptr = self.builder.inst_results(call)[0];
 
         // 将参数存入 env
+        // 参数不做 clone，逃逸的 RC 值需标记为共享，之后其计数走原子路径
         for (i, arg) in args.iter().enumerate() {
+            let arg_ty = self.infer_expr_type(arg);
             let val = self.compile_expr(arg)?;
             let offset = (i * 8) as i32;
+            if let Some(ty) = &arg_ty {
+                if Self::needs_share_mark(ty) && Self::arg_escapes(arg) {
+                    self.emit_mark_shared(val, ty)?;
+                }
+            }
             self.builder.ins().store(MemFlags::new(), val, env_ptr, offset);
         }
 
@@ -3270,7 +4403,14 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         } else {
             return Err(format!("Channel not found: {}", send_stmt.channel));
         };
+        // 接收方可能在其他线程，逃逸的 RC 值需标记为共享
+        let val_ty = self.infer_expr_type(&send_stmt.value);
         let val = self.compile_expr(&send_stmt.value)?;
+        if let Some(ty) = &val_ty {
+            if Self::needs_share_mark(ty) && Self::arg_escapes(&send_stmt.value) {
+                self.emit_mark_shared(val, ty)?;
+            }
+        }
         let func_ref = *self.func_refs.get("channel_send")
             .ok_or("channel_send not found")?;
         self.builder.ins().call(func_ref, &[ch, val]);
@@ -3617,7 +4757,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         }
 
         if let Some(ref value) = decl.value {
-            let val = self.compile_expr(value)?;
+            let val = self.compile_expr_for(value, decl.ty.as_ref())?;
             
             // Take ownership if it's a temp RC value
             self.remove_temp_rc_value(val);
@@ -3642,7 +4782,45 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             Expr::Ident(var_name) => {
                 let var = *self.variables.get(var_name)
                     .ok_or_else(|| format!("Undefined variable: {}", var_name))?;
-                let val = self.compile_expr(&assign.value)?;
+
+                // s = s + a + ...：旧值交给 string_append 消费，s 独占时原地追加
+                // 右侧其余部分不能再读 s（否则会看到追加中途的值）
+                if self.var_types.get(var_name) == Some(&BolideType::Str) {
+                    let mut parts = Vec::new();
+                    self.collect_concat_parts(&assign.value, &mut parts);
+                    let is_self_append = parts.len() >= 2
+                        && matches!(parts[0], Expr::Ident(name) if name == var_name)
+                        && !parts[1..].iter().any(|part| Self::expr_refers_to(part, var_name));
+                    if is_self_append {
+                        let append_ref = *self.func_refs.get("string_append")
+                            .ok_or("string_append not found")?;
+                        let mut current = self.builder.use_var(var);
+                        for part in &parts[1..] {
+                            let part_val = self.compile_expr(part)?;
+                            let call = self.builder.ins().call(append_ref, &[current, part_val]);
+                            current = self.builder.inst_results(call)[0];
+                        }
+                        self.builder.def_var(var, current);
+                        return Ok(());
+                    }
+                }
+
+                // x = x + y（bigint）：旧值交给 bigint_*_assign 消费，小整数不分配，独占的堆对象原地更新
+                if self.var_types.get(var_name) == Some(&BolideType::BigInt) {
+                    if let Some((func_name, rhs)) = self.bigint_self_update(var_name, &assign.value) {
+                        let func_ref = *self.func_refs.get(func_name)
+                            .ok_or_else(|| format!("{} not found", func_name))?;
+                        let current = self.builder.use_var(var);
+                        let rhs_val = self.compile_expr(rhs)?;
+                        let call = self.builder.ins().call(func_ref, &[current, rhs_val]);
+                        let result = self.builder.inst_results(call)[0];
+                        self.builder.def_var(var, result);
+                        return Ok(());
+                    }
+                }
+
+                let target_ty = self.var_types.get(var_name).cloned();
+                let val = self.compile_expr_for(&assign.value, target_ty.as_ref())?;
                 
                 // Release old value if RC type
                 if let Some(ty) = self.var_types.get(var_name).cloned() {
@@ -3712,6 +4890,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
                         }
                         
                         self.builder.ins().store(MemFlags::new(), val, base_val, offset);
+                        self.emit_share_field(base_val, val, &field.ty)?;
                         return Ok(());
                     }
                 }
@@ -3723,16 +4902,23 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
 
     /// 编译索引赋值
     fn compile_index_assign(&mut self, base: &Expr, index: &Expr, value: &Expr) -> Result<(), String> {
+        let base_type = self.infer_expr_type(base);
         let base_val = self.compile_expr(base)?;
         let index_val = self.compile_expr(index)?;
         let val = self.compile_expr(value)?;
 
         // Consume value ownership
         self.remove_temp_rc_value(val);
+        let val = self.to_list_slot(val);
 
-        let func_ref = *self.func_refs.get("list_set")
-            .ok_or("list_set not found")?;
-        self.builder.ins().call(func_ref, &[base_val, index_val, val]);
+        // 元素类型已知时可内联写入非 RC 元素，否则交给 list_set
+        if let Some(BolideType::List(elem_ty)) = base_type {
+            self.emit_list_set(base_val, index_val, val, &elem_ty)?;
+        } else {
+            let func_ref = *self.func_refs.get("list_set")
+                .ok_or("list_set not found")?;
+            self.builder.ins().call(func_ref, &[base_val, index_val, val]);
+        }
         Ok(())
     }
 
@@ -3750,12 +4936,14 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             
             // Cleanup variables before returning
             self.emit_rc_cleanup();
+            self.emit_profile_exit()?;
             self.builder.ins().return_(&[val]);
         } else {
             // Release temporary values
             self.release_temp_rc_values();
             
             self.emit_rc_cleanup();
+            self.emit_profile_exit()?;
             self.builder.ins().return_(&[]);
         }
         Ok(())
@@ -3877,10 +5065,106 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             }
         }
 
+        // 字典迭代（按插入顺序）
+        if let Some(BolideType::Dict(_, _)) = self.infer_expr_type(&for_stmt.iter) {
+            return self.compile_dict_for(for_stmt);
+        }
+
         // 列表迭代
         self.compile_list_for(for_stmt)
     }
 
+    /// 编译 for k in dict / for k, v in dict 循环
+    ///
+    /// 通过游标直接遍历字典条目，不复制键列表。
+    fn compile_dict_for(&mut self, for_stmt: &bolide_parser::ForStmt) -> Result<(), String> {
+        let dict_val = self.compile_expr(&for_stmt.iter)?;
+        let (key_type, val_type) = match self.infer_expr_type(&for_stmt.iter) {
+            Some(BolideType::Dict(k, v)) => (*k, *v),
+            _ => (BolideType::Int, BolideType::Int),
+        };
+
+        let next_ref = *self.func_refs.get("dict_iter_next")
+            .ok_or("dict_iter_next not found")?;
+        let key_ref = *self.func_refs.get("dict_key_at")
+            .ok_or("dict_key_at not found")?;
+        let value_ref = *self.func_refs.get("dict_value_at")
+            .ok_or("dict_value_at not found")?;
+
+        // 游标位置
+        let pos_var = self.declare_variable("__for_pos", types::I64);
+        let zero = self.builder.ins().iconst(types::I64, 0);
+        self.builder.def_var(pos_var, zero);
+
+        let key_name = for_stmt.vars.first()
+            .ok_or("For loop requires at least one variable")?;
+        let mut bindings = vec![(key_name.clone(), key_type, key_ref)];
+        if let Some(value_name) = for_stmt.vars.get(1) {
+            bindings.push((value_name.clone(), val_type, value_ref));
+        }
+        let mut loop_vars = Vec::new();
+        for (name, ty, _) in &bindings {
+            let var = self.declare_variable(name, types::I64);
+            self.builder.def_var(var, zero);
+            self.var_types.insert(name.clone(), ty.clone());
+            loop_vars.push(var);
+        }
+
+        let header_block = self.builder.create_block();
+        let body_block = self.builder.create_block();
+        let exit_block = self.builder.create_block();
+
+        self.builder.ins().jump(header_block, &[]);
+
+        // 条件检查: pos = dict_iter_next(dict, pos) >= 0
+        self.builder.switch_to_block(header_block);
+        let pos = self.builder.use_var(pos_var);
+        let call = self.builder.ins().call(next_ref, &[dict_val, pos]);
+        let entry_pos = self.builder.inst_results(call)[0];
+        let cond = self.builder.ins().icmp_imm(IntCC::SignedGreaterThanOrEqual, entry_pos, 0);
+        self.builder.ins().brif(cond, body_block, &[], exit_block, &[]);
+
+        // 循环体
+        self.builder.switch_to_block(body_block);
+        self.builder.seal_block(body_block);
+
+        let scope_idx = self.enter_scope();
+        for ((name, ty, get_ref), var) in bindings.iter().zip(&loop_vars) {
+            let call = self.builder.ins().call(*get_ref, &[dict_val, entry_pos]);
+            let val = self.builder.inst_results(call)[0];
+            let val = if Self::is_rc_type(ty) {
+                self.track_rc_variable(name, ty);
+                self.emit_retain(val, ty)
+            } else {
+                val
+            };
+            self.builder.def_var(*var, val);
+        }
+
+        let mut body_returned = false;
+        for stmt in &for_stmt.body {
+            if self.compile_stmt(stmt)? {
+                body_returned = true;
+                break;
+            }
+        }
+
+        if !body_returned {
+            self.leave_scope(scope_idx);
+
+            let next_pos = self.builder.ins().iadd_imm(entry_pos, 1);
+            self.builder.def_var(pos_var, next_pos);
+            self.builder.ins().jump(header_block, &[]);
+        }
+
+        self.builder.seal_block(header_block);
+
+        self.builder.switch_to_block(exit_block);
+        self.builder.seal_block(exit_block);
+
+        Ok(())
+    }
+
     /// 编译 range for 循环
     fn compile_range_for(&mut self, for_stmt: &bolide_parser::ForStmt, args: &[Expr]) -> Result<(), String> {
         // 解析 range 参数: range(end) 或 range(start, end) 或 range(start, end, step)
@@ -3968,10 +5252,7 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         };
 
         // 获取列表长度
-        let len_ref = *self.func_refs.get("list_len")
-            .ok_or("list_len not found")?;
-        let call = self.builder.ins().call(len_ref, &[iter_val]);
-        let len = self.builder.inst_results(call)[0];
+        let len = self.emit_len_field(iter_val, bolide_runtime::LIST_LEN_OFFSET);
 
         // 创建索引变量
         let idx_var = self.declare_variable("__for_idx", types::I64);
@@ -3981,8 +5262,17 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
         // 创建循环变量
         let var_name = for_stmt.vars.first()
             .ok_or("For loop requires at least one variable")?;
-        let loop_var = self.declare_variable(var_name, types::I64);
-        self.builder.def_var(loop_var, zero);
+        // float 元素从槽位按位转换为 f64
+        let loop_var = if elem_type == BolideType::Float {
+            let v = self.declare_variable(var_name, types::F64);
+            let fzero = self.builder.ins().f64const(0.0);
+            self.builder.def_var(v, fzero);
+            v
+        } else {
+            let v = self.declare_variable(var_name, types::I64);
+            self.builder.def_var(v, zero);
+            v
+        };
         
         self.var_types.insert(var_name.clone(), elem_type.clone());
 
@@ -4007,16 +5297,14 @@ impl<'a, 'b> AotCompileContext<'a, 'b> {
             self.track_rc_variable(var_name, &elem_type);
         }
 
-        let get_ref = *self.func_refs.get("list_get")
-            .ok_or("list_get not found")?;
+        // 循环体可能修改列表，仍按当前长度检查下标
         let idx = self.builder.use_var(idx_var);
-        let call = self.builder.ins().call(get_ref, &[iter_val, idx]);
-        let elem = self.builder.inst_results(call)[0];
+        let elem = self.emit_list_get(iter_val, idx)?;
         
         let elem = if Self::is_rc_type(&elem_type) {
              self.emit_retain(elem, &elem_type)
         } else {
-             elem
+             self.from_list_slot(elem, &elem_type)
         };
         self.builder.def_var(loop_var, elem);
 
@@ -8,15 +8,39 @@ use cranelift_jit::{JITBuilder, JITModule};
 use cranelift_module::{DataDescription, Linkage, Module, FuncId};
 use cranelift_codegen::ir::{FuncRef, StackSlotData, StackSlotKind};
 use std::collections::{HashMap, HashSet};
+use crate::options::CompileOptions;
+use crate::last_use::{self, LastUses};
 use bolide_parser::{Program, Statement, Expr, BinOp, UnaryOp, Type as BolideType, FuncDef, VarDecl, Assign, Param, ParamMode, ClassDef, ClassField, ExternBlock};
 
 /// Trampoline 信息
+#[derive(Clone)]
 struct TrampolineInfo {
     func_id: FuncId,
     param_types: Vec<BolideType>,
     env_size: i64,
 }
 
+/// 增量单元开始前的名字表，单元编译失败时据此回滚
+struct UnitSnapshot {
+    /// 模块中已声明的函数个数（之后声明的都属于本单元）
+    declared_funcs: usize,
+    functions: HashMap<String, FuncId>,
+    func_return_types: HashMap<String, Option<BolideType>>,
+    func_params: HashMap<String, Vec<Param>>,
+    trampolines: HashMap<String, TrampolineInfo>,
+    classes: HashMap<String, ClassInfo>,
+    async_funcs: HashSet<String>,
+    extern_funcs: HashMap<String, (String, bolide_parser::ExternFunc)>,
+    extern_symbols: HashMap<String, usize>,
+    modules: HashMap<String, String>,
+    lifetime_funcs: HashSet<String>,
+    global_data_ids: HashMap<String, cranelift_module::DataId>,
+    global_var_types: HashMap<String, BolideType>,
+    func_names: HashMap<String, HashSet<String>>,
+    thread_globals: HashSet<String>,
+    profile_names: usize,
+}
+
 /// 类字段信息
 #[derive(Clone)]
 struct FieldInfo {
@@ -58,8 +82,8 @@ pub struct JitCompiler {
     async_funcs: HashSet<String>,
     /// extern 函数信息: 函数名 -> (库路径, 函数声明)
     extern_funcs: HashMap<String, (String, bolide_parser::ExternFunc)>,
-    /// 已加载的动态库
-    loaded_libs: HashMap<String, libloading::Library>,
+    /// extern 函数名 -> 注册 extern 块时解析好的函数地址
+    extern_symbols: HashMap<String, usize>,
     /// 模块名映射: 模块名 -> 文件路径
     modules: HashMap<String, String>,
     /// 使用生命周期模式的函数集合（返回借用而非拥有的值）
@@ -68,12 +92,33 @@ pub struct JitCompiler {
     global_data_ids: HashMap<String, cranelift_module::DataId>,
     /// 全局变量类型映射
     global_var_types: HashMap<String, BolideType>,
+    /// 函数名 -> 函数体中出现的名字（跨增量单元保留，用于找出其他线程访问的全局变量）
+    func_names: HashMap<String, HashSet<String>>,
+    /// 被 spawn/async 目标（及其调用的函数）访问的 RC 全局变量，赋值时标记共享
+    thread_globals: HashSet<String>,
+    /// 内置函数是否已声明（增量编译时只声明一次）
+    builtins_registered: bool,
+    /// 增量编译的入口函数计数器
+    entry_counter: usize,
+    /// 编译失败的增量单元在模块中留下的符号名（再次声明同名函数/全局变量时换用新符号）
+    abandoned_symbols: HashSet<String>,
+    /// 当前单元已经定义的函数
+    unit_defined: HashSet<FuncId>,
+    /// 剖析模式
+    profile: bool,
+    /// 剖析槽位 -> 函数名
+    profile_names: Vec<String>,
 }
 
 impl JitCompiler {
     pub fn new() -> Self {
-        let mut builder = JITBuilder::new(cranelift_module::default_libcall_names())
-            .expect("Failed to create JIT builder");
+        Self::with_options(CompileOptions::default())
+    }
+
+    /// 按优化选项创建 JIT 编译器
+    pub fn with_options(options: CompileOptions) -> Self {
+        let isa = options.isa(true).expect("Failed to create JIT ISA");
+        let mut builder = JITBuilder::with_isa(isa, cranelift_module::default_libcall_names());
 
         // 注册运行时函数 - 基本类型打印 (统一在 print.rs)
         builder.symbol("print_int", bolide_runtime::bolide_print_int as *const u8);
@@ -88,6 +133,16 @@ impl JitCompiler {
         builder.symbol("input", bolide_runtime::bolide_input as *const u8);
         builder.symbol("input_prompt", bolide_runtime::bolide_input_prompt as *const u8);
 
+        // 注册运行时函数 - 文件读写
+        builder.symbol("file_open", bolide_runtime::bolide_file_open as *const u8);
+        builder.symbol("file_create", bolide_runtime::bolide_file_create as *const u8);
+        builder.symbol("file_read_line", bolide_runtime::bolide_file_read_line as *const u8);
+        builder.symbol("file_eof", bolide_runtime::bolide_file_eof as *const u8);
+        builder.symbol("file_write", bolide_runtime::bolide_file_write as *const u8);
+        builder.symbol("file_write_line", bolide_runtime::bolide_file_write_line as *const u8);
+        builder.symbol("file_flush", bolide_runtime::bolide_file_flush as *const u8);
+        builder.symbol("file_close", bolide_runtime::bolide_file_close as *const u8);
+
         // 注册运行时函数 - BigInt
         builder.symbol("bigint_from_i64", bolide_runtime::bolide_bigint_from_i64 as *const u8);
         builder.symbol("bigint_from_str", bolide_runtime::bolide_bigint_from_str as *const u8);
@@ -97,6 +152,9 @@ impl JitCompiler {
         builder.symbol("bigint_div", bolide_runtime::bolide_bigint_div as *const u8);
         builder.symbol("bigint_rem", bolide_runtime::bolide_bigint_rem as *const u8);
         builder.symbol("bigint_neg", bolide_runtime::bolide_bigint_neg as *const u8);
+        builder.symbol("bigint_add_assign", bolide_runtime::bolide_bigint_add_assign as *const u8);
+        builder.symbol("bigint_sub_assign", bolide_runtime::bolide_bigint_sub_assign as *const u8);
+        builder.symbol("bigint_mul_assign", bolide_runtime::bolide_bigint_mul_assign as *const u8);
         builder.symbol("bigint_eq", bolide_runtime::bolide_bigint_eq as *const u8);
         builder.symbol("bigint_lt", bolide_runtime::bolide_bigint_lt as *const u8);
         builder.symbol("bigint_le", bolide_runtime::bolide_bigint_le as *const u8);
@@ -105,6 +163,13 @@ impl JitCompiler {
         builder.symbol("bigint_to_i64", bolide_runtime::bolide_bigint_to_i64 as *const u8);
         builder.symbol("bigint_clone", bolide_runtime::bolide_bigint_clone as *const u8);
         builder.symbol("bigint_debug_stats", bolide_runtime::bolide_bigint_debug_stats as *const u8);
+        builder.symbol("slab_debug_stats", bolide_runtime::bolide_slab_debug_stats as *const u8);
+        builder.symbol("arena_enter", bolide_runtime::bolide_arena_enter as *const u8);
+        builder.symbol("arena_exit", bolide_runtime::bolide_arena_exit as *const u8);
+        builder.symbol("print_flush", bolide_runtime::bolide_print_flush as *const u8);
+        builder.symbol("profile_begin", bolide_runtime::bolide_profile_begin as *const u8);
+        builder.symbol("profile_enter", bolide_runtime::bolide_profile_enter as *const u8);
+        builder.symbol("profile_exit", bolide_runtime::bolide_profile_exit as *const u8);
 
         // 注册运行时函数 - Decimal
         builder.symbol("decimal_from_i64", bolide_runtime::bolide_decimal_from_i64 as *const u8);
@@ -136,6 +201,11 @@ impl JitCompiler {
         builder.symbol("dynamic_neg", bolide_runtime::bolide_dynamic_neg as *const u8);
         builder.symbol("dynamic_eq", bolide_runtime::bolide_dynamic_eq as *const u8);
         builder.symbol("dynamic_lt", bolide_runtime::bolide_dynamic_lt as *const u8);
+        builder.symbol("dynamic_le", bolide_runtime::bolide_dynamic_le as *const u8);
+        builder.symbol("dynamic_gt", bolide_runtime::bolide_dynamic_gt as *const u8);
+        builder.symbol("dynamic_ge", bolide_runtime::bolide_dynamic_ge as *const u8);
+        builder.symbol("dynamic_is_truthy", bolide_runtime::bolide_dynamic_is_truthy as *const u8);
+        builder.symbol("dynamic_to_int", bolide_runtime::bolide_dynamic_to_int as *const u8);
         builder.symbol("dynamic_clone", bolide_runtime::bolide_dynamic_clone as *const u8);
 
         // 注册字符串函数
@@ -144,6 +214,11 @@ impl JitCompiler {
         builder.symbol("string_literal", bolide_runtime::bolide_string_literal as *const u8);
         builder.symbol("string_as_cstr", bolide_runtime::bolide_string_as_cstr as *const u8);
         builder.symbol("string_concat", bolide_runtime::bolide_string_concat as *const u8);
+        builder.symbol("string_append", bolide_runtime::bolide_string_append as *const u8);
+        builder.symbol("string_len", bolide_runtime::bolide_string_len as *const u8);
+        builder.symbol("string_builder_new", bolide_runtime::bolide_string_builder_new as *const u8);
+        builder.symbol("string_builder_append", bolide_runtime::bolide_string_builder_append as *const u8);
+        builder.symbol("string_builder_finish", bolide_runtime::bolide_string_builder_finish as *const u8);
         builder.symbol("string_eq", bolide_runtime::bolide_string_eq as *const u8);
 
         // 注册类型转换函数
@@ -161,6 +236,8 @@ impl JitCompiler {
 
         // 注册对象运行时函数
         builder.symbol("object_alloc", bolide_runtime::object_alloc as *const u8);
+        builder.symbol("object_mark_shared", bolide_runtime::object_mark_shared as *const u8);
+        builder.symbol("object_share_field", bolide_runtime::object_share_field as *const u8);
         builder.symbol("object_retain", bolide_runtime::object_retain as *const u8);
         builder.symbol("object_release", bolide_runtime::object_release as *const u8);
         builder.symbol("object_clone", bolide_runtime::object_clone as *const u8);
@@ -253,6 +330,7 @@ impl JitCompiler {
         builder.symbol("list_retain", bolide_runtime::bolide_list_retain as *const u8);
         builder.symbol("list_release", bolide_runtime::bolide_list_release as *const u8);
         builder.symbol("list_clone", bolide_runtime::bolide_list_clone as *const u8);
+        builder.symbol("value_mark_shared", bolide_runtime::bolide_value_mark_shared as *const u8);
         builder.symbol("list_new", bolide_runtime::bolide_list_new as *const u8);
         builder.symbol("list_push", bolide_runtime::bolide_list_push as *const u8);
         builder.symbol("list_pop", bolide_runtime::bolide_list_pop as *const u8);
@@ -268,6 +346,14 @@ impl JitCompiler {
         builder.symbol("list_index_of", bolide_runtime::bolide_list_index_of as *const u8);
         builder.symbol("list_count", bolide_runtime::bolide_list_count as *const u8);
         builder.symbol("list_sort", bolide_runtime::bolide_list_sort as *const u8);
+        builder.symbol("list_sum_int", bolide_runtime::bolide_list_sum_int as *const u8);
+        builder.symbol("list_sum_float", bolide_runtime::bolide_list_sum_float as *const u8);
+        builder.symbol("list_min_int", bolide_runtime::bolide_list_min_int as *const u8);
+        builder.symbol("list_min_float", bolide_runtime::bolide_list_min_float as *const u8);
+        builder.symbol("list_max_int", bolide_runtime::bolide_list_max_int as *const u8);
+        builder.symbol("list_max_float", bolide_runtime::bolide_list_max_float as *const u8);
+        builder.symbol("list_dot_int", bolide_runtime::bolide_list_dot_int as *const u8);
+        builder.symbol("list_dot_float", bolide_runtime::bolide_list_dot_float as *const u8);
         builder.symbol("list_slice", bolide_runtime::bolide_list_slice as *const u8);
         builder.symbol("list_is_empty", bolide_runtime::bolide_list_is_empty as *const u8);
         builder.symbol("list_first", bolide_runtime::bolide_list_first as *const u8);
@@ -288,6 +374,9 @@ impl JitCompiler {
         builder.symbol("dict_keys", bolide_runtime::bolide_dict_keys as *const u8);
         builder.symbol("dict_values", bolide_runtime::bolide_dict_values as *const u8);
         builder.symbol("dict_iter", bolide_runtime::bolide_dict_iter as *const u8);
+        builder.symbol("dict_iter_next", bolide_runtime::bolide_dict_iter_next as *const u8);
+        builder.symbol("dict_key_at", bolide_runtime::bolide_dict_key_at as *const u8);
+        builder.symbol("dict_value_at", bolide_runtime::bolide_dict_value_at as *const u8);
         builder.symbol("print_dict", bolide_runtime::bolide_print_dict as *const u8);
         builder.symbol("dynamic_retain", bolide_runtime::bolide_dynamic_retain as *const u8);
         builder.symbol("dynamic_release", bolide_runtime::bolide_dynamic_release as *const u8);
@@ -312,21 +401,162 @@ impl JitCompiler {
             classes: HashMap::new(),
             async_funcs: HashSet::new(),
             extern_funcs: HashMap::new(),
-            loaded_libs: HashMap::new(),
+            extern_symbols: HashMap::new(),
             modules: HashMap::new(),
             lifetime_funcs: HashSet::new(),
             global_data_ids: HashMap::new(),
             global_var_types: HashMap::new(),
+            func_names: HashMap::new(),
+            thread_globals: HashSet::new(),
+            builtins_registered: false,
+            entry_counter: 0,
+            abandoned_symbols: HashSet::new(),
+            unit_defined: HashSet::new(),
+            profile: options.profile,
+            profile_names: Vec::new(),
         }
     }
 
     /// 编译程序并返回入口函数指针
     pub fn compile(&mut self, program: &Program) -> Result<*const u8, String> {
+        self.compile_unit(program, "__main__")
+    }
+
+    /// 增量编译（REPL）：在同一个 JITModule 上只编译 program 中新增的定义，
+    /// 顶层语句包装成新的入口函数。之前编译过的函数、类和全局变量（包括它们的值）
+    /// 继续可用，每次输入的编译量与历史长度无关。
+    ///
+    /// 编译失败时回滚本单元的声明并丢弃半成品 IR，之前的定义保持可用。
+    pub fn compile_incremental(&mut self, program: &Program) -> Result<*const u8, String> {
+        self.entry_counter += 1;
+        let entry_name = format!("__entry_{}__", self.entry_counter);
+        let snapshot = self.unit_snapshot();
+        self.unit_defined.clear();
+        match self.compile_unit(program, &entry_name) {
+            Ok(entry) => {
+                let (functions, globals) = (&self.functions, &self.global_data_ids);
+                self.abandoned_symbols.retain(|name| !functions.contains_key(name) && !globals.contains_key(name));
+                Ok(entry)
+            }
+            Err(e) => {
+                self.rollback_unit(snapshot)?;
+                Err(e)
+            }
+        }
+    }
+
+    /// 记录增量单元开始前的编译器状态
+    fn unit_snapshot(&self) -> UnitSnapshot {
+        UnitSnapshot {
+            declared_funcs: self.module.declarations().get_functions().count(),
+            functions: self.functions.clone(),
+            func_return_types: self.func_return_types.clone(),
+            func_params: self.func_params.clone(),
+            trampolines: self.trampolines.clone(),
+            classes: self.classes.clone(),
+            async_funcs: self.async_funcs.clone(),
+            extern_funcs: self.extern_funcs.clone(),
+            extern_symbols: self.extern_symbols.clone(),
+            modules: self.modules.clone(),
+            lifetime_funcs: self.lifetime_funcs.clone(),
+            global_data_ids: self.global_data_ids.clone(),
+            global_var_types: self.global_var_types.clone(),
+            func_names: self.func_names.clone(),
+            thread_globals: self.thread_globals.clone(),
+            profile_names: self.profile_names.len(),
+        }
+    }
+
+    /// 撤销失败单元：清掉半成品函数，恢复名字表
+    ///
+    /// 模块里的声明无法删除：本单元声明但没定义的函数补一个 trap 桩，让之后的 finalize
+    /// 能解析已定义函数里对它们的引用；本单元引入的名字记入 abandoned_symbols，
+    /// 以后重新定义时使用新符号。
+    fn rollback_unit(&mut self, snapshot: UnitSnapshot) -> Result<(), String> {
+        self.module.clear_context(&mut self.ctx);
+        self.data_desc.clear();
+
+        let undefined: Vec<FuncId> = self.module.declarations().get_functions()
+            .skip(snapshot.declared_funcs)
+            .filter(|(id, decl)| decl.linkage != Linkage::Import && !self.unit_defined.contains(id))
+            .map(|(id, _)| id)
+            .collect();
+        for func_id in undefined {
+            self.define_trap_stub(func_id)?;
+        }
+
+        for name in self.functions.keys().filter(|name| !snapshot.functions.contains_key(*name))
+            .chain(self.global_data_ids.keys().filter(|name| !snapshot.global_data_ids.contains_key(*name)))
+        {
+            self.abandoned_symbols.insert(name.clone());
+        }
+
+        self.functions = snapshot.functions;
+        self.func_return_types = snapshot.func_return_types;
+        self.func_params = snapshot.func_params;
+        self.trampolines = snapshot.trampolines;
+        self.classes = snapshot.classes;
+        self.async_funcs = snapshot.async_funcs;
+        self.extern_funcs = snapshot.extern_funcs;
+        self.extern_symbols = snapshot.extern_symbols;
+        self.modules = snapshot.modules;
+        self.lifetime_funcs = snapshot.lifetime_funcs;
+        self.global_data_ids = snapshot.global_data_ids;
+        self.global_var_types = snapshot.global_var_types;
+        self.func_names = snapshot.func_names;
+        self.thread_globals = snapshot.thread_globals;
+        self.profile_names.truncate(snapshot.profile_names);
+        Ok(())
+    }
+
+    /// 定义一个直接 trap 的函数体
+    fn define_trap_stub(&mut self, func_id: FuncId) -> Result<(), String> {
+        self.ctx.func.signature = self.module.declarations().get_function_decl(func_id).signature.clone();
+        self.ctx.func.name = cranelift_codegen::ir::UserFuncName::user(0, func_id.as_u32());
+
+        let mut builder_ctx = FunctionBuilderContext::new();
+        let mut builder = FunctionBuilder::new(&mut self.ctx.func, &mut builder_ctx);
+        let block = builder.create_block();
+        builder.append_block_params_for_function_params(block);
+        builder.switch_to_block(block);
+        builder.seal_block(block);
+        builder.ins().trap(TrapCode::unwrap_user(1));
+        builder.finalize();
+
+        self.module.define_function(func_id, &mut self.ctx)
+            .map_err(|e| format!("Define function error: {}", e))?;
+        self.module.clear_context(&mut self.ctx);
+        Ok(())
+    }
+
+    /// 函数/全局变量在模块中的符号名：名字被失败的单元占用过时加上单元序号
+    fn symbol_name(&self, name: &str) -> String {
+        if self.abandoned_symbols.contains(name) {
+            format!("{}__unit{}", name, self.entry_counter)
+        } else {
+            name.to_string()
+        }
+    }
+
+    /// 已编译的 Bolide 函数的入口指针（在 compile 之后调用，内置函数和未定义的名字返回 None）
+    pub fn get_function(&self, name: &str) -> Option<*const u8> {
+        if !self.func_params.contains_key(name) {
+            return None;
+        }
+        let func_id = *self.functions.get(name)?;
+        Some(self.module.get_finalized_function(func_id))
+    }
+
+    /// 编译一个单元：定义其中的函数/类/全局变量，顶层语句编译为入口函数 entry_name
+    fn compile_unit(&mut self, program: &Program, entry_name: &str) -> Result<*const u8, String> {
         // 预处理 import 语句，加载并合并导入的模块
         let program = self.process_imports(program)?;
 
         // 注册内置函数
-        self.register_builtins()?;
+        if !self.builtins_registered {
+            self.register_builtins()?;
+            self.builtins_registered = true;
+        }
 
         // 先处理所有 extern 块（必须在函数声明之前）
         for stmt in &program.statements {
@@ -335,8 +565,14 @@ impl JitCompiler {
             }
         }
 
-        // 收集所有类定义
+        // 收集所有类定义（之前单元里的类已经编译过，只处理本单元新增的）
         self.collect_classes(&program)?;
+        let unit_classes: Vec<String> = program.statements.iter()
+            .filter_map(|stmt| match stmt {
+                Statement::ClassDef(class_def) => Some(class_def.name.clone()),
+                _ => None,
+            })
+            .collect();
 
         // 第一遍：收集所有函数声明（包括类构造函数）
         for stmt in &program.statements {
@@ -350,8 +586,8 @@ impl JitCompiler {
         }
 
         // 声明类构造函数
-        for class_name in self.classes.keys().cloned().collect::<Vec<_>>() {
-            self.declare_class_constructor(&class_name)?;
+        for class_name in &unit_classes {
+            self.declare_class_constructor(class_name)?;
         }
 
         // 声明类方法
@@ -363,10 +599,11 @@ impl JitCompiler {
 
         // 收集并声明全局变量（顶层 VarDecl）
         self.collect_global_variables(&program)?;
+        self.collect_thread_globals(&program, &spawn_targets);
 
         // 编译类构造函数
-        for class_name in self.classes.keys().cloned().collect::<Vec<_>>() {
-            self.compile_class_constructor(&class_name)?;
+        for class_name in &unit_classes {
+            self.compile_class_constructor(class_name)?;
         }
 
         // 编译类方法
@@ -388,9 +625,9 @@ impl JitCompiler {
             }
         }
 
-        // 将顶层代码包装成 __main__ 函数
+        // 将顶层代码包装成入口函数
         let main_func = FuncDef {
-            name: "__main__".to_string(),
+            name: entry_name.to_string(),
             is_async: false,
             params: vec![],
             return_type: Some(BolideType::Int),
@@ -403,9 +640,9 @@ impl JitCompiler {
         self.module.finalize_definitions()
             .map_err(|e| format!("Finalize error: {}", e))?;
 
-        // 获取 __main__ 函数
-        let func_id = self.functions.get("__main__")
-            .ok_or("No __main__ function found")?;
+        // 获取入口函数
+        let func_id = self.functions.get(entry_name)
+            .ok_or_else(|| format!("No {} function found", entry_name))?;
         let main_ptr = self.module.get_finalized_function(*func_id);
         Ok(main_ptr)
     }
@@ -426,7 +663,7 @@ impl JitCompiler {
         }
 
         let func_id = self.module
-            .declare_function(&func.name, Linkage::Export, &sig)
+            .declare_function(&self.symbol_name(&func.name), Linkage::Export, &sig)
             .map_err(|e| format!("Declare function error: {}", e))?;
 
         self.functions.insert(func.name.clone(), func_id);
@@ -695,9 +932,19 @@ impl JitCompiler {
                     BolideType::Int
                 };
 
+                // 增量编译时重复声明的全局变量复用已有数据段，初始化按赋值编译
+                if let Some(existing) = self.global_var_types.get(&decl.name) {
+                    if *existing != var_type {
+                        return Err(format!(
+                            "Global '{}' is already declared with type {:?}", decl.name, existing
+                        ));
+                    }
+                    continue;
+                }
+
                 // 为全局变量创建数据段（8 字节用于存储值）
                 let data_id = self.module
-                    .declare_data(&decl.name, Linkage::Local, true, false)
+                    .declare_data(&self.symbol_name(&decl.name), Linkage::Local, true, false)
                     .map_err(|e| format!("Failed to declare global '{}': {}", decl.name, e))?;
 
                 // 初始化数据段为 0
@@ -902,6 +1149,32 @@ impl JitCompiler {
         let id = self.module.declare_function("input_prompt", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("input_prompt".to_string(), id);
 
+        // ===== 文件读写函数 =====
+        // file_open(path) / file_create(path) -> ptr
+        // file_read_line(ptr) -> ptr, file_eof(ptr) -> i64
+        for (name, returns) in [("file_open", ptr), ("file_create", ptr), ("file_read_line", ptr), ("file_eof", types::I64)] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(returns));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+        // file_write(ptr, ptr) / file_write_line(ptr, ptr) -> void
+        for name in ["file_write", "file_write_line"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+        // file_flush(ptr) / file_close(ptr) -> void
+        for name in ["file_flush", "file_close"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
         // ===== 类型转换函数 =====
         // string_from_int(i64) -> ptr
         let mut sig = self.module.make_signature();
@@ -1012,6 +1285,12 @@ impl JitCompiler {
         let id = self.module.declare_function("list_clone", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("list_clone".to_string(), id);
 
+        // value_mark_shared(ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("value_mark_shared", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("value_mark_shared".to_string(), id);
+
         // list_new(elem_type: u8) -> ptr
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(types::I8));
@@ -1122,6 +1401,21 @@ impl JitCompiler {
         let id = self.module.declare_function("list_sort", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("list_sort".to_string(), id);
 
+        // list_{sum,min,max}_{int,float}(list: ptr) -> i64/f64, list_dot_*(a: ptr, b: ptr) -> i64/f64
+        for (suffix, ret) in [("int", types::I64), ("float", types::F64)] {
+            for op in ["sum", "min", "max", "dot"] {
+                let mut sig = self.module.make_signature();
+                sig.params.push(AbiParam::new(ptr));
+                if op == "dot" {
+                    sig.params.push(AbiParam::new(ptr));
+                }
+                sig.returns.push(AbiParam::new(ret));
+                let name = format!("list_{}_{}", op, suffix);
+                let id = self.module.declare_function(&name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+                self.functions.insert(name, id);
+            }
+        }
+
         // list_slice(list: ptr, start: i64, end: i64) -> ptr
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1259,6 +1553,16 @@ impl JitCompiler {
         let id = self.module.declare_function("dict_iter", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("dict_iter".to_string(), id);
 
+        // dict_iter_next / dict_key_at / dict_value_at(dict: ptr, pos: i64) -> i64 (游标迭代)
+        for name in ["dict_iter_next", "dict_key_at", "dict_value_at"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(types::I64));
+            sig.returns.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
         // print_dict(dict: ptr) -> void
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1314,6 +1618,16 @@ impl JitCompiler {
         let id = self.module.declare_function("bigint_mul", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("bigint_mul".to_string(), id);
 
+        // bigint_{add,sub,mul}_assign(ptr, ptr) -> ptr  (x = x op y，消费 x，独占时原地更新)
+        for name in ["bigint_add_assign", "bigint_sub_assign", "bigint_mul_assign"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
         // bigint_div(ptr, ptr) -> ptr
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1358,6 +1672,36 @@ impl JitCompiler {
         let id = self.module.declare_function("bigint_debug_stats", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("bigint_debug_stats".to_string(), id);
 
+        // slab_debug_stats() / arena_enter() / arena_exit() / print_flush() -> void
+        for name in ["slab_debug_stats", "arena_enter", "arena_exit", "print_flush"] {
+            let sig = self.module.make_signature();
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        if self.profile {
+            // profile_begin(names: ptr, len: i64) -> void
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function("profile_begin", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert("profile_begin".to_string(), id);
+
+            // profile_enter(slot: i64) -> i64
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(types::I64));
+            sig.returns.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function("profile_enter", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert("profile_enter".to_string(), id);
+
+            // profile_exit(slot: i64, start: i64) -> void
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(types::I64));
+            sig.params.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function("profile_exit", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert("profile_exit".to_string(), id);
+        }
+
         // ===== Decimal 函数 =====
         // decimal_from_i64(i64) -> ptr
         let mut sig = self.module.make_signature();
@@ -1504,6 +1848,39 @@ impl JitCompiler {
         let id = self.module.declare_function("dynamic_div", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("dynamic_div".to_string(), id);
 
+        // dynamic_from_bool(i64) -> ptr
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(types::I64));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("dynamic_from_bool", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("dynamic_from_bool".to_string(), id);
+
+        // dynamic_from_bigint / from_decimal / neg(ptr) -> ptr
+        for name in ["dynamic_from_bigint", "dynamic_from_decimal", "dynamic_neg"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(ptr));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // dynamic 比较(ptr, ptr) -> i64
+        for name in ["dynamic_eq", "dynamic_lt", "dynamic_le", "dynamic_gt", "dynamic_ge"] {
+            let mut sig = self.module.make_signature();
+            sig.params.push(AbiParam::new(ptr));
+            sig.params.push(AbiParam::new(ptr));
+            sig.returns.push(AbiParam::new(types::I64));
+            let id = self.module.declare_function(name, Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+            self.functions.insert(name.to_string(), id);
+        }
+
+        // dynamic_is_truthy(ptr) -> i64
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("dynamic_is_truthy", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("dynamic_is_truthy".to_string(), id);
+
         // print_dynamic(ptr) -> void
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1556,6 +1933,42 @@ impl JitCompiler {
         let id = self.module.declare_function("string_concat", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("string_concat".to_string(), id);
 
+        // string_append(ptr, ptr) -> ptr  (s = s + x，消费 s，独占时原地追加)
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("string_append", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_append".to_string(), id);
+
+        // string_len(ptr) -> i64
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("string_len", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_len".to_string(), id);
+
+        // string_builder_new(capacity: i64) -> ptr
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(types::I64));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("string_builder_new", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_new".to_string(), id);
+
+        // string_builder_append(sb: ptr, s: ptr) -> void
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("string_builder_append", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_append".to_string(), id);
+
+        // string_builder_finish(sb: ptr) -> ptr
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.returns.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("string_builder_finish", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("string_builder_finish".to_string(), id);
+
         // string_eq(ptr, ptr) -> i64  (字符串比较)
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1956,9 +2369,10 @@ impl JitCompiler {
         self.functions.insert("map_int".to_string(), id);
 
         // ===== Object 函数 =====
-        // object_alloc(size) -> ptr
+        // object_alloc(size, layout) -> ptr
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(types::I64));
+        sig.params.push(AbiParam::new(ptr));
         sig.returns.push(AbiParam::new(ptr));
         let id = self.module.declare_function("object_alloc", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("object_alloc".to_string(), id);
@@ -1969,6 +2383,20 @@ impl JitCompiler {
         let id = self.module.declare_function("object_release", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
         self.functions.insert("object_release".to_string(), id);
 
+        // object_mark_shared(ptr)
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        let id = self.module.declare_function("object_mark_shared", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("object_mark_shared".to_string(), id);
+
+        // object_share_field(obj, value, is_object)
+        let mut sig = self.module.make_signature();
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(ptr));
+        sig.params.push(AbiParam::new(types::I64));
+        let id = self.module.declare_function("object_share_field", Linkage::Import, &sig).map_err(|e| format!("{}", e))?;
+        self.functions.insert("object_share_field".to_string(), id);
+
         // object_retain(ptr)
         let mut sig = self.module.make_signature();
         sig.params.push(AbiParam::new(ptr));
@@ -1990,6 +2418,18 @@ impl JitCompiler {
         let func_id = *self.functions.get(&func.name)
             .ok_or_else(|| format!("Function {} not declared", func.name))?;
 
+        // 剖析模式：入口函数最后编译，此时所有槽位都已分配，由它注册函数名表
+        let profile_slot = self.profile.then(|| {
+            self.profile_names.push(func.name.clone());
+            self.profile_names.len() as i64 - 1
+        });
+        let profile_names: Option<&'static [u8]> = if profile_slot.is_some() && func.name == "__main__" {
+            let names: Box<[u8]> = self.profile_names.join("\n").into_bytes().into();
+            Some(Box::leak(names))
+        } else {
+            None
+        };
+
         // 预先计算参数类型
         let param_types: Vec<types::Type> = func.params.iter()
             .map(|p| self.bolide_type_to_cranelift(&p.ty))
@@ -2041,6 +2481,7 @@ impl JitCompiler {
         let classes = self.classes.clone();
         let async_funcs = self.async_funcs.clone();
         let extern_funcs = self.extern_funcs.clone();
+        let extern_symbols = self.extern_symbols.clone();
         let modules = self.modules.clone();
 
         let lifetime_funcs = self.lifetime_funcs.clone();
@@ -2051,6 +2492,7 @@ impl JitCompiler {
             &mut self.module,
             &self.global_data_ids,
             &self.global_var_types,
+            &self.thread_globals,
             func_refs,
             func_return_types,
             func_params,
@@ -2061,12 +2503,21 @@ impl JitCompiler {
             classes,
             async_funcs,
             extern_funcs,
+            extern_symbols,
             modules,
             func.lifetime_deps.clone(),
             func.name.clone(),
             lifetime_funcs,
         );
 
+        // 生命周期模式不做 RC，不需要移动分析
+        if !compile_ctx.uses_lifetime_mode() {
+            compile_ctx.last_uses = last_use::analyze(&func.body);
+        }
+        if let Some(slot) = profile_slot {
+            compile_ctx.emit_profile_enter(slot, profile_names)?;
+        }
+
         // 绑定参数到变量
         let params = compile_ctx.builder.block_params(entry_block).to_vec();
 
@@ -2120,6 +2571,7 @@ impl JitCompiler {
 
             // 写回 Ref 参数
             compile_ctx.write_back_ref_params();
+            compile_ctx.emit_profile_exit()?;
 
             if let Some(ref ret_ty) = func.return_type {
                 let zero = match ret_ty {
@@ -2138,11 +2590,12 @@ impl JitCompiler {
         self.module.define_function(func_id, &mut self.ctx)
             .map_err(|e| format!("Define function error: {}", e))?;
         self.module.clear_context(&mut self.ctx);
+        self.unit_defined.insert(func_id);
 
         Ok(())
     }
 
-    /// 收集需要 trampoline 的 spawn 目标函数
+    /// 收集 spawn 和 async 调用的目标函数（在其他线程上执行）
     fn collect_spawn_targets(&self, program: &Program) -> Vec<String> {
         let mut targets = Vec::new();
         for stmt in &program.statements {
@@ -2230,13 +2683,7 @@ impl JitCompiler {
     fn collect_spawn_targets_in_expr(&self, expr: &Expr, targets: &mut Vec<String>) {
         match expr {
             Expr::Spawn(func_name, args) => {
-                // 只有带参数的 spawn 需要 trampoline
-                if !args.is_empty() {
-                    // 检查目标函数存在且有参数
-                    if self.func_params.get(func_name).map(|p| !p.is_empty()).unwrap_or(false) {
-                        targets.push(func_name.clone());
-                    }
-                }
+                targets.push(func_name.clone());
                 for arg in args {
                     self.collect_spawn_targets_in_expr(arg, targets);
                 }
@@ -2251,10 +2698,8 @@ impl JitCompiler {
             Expr::Call(callee, args) => {
                 // 检查是否是 async 函数调用
                 if let Expr::Ident(func_name) = callee.as_ref() {
-                    if self.async_funcs.contains(func_name) && !args.is_empty() {
-                        if self.func_params.get(func_name).map(|p| !p.is_empty()).unwrap_or(false) {
-                            targets.push(func_name.clone());
-                        }
+                    if self.async_funcs.contains(func_name) {
+                        targets.push(func_name.clone());
                     }
                 }
                 self.collect_spawn_targets_in_expr(callee, targets);
@@ -2278,10 +2723,45 @@ impl JitCompiler {
         }
     }
 
-    /// 为目标函数生成 trampoline
+    /// 从 spawn/async 目标出发，沿函数调用找出其他线程会访问的 RC 全局变量
+    ///
+    /// 这些全局变量的值不经过参数传递，标记只能在赋值时进行（见 compile_var_assign）。
+    /// 类方法体不在分析范围内。
+    fn collect_thread_globals(&mut self, program: &Program, targets: &[String]) {
+        for stmt in &program.statements {
+            if let Statement::FuncDef(func) = stmt {
+                self.func_names.insert(func.name.clone(), last_use::referenced_names(&func.body));
+            }
+        }
+
+        let mut found = Vec::new();
+        let mut visited = HashSet::new();
+        let mut stack: Vec<&str> = targets.iter().map(String::as_str).collect();
+        while let Some(func) = stack.pop() {
+            if !visited.insert(func) {
+                continue;
+            }
+            for name in self.func_names.get(func).into_iter().flatten() {
+                if self.func_names.contains_key(name) {
+                    stack.push(name);
+                } else if self.global_var_types.get(name).map_or(false, |ty| CompileContext::needs_share_mark(ty, false)) {
+                    found.push(name.clone());
+                }
+            }
+        }
+        self.thread_globals.extend(found);
+    }
+
+    /// 为带参数的目标函数生成 trampoline
     fn generate_trampolines(&mut self, targets: &[String]) -> Result<(), String> {
         for func_name in targets {
-            self.create_trampoline(func_name)?;
+            if !self.func_params.get(func_name).map(|p| !p.is_empty()).unwrap_or(false) {
+                continue;
+            }
+            // 增量编译时之前的单元可能已经生成过
+            if !self.trampolines.contains_key(func_name) {
+                self.create_trampoline(func_name)?;
+            }
         }
         Ok(())
     }
@@ -2388,6 +2868,7 @@ impl JitCompiler {
         self.module.define_function(trampoline_id, &mut self.ctx)
             .map_err(|e| format!("Define trampoline error: {}", e))?;
         self.module.clear_context(&mut self.ctx);
+        self.unit_defined.insert(trampoline_id);
 
         // 存储 trampoline 信息
         self.trampolines.insert(target_func_name.to_string(), TrampolineInfo {
@@ -2529,7 +3010,7 @@ impl JitCompiler {
 
         let func_name = class_name.to_string();
         let func_id = self.module
-            .declare_function(&func_name, Linkage::Export, &sig)
+            .declare_function(&self.symbol_name(&func_name), Linkage::Export, &sig)
             .map_err(|e| format!("Declare constructor error: {}", e))?;
 
         self.functions.insert(func_name.clone(), func_id);
@@ -2565,6 +3046,8 @@ impl JitCompiler {
         }
         sig.returns.push(AbiParam::new(self.ptr_type));
 
+        let layout_data = self.define_object_layout(&class_info)?;
+
         self.ctx.func.signature = sig;
         self.ctx.func.name = cranelift_codegen::ir::UserFuncName::user(0, func_id.as_u32());
 
@@ -2586,9 +3069,16 @@ impl JitCompiler {
             .ok_or("object_alloc not found")?;
         let object_alloc_ref = self.module.declare_func_in_func(object_alloc_id, builder.func);
 
-        // 调用 object_alloc(size) 分配内存
+        // 调用 object_alloc(size, layout) 分配内存
         let size_val = builder.ins().iconst(types::I64, class_info.size as i64);
-        let call = builder.ins().call(object_alloc_ref, &[size_val]);
+        let layout_val = match layout_data {
+            Some(data_id) => {
+                let gv = self.module.declare_data_in_func(data_id, builder.func);
+                builder.ins().global_value(self.ptr_type, gv)
+            }
+            None => builder.ins().iconst(self.ptr_type, 0),
+        };
+        let call = builder.ins().call(object_alloc_ref, &[size_val, layout_val]);
         let obj_ptr = builder.inst_results(call)[0];
 
         // 使用传入的参数初始化字段
@@ -2611,10 +3101,45 @@ impl JitCompiler {
         self.module.define_function(func_id, &mut self.ctx)
             .map_err(|e| format!("Define constructor error: {}", e))?;
         self.module.clear_context(&mut self.ctx);
+        self.unit_defined.insert(func_id);
 
         Ok(())
     }
 
+    /// 生成类的字段布局表：[条目数, (偏移 << 1 | 是否类对象)...]
+    /// 跨线程传递对象时 object_mark_shared 据此标记 RC 字段；没有 RC 字段时返回 None
+    fn define_object_layout(&mut self, class_info: &ClassInfo) -> Result<Option<cranelift_module::DataId>, String> {
+        let mut entries = Vec::new();
+        for field in &class_info.fields {
+            let offset = (field.offset as u32) << 1;
+            match &field.ty {
+                BolideType::Custom(_) => entries.push(offset | bolide_runtime::LAYOUT_FIELD_OBJECT),
+                BolideType::Tuple(_) => {}
+                ty if CompileContext::is_rc_type(ty) => entries.push(offset),
+                _ => {}
+            }
+        }
+        if entries.is_empty() {
+            return Ok(None);
+        }
+
+        let big_endian = self.module.isa().endianness() == cranelift_codegen::ir::Endianness::Big;
+        let mut bytes = Vec::with_capacity((entries.len() + 1) * 4);
+        for word in std::iter::once(entries.len() as u32).chain(entries) {
+            let word = if big_endian { word.to_be_bytes() } else { word.to_le_bytes() };
+            bytes.extend_from_slice(&word);
+        }
+
+        let data_id = self.module.declare_anonymous_data(false, false)
+            .map_err(|e| format!("Failed to declare layout of '{}': {}", class_info.name, e))?;
+        self.data_desc.define(bytes.into_boxed_slice());
+        self.data_desc.set_align(4);
+        self.module.define_data(data_id, &self.data_desc)
+            .map_err(|e| format!("Failed to define layout of '{}': {}", class_info.name, e))?;
+        self.data_desc.clear();
+        Ok(Some(data_id))
+    }
+
     /// 声明类方法
     fn declare_class_methods(&mut self, program: &Program) -> Result<(), String> {
         for stmt in &program.statements {
@@ -2637,7 +3162,7 @@ impl JitCompiler {
                     }
 
                     let func_id = self.module
-                        .declare_function(&method_name, Linkage::Export, &sig)
+                        .declare_function(&self.symbol_name(&method_name), Linkage::Export, &sig)
                         .map_err(|e| format!("Declare method error: {}", e))?;
 
                     self.functions.insert(method_name.clone(), func_id);
@@ -2691,10 +3216,32 @@ impl JitCompiler {
                 );
             }
         }
+        self.extern_symbols.extend(resolve_extern_block(eb));
         Ok(())
     }
 }
 
+/// 加载 extern 块的库，一次性解析块中全部函数的地址
+///
+/// 库或符号缺失时不报错：对应函数不在结果里，调用处退回运行时查找，执行到时再报告错误。
+fn resolve_extern_block(eb: &ExternBlock) -> HashMap<String, usize> {
+    let names: Vec<&str> = eb.declarations.iter()
+        .filter_map(|decl| match decl {
+            bolide_parser::ExternDecl::Function(func) => Some(func.name.as_str()),
+            _ => None,
+        })
+        .collect();
+    if names.is_empty() {
+        return HashMap::new();
+    }
+    match bolide_runtime::bolide_ffi_resolve_symbols(&eb.lib_path, &names) {
+        Ok(addrs) => names.iter().zip(addrs)
+            .filter_map(|(name, addr)| addr.map(|addr| (name.to_string(), addr as usize)))
+            .collect(),
+        Err(_) => HashMap::new(),
+    }
+}
+
 impl Default for JitCompiler {
     fn default() -> Self {
         Self::new()
@@ -2707,6 +3254,8 @@ struct CompileContext<'a, 'b> {
     module: &'a mut JITModule,
     global_data_ids: &'a HashMap<String, cranelift_module::DataId>,
     global_var_types: &'a HashMap<String, BolideType>,
+    /// 其他线程会访问的 RC 全局变量
+    thread_globals: &'a HashSet<String>,
     func_refs: HashMap<String, FuncRef>,
     variables: HashMap<String, Variable>,
     /// 变量的 Bolide 类型（用于类型推断）
@@ -2741,6 +3290,8 @@ struct CompileContext<'a, 'b> {
     async_funcs: HashSet<String>,
     /// extern 函数信息
     extern_funcs: HashMap<String, (String, bolide_parser::ExternFunc)>,
+    /// extern 函数名 -> 已解析的函数地址
+    extern_symbols: HashMap<String, usize>,
     /// 模块名映射
     modules: HashMap<String, String>,
     /// 生命周期依赖参数（from x, y 中的参数名）
@@ -2760,6 +3311,10 @@ struct CompileContext<'a, 'b> {
     borrowed_vars: HashMap<String, (String, usize)>,
     /// weak 引用变量集合（访问时需要检查是否为 nil）
     weak_variables: HashSet<String>,
+    /// 最后一次使用的变量读取（let/赋值时直接转移所有权，不 clone）
+    last_uses: LastUses,
+    /// 剖析模式：函数槽位和入口时间戳
+    profile: Option<(i64, Value)>,
 }
 
 impl<'a, 'b> CompileContext<'a, 'b> {
@@ -2768,6 +3323,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         module: &'a mut JITModule,
         global_data_ids: &'a HashMap<String, cranelift_module::DataId>,
         global_var_types: &'a HashMap<String, BolideType>,
+        thread_globals: &'a HashSet<String>,
         func_refs: HashMap<String, FuncRef>,
         func_return_types: HashMap<String, Option<BolideType>>,
         func_params: HashMap<String, Vec<Param>>,
@@ -2778,6 +3334,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         classes: HashMap<String, ClassInfo>,
         async_funcs: HashSet<String>,
         extern_funcs: HashMap<String, (String, bolide_parser::ExternFunc)>,
+        extern_symbols: HashMap<String, usize>,
         modules: HashMap<String, String>,
         lifetime_deps: Option<Vec<String>>,
         current_func_name: String,
@@ -2788,6 +3345,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             module,
             global_data_ids,
             global_var_types,
+            thread_globals,
             func_refs,
             variables: HashMap::new(),
             var_types: HashMap::new(),
@@ -2807,6 +3365,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             classes,
             async_funcs,
             extern_funcs,
+            extern_symbols,
             modules,
             lifetime_deps,
             current_func_name,
@@ -2816,9 +3375,38 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             var_scope_depth: HashMap::new(),
             borrowed_vars: HashMap::new(),
             weak_variables: HashSet::new(),
+            last_uses: LastUses::new(),
+            profile: None,
         }
     }
 
+    /// 剖析模式的函数入口：计数一次调用并记下起始时间戳，
+    /// names 为函数名表时（只有入口函数）先开始剖析
+    fn emit_profile_enter(&mut self, slot: i64, names: Option<&'static [u8]>) -> Result<(), String> {
+        if let Some(names) = names {
+            let begin = *self.func_refs.get("profile_begin").ok_or("profile_begin not found")?;
+            let ptr = self.builder.ins().iconst(self.ptr_type, names.as_ptr() as i64);
+            let len = self.builder.ins().iconst(types::I64, names.len() as i64);
+            self.builder.ins().call(begin, &[ptr, len]);
+        }
+        let enter = *self.func_refs.get("profile_enter").ok_or("profile_enter not found")?;
+        let slot_val = self.builder.ins().iconst(types::I64, slot);
+        let call = self.builder.ins().call(enter, &[slot_val]);
+        let start = self.builder.inst_results(call)[0];
+        self.profile = Some((slot, start));
+        Ok(())
+    }
+
+    /// 剖析模式的函数返回：累加本次调用的耗时（在 return 指令之前调用）
+    fn emit_profile_exit(&mut self) -> Result<(), String> {
+        if let Some((slot, start)) = self.profile {
+            let exit = *self.func_refs.get("profile_exit").ok_or("profile_exit not found")?;
+            let slot_val = self.builder.ins().iconst(types::I64, slot);
+            self.builder.ins().call(exit, &[slot_val, start]);
+        }
+        Ok(())
+    }
+
     /// 规范化类型名称
     fn normalize_type_name(&self, name: &str) -> String {
         if name.contains('.') {
@@ -3052,6 +3640,57 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         }
     }
 
+    /// 跨线程传递时需要打 SHARED 标志的类型
+    /// cloned 表示传递前已经 clone：Str/BigInt/Decimal 的 clone 是深拷贝，不再与原线程共享；
+    /// 类对象自身是原子计数，但其 list/dict 等字段需要沿布局表标记
+    fn needs_share_mark(ty: &BolideType, cloned: bool) -> bool {
+        match ty {
+            BolideType::Str | BolideType::BigInt | BolideType::Decimal => !cloned,
+            BolideType::Tuple(_) => false,
+            _ => Self::is_rc_type(ty),
+        }
+    }
+
+    /// 参数值在传给其他线程后，是否仍可能被当前线程访问
+    /// 只有字面量和一元运算结果是新建的临时值；二元运算（如列表拼接）的结果与操作数共享元素，
+    /// 其余（变量、成员、索引、调用结果）也都视为逃逸
+    fn arg_escapes(expr: &Expr) -> bool {
+        match expr {
+            Expr::Int(_) | Expr::Float(_) | Expr::Bool(_) | Expr::None
+            | Expr::String(_) | Expr::BigInt(_) | Expr::Decimal(_)
+            | Expr::UnaryOp(..) => false,
+            Expr::List(items) | Expr::Tuple(items) => items.iter().any(Self::arg_escapes),
+            Expr::Dict(pairs) => pairs.iter().any(|(k, v)| Self::arg_escapes(k) || Self::arg_escapes(v)),
+            _ => true,
+        }
+    }
+
+    /// 对可能跨线程共享的 RC 值调用 value_mark_shared（类对象用 object_mark_shared），
+    /// 之后其计数走原子路径
+    fn emit_mark_shared(&mut self, val: Value, ty: &BolideType) -> Result<(), String> {
+        let mark_func = match ty {
+            BolideType::Custom(_) => "object_mark_shared",
+            _ => "value_mark_shared",
+        };
+        let mark_ref = *self.func_refs.get(mark_func)
+            .ok_or_else(|| format!("{} not found", mark_func))?;
+        self.builder.ins().call(mark_ref, &[val]);
+        Ok(())
+    }
+
+    /// 存入对象字段后调用 object_share_field：对象已跨线程共享时同时标记新值
+    /// （只处理布局表记录的字段，元组不带 RC 头）
+    fn emit_share_field(&mut self, obj: Value, val: Value, ty: &BolideType) -> Result<(), String> {
+        if matches!(ty, BolideType::Tuple(_)) || !Self::is_rc_type(ty) {
+            return Ok(());
+        }
+        let share_ref = *self.func_refs.get("object_share_field")
+            .ok_or("object_share_field not found")?;
+        let is_object = self.builder.ins().iconst(types::I64, matches!(ty, BolideType::Custom(_)) as i64);
+        self.builder.ins().call(share_ref, &[obj, val, is_object]);
+        Ok(())
+    }
+
     /// 获取类型对应的 release 函数名
     fn get_release_func_name(ty: &BolideType) -> Option<&'static str> {
         match ty {
@@ -3160,7 +3799,12 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             // 其他基本 RC 类型
             if let Some(func_name) = Self::get_release_func_name(ty) {
                 if let Some(&func_ref) = self.func_refs.get(func_name) {
-                    self.builder.ins().call(func_ref, &[val]);
+                    // 剖析模式下释放都经过运行时，计数才完整
+                    if Self::has_inline_header(ty) && self.profile.is_none() {
+                        self.emit_inline_release(val, func_ref, ty);
+                    } else {
+                        self.builder.ins().call(func_ref, &[val]);
+                    }
                 }
             }
         }
@@ -3314,10 +3958,9 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         let value_val = self.compile_expr(value)?;
 
         match base_type {
-            BolideType::List(_) => {
-                let list_set = *self.func_refs.get("list_set")
-                    .ok_or("list_set not found")?;
-                self.builder.ins().call(list_set, &[base_val, index_val, value_val]);
+            BolideType::List(elem_ty) => {
+                let value_val = self.to_list_slot(value_val);
+                self.emit_list_set(base_val, index_val, value_val, &elem_ty)?;
                 Ok(())
             }
             BolideType::Dict(_, _) => {
@@ -3352,25 +3995,77 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             let should_release = !is_ref_param || was_reassigned;
 
             let var_ty = self.var_types.get(var_name).cloned();
-            if let Some(ref ty) = var_ty {
-                if Self::is_rc_type(ty) && should_release {
-                    let old_val = self.builder.use_var(var);
-                    self.emit_release(old_val, ty);
+
+            // s = s + a + ...：旧值交给 string_append 消费，s 独占时原地追加
+            // 右侧其余部分不能再读 s（否则会看到追加中途的值）
+            if should_release && var_ty == Some(BolideType::Str) {
+                let mut parts = Vec::new();
+                self.collect_concat_parts(value, &mut parts);
+                let is_self_append = parts.len() >= 2
+                    && matches!(parts[0], Expr::Ident(name) if name == var_name)
+                    && !parts[1..].iter().any(|part| Self::expr_refers_to(part, var_name));
+                if is_self_append {
+                    if is_ref_param && !was_reassigned {
+                        self.ref_params_reassigned.insert(var_name.to_string());
+                    }
+                    let append_ref = *self.func_refs.get("string_append")
+                        .ok_or("string_append not found")?;
+                    let mut current = self.builder.use_var(var);
+                    for part in &parts[1..] {
+                        let part_val = self.compile_expr(part)?;
+                        let call = self.builder.ins().call(append_ref, &[current, part_val]);
+                        current = self.builder.inst_results(call)[0];
+                    }
+                    self.builder.def_var(var, current);
+                    return Ok(());
+                }
+            }
+
+            // x = x + y（bigint）：旧值交给 bigint_*_assign 消费，小整数不分配，独占的堆对象原地更新
+            if should_release && var_ty == Some(BolideType::BigInt) {
+                if let Some((func_name, rhs)) = self.bigint_self_update(var_name, value) {
+                    if is_ref_param && !was_reassigned {
+                        self.ref_params_reassigned.insert(var_name.to_string());
+                    }
+                    let func_ref = *self.func_refs.get(func_name)
+                        .ok_or_else(|| format!("{} not found", func_name))?;
+                    let current = self.builder.use_var(var);
+                    let rhs_val = self.compile_expr(rhs)?;
+                    let call = self.builder.ins().call(func_ref, &[current, rhs_val]);
+                    let result = self.builder.inst_results(call)[0];
+                    self.builder.def_var(var, result);
+                    return Ok(());
                 }
             }
 
+            // 先取旧值、计算新值，再释放旧值（右侧可能读取该变量，如 s = "x" + s）
+            let old_rc_val = match var_ty {
+                Some(ref ty) if Self::is_rc_type(ty) && should_release => Some(self.builder.use_var(var)),
+                _ => None,
+            };
+            let moved = var_ty.as_ref().and_then(|ty| self.take_last_use(value, ty));
+            let val = match (moved, &var_ty) {
+                (Some(val), _) => val,
+                (None, Some(ty)) => self.compile_expr_for(value, ty)?,
+                (None, None) => self.compile_expr(value)?,
+            };
+
+            if let (Some(old_val), Some(ty)) = (old_rc_val, var_ty.as_ref()) {
+                self.emit_release(old_val, ty);
+            }
+
             // 如果是 Ref 参数的首次赋值，标记为已重新赋值
             if is_ref_param && !was_reassigned {
                 self.ref_params_reassigned.insert(var_name.to_string());
             }
 
-            let val = self.compile_expr(value)?;
-
             // 如果是 RC 类型，需要处理引用计数
             if let Some(ref ty) = var_ty {
                 if Self::is_rc_type(ty) {
                     let is_temp = self.temp_rc_values.iter().any(|(v, _)| *v == val);
-                    if is_temp {
+                    if moved.is_some() {
+                        self.builder.def_var(var, val);
+                    } else if is_temp {
                         self.remove_temp_rc_value(val);
                         self.builder.def_var(var, val);
                     } else {
@@ -3420,30 +4115,31 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             if let Some(ref ty) = global_ty {
                 if Self::is_rc_type(ty) {
                     let is_temp = self.temp_rc_values.iter().any(|(v, _)| *v == val);
-                    if is_temp {
+                    let new_val = if is_temp {
                         // 值是临时的，移除临时标记，全局变量接管所有权
                         self.remove_temp_rc_value(val);
-                        // 释放旧值（新值已经计算完成）
-                        let old_val = self.builder.ins().load(self.ptr_type, MemFlags::new(), addr, 0);
-                        self.emit_release(old_val, ty);
-                        // 存储新值
-                        self.builder.ins().store(MemFlags::new(), val, addr, 0);
+                        Some(val)
                     } else {
                         // 值来自另一个变量，需要 clone
-                        let clone_func_name = Self::get_clone_func_name(ty);
-                        if let Some(func_name) = clone_func_name {
-                            if let Some(&func_ref) = self.func_refs.get(func_name) {
+                        Self::get_clone_func_name(ty)
+                            .and_then(|name| self.func_refs.get(name))
+                            .map(|&func_ref| {
                                 let call = self.builder.ins().call(func_ref, &[val]);
-                                let cloned_val = self.builder.inst_results(call)[0];
-                                // 释放旧值
-                                let old_val = self.builder.ins().load(self.ptr_type, MemFlags::new(), addr, 0);
-                                self.emit_release(old_val, ty);
-                                // 存储新值
-                                self.builder.ins().store(MemFlags::new(), cloned_val, addr, 0);
-                            } else {
-                                self.builder.ins().store(MemFlags::new(), val, addr, 0);
+                                self.builder.inst_results(call)[0]
+                            })
+                    };
+                    match new_val {
+                        Some(new_val) => {
+                            // 释放旧值（新值已经计算完成）
+                            let old_val = self.builder.ins().load(self.ptr_type, MemFlags::new(), addr, 0);
+                            self.emit_release(old_val, ty);
+                            // 其他线程会读取的全局变量：新值写入前先标记共享
+                            if self.thread_globals.contains(var_name) && Self::needs_share_mark(ty, false) {
+                                self.emit_mark_shared(new_val, ty)?;
                             }
-                        } else {
+                            self.builder.ins().store(MemFlags::new(), new_val, addr, 0);
+                        }
+                        None => {
                             self.builder.ins().store(MemFlags::new(), val, addr, 0);
                         }
                     }
@@ -3492,24 +4188,22 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         // 如果字段是 RC 类型，需要处理引用计数
         if Self::is_rc_type(&field_ty) {
             let is_temp = self.temp_rc_values.iter().any(|(v, _)| *v == val);
-            if is_temp {
+            let stored = if is_temp {
                 // 值是临时的，移除临时标记，字段接管所有权
                 self.remove_temp_rc_value(val);
-                self.builder.ins().store(MemFlags::new(), val, field_ptr, 0);
+                val
             } else {
                 // 值来自另一个变量，需要 clone
-                if let Some(func_name) = Self::get_clone_func_name(&field_ty) {
-                    if let Some(&func_ref) = self.func_refs.get(func_name) {
+                match Self::get_clone_func_name(&field_ty).and_then(|name| self.func_refs.get(name)) {
+                    Some(&func_ref) => {
                         let call = self.builder.ins().call(func_ref, &[val]);
-                        let cloned = self.builder.inst_results(call)[0];
-                        self.builder.ins().store(MemFlags::new(), cloned, field_ptr, 0);
-                    } else {
-                        self.builder.ins().store(MemFlags::new(), val, field_ptr, 0);
+                        self.builder.inst_results(call)[0]
                     }
-                } else {
-                    self.builder.ins().store(MemFlags::new(), val, field_ptr, 0);
+                    None => val,
                 }
-            }
+            };
+            self.builder.ins().store(MemFlags::new(), stored, field_ptr, 0);
+            self.emit_share_field(obj_ptr, stored, &field_ty)?;
         } else {
             self.builder.ins().store(MemFlags::new(), val, field_ptr, 0);
         }
@@ -3601,7 +4295,13 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         };
 
         if let Some(ref value) = decl.value {
-            let val = self.compile_expr(value)?;
+            // 最后一次使用的变量直接移动过来
+            let moved = self.take_last_use(value, &bolide_ty);
+            let val = match (moved, value, &bolide_ty) {
+                (Some(val), _, _) => val,
+                (None, Expr::List(items), BolideType::List(elem)) => self.compile_list_typed(items, Some(elem))?,
+                _ => self.compile_expr_for(value, &bolide_ty)?,
+            };
 
             // 检查值是否来自生命周期函数调用（返回借用而非拥有的值）
             let is_from_lifetime_func = self.is_lifetime_func_call(value);
@@ -3611,7 +4311,9 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 // 检查值是否来自临时 RC 值（函数调用结果等）
                 let is_temp = self.temp_rc_values.iter().any(|(v, _)| *v == val);
 
-                if is_temp {
+                if moved.is_some() {
+                    self.builder.def_var(var, val);
+                } else if is_temp {
                     // 值是临时的，移除临时标记，变量接管所有权
                     self.remove_temp_rc_value(val);
                     self.builder.def_var(var, val);
@@ -3740,6 +4442,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
             // 写回 Ref 参数
             self.write_back_ref_params();
+            self.emit_profile_exit()?;
 
             self.builder.ins().return_(&[final_val]);
         } else {
@@ -3754,12 +4457,37 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
             // 写回 Ref 参数
             self.write_back_ref_params();
+            self.emit_profile_exit()?;
 
             self.builder.ins().return_(&[]);
         }
         Ok(())
     }
 
+    /// 最后一次使用的 RC 局部变量：取出值并把变量置空，所有权转给新变量
+    /// 省掉 clone，作用域结束时对空指针的 release 也会跳过。
+    /// 只移动本函数拥有的变量：借用/Ref 参数、全局变量、被借用的来源变量和
+    /// 生命周期派生变量都保持原样；对象的字段清理不判空，Custom 也不移动
+    fn take_last_use(&mut self, value: &Expr, ty: &BolideType) -> Option<Value> {
+        let Expr::Ident(src) = value else { return None };
+        if !self.last_uses.contains(&(value as *const Expr))
+            || !Self::is_rc_type(ty)
+            || matches!(ty, BolideType::Custom(_))
+            || self.var_types.get(src) != Some(ty)
+            || !self.rc_variables.iter().any(|(n, _)| n == src)
+            || self.weak_variables.contains(src)
+            || self.var_lifetime_source.contains_key(src)
+            || self.borrowed_vars.values().any(|(source, _)| source == src)
+        {
+            return None;
+        }
+        let var = *self.variables.get(src)?;
+        let val = self.builder.use_var(var);
+        let null = self.builder.ins().iconst(self.ptr_type, 0);
+        self.builder.def_var(var, null);
+        Some(val)
+    }
+
     /// 统一的 retain 辅助函数
     fn emit_retain(&mut self, val: Value, ty: &BolideType) -> Option<Value> {
         if let Some(clone_func) = Self::get_clone_func_name(ty) {
@@ -4078,11 +4806,8 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         elem_type: BolideType, 
         body: &[Statement]
     ) -> Result<(), String> {
-        // 获取列表长度: list_len(list_ptr)
-        let list_len_ref = *self.func_refs.get("list_len")
-            .ok_or("list_len not found")?;
-        let len_call = self.builder.ins().call(list_len_ref, &[list_ptr]);
-        let list_length = self.builder.inst_results(len_call)[0];
+        // 获取列表长度
+        let list_length = self.emit_len_field(list_ptr, bolide_runtime::LIST_LEN_OFFSET);
 
         // 使用第一个变量名作为索引变量后缀
         let loop_base_name = if !vars.is_empty() { &vars[0] } else { "loop" };
@@ -4095,15 +4820,17 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
         // 创建循环变量 (如果是单个变量)
         let loop_var = if vars.len() == 1 {
-            let v = self.declare_variable(&vars[0], types::I64); // 注意: declare_variable 需要具体类型吗? 这里的declare 是JIT internal mapping.
-            // Wait: declare_variable in jit.rs assigns Slot.
-            // Previous code:
-            // let loop_var = self.declare_variable(var_name, types::I64); -- TYPE I64?
-            // Element can be Ptr or I64.
-            // If elem_type is Ptr, we should declare valid Cranelift type.
-            // Step 630 line 3414: types::I64. (Maybe everything is I64/Ptr=I64 in current impl).
-            // I'll stick to I64.
-            self.builder.def_var(v, zero);
+            // float 元素从槽位按位转换为 f64，其余元素（值或指针）都是 I64
+            let v = if elem_type == BolideType::Float {
+                let v = self.declare_variable(&vars[0], types::F64);
+                let fzero = self.builder.ins().f64const(0.0);
+                self.builder.def_var(v, fzero);
+                v
+            } else {
+                let v = self.declare_variable(&vars[0], types::I64);
+                self.builder.def_var(v, zero);
+                v
+            };
             // 注册类型
             self.var_types.insert(vars[0].to_string(), elem_type.clone());
             Some(v)
@@ -4143,12 +4870,10 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         self.builder.switch_to_block(body_block);
         self.builder.seal_block(body_block);
 
-        // 获取当前元素: list_get(list_ptr, idx)
-        let list_get_ref = *self.func_refs.get("list_get")
-            .ok_or("list_get not found")?;
+        // 获取当前元素（循环体可能修改列表，仍按当前长度检查下标）
         let idx_val = self.builder.use_var(idx_var);
-        let get_call = self.builder.ins().call(list_get_ref, &[list_ptr, idx_val]);
-        let elem_val = self.builder.inst_results(get_call)[0];
+        let elem_val = self.emit_list_get(list_ptr, idx_val)?;
+        let elem_val = self.from_list_slot(elem_val, &elem_type);
         
         if vars.len() == 1 {
              if let Some(v) = loop_var {
@@ -4158,11 +4883,9 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             // 解构 (Destructuring)
             match elem_type {
                 BolideType::List(inner_type) => { // List unpacking
-                    let list_get_ref = *self.func_refs.get("list_get").ok_or("list_get not found")?;
                     for (i, var_name) in vars.iter().enumerate() {
                         let idx_const = self.builder.ins().iconst(types::I64, i as i64);
-                        let call = self.builder.ins().call(list_get_ref, &[elem_val, idx_const]);
-                        let val = self.builder.inst_results(call)[0];
+                        let val = self.emit_list_get(elem_val, idx_const)?;
                         self.define_variable(var_name, val, *inner_type.clone())?;
                     }
                 }
@@ -4215,95 +4938,86 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         self.compile_list_iteration_loop(vars, list_ptr, elem_type, body)
     }
 
-    /// 编译 for key in dict { ... }
+    /// 编译 for key in dict { ... } / for k, v in dict { ... }
+    ///
+    /// 通过游标按插入顺序直接读取字典条目，不复制键列表。
     fn compile_for_dict(&mut self, vars: &[String], iter_expr: &Expr, body: &[Statement]) -> Result<(), String> {
         let dict_ptr = self.compile_expr(iter_expr)?;
-        
-        let dict_iter = *self.func_refs.get("dict_iter").ok_or("dict_iter not found")?;
-        let call = self.builder.ins().call(dict_iter, &[dict_ptr]);
-        let keys_list_ptr = self.builder.inst_results(call)[0];
-        
+
         let (key_type, val_type) = match self.infer_expr_type(iter_expr) {
             BolideType::Dict(k, v) => (*k, *v),
             _ => (BolideType::Int, BolideType::Int),
         };
 
-        if vars.len() == 2 {
-            // 优化: for k, v in d. 直接在循环中获取 value，避免创建 items 列表
-            // 复用 list 迭代逻辑，但需要自定义 body 来注入 "let v = d[k]"
-            
-            // 我们不能直接修改 AST body，所以我们需要手动构建循环逻辑
-            // 或者，我们可以生成一个新的 Statement 列表，把 v 的定义加进去
-            // 但是 AST Statement 是结构体，需要构建。
-            // 更简单的方法是: 手动编写 loop 逻辑 (inline)
-            
-            // 1. 获取 length (keys list)
-            let list_len_ref = *self.func_refs.get("list_len").ok_or("list_len not found")?;
-            let len_call = self.builder.ins().call(list_len_ref, &[keys_list_ptr]);
-            let list_length = self.builder.inst_results(len_call)[0];
+        let iter_next = *self.func_refs.get("dict_iter_next").ok_or("dict_iter_next not found")?;
+        let key_at = *self.func_refs.get("dict_key_at").ok_or("dict_key_at not found")?;
+        let value_at = *self.func_refs.get("dict_value_at").ok_or("dict_value_at not found")?;
 
-            let idx_var = self.declare_variable(&format!("__for_idx_{}", vars[0]), types::I64);
-            let zero = self.builder.ins().iconst(types::I64, 0);
-            self.builder.def_var(idx_var, zero);
+        // 游标位置变量
+        let loop_base_name = if !vars.is_empty() { &vars[0] } else { "loop" };
+        let pos_var = self.declare_variable(&format!("__for_pos_{}", loop_base_name), types::I64);
+        let zero = self.builder.ins().iconst(types::I64, 0);
+        self.builder.def_var(pos_var, zero);
 
-            let header_block = self.builder.create_block();
-            let body_block = self.builder.create_block();
-            let exit_block = self.builder.create_block();
+        // 收集循环体内的 RC 变量声明
+        let loop_rc_vars = self.collect_rc_var_decls(body);
+        for (rc_var_name, var_ty) in &loop_rc_vars {
+            if self.variables.contains_key(rc_var_name) {
+                continue;
+            }
+            let ty = self.bolide_type_to_cranelift(var_ty);
+            let var = self.declare_variable(rc_var_name, ty);
+            let null_val = self.builder.ins().iconst(self.ptr_type, 0);
+            self.builder.def_var(var, null_val);
+            self.var_types.insert(rc_var_name.clone(), var_ty.clone());
+            self.track_rc_variable(rc_var_name, var_ty);
+        }
 
-            self.builder.ins().jump(header_block, &[]);
+        let header_block = self.builder.create_block();
+        let body_block = self.builder.create_block();
+        let exit_block = self.builder.create_block();
 
-            // Header
-            self.builder.switch_to_block(header_block);
-            let current_idx = self.builder.use_var(idx_var);
-            let cond = self.builder.ins().icmp(IntCC::SignedLessThan, current_idx, list_length);
-            self.builder.ins().brif(cond, body_block, &[], exit_block, &[]);
+        self.builder.ins().jump(header_block, &[]);
 
-            // Body
-            self.builder.switch_to_block(body_block);
-            self.builder.seal_block(body_block);
+        // Header: pos = dict_iter_next(dict, pos)，为 -1 时结束
+        self.builder.switch_to_block(header_block);
+        let current_pos = self.builder.use_var(pos_var);
+        let next_call = self.builder.ins().call(iter_next, &[dict_ptr, current_pos]);
+        let entry_pos = self.builder.inst_results(next_call)[0];
+        let cond = self.builder.ins().icmp_imm(IntCC::SignedGreaterThanOrEqual, entry_pos, 0);
+        self.builder.ins().brif(cond, body_block, &[], exit_block, &[]);
 
-            // Get Key
-            let list_get_ref = *self.func_refs.get("list_get").ok_or("list_get not found")?;
-            let get_key_call = self.builder.ins().call(list_get_ref, &[keys_list_ptr, current_idx]);
-            let key_val = self.builder.inst_results(get_key_call)[0];
-            
-            self.define_variable(&vars[0], key_val, key_type.clone())?;
+        // Body
+        self.builder.switch_to_block(body_block);
+        self.builder.seal_block(body_block);
 
-            // Get Value: val = dict_get(dict_ptr, key)
-            let dict_get_ref = *self.func_refs.get("dict_get").ok_or("dict_get not found")?;
-            let get_val_call = self.builder.ins().call(dict_get_ref, &[dict_ptr, key_val]);
-            let val_val = self.builder.inst_results(get_val_call)[0];
-            
-            self.define_variable(&vars[1], val_val, val_type.clone())?;
+        let key_call = self.builder.ins().call(key_at, &[dict_ptr, entry_pos]);
+        let key_val = self.builder.inst_results(key_call)[0];
+        self.define_variable(&vars[0], key_val, key_type.clone())?;
 
-            // Compile body
-            self.enter_scope();
-            let mut terminated = false;
-            for stmt in body {
-                if terminated { break; }
-                terminated = self.compile_stmt(stmt)?;
-            }
-            self.leave_scope()?;
-
-            if !terminated {
-                 let current = self.builder.use_var(idx_var);
-                 let next = self.builder.ins().iadd_imm(current, 1);
-                 self.builder.def_var(idx_var, next);
-                 self.builder.ins().jump(header_block, &[]);
-            }
+        if vars.len() == 2 {
+            let value_call = self.builder.ins().call(value_at, &[dict_ptr, entry_pos]);
+            let val_val = self.builder.inst_results(value_call)[0];
+            self.define_variable(&vars[1], val_val, val_type.clone())?;
+        }
 
-            self.builder.seal_block(header_block);
-            self.builder.switch_to_block(exit_block);
-            self.builder.seal_block(exit_block);
+        self.enter_scope();
+        let mut terminated = false;
+        for stmt in body {
+            if terminated { break; }
+            terminated = self.compile_stmt(stmt)?;
+        }
+        self.leave_scope()?;
 
-        } else {
-            // 单变量迭代 (Keys)
-            self.compile_list_iteration_loop(vars, keys_list_ptr, key_type, body)?;
+        if !terminated {
+            let next_pos = self.builder.ins().iadd_imm(entry_pos, 1);
+            self.builder.def_var(pos_var, next_pos);
+            self.builder.ins().jump(header_block, &[]);
         }
 
-        // Release keys list
-        let release_fn = *self.func_refs.get("list_release").ok_or("list_release not found")?;
-        self.builder.ins().call(release_fn, &[keys_list_ptr]);
+        self.builder.seal_block(header_block);
+        self.builder.switch_to_block(exit_block);
+        self.builder.seal_block(exit_block);
 
         Ok(())
     }
@@ -4473,6 +5187,87 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         Err(format!("Undefined variable or function: {}", name))
     }
 
+    /// 展开字符串 `+` 拼接链: ((a + b) + c) -> [a, b, c]
+    fn collect_concat_parts<'e>(&self, expr: &'e Expr, parts: &mut Vec<&'e Expr>) {
+        if let Expr::BinOp(left, BinOp::Add, right) = expr {
+            if self.infer_expr_type(left) == BolideType::Str && self.infer_expr_type(right) == BolideType::Str {
+                self.collect_concat_parts(left, parts);
+                self.collect_concat_parts(right, parts);
+                return;
+            }
+        }
+        parts.push(expr);
+    }
+
+    /// 识别 x = x op y（op 为 + - *，y 是 bigint 且不读取 x），返回对应的原地运算函数和 y
+    fn bigint_self_update<'e>(&self, var_name: &str, value: &'e Expr) -> Option<(&'static str, &'e Expr)> {
+        if let Expr::BinOp(left, op, right) = value {
+            let func_name = match op {
+                BinOp::Add => "bigint_add_assign",
+                BinOp::Sub => "bigint_sub_assign",
+                BinOp::Mul => "bigint_mul_assign",
+                _ => return None,
+            };
+            if matches!(left.as_ref(), Expr::Ident(name) if name == var_name)
+                && !Self::expr_refers_to(right, var_name)
+                && self.infer_expr_type(right) == BolideType::BigInt
+            {
+                return Some((func_name, right));
+            }
+        }
+        None
+    }
+
+    /// 表达式中是否引用了变量 name
+    fn expr_refers_to(expr: &Expr, name: &str) -> bool {
+        match expr {
+            Expr::Ident(n) | Expr::Recv(n) => n == name,
+            Expr::BinOp(left, _, right) | Expr::Index(left, right) => {
+                Self::expr_refers_to(left, name) || Self::expr_refers_to(right, name)
+            }
+            Expr::UnaryOp(_, inner) | Expr::Member(inner, _) | Expr::Await(inner) => {
+                Self::expr_refers_to(inner, name)
+            }
+            Expr::Call(callee, args) => {
+                Self::expr_refers_to(callee, name) || args.iter().any(|a| Self::expr_refers_to(a, name))
+            }
+            Expr::Spawn(_, items) | Expr::List(items) | Expr::Tuple(items) | Expr::AwaitAll(items) => {
+                items.iter().any(|e| Self::expr_refers_to(e, name))
+            }
+            Expr::Dict(pairs) => pairs.iter()
+                .any(|(k, v)| Self::expr_refers_to(k, name) || Self::expr_refers_to(v, name)),
+            _ => false,
+        }
+    }
+
+    /// 编译多段字符串拼接: 先求各段总长度，再用 StringBuilder 一次分配
+    fn compile_concat_chain(&mut self, parts: &[&Expr]) -> Result<Value, String> {
+        let new_ref = *self.func_refs.get("string_builder_new").ok_or("string_builder_new not found")?;
+        let append_ref = *self.func_refs.get("string_builder_append").ok_or("string_builder_append not found")?;
+        let finish_ref = *self.func_refs.get("string_builder_finish").ok_or("string_builder_finish not found")?;
+
+        let mut vals = Vec::with_capacity(parts.len());
+        for part in parts {
+            vals.push(self.compile_expr(part)?);
+        }
+
+        let mut total = self.builder.ins().iconst(types::I64, 0);
+        for &val in &vals {
+            let len = self.emit_len_field(val, bolide_runtime::STRING_LEN_OFFSET);
+            total = self.builder.ins().iadd(total, len);
+        }
+
+        let call = self.builder.ins().call(new_ref, &[total]);
+        let sb = self.builder.inst_results(call)[0];
+        for &val in &vals {
+            self.builder.ins().call(append_ref, &[sb, val]);
+        }
+        let call = self.builder.ins().call(finish_ref, &[sb]);
+        let result = self.builder.inst_results(call)[0];
+        self.track_temp_rc_value(result, &BolideType::Str);
+        Ok(result)
+    }
+
     /// 编译二元操作
     fn compile_binop(&mut self, left: &Expr, op: &BinOp, right: &Expr) -> Result<Value, String> {
         // 推断操作数类型
@@ -4486,6 +5281,23 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             }
         }
 
+        // 三段及以上的字符串拼接链降级为 StringBuilder，只分配一次
+        if matches!(op, BinOp::Add) && left_ty == BolideType::Str && right_ty == BolideType::Str {
+            let mut parts = Vec::new();
+            self.collect_concat_parts(left, &mut parts);
+            self.collect_concat_parts(right, &mut parts);
+            if parts.len() >= 3 {
+                return self.compile_concat_chain(&parts);
+            }
+        }
+
+        // Dynamic 运算：另一侧的静态类型值先装箱
+        if left_ty == BolideType::Dynamic || right_ty == BolideType::Dynamic {
+            let lhs = self.compile_dynamic_operand(left, &left_ty)?;
+            let rhs = self.compile_dynamic_operand(right, &right_ty)?;
+            return self.compile_dynamic_binop(lhs, op, rhs);
+        }
+
         let lhs = self.compile_expr(left)?;
         let rhs = self.compile_expr(right)?;
 
@@ -4697,12 +5509,174 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         Ok(result)
     }
 
+    /// 编译 dynamic 运算的操作数：int 字面量和 none 直接编码为立即数，其他静态类型值装箱
+    fn compile_dynamic_operand(&mut self, expr: &Expr, ty: &BolideType) -> Result<Value, String> {
+        match expr {
+            Expr::Int(n) if (i64::MIN >> 1..=i64::MAX >> 1).contains(n) => {
+                return Ok(self.builder.ins().iconst(self.ptr_type, (n << 1) | bolide_runtime::DYNAMIC_INT_TAG));
+            }
+            Expr::None => return Ok(self.builder.ins().iconst(self.ptr_type, bolide_runtime::DYNAMIC_NONE)),
+            _ => {}
+        }
+        let val = self.compile_expr(expr)?;
+        if *ty == BolideType::Dynamic || !Self::is_rc_type(ty) {
+            return self.convert_to_dynamic(val, ty);
+        }
+        // 装箱后由 dynamic 持有引用：临时值直接交出，变量的值先 clone
+        let owned = if self.temp_rc_values.iter().any(|(v, _)| *v == val) {
+            self.remove_temp_rc_value(val);
+            val
+        } else if let Some(&clone_ref) = Self::get_clone_func_name(ty).and_then(|name| self.func_refs.get(name)) {
+            let call = self.builder.ins().call(clone_ref, &[val]);
+            self.builder.inst_results(call)[0]
+        } else {
+            val
+        };
+        self.convert_to_dynamic(owned, ty)
+    }
+
+    /// 编译赋给 target 类型的值：目标是 dynamic 而值是静态类型时先装箱
+    fn compile_expr_for(&mut self, value: &Expr, target: &BolideType) -> Result<Value, String> {
+        if *target == BolideType::Dynamic {
+            let value_ty = self.infer_expr_type(value);
+            if value_ty != BolideType::Dynamic {
+                return self.compile_dynamic_operand(value, &value_ty);
+            }
+        }
+        self.compile_expr(value)
+    }
+
+    /// int 装箱为 dynamic：能放进 63 位时内联编码为立即数，否则调用 dynamic_from_int
+    fn emit_dynamic_from_int(&mut self, val: Value) -> Result<Value, String> {
+        let box_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, self.ptr_type);
+
+        let shifted = self.builder.ins().ishl_imm(val, 1);
+        let restored = self.builder.ins().sshr_imm(shifted, 1);
+        let fits = self.builder.ins().icmp(IntCC::Equal, restored, val);
+        let tagged = self.builder.ins().bor_imm(shifted, bolide_runtime::DYNAMIC_INT_TAG);
+        self.builder.ins().brif(fits, done_block, &[tagged], box_block, &[]);
+
+        self.builder.switch_to_block(box_block);
+        self.builder.seal_block(box_block);
+        let func_ref = *self.func_refs.get("dynamic_from_int")
+            .ok_or("dynamic_from_int not found")?;
+        let call = self.builder.ins().call(func_ref, &[val]);
+        let boxed = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[boxed]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        let result = self.builder.block_params(done_block)[0];
+        self.track_temp_rc_value(result, &BolideType::Dynamic);
+        Ok(result)
+    }
+
+    /// 编译 Dynamic 二元操作
+    ///
+    /// 两个操作数都是 int 立即数时直接在标记值上计算（与 bigint 小整数相同的恒等式，
+    /// 比较直接比较标记值），只有加减乘溢出、除法或其他类型组合才调用运行时。
+    fn compile_dynamic_binop(&mut self, lhs: Value, op: &BinOp, rhs: Value) -> Result<Value, String> {
+        let func_name = match op {
+            BinOp::Add => "dynamic_add",
+            BinOp::Sub => "dynamic_sub",
+            BinOp::Mul => "dynamic_mul",
+            BinOp::Div => "dynamic_div",
+            BinOp::Eq | BinOp::Ne => "dynamic_eq",
+            BinOp::Lt => "dynamic_lt",
+            BinOp::Le => "dynamic_le",
+            BinOp::Gt => "dynamic_gt",
+            BinOp::Ge => "dynamic_ge",
+            BinOp::Mod | BinOp::And | BinOp::Or => {
+                return Err(format!("Unsupported dynamic operation: {:?}", op));
+            }
+        };
+        let func_ref = *self.func_refs.get(func_name)
+            .ok_or_else(|| format!("{} not found", func_name))?;
+        let is_arithmetic = matches!(op, BinOp::Add | BinOp::Sub | BinOp::Mul | BinOp::Div);
+        let result_ty = if is_arithmetic { self.ptr_type } else { types::I64 };
+
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, result_ty);
+
+        if !matches!(op, BinOp::Div) {
+            let fast_block = self.builder.create_block();
+            let both = self.builder.ins().band(lhs, rhs);
+            let tag = self.builder.ins().band_imm(both, bolide_runtime::DYNAMIC_INT_TAG);
+            self.builder.ins().brif(tag, fast_block, &[], slow_block, &[]);
+
+            self.builder.switch_to_block(fast_block);
+            self.builder.seal_block(fast_block);
+            if is_arithmetic {
+                let (raw, overflow) = match op {
+                    // (2a+1) - 1 + (2b+1) = 2(a+b)+1
+                    BinOp::Add => {
+                        let untagged = self.builder.ins().bxor_imm(lhs, 1);
+                        self.builder.ins().sadd_overflow(untagged, rhs)
+                    }
+                    // (2a+1) - 2b = 2(a-b)+1
+                    BinOp::Sub => {
+                        let untagged = self.builder.ins().bxor_imm(rhs, 1);
+                        self.builder.ins().ssub_overflow(lhs, untagged)
+                    }
+                    // a * 2b + 1 = 2ab+1
+                    _ => {
+                        let a = self.builder.ins().sshr_imm(lhs, 1);
+                        let untagged = self.builder.ins().bxor_imm(rhs, 1);
+                        let (prod, overflow) = self.builder.ins().smul_overflow(a, untagged);
+                        (self.builder.ins().bor_imm(prod, 1), overflow)
+                    }
+                };
+                self.builder.ins().brif(overflow, slow_block, &[], done_block, &[raw]);
+            } else {
+                let cc = match op {
+                    BinOp::Lt => IntCC::SignedLessThan,
+                    BinOp::Le => IntCC::SignedLessThanOrEqual,
+                    BinOp::Gt => IntCC::SignedGreaterThan,
+                    BinOp::Ge => IntCC::SignedGreaterThanOrEqual,
+                    _ => IntCC::Equal,
+                };
+                let cmp = self.builder.ins().icmp(cc, lhs, rhs);
+                let res = self.builder.ins().uextend(types::I64, cmp);
+                self.builder.ins().jump(done_block, &[res]);
+            }
+        } else {
+            self.builder.ins().jump(slow_block, &[]);
+        }
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(func_ref, &[lhs, rhs]);
+        let res = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[res]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        let result = self.builder.block_params(done_block)[0];
+
+        if is_arithmetic {
+            self.track_temp_rc_value(result, &BolideType::Dynamic);
+            Ok(result)
+        } else if matches!(op, BinOp::Ne) {
+            let one = self.builder.ins().iconst(types::I64, 1);
+            Ok(self.builder.ins().isub(one, result))
+        } else {
+            Ok(result)
+        }
+    }
+
     /// 编译一元操作
     fn compile_unary(&mut self, op: &UnaryOp, operand: &Expr) -> Result<Value, String> {
         let operand_ty = self.infer_expr_type(operand);
         let is_float = matches!(operand_ty, BolideType::Float);
         let val = self.compile_expr(operand)?;
 
+        if operand_ty == BolideType::Dynamic {
+            return self.compile_dynamic_unary(op, val);
+        }
+
         let result = match op {
             UnaryOp::Neg => {
                 if is_float {
@@ -4721,6 +5695,28 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         Ok(result)
     }
 
+    /// 编译 Dynamic 一元操作
+    fn compile_dynamic_unary(&mut self, op: &UnaryOp, val: Value) -> Result<Value, String> {
+        match op {
+            UnaryOp::Neg => {
+                let func_ref = *self.func_refs.get("dynamic_neg")
+                    .ok_or("dynamic_neg not found")?;
+                let call = self.builder.ins().call(func_ref, &[val]);
+                let result = self.builder.inst_results(call)[0];
+                self.track_temp_rc_value(result, &BolideType::Dynamic);
+                Ok(result)
+            }
+            UnaryOp::Not => {
+                let func_ref = *self.func_refs.get("dynamic_is_truthy")
+                    .ok_or("dynamic_is_truthy not found")?;
+                let call = self.builder.ins().call(func_ref, &[val]);
+                let truthy = self.builder.inst_results(call)[0];
+                let one = self.builder.ins().iconst(types::I64, 1);
+                Ok(self.builder.ins().isub(one, truthy))
+            }
+        }
+    }
+
     /// 编译间接函数调用（通过函数指针调用）
     fn compile_indirect_call(
         &mut self,
@@ -4845,6 +5841,21 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
         // 处理类型转换函数和特殊函数
         match func_name.as_str() {
+            // sum/min/max(list)、dot(a, b) - 列表数值归约（不覆盖同名的用户函数）
+            "sum" | "min" | "max" | "dot"
+                if !self.func_return_types.contains_key(func_name.as_str()) =>
+            {
+                let expected = if func_name == "dot" { 2 } else { 1 };
+                if args.len() != expected {
+                    return Err(format!("{} expects {} argument(s)", func_name, expected));
+                }
+                let elem_ty = match self.infer_expr_type(&args[0]) {
+                    BolideType::List(elem) => *elem,
+                    other => return Err(format!("{} expects a list, got {:?}", func_name, other)),
+                };
+                let list_ptr = self.compile_expr(&args[0])?;
+                return self.compile_list_reduce(func_name.as_str(), list_ptr, &elem_ty, args.get(1));
+            }
             "int" => return self.compile_type_conversion_to_int(args),
             "float" => return self.compile_type_conversion_to_float(args),
             "str" => return self.compile_type_conversion_to_str(args),
@@ -4876,6 +5887,14 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 self.builder.ins().call(func_ref, &[]);
                 return Ok(self.builder.ins().iconst(types::I64, 0));
             }
+            // slab_debug_stats - 调试用；arena_enter/arena_exit - 短生命周期作用域的 arena 分配
+            // print_flush - 立即刷出当前线程缓冲的 print 输出
+            "slab_debug_stats" | "arena_enter" | "arena_exit" | "print_flush" => {
+                let func_ref = *self.func_refs.get(func_name.as_str())
+                    .ok_or_else(|| format!("{} not found", func_name))?;
+                self.builder.ins().call(func_ref, &[]);
+                return Ok(self.builder.ins().iconst(types::I64, 0));
+            }
             // tuple_debug_stats - 调试用
             "tuple_debug_stats" => {
                 let func_ref = *self.func_refs.get("tuple_debug_stats")
@@ -4887,6 +5906,12 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             "input" => {
                 return self.compile_input(args);
             }
+            // 文件读写 - 句柄是不透明指针（ptr），不覆盖同名的用户函数
+            name if Self::file_builtin_arity(name).is_some()
+                && !self.func_return_types.contains_key(name) =>
+            {
+                return self.compile_file_call(name, args);
+            }
             _ => {}
 
         }
@@ -5247,6 +6272,40 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         Ok(result)
     }
 
+    /// 文件读写内置函数的参数个数
+    fn file_builtin_arity(name: &str) -> Option<usize> {
+        match name {
+            "file_open" | "file_create" | "file_read_line" | "file_eof" | "file_flush" | "file_close" => Some(1),
+            "file_write" | "file_write_line" => Some(2),
+            _ => None,
+        }
+    }
+
+    /// 编译文件读写函数调用
+    fn compile_file_call(&mut self, name: &str, args: &[Expr]) -> Result<Value, String> {
+        let arity = Self::file_builtin_arity(name).ok_or_else(|| format!("{} not found", name))?;
+        if args.len() != arity {
+            return Err(format!("{} expects {} argument(s)", name, arity));
+        }
+        let mut arg_values = Vec::new();
+        for arg in args {
+            arg_values.push(self.compile_expr(arg)?);
+        }
+        let func_ref = *self.func_refs.get(name)
+            .ok_or_else(|| format!("{} not found", name))?;
+        let call = self.builder.ins().call(func_ref, &arg_values);
+        match self.builder.inst_results(call).first() {
+            Some(&result) => {
+                // 读到的行是新的字符串引用（借用文件内容），需要 RC 跟踪
+                if name == "file_read_line" {
+                    self.track_temp_rc_value(result, &BolideType::Str);
+                }
+                Ok(result)
+            }
+            None => Ok(self.builder.ins().iconst(types::I64, 0)),
+        }
+    }
+
     /// 推断表达式类型
     fn infer_expr_type(&self, expr: &Expr) -> BolideType {
         match expr {
@@ -5282,6 +6341,10 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                             _ => BolideType::Int,
                         }
                     }
+                    (BolideType::Dynamic, _) | (_, BolideType::Dynamic) => match op {
+                        BinOp::Add | BinOp::Sub | BinOp::Mul | BinOp::Div | BinOp::Mod => BolideType::Dynamic,
+                        _ => BolideType::Bool,
+                    },
                     (BolideType::Float, _) | (_, BolideType::Float) => BolideType::Float,
                     (BolideType::BigInt, _) | (_, BolideType::BigInt) => BolideType::BigInt,
                     (BolideType::Decimal, _) | (_, BolideType::Decimal) => BolideType::Decimal,
@@ -5309,6 +6372,24 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                         "str" => BolideType::Str,  // str 函数返回字符串
                         "channel" => BolideType::Channel(Box::new(BolideType::Int)),  // 默认 int，实际类型从声明获取
                         "input" => BolideType::Str,  // input 函数返回字符串
+                        file_fn if Self::file_builtin_arity(file_fn).is_some()
+                            && !self.func_return_types.contains_key(file_fn) =>
+                        {
+                            match file_fn {
+                                "file_open" | "file_create" => BolideType::Ptr,
+                                "file_read_line" => BolideType::Str,
+                                "file_eof" => BolideType::Bool,
+                                _ => BolideType::Int,
+                            }
+                        }
+                        "sum" | "min" | "max" | "dot"
+                            if !self.func_return_types.contains_key(name.as_str()) =>
+                        {
+                            match args.first().map(|a| self.infer_expr_type(a)) {
+                                Some(BolideType::List(elem)) if *elem == BolideType::Float => BolideType::Float,
+                                _ => BolideType::Int,
+                            }
+                        }
                         "join" => {
                             // 从 spawn_func_map 获取原函数的返回类型
                             if args.len() == 1 {
@@ -5346,7 +6427,8 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                         }
                         BolideType::List(elem) => {
                              match method.as_str() {
-                                 "pop" | "get" | "first" | "last" => *elem,
+                                 "pop" | "get" | "first" | "last" | "remove" => *elem,
+                                 "sum" | "min" | "max" | "dot" => *elem,
                                  "slice" | "copy" | "clone" => BolideType::List(elem),
                                  "len" | "index_of" | "count" | "is_empty" => BolideType::Int,
                                  _ => BolideType::Int
@@ -5530,8 +6612,12 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             .ok_or_else(|| format!("Undefined channel: {}", send_stmt.channel))?;
         let channel_ptr = self.builder.use_var(channel_var);
 
-        // 编译要发送的值
+        // 编译要发送的值；接收方可能在其他线程，逃逸的 RC 值需标记为共享
+        let value_ty = self.infer_expr_type(&send_stmt.value);
         let value = self.compile_expr(&send_stmt.value)?;
+        if Self::needs_share_mark(&value_ty, false) && Self::arg_escapes(&send_stmt.value) {
+            self.emit_mark_shared(value, &value_ty)?;
+        }
 
         // 调用 channel_send(channel, value)
         let channel_send_ref = *self.func_refs.get("channel_send")
@@ -5737,8 +6823,28 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         Ok(())
     }
 
+    /// 启动其他线程前标记它们会访问的全局变量：增量编译时全局变量可能在之前的单元赋值，
+    /// 那时还不知道它会被共享（已标记的对象只检查一次标志）
+    fn emit_mark_thread_globals(&mut self) -> Result<(), String> {
+        let (thread_globals, global_data_ids, global_var_types) =
+            (self.thread_globals, self.global_data_ids, self.global_var_types);
+        let mut names: Vec<&String> = thread_globals.iter().collect();
+        names.sort();
+        for name in names {
+            let (Some(&data_id), Some(ty)) = (global_data_ids.get(name), global_var_types.get(name)) else {
+                continue;
+            };
+            let gv = self.module.declare_data_in_func(data_id, self.builder.func);
+            let addr = self.builder.ins().global_value(self.ptr_type, gv);
+            let val = self.builder.ins().load(self.ptr_type, MemFlags::new(), addr, 0);
+            self.emit_mark_shared(val, ty)?;
+        }
+        Ok(())
+    }
+
     /// 编译 spawn 表达式
     fn compile_spawn(&mut self, func_name: &str, args: &[Expr]) -> Result<Value, String> {
+        self.emit_mark_thread_globals()?;
         // 获取目标函数的返回类型，确定 spawn 函数后缀
         let return_type = self.func_return_types.get(func_name).cloned().unwrap_or(None);
         let type_suffix = match &return_type {
@@ -5797,6 +6903,11 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     val
                 };
 
+                // 容器的 clone 是浅拷贝，元素仍与原线程共享
+                if Self::needs_share_mark(bolide_type, true) && Self::arg_escapes(arg) {
+                    self.emit_mark_shared(val_to_store, bolide_type)?;
+                }
+
                 self.builder.ins().store(MemFlags::trusted(), val_to_store, env_ptr, offset);
             }
 
@@ -5880,6 +6991,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
     /// 编译 async 函数调用 - 启动协程并返回 Future
     fn compile_async_call(&mut self, func_name: &str, args: &[Expr]) -> Result<Value, String> {
+        self.emit_mark_thread_globals()?;
         // 获取返回类型确定 spawn 函数后缀
         let return_type = self.func_return_types.get(func_name).cloned().unwrap_or(None);
         let type_suffix = match &return_type {
@@ -5915,9 +7027,15 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             let env_ptr = self.builder.inst_results(alloc_call)[0];
 
             // 存储参数到 env
+            // 协程可能在其他 worker 上运行，逃逸的 RC 参数需标记为共享
             for (i, arg) in args.iter().enumerate() {
                 let val = self.compile_expr(arg)?;
                 let offset = (i * 8) as i32;
+                if let Some(ty) = param_types.get(i) {
+                    if Self::needs_share_mark(ty, false) && Self::arg_escapes(arg) {
+                        self.emit_mark_shared(val, ty)?;
+                    }
+                }
                 self.builder.ins().store(MemFlags::trusted(), val, env_ptr, offset);
             }
 
@@ -6051,19 +7169,25 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
     /// 编译列表字面量 [a, b, c]
     fn compile_list(&mut self, items: &[Expr]) -> Result<Value, String> {
+        self.compile_list_typed(items, None)
+    }
+
+    /// 编译列表字面量；elem_hint 来自变量声明的类型，用于空列表 (如 `let xs: list<float> = []`)
+    fn compile_list_typed(&mut self, items: &[Expr], elem_hint: Option<&BolideType>) -> Result<Value, String> {
         // 确定元素类型（默认 int = 0）
-        let elem_type = if items.is_empty() {
-            0u8 // int
-        } else {
-            match self.infer_expr_type(&items[0]) {
-                BolideType::Int => 0,
-                BolideType::Float => 1,
-                BolideType::Bool => 2,
-                BolideType::Str => 3,
-                BolideType::BigInt => 4,
-                BolideType::Decimal => 5,
-                _ => 0, // default to int
-            }
+        let elem_bolide_ty = match (items.first(), elem_hint) {
+            (Some(first), _) => self.infer_expr_type(first),
+            (None, Some(hint)) => hint.clone(),
+            (None, None) => BolideType::Int,
+        };
+        let elem_type = match elem_bolide_ty {
+            BolideType::Int => 0u8,
+            BolideType::Float => 1,
+            BolideType::Bool => 2,
+            BolideType::Str => 3,
+            BolideType::BigInt => 4,
+            BolideType::Decimal => 5,
+            _ => 0, // default to int
         };
 
         // 调用 list_new(elem_type) 创建列表
@@ -6078,6 +7202,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             .ok_or("list_push not found")?;
         for expr in items {
             let val = self.compile_expr(expr)?;
+            let val = self.to_list_slot(val);
             self.builder.ins().call(list_push, &[list_ptr, val]);
         }
 
@@ -6089,7 +7214,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
     /// 将值转换为 Dynamic 类型 (Boxing)
     fn convert_to_dynamic(&mut self, val: Value, ty: &BolideType) -> Result<Value, String> {
         let func_name = match ty {
-            BolideType::Int => "dynamic_from_int",
+            BolideType::Int => return self.emit_dynamic_from_int(val),
             BolideType::Float => "dynamic_from_float",
             BolideType::Bool => "dynamic_from_bool",
             BolideType::Str => "dynamic_from_string",
@@ -6190,11 +7315,9 @@ impl<'a, 'b> CompileContext<'a, 'b> {
 
         // 根据类型选择不同的索引函数
         match base_type {
-            BolideType::List(_) => {
-                let list_get = *self.func_refs.get("list_get")
-                    .ok_or("list_get not found")?;
-                let call = self.builder.ins().call(list_get, &[base_val, index_val]);
-                Ok(self.builder.inst_results(call)[0])
+            BolideType::List(elem_ty) => {
+                let val = self.emit_list_get(base_val, index_val)?;
+                Ok(self.from_list_slot(val, &elem_ty))
             }
             BolideType::Dict(_, _) => {
                 let dict_get = *self.func_refs.get("dict_get")
@@ -6673,9 +7796,9 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         }
 
         // 检查是否是 List 类型的方法调用
-        if matches!(class_name, BolideType::List(_)) {
+        if let BolideType::List(elem_ty) = &class_name {
             let list_ptr = self.compile_expr(base)?;
-            return self.compile_list_method_call(list_ptr, method_name, args);
+            return self.compile_list_method_call(list_ptr, elem_ty, method_name, args);
         }
 
         // 检查是否是 Dict 类型的方法调用
@@ -6718,8 +7841,204 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         }
     }
 
+    // ==================== 内联快速路径 ====================
+    //
+    // len/下标读写和 RC 释放的常见情况按运行时 #[repr(C)] 布局的字段偏移直接生成 IR，
+    // null、越界、RC 元素写入、跨线程共享对象和最后一个引用仍调用运行时函数。
+
+    /// 内联读取对象的长度字段（列表/字典/字符串），null 视为 0
+    fn emit_len_field(&mut self, ptr: Value, offset: i32) -> Value {
+        let load_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+
+        let zero = self.builder.ins().iconst(types::I64, 0);
+        self.builder.ins().brif(ptr, load_block, &[], done_block, &[zero]);
+
+        self.builder.switch_to_block(load_block);
+        self.builder.seal_block(load_block);
+        let len = self.builder.ins().load(types::I64, MemFlags::trusted(), ptr, offset);
+        self.builder.ins().jump(done_block, &[len]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        self.builder.block_params(done_block)[0]
+    }
+
+    /// 列表元素槽位地址: data + index * 8
+    fn emit_list_slot_addr(&mut self, list: Value, index: Value) -> Value {
+        let data = self.builder.ins().load(self.ptr_type, MemFlags::trusted(), list, bolide_runtime::LIST_DATA_OFFSET);
+        let offset = self.builder.ins().ishl_imm(index, 3);
+        self.builder.ins().iadd(data, offset)
+    }
+
+    /// 内联 list[index]：下标在 [0, len) 内时直接读槽位，否则调用 list_get（越界返回 0）
+    fn emit_list_get(&mut self, list: Value, index: Value) -> Result<Value, String> {
+        let list_get = *self.func_refs.get("list_get").ok_or("list_get not found")?;
+        // 无符号比较同时排除负下标；null 列表长度为 0，也走慢路径
+        let len = self.emit_len_field(list, bolide_runtime::LIST_LEN_OFFSET);
+        let in_bounds = self.builder.ins().icmp(IntCC::UnsignedLessThan, index, len);
+
+        let fast_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+        self.builder.ins().brif(in_bounds, fast_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(fast_block);
+        self.builder.seal_block(fast_block);
+        let addr = self.emit_list_slot_addr(list, index);
+        let val = self.builder.ins().load(types::I64, MemFlags::trusted(), addr, 0);
+        self.builder.ins().jump(done_block, &[val]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(list_get, &[list, index]);
+        let val = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[val]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        Ok(self.builder.block_params(done_block)[0])
+    }
+
+    /// 内联 list[index] = value，返回是否成功
+    /// RC 元素要 retain 新值、release 旧值，和越界一样交给 list_set
+    fn emit_list_set(&mut self, list: Value, index: Value, value: Value, elem_ty: &BolideType) -> Result<Value, String> {
+        let list_set = *self.func_refs.get("list_set").ok_or("list_set not found")?;
+        if Self::is_rc_type(elem_ty) {
+            let call = self.builder.ins().call(list_set, &[list, index, value]);
+            return Ok(self.builder.inst_results(call)[0]);
+        }
+        let len = self.emit_len_field(list, bolide_runtime::LIST_LEN_OFFSET);
+        let in_bounds = self.builder.ins().icmp(IntCC::UnsignedLessThan, index, len);
+
+        let fast_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+        self.builder.append_block_param(done_block, types::I64);
+        self.builder.ins().brif(in_bounds, fast_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(fast_block);
+        self.builder.seal_block(fast_block);
+        let addr = self.emit_list_slot_addr(list, index);
+        self.builder.ins().store(MemFlags::trusted(), value, addr, 0);
+        let one = self.builder.ins().iconst(types::I64, 1);
+        self.builder.ins().jump(done_block, &[one]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        let call = self.builder.ins().call(list_set, &[list, index, value]);
+        let ok = self.builder.inst_results(call)[0];
+        self.builder.ins().jump(done_block, &[ok]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+        Ok(self.builder.block_params(done_block)[0])
+    }
+
+    /// 内联 RC 释放：对象未跨线程共享且计数大于 1 时直接减一；
+    /// 共享对象（原子计数）和最后一个引用（需要析构）调用运行时 release
+    fn emit_inline_release(&mut self, val: Value, release_ref: FuncRef, ty: &BolideType) {
+        let header_block = self.builder.create_block();
+        let unshared_block = self.builder.create_block();
+        let dec_block = self.builder.create_block();
+        let slow_block = self.builder.create_block();
+        let done_block = self.builder.create_block();
+
+        // null、内联小整数 bigint（最低位为 1）以及 dynamic 立即数（低 3 位非 0）没有对象头
+        let tag_mask = match ty {
+            BolideType::BigInt => Some(1),
+            BolideType::Dynamic => Some(bolide_runtime::DYNAMIC_TAG_MASK),
+            _ => None,
+        };
+        if let Some(mask) = tag_mask {
+            let tag_block = self.builder.create_block();
+            self.builder.ins().brif(val, tag_block, &[], done_block, &[]);
+            self.builder.switch_to_block(tag_block);
+            self.builder.seal_block(tag_block);
+            let tag = self.builder.ins().band_imm(val, mask);
+            self.builder.ins().brif(tag, done_block, &[], header_block, &[]);
+        } else {
+            self.builder.ins().brif(val, header_block, &[], done_block, &[]);
+        }
+
+        self.builder.switch_to_block(header_block);
+        self.builder.seal_block(header_block);
+        let flags = self.builder.ins().uload8(types::I32, MemFlags::trusted(), val, bolide_runtime::RC_FLAGS_OFFSET);
+        let shared = self.builder.ins().band_imm(flags, bolide_runtime::flags::SHARED as i64);
+        self.builder.ins().brif(shared, slow_block, &[], unshared_block, &[]);
+
+        self.builder.switch_to_block(unshared_block);
+        self.builder.seal_block(unshared_block);
+        let count = self.builder.ins().load(types::I32, MemFlags::trusted(), val, bolide_runtime::RC_STRONG_OFFSET);
+        let more = self.builder.ins().icmp_imm(IntCC::UnsignedGreaterThan, count, 1);
+        self.builder.ins().brif(more, dec_block, &[], slow_block, &[]);
+
+        self.builder.switch_to_block(dec_block);
+        self.builder.seal_block(dec_block);
+        let dec = self.builder.ins().iadd_imm(count, -1);
+        self.builder.ins().store(MemFlags::trusted(), dec, val, bolide_runtime::RC_STRONG_OFFSET);
+        self.builder.ins().jump(done_block, &[]);
+
+        self.builder.switch_to_block(slow_block);
+        self.builder.seal_block(slow_block);
+        self.builder.ins().call(release_ref, &[val]);
+        self.builder.ins().jump(done_block, &[]);
+
+        self.builder.switch_to_block(done_block);
+        self.builder.seal_block(done_block);
+    }
+
+    /// 可以内联释放的类型：对象头在指针处、与 RcHeader 布局相同
+    fn has_inline_header(ty: &BolideType) -> bool {
+        matches!(
+            ty,
+            BolideType::Str
+                | BolideType::BigInt
+                | BolideType::Decimal
+                | BolideType::List(_)
+                | BolideType::Dict(_, _)
+                | BolideType::Dynamic
+        )
+    }
+
+    /// 值写入列表槽位前的转换：槽位是 i64，float 按位存放
+    fn to_list_slot(&mut self, val: Value) -> Value {
+        if self.builder.func.dfg.value_type(val) == types::F64 {
+            self.builder.ins().bitcast(types::I64, MemFlags::new(), val)
+        } else {
+            val
+        }
+    }
+
+    /// 从列表槽位读出的值转换为元素类型
+    fn from_list_slot(&mut self, val: Value, elem_ty: &BolideType) -> Value {
+        if *elem_ty == BolideType::Float {
+            self.builder.ins().bitcast(types::F64, MemFlags::new(), val)
+        } else {
+            val
+        }
+    }
+
+    /// 编译列表归约: sum/min/max(list)、dot(a, b)，按元素类型选择 int/float 内核
+    fn compile_list_reduce(&mut self, op: &str, list_ptr: Value, elem_ty: &BolideType, other: Option<&Expr>) -> Result<Value, String> {
+        let suffix = if *elem_ty == BolideType::Float { "float" } else { "int" };
+        let name = format!("list_{}_{}", op, suffix);
+        let func_ref = *self.func_refs.get(&name)
+            .ok_or_else(|| format!("{} not found", name))?;
+        let call = if op == "dot" {
+            let other = other.ok_or("dot expects 2 lists")?;
+            let other_ptr = self.compile_expr(other)?;
+            self.builder.ins().call(func_ref, &[list_ptr, other_ptr])
+        } else {
+            self.builder.ins().call(func_ref, &[list_ptr])
+        };
+        Ok(self.builder.inst_results(call)[0])
+    }
+
     /// 编译列表方法调用
-    fn compile_list_method_call(&mut self, list_ptr: Value, method_name: &str, args: &[Expr]) -> Result<Value, String> {
+    fn compile_list_method_call(&mut self, list_ptr: Value, elem_ty: &BolideType, method_name: &str, args: &[Expr]) -> Result<Value, String> {
         match method_name {
             // push(value) -> void
             "push" | "append" => {
@@ -6727,6 +8046,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     return Err(format!("{} expects 1 argument", method_name));
                 }
                 let value = self.compile_expr(&args[0])?;
+                let value = self.to_list_slot(value);
                 let func_ref = *self.func_refs.get("list_push").ok_or("list_push not found")?;
                 self.builder.ins().call(func_ref, &[list_ptr, value]);
                 Ok(self.builder.ins().iconst(types::I64, 0))
@@ -6735,13 +8055,12 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             "pop" => {
                 let func_ref = *self.func_refs.get("list_pop").ok_or("list_pop not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.builder.inst_results(call)[0];
+                Ok(self.from_list_slot(val, elem_ty))
             }
             // len() -> int
             "len" | "length" | "size" => {
-                let func_ref = *self.func_refs.get("list_len").ok_or("list_len not found")?;
-                let call = self.builder.ins().call(func_ref, &[list_ptr]);
-                Ok(self.builder.inst_results(call)[0])
+                Ok(self.emit_len_field(list_ptr, bolide_runtime::LIST_LEN_OFFSET))
             }
             // get(index) -> value
             "get" => {
@@ -6749,9 +8068,8 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     return Err("get expects 1 argument".to_string());
                 }
                 let index = self.compile_expr(&args[0])?;
-                let func_ref = *self.func_refs.get("list_get").ok_or("list_get not found")?;
-                let call = self.builder.ins().call(func_ref, &[list_ptr, index]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.emit_list_get(list_ptr, index)?;
+                Ok(self.from_list_slot(val, elem_ty))
             }
             // set(index, value) -> bool
             "set" => {
@@ -6760,9 +8078,8 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 }
                 let index = self.compile_expr(&args[0])?;
                 let value = self.compile_expr(&args[1])?;
-                let func_ref = *self.func_refs.get("list_set").ok_or("list_set not found")?;
-                let call = self.builder.ins().call(func_ref, &[list_ptr, index, value]);
-                Ok(self.builder.inst_results(call)[0])
+                let value = self.to_list_slot(value);
+                self.emit_list_set(list_ptr, index, value, elem_ty)
             }
             // insert(index, value) -> void
             "insert" => {
@@ -6771,6 +8088,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 }
                 let index = self.compile_expr(&args[0])?;
                 let value = self.compile_expr(&args[1])?;
+                let value = self.to_list_slot(value);
                 let func_ref = *self.func_refs.get("list_insert").ok_or("list_insert not found")?;
                 self.builder.ins().call(func_ref, &[list_ptr, index, value]);
                 Ok(self.builder.ins().iconst(types::I64, 0))
@@ -6783,7 +8101,8 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 let index = self.compile_expr(&args[0])?;
                 let func_ref = *self.func_refs.get("list_remove").ok_or("list_remove not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr, index]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.builder.inst_results(call)[0];
+                Ok(self.from_list_slot(val, elem_ty))
             }
             // clear() -> void
             "clear" => {
@@ -6813,6 +8132,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     return Err(format!("{} expects 1 argument", method_name));
                 }
                 let value = self.compile_expr(&args[0])?;
+                let value = self.to_list_slot(value);
                 let func_ref = *self.func_refs.get("list_contains").ok_or("list_contains not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr, value]);
                 Ok(self.builder.inst_results(call)[0])
@@ -6823,6 +8143,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     return Err(format!("{} expects 1 argument", method_name));
                 }
                 let value = self.compile_expr(&args[0])?;
+                let value = self.to_list_slot(value);
                 let func_ref = *self.func_refs.get("list_index_of").ok_or("list_index_of not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr, value]);
                 Ok(self.builder.inst_results(call)[0])
@@ -6833,6 +8154,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                     return Err("count expects 1 argument".to_string());
                 }
                 let value = self.compile_expr(&args[0])?;
+                let value = self.to_list_slot(value);
                 let func_ref = *self.func_refs.get("list_count").ok_or("list_count not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr, value]);
                 Ok(self.builder.inst_results(call)[0])
@@ -6843,6 +8165,15 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 self.builder.ins().call(func_ref, &[list_ptr]);
                 Ok(self.builder.ins().iconst(types::I64, 0))
             }
+            // sum() / min() / max() -> 元素类型（int 或 float）
+            "sum" | "min" | "max" => self.compile_list_reduce(method_name, list_ptr, elem_ty, None),
+            // dot(other) -> 元素类型
+            "dot" => {
+                if args.len() != 1 {
+                    return Err("dot expects 1 argument".to_string());
+                }
+                self.compile_list_reduce("dot", list_ptr, elem_ty, Some(&args[0]))
+            }
             // slice(start, end) -> list
             "slice" => {
                 if args.len() != 2 {
@@ -6864,13 +8195,15 @@ impl<'a, 'b> CompileContext<'a, 'b> {
             "first" => {
                 let func_ref = *self.func_refs.get("list_first").ok_or("list_first not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.builder.inst_results(call)[0];
+                Ok(self.from_list_slot(val, elem_ty))
             }
             // last() -> value
             "last" => {
                 let func_ref = *self.func_refs.get("list_last").ok_or("list_last not found")?;
                 let call = self.builder.ins().call(func_ref, &[list_ptr]);
-                Ok(self.builder.inst_results(call)[0])
+                let val = self.builder.inst_results(call)[0];
+                Ok(self.from_list_slot(val, elem_ty))
             }
             // copy() -> list (shallow copy, same as clone)
             "copy" | "clone" => {
@@ -6911,9 +8244,7 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 Ok(self.builder.inst_results(call)[0])
             }
              "len" => {
-                let len_fn = *self.func_refs.get("dict_len").ok_or("dict_len failed")?;
-                let call = self.builder.ins().call(len_fn, &[dict_ptr]);
-                Ok(self.builder.inst_results(call)[0])
+                Ok(self.emit_len_field(dict_ptr, bolide_runtime::DICT_LEN_OFFSET))
             }
              "is_empty" => {
                 let is_empty_fn = *self.func_refs.get("dict_is_empty").ok_or("dict_is_empty failed")?;
@@ -7014,6 +8345,13 @@ impl<'a, 'b> CompileContext<'a, 'b> {
                 }
             }
         }
+
+        // 顶层 extern 块已由 JitCompiler 解析过，只解析新出现的块
+        let unresolved = eb.declarations.iter().any(|decl| matches!(decl,
+            bolide_parser::ExternDecl::Function(func) if !self.extern_symbols.contains_key(&func.name)));
+        if unresolved {
+            self.extern_symbols.extend(resolve_extern_block(eb));
+        }
         Ok(())
     }
 
@@ -7054,22 +8392,24 @@ impl<'a, 'b> CompileContext<'a, 'b> {
         extern_func: &bolide_parser::ExternFunc,
         args: &[Expr],
     ) -> Result<Value, String> {
-        // 1. 创建库路径字符串常量
-        let lib_path_ptr = self.create_string_constant(lib_path)?;
-
-        // 2. 加载库
-        let load_lib_ref = *self.func_refs.get("ffi_load_library")
-            .ok_or("ffi_load_library not found")?;
-        self.builder.ins().call(load_lib_ref, &[lib_path_ptr]);
-
-        // 3. 创建函数名字符串常量
-        let func_name_ptr = self.create_string_constant(&extern_func.name)?;
-
-        // 4. 获取函数指针
-        let get_symbol_ref = *self.func_refs.get("ffi_get_symbol")
-            .ok_or("ffi_get_symbol not found")?;
-        let call = self.builder.ins().call(get_symbol_ref, &[lib_path_ptr, func_name_ptr]);
-        let func_ptr = self.builder.inst_results(call)[0];
+        // 1-4. 取得函数指针
+        let func_ptr = match self.extern_symbols.get(&extern_func.name) {
+            // extern 块注册时已经解析：地址是常量，直接间接调用
+            Some(&addr) => self.builder.ins().iconst(self.ptr_type, addr as i64),
+            // 库或符号缺失：每次调用时经运行时查找，由运行时报告错误
+            None => {
+                let lib_path_ptr = self.create_string_constant(lib_path)?;
+                let load_lib_ref = *self.func_refs.get("ffi_load_library")
+                    .ok_or("ffi_load_library not found")?;
+                self.builder.ins().call(load_lib_ref, &[lib_path_ptr]);
+
+                let func_name_ptr = self.create_string_constant(&extern_func.name)?;
+                let get_symbol_ref = *self.func_refs.get("ffi_get_symbol")
+                    .ok_or("ffi_get_symbol not found")?;
+                let call = self.builder.ins().call(get_symbol_ref, &[lib_path_ptr, func_name_ptr]);
+                self.builder.inst_results(call)[0]
+            }
+        };
 
         // 5. 编译参数并进行类型转换
         let mut arg_values = Vec::new();
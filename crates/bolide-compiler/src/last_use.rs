@@ -0,0 +1,294 @@
+//! 最后使用分析：找出读取后不再使用的变量引用
+//!
+//! 对函数体做一次逆序扫描，得到每条简单语句之后仍然活跃的变量名。
+//! 变量在一条语句中只出现一次、且语句之后不再活跃时，这次读取可以直接转移所有权：
+//! 编译器把变量置空而不是 clone，作用域结束时对空指针的 release 直接跳过，
+//! 这一对 retain/release 就抵消了。
+//!
+//! 分析按变量名进行，只会把变量多算成活跃，不会漏算：
+//! - if 的各分支分别分析，出口活跃集相同
+//! - 循环中出现的变量在整个循环里都视为活跃（下一轮还会读取），
+//!   循环体顶层先声明后使用的变量除外，它们每轮都会重新赋值
+//! - pool / select / await scope 等块里出现的变量整体视为活跃，块内不做移动
+//!
+//! 结果用 Expr 节点地址标识：编译期间 AST 只读且不会移动，地址在整个函数编译期间有效。
+
+use std::collections::{HashMap, HashSet};
+
+use bolide_parser::{AsyncSelectBranch, Expr, SelectBranch, Statement};
+
+/// 可以转移所有权的 Ident 节点
+pub(crate) type LastUses = HashSet<*const Expr>;
+
+/// 分析函数体，返回其中所有最后一次使用的变量读取
+pub(crate) fn analyze(body: &[Statement]) -> LastUses {
+    let mut moves = LastUses::new();
+    let mut live = HashSet::new();
+    visit_block(body, &mut live, &mut moves);
+    moves
+}
+
+/// 函数体中出现的所有名字（变量、赋值目标和被调用的函数名）
+///
+/// 编译器据此找出被其他线程执行的函数会访问哪些全局变量
+pub(crate) fn referenced_names(body: &[Statement]) -> HashSet<String> {
+    let mut names = HashSet::new();
+    block_names(body, &mut names);
+    names
+}
+
+/// 逆序扫描语句块：live 传入时是块出口的活跃集，返回时是块入口的活跃集
+fn visit_block(stmts: &[Statement], live: &mut HashSet<String>, moves: &mut LastUses) {
+    for stmt in stmts.iter().rev() {
+        visit_stmt(stmt, live, moves);
+    }
+}
+
+fn visit_stmt(stmt: &Statement, live: &mut HashSet<String>, moves: &mut LastUses) {
+    match stmt {
+        Statement::VarDecl(_) | Statement::Assign(_) | Statement::Expr(_)
+        | Statement::Return(_) | Statement::Send(_) => {
+            let mut reads = Vec::new();
+            let mut counts = HashMap::new();
+            simple_stmt_refs(stmt, &mut reads, &mut counts);
+            for expr in reads {
+                if let Expr::Ident(name) = expr {
+                    if counts.get(name.as_str()) == Some(&1) && !live.contains(name) {
+                        moves.insert(expr as *const Expr);
+                    }
+                }
+            }
+            live.extend(counts.into_keys().map(str::to_string));
+        }
+        Statement::If(if_stmt) => {
+            let live_out = live.clone();
+            let mut live_in = HashSet::new();
+            let bodies = std::iter::once(&if_stmt.then_body)
+                .chain(if_stmt.elif_branches.iter().map(|(_, body)| body))
+                .chain(if_stmt.else_body.as_ref());
+            for body in bodies {
+                let mut branch_live = live_out.clone();
+                visit_block(body, &mut branch_live, moves);
+                live_in.extend(branch_live);
+            }
+            if if_stmt.else_body.is_none() {
+                live_in.extend(live_out);
+            }
+            let mut names = HashSet::new();
+            expr_names(&if_stmt.condition, &mut names);
+            for (cond, _) in &if_stmt.elif_branches {
+                expr_names(cond, &mut names);
+            }
+            live_in.extend(names);
+            *live = live_in;
+        }
+        Statement::While(while_stmt) => {
+            let mut header = HashSet::new();
+            expr_names(&while_stmt.condition, &mut header);
+            visit_loop(&while_stmt.body, header, &[], live, moves);
+        }
+        Statement::For(for_stmt) => {
+            let mut header = HashSet::new();
+            expr_names(&for_stmt.iter, &mut header);
+            visit_loop(&for_stmt.body, header, &for_stmt.vars, live, moves);
+        }
+        Statement::Pool(_) | Statement::Select(_) | Statement::AwaitScope(_) | Statement::AsyncSelect(_) => {
+            stmt_names(stmt, live);
+        }
+        Statement::FuncDef(_) | Statement::ClassDef(_) | Statement::Import(_) | Statement::ExternBlock(_) => {}
+    }
+}
+
+/// 循环：循环中出现的变量在整个循环里活跃，每轮重新定义的变量除外
+fn visit_loop(
+    body: &[Statement],
+    header: HashSet<String>,
+    loop_vars: &[String],
+    live: &mut HashSet<String>,
+    moves: &mut LastUses,
+) {
+    let mut names = HashSet::new();
+    block_names(body, &mut names);
+    let locals = iteration_locals(body);
+    for name in names {
+        if !locals.contains(&name) && !loop_vars.contains(&name) {
+            live.insert(name);
+        }
+    }
+    // 条件和迭代对象每轮都会重新读取
+    live.extend(header);
+
+    let mut body_live = live.clone();
+    visit_block(body, &mut body_live, moves);
+    live.extend(body_live);
+}
+
+/// 循环体顶层声明、且声明前没有被读取的变量：每轮开头都会被重新赋值，不跨轮活跃
+fn iteration_locals(body: &[Statement]) -> HashSet<String> {
+    let mut seen = HashSet::new();
+    let mut locals = HashSet::new();
+    for stmt in body {
+        if let Statement::VarDecl(decl) = stmt {
+            let self_ref = decl.value.as_ref().map_or(false, |v| {
+                let mut names = HashSet::new();
+                expr_names(v, &mut names);
+                names.contains(&decl.name)
+            });
+            if !seen.contains(&decl.name) && !self_ref {
+                locals.insert(decl.name.clone());
+            }
+        }
+        stmt_names(stmt, &mut seen);
+    }
+    locals
+}
+
+/// 简单语句中的读取位置（Ident 节点）和每个名字的出现次数（含赋值目标、声明名）
+fn simple_stmt_refs<'e>(stmt: &'e Statement, reads: &mut Vec<&'e Expr>, counts: &mut HashMap<&'e str, usize>) {
+    match stmt {
+        Statement::VarDecl(decl) => {
+            *counts.entry(decl.name.as_str()).or_insert(0) += 1;
+            if let Some(ref value) = decl.value {
+                expr_refs(value, reads, counts);
+            }
+        }
+        Statement::Assign(assign) => {
+            match &assign.target {
+                // 赋值目标本身不是读取，只计数
+                Expr::Ident(name) => *counts.entry(name.as_str()).or_insert(0) += 1,
+                target => {
+                    let mut target_reads = Vec::new();
+                    expr_refs(target, &mut target_reads, counts);
+                }
+            }
+            expr_refs(&assign.value, reads, counts);
+        }
+        Statement::Expr(e) | Statement::Return(Some(e)) => expr_refs(e, reads, counts),
+        Statement::Send(send) => {
+            *counts.entry(send.channel.as_str()).or_insert(0) += 1;
+            expr_refs(&send.value, reads, counts);
+        }
+        _ => {}
+    }
+}
+
+fn expr_refs<'e>(expr: &'e Expr, reads: &mut Vec<&'e Expr>, counts: &mut HashMap<&'e str, usize>) {
+    match expr {
+        Expr::Ident(name) => {
+            *counts.entry(name.as_str()).or_insert(0) += 1;
+            reads.push(expr);
+        }
+        Expr::Recv(name) => *counts.entry(name.as_str()).or_insert(0) += 1,
+        Expr::BinOp(left, _, right) | Expr::Index(left, right) => {
+            expr_refs(left, reads, counts);
+            expr_refs(right, reads, counts);
+        }
+        Expr::UnaryOp(_, inner) | Expr::Member(inner, _) | Expr::Await(inner) => expr_refs(inner, reads, counts),
+        Expr::Call(callee, args) => {
+            match callee.as_ref() {
+                // 被调用的函数名不是值读取
+                Expr::Ident(name) => *counts.entry(name.as_str()).or_insert(0) += 1,
+                callee => expr_refs(callee, reads, counts),
+            }
+            for arg in args {
+                expr_refs(arg, reads, counts);
+            }
+        }
+        Expr::Spawn(_, items) | Expr::List(items) | Expr::Tuple(items) | Expr::AwaitAll(items) => {
+            for item in items {
+                expr_refs(item, reads, counts);
+            }
+        }
+        Expr::Dict(pairs) => {
+            for (k, v) in pairs {
+                expr_refs(k, reads, counts);
+                expr_refs(v, reads, counts);
+            }
+        }
+        Expr::Int(_) | Expr::Float(_) | Expr::Bool(_) | Expr::String(_)
+        | Expr::BigInt(_) | Expr::Decimal(_) | Expr::None => {}
+    }
+}
+
+fn expr_names(expr: &Expr, names: &mut HashSet<String>) {
+    let mut reads = Vec::new();
+    let mut counts = HashMap::new();
+    expr_refs(expr, &mut reads, &mut counts);
+    names.extend(counts.into_keys().map(str::to_string));
+}
+
+fn block_names(stmts: &[Statement], names: &mut HashSet<String>) {
+    for stmt in stmts {
+        stmt_names(stmt, names);
+    }
+}
+
+/// 语句（含嵌套语句块）中出现的所有变量名
+fn stmt_names(stmt: &Statement, names: &mut HashSet<String>) {
+    match stmt {
+        Statement::VarDecl(_) | Statement::Assign(_) | Statement::Expr(_)
+        | Statement::Return(_) | Statement::Send(_) => {
+            let mut reads = Vec::new();
+            let mut counts = HashMap::new();
+            simple_stmt_refs(stmt, &mut reads, &mut counts);
+            names.extend(counts.into_keys().map(str::to_string));
+        }
+        Statement::If(if_stmt) => {
+            expr_names(&if_stmt.condition, names);
+            block_names(&if_stmt.then_body, names);
+            for (cond, body) in &if_stmt.elif_branches {
+                expr_names(cond, names);
+                block_names(body, names);
+            }
+            if let Some(ref body) = if_stmt.else_body {
+                block_names(body, names);
+            }
+        }
+        Statement::While(while_stmt) => {
+            expr_names(&while_stmt.condition, names);
+            block_names(&while_stmt.body, names);
+        }
+        Statement::For(for_stmt) => {
+            names.extend(for_stmt.vars.iter().cloned());
+            expr_names(&for_stmt.iter, names);
+            block_names(&for_stmt.body, names);
+        }
+        Statement::Pool(pool_stmt) => {
+            expr_names(&pool_stmt.size, names);
+            block_names(&pool_stmt.body, names);
+        }
+        Statement::Select(select_stmt) => {
+            for branch in &select_stmt.branches {
+                match branch {
+                    SelectBranch::Recv { var, channel, body } => {
+                        names.insert(var.clone());
+                        names.insert(channel.clone());
+                        block_names(body, names);
+                    }
+                    SelectBranch::Timeout { duration, body } => {
+                        expr_names(duration, names);
+                        block_names(body, names);
+                    }
+                    SelectBranch::Default { body } => block_names(body, names),
+                }
+            }
+        }
+        Statement::AwaitScope(scope_stmt) => block_names(&scope_stmt.body, names),
+        Statement::AsyncSelect(async_select) => {
+            for branch in &async_select.branches {
+                match branch {
+                    AsyncSelectBranch::Bind { var, expr, body } => {
+                        names.insert(var.clone());
+                        expr_names(expr, names);
+                        block_names(body, names);
+                    }
+                    AsyncSelectBranch::Expr { expr, body } => {
+                        expr_names(expr, names);
+                        block_names(body, names);
+                    }
+                }
+            }
+        }
+        Statement::FuncDef(_) | Statement::ClassDef(_) | Statement::Import(_) | Statement::ExternBlock(_) => {}
+    }
+}
@@ -4,8 +4,11 @@
 
 mod jit;
 mod aot;
+mod options;
+mod last_use;
 
 pub use jit::JitCompiler;
 pub use aot::AotCompiler;
 pub use aot::AotCompileResult;
 pub use aot::RUNTIME_SYMBOLS;
+pub use options::{CompileOptions, OptLevel};
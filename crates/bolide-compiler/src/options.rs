@@ -0,0 +1,91 @@
+//! 编译选项：优化级别与目标 CPU
+//!
+//! JIT 与 AOT 共用同一套 Cranelift 标志位构建逻辑：
+//! - `-O0`：opt_level=none，开启 IR 校验（默认，编译最快，适合开发时运行）
+//! - `-O1`：opt_level=speed，保留 IR 校验
+//! - `-O2`：opt_level=speed，关闭 IR 校验（发布构建）
+//! - `--target-cpu=native`：AOT 启用宿主 CPU 支持的全部指令集扩展（AVX2 等），
+//!   默认只用基线指令集，生成的可执行文件可以拷到其他机器运行
+//! - `--profile`：在每个函数入口/返回处插入计数和计时调用，退出时由运行时打印报告
+
+use cranelift::prelude::settings::{self, Configurable};
+use cranelift_codegen::isa::OwnedTargetIsa;
+
+/// 优化级别
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum OptLevel {
+    #[default]
+    O0,
+    O1,
+    O2,
+}
+
+impl OptLevel {
+    /// 从命令行的数字级别转换（0/1/2）
+    pub fn from_level(level: u8) -> Option<Self> {
+        match level {
+            0 => Some(OptLevel::O0),
+            1 => Some(OptLevel::O1),
+            2 => Some(OptLevel::O2),
+            _ => None,
+        }
+    }
+
+    /// (opt_level, enable_verifier)
+    fn cranelift_settings(self) -> (&'static str, &'static str) {
+        match self {
+            OptLevel::O0 => ("none", "true"),
+            OptLevel::O1 => ("speed", "true"),
+            OptLevel::O2 => ("speed", "false"),
+        }
+    }
+}
+
+/// 编译选项
+#[derive(Clone, Copy, Debug, Default)]
+pub struct CompileOptions {
+    pub opt_level: OptLevel,
+    /// 针对宿主 CPU 生成代码（仅影响 AOT；JIT 代码只在本机运行，总是使用宿主特性）
+    pub target_native: bool,
+    /// 剖析模式：插入函数计数/计时，RC 释放全部经过运行时以便计数
+    pub profile: bool,
+}
+
+impl CompileOptions {
+    pub fn new(opt_level: OptLevel, target_native: bool) -> Self {
+        Self { opt_level, target_native, profile: false }
+    }
+
+    /// 开启或关闭剖析模式
+    pub fn with_profile(mut self, profile: bool) -> Self {
+        self.profile = profile;
+        self
+    }
+
+    /// 构建 Cranelift 标志位
+    fn flags(&self, jit: bool) -> Result<settings::Flags, String> {
+        let mut builder = settings::builder();
+        let (opt_level, verifier) = self.opt_level.cranelift_settings();
+        let mut set = |name: &str, value: &str| {
+            builder.set(name, value)
+                .map_err(|e| format!("Failed to set {}={}: {}", name, value, e))
+        };
+        set("opt_level", opt_level)?;
+        set("enable_verifier", verifier)?;
+        if jit {
+            // 与 JITBuilder::new 一致：JIT 代码按绝对地址调用运行时函数
+            set("use_colocated_libcalls", "false")?;
+            set("is_pic", "false")?;
+        }
+        Ok(settings::Flags::new(builder))
+    }
+
+    /// 构建目标 ISA
+    pub(crate) fn isa(&self, jit: bool) -> Result<OwnedTargetIsa, String> {
+        let infer_native_flags = jit || self.target_native;
+        let isa_builder = cranelift_native::builder_with_options(infer_native_flags)
+            .map_err(|e| format!("Failed to create ISA builder: {}", e))?;
+        isa_builder.finish(self.flags(jit)?)
+            .map_err(|e| format!("Failed to create ISA: {}", e))
+    }
+}
@@ -1,18 +1,32 @@
 //! Bolide BigInt type with reference counting
 //!
 //! BolideBigInt 使用引用计数管理内存
+//!
+//! 小整数直接编码在指针里，不分配堆对象：
+//! - 指针最低位为 1 表示内联整数，值为 `ptr >> 1`（63 位有符号，范围见 SMALL_MIN/SMALL_MAX）
+//! - 堆对象至少 8 字节对齐，最低位总为 0；null 仍表示无效值
+//! - 运算结果超出小整数范围时（用 overflowing_* 检测）才提升为堆上的 num_bigint::BigInt
+//! - 读取值一律经 `BolideBigInt::view`，不要直接对 BigInt 指针解引用
 
 use num_bigint::BigInt;
-use num_traits::{Zero, Signed, ToPrimitive};
+use num_traits::{Zero, ToPrimitive};
+use std::borrow::Cow;
 use std::cell::Cell;
+use std::cmp::Ordering as CmpOrdering;
 use std::sync::atomic::{AtomicI64, Ordering};
 
 use crate::rc::{TypeTag, flags};
 
-// Debug: 跟踪分配和释放
+// Debug: 跟踪分配和释放（只统计堆对象）
 static BIGINT_ALLOC_COUNT: AtomicI64 = AtomicI64::new(0);
 static BIGINT_FREE_COUNT: AtomicI64 = AtomicI64::new(0);
 
+/// 内联小整数标记位
+const SMALL_TAG: usize = 1;
+/// 内联小整数范围
+const SMALL_MIN: i64 = i64::MIN >> 1;
+const SMALL_MAX: i64 = i64::MAX >> 1;
+
 /// RC 对象头
 #[repr(C)]
 struct RcHeader {
@@ -30,25 +44,66 @@ pub struct BolideBigInt {
     inner: BigInt,
 }
 
+/// BigInt 值视图：内联小整数或堆对象
+pub enum BigValue<'a> {
+    Small(i64),
+    Heap(&'a BolideBigInt),
+}
+
+impl<'a> BigValue<'a> {
+    pub fn to_bigint(&self) -> Cow<'a, BigInt> {
+        match *self {
+            BigValue::Small(v) => Cow::Owned(BigInt::from(v)),
+            BigValue::Heap(h) => Cow::Borrowed(&h.inner),
+        }
+    }
+
+    pub fn to_i64(&self) -> Option<i64> {
+        match self {
+            BigValue::Small(v) => Some(*v),
+            BigValue::Heap(h) => h.to_i64(),
+        }
+    }
+
+    pub fn to_f64(&self) -> f64 {
+        match self {
+            BigValue::Small(v) => *v as f64,
+            BigValue::Heap(h) => h.to_f64(),
+        }
+    }
+
+    pub fn to_string(&self) -> String {
+        match self {
+            BigValue::Small(v) => v.to_string(),
+            BigValue::Heap(h) => h.to_string(),
+        }
+    }
+
+    pub fn is_zero(&self) -> bool {
+        match self {
+            BigValue::Small(v) => *v == 0,
+            BigValue::Heap(h) => h.is_zero(),
+        }
+    }
+
+    fn cmp(&self, other: &BigValue) -> CmpOrdering {
+        match (self, other) {
+            (BigValue::Small(a), BigValue::Small(b)) => a.cmp(b),
+            _ => self.to_bigint().as_ref().cmp(other.to_bigint().as_ref()),
+        }
+    }
+}
+
 impl BolideBigInt {
-    /// 创建新 BigInt（ref_count = 1）
+    /// 创建新 BigInt（堆对象，ref_count = 1）
     pub fn new(value: i64) -> *mut Self {
-        BIGINT_ALLOC_COUNT.fetch_add(1, Ordering::SeqCst);
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::BigInt,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            inner: BigInt::from(value),
-        }))
+        Self::from_bigint(BigInt::from(value))
     }
 
+    /// 从 BigInt 创建堆对象（ref_count = 1）
     pub fn from_bigint(inner: BigInt) -> *mut Self {
         BIGINT_ALLOC_COUNT.fetch_add(1, Ordering::SeqCst);
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -57,11 +112,55 @@ impl BolideBigInt {
                 _padding: [0; 6],
             },
             inner,
-        }))
+        })
+    }
+
+    /// 从 i64 创建：在小整数范围内时内联，否则分配堆对象
+    #[inline]
+    pub fn from_i64(value: i64) -> *mut Self {
+        Self::encode_small(value).unwrap_or_else(|| Self::new(value))
+    }
+
+    /// 从运算结果创建：能放进小整数时内联
+    fn from_result(value: BigInt) -> *mut Self {
+        match value.to_i64().and_then(Self::encode_small) {
+            Some(small) => small,
+            None => Self::from_bigint(value),
+        }
     }
 
     pub fn from_str(s: &str) -> Option<*mut Self> {
-        s.parse::<BigInt>().ok().map(Self::from_bigint)
+        s.parse::<BigInt>().ok().map(Self::from_result)
+    }
+
+    /// 是否为内联小整数
+    #[inline]
+    pub fn is_small(ptr: *const Self) -> bool {
+        ptr as usize & SMALL_TAG != 0
+    }
+
+    #[inline]
+    fn encode_small(value: i64) -> Option<*mut Self> {
+        if (SMALL_MIN..=SMALL_MAX).contains(&value) {
+            Some(((value << 1) as usize | SMALL_TAG) as *mut Self)
+        } else {
+            None
+        }
+    }
+
+    #[inline]
+    fn small_value(ptr: *const Self) -> i64 {
+        (ptr as usize as i64) >> 1
+    }
+
+    /// 读取值；ptr 必须非 null
+    #[inline]
+    pub unsafe fn view<'a>(ptr: *const Self) -> BigValue<'a> {
+        if Self::is_small(ptr) {
+            BigValue::Small(Self::small_value(ptr))
+        } else {
+            BigValue::Heap(&*ptr)
+        }
     }
 
     pub fn inner(&self) -> &BigInt {
@@ -88,20 +187,17 @@ impl BolideBigInt {
 
     #[inline]
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     #[inline]
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
@@ -119,7 +215,7 @@ impl BolideBigInt {
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_from_i64(value: i64) -> *mut BolideBigInt {
-    BolideBigInt::new(value)
+    BolideBigInt::from_i64(value)
 }
 
 #[no_mangle]
@@ -129,10 +225,10 @@ pub extern "C" fn bolide_bigint_from_str(s: *const i8, len: usize) -> *mut Bolid
     BolideBigInt::from_str(s).unwrap_or(std::ptr::null_mut())
 }
 
-/// 增加引用计数
+/// 增加引用计数（内联小整数无需计数）
 #[no_mangle]
 pub extern "C" fn bolide_bigint_retain(b: *mut BolideBigInt) -> *mut BolideBigInt {
-    if !b.is_null() {
+    if !b.is_null() && !BolideBigInt::is_small(b) {
         unsafe { (*b).retain(); }
     }
     b
@@ -141,19 +237,20 @@ pub extern "C" fn bolide_bigint_retain(b: *mut BolideBigInt) -> *mut BolideBigIn
 /// 减少引用计数
 #[no_mangle]
 pub extern "C" fn bolide_bigint_release(b: *mut BolideBigInt) {
-    if b.is_null() { return; }
+    if b.is_null() || BolideBigInt::is_small(b) { return; }
     unsafe {
         if (*b).release() {
             BIGINT_FREE_COUNT.fetch_add(1, Ordering::SeqCst);
-            let _ = Box::from_raw(b);
+            crate::slab::free_value(b);
         }
     }
 }
 
-/// 深拷贝
+/// 深拷贝（内联小整数按值传递，直接返回）
 #[no_mangle]
 pub extern "C" fn bolide_bigint_clone(a: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() { return std::ptr::null_mut(); }
+    if BolideBigInt::is_small(a) { return a as *mut BolideBigInt; }
     let a = unsafe { &*a };
     BolideBigInt::from_bigint(a.inner.clone())
 }
@@ -167,109 +264,224 @@ pub extern "C" fn bolide_bigint_free(b: *mut BolideBigInt) {
 #[no_mangle]
 pub extern "C" fn bolide_bigint_ref_count(b: *const BolideBigInt) -> u32 {
     if b.is_null() { return 0; }
+    if BolideBigInt::is_small(b) { return 1; }
     unsafe { (*b).ref_count() }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_to_i64(a: *const BolideBigInt) -> i64 {
     if a.is_null() { return 0; }
-    unsafe { (*a).to_i64().unwrap_or(0) }
+    unsafe { BolideBigInt::view(a).to_i64().unwrap_or(0) }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_to_f64(a: *const BolideBigInt) -> f64 {
     if a.is_null() { return 0.0; }
-    unsafe { (*a).to_f64() }
+    unsafe { BolideBigInt::view(a).to_f64() }
 }
 
 // ==================== 算术运算（返回新对象，ref_count = 1）====================
+//
+// 两个操作数都是内联小整数时直接在标记值上计算：
+//   加: (2a+1) - 1 + (2b+1) = 2(a+b)+1
+//   减: (2a+1) - 2b          = 2(a-b)+1
+//   乘: a * 2b + 1           = 2ab+1
+// overflowing_* 溢出即说明结果超出小整数范围，再走 num_bigint。
+
+#[inline]
+fn small_pair(a: *const BolideBigInt, b: *const BolideBigInt) -> Option<(i64, i64)> {
+    if BolideBigInt::is_small(a) && BolideBigInt::is_small(b) {
+        Some((a as usize as i64, b as usize as i64))
+    } else {
+        None
+    }
+}
+
+#[inline]
+fn tagged(raw: i64) -> *mut BolideBigInt {
+    raw as usize as *mut BolideBigInt
+}
+
+#[inline]
+fn small_add(a: *const BolideBigInt, b: *const BolideBigInt) -> Option<*mut BolideBigInt> {
+    let (ta, tb) = small_pair(a, b)?;
+    match (ta ^ 1).overflowing_add(tb) {
+        (raw, false) => Some(tagged(raw)),
+        _ => None,
+    }
+}
+
+#[inline]
+fn small_sub(a: *const BolideBigInt, b: *const BolideBigInt) -> Option<*mut BolideBigInt> {
+    let (ta, tb) = small_pair(a, b)?;
+    match ta.overflowing_sub(tb ^ 1) {
+        (raw, false) => Some(tagged(raw)),
+        _ => None,
+    }
+}
+
+#[inline]
+fn small_mul(a: *const BolideBigInt, b: *const BolideBigInt) -> Option<*mut BolideBigInt> {
+    let (ta, tb) = small_pair(a, b)?;
+    match (ta >> 1).overflowing_mul(tb ^ 1) {
+        (raw, false) => Some(tagged(raw | 1)),
+        _ => None,
+    }
+}
+
+/// 通用路径：转成 num_bigint 计算
+unsafe fn heap_op(
+    a: *const BolideBigInt,
+    b: *const BolideBigInt,
+    op: impl FnOnce(&BigInt, &BigInt) -> BigInt,
+) -> *mut BolideBigInt {
+    let (a, b) = (BolideBigInt::view(a), BolideBigInt::view(b));
+    BolideBigInt::from_result(op(a.to_bigint().as_ref(), b.to_bigint().as_ref()))
+}
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_add(a: *const BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() || b.is_null() { return std::ptr::null_mut(); }
-    let (a, b) = unsafe { (&*a, &*b) };
-    BolideBigInt::from_bigint(&a.inner + &b.inner)
+    if let Some(r) = small_add(a, b) { return r; }
+    unsafe { heap_op(a, b, |a, b| a + b) }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_sub(a: *const BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() || b.is_null() { return std::ptr::null_mut(); }
-    let (a, b) = unsafe { (&*a, &*b) };
-    BolideBigInt::from_bigint(&a.inner - &b.inner)
+    if let Some(r) = small_sub(a, b) { return r; }
+    unsafe { heap_op(a, b, |a, b| a - b) }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_mul(a: *const BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() || b.is_null() { return std::ptr::null_mut(); }
-    let (a, b) = unsafe { (&*a, &*b) };
-    BolideBigInt::from_bigint(&a.inner * &b.inner)
+    if let Some(r) = small_mul(a, b) { return r; }
+    unsafe { heap_op(a, b, |a, b| a * b) }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_div(a: *const BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() || b.is_null() { return std::ptr::null_mut(); }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if b.is_zero() { return std::ptr::null_mut(); }
-    BolideBigInt::from_bigint(&a.inner / &b.inner)
+    unsafe {
+        if BolideBigInt::view(b).is_zero() { return std::ptr::null_mut(); }
+        if let Some((ta, tb)) = small_pair(a, b) {
+            // 截断除法与 num_bigint 一致；SMALL_MIN / -1 超出范围时由 from_i64 提升
+            return BolideBigInt::from_i64((ta >> 1) / (tb >> 1));
+        }
+        heap_op(a, b, |a, b| a / b)
+    }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_rem(a: *const BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() || b.is_null() { return std::ptr::null_mut(); }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if b.is_zero() { return std::ptr::null_mut(); }
-    BolideBigInt::from_bigint(&a.inner % &b.inner)
+    unsafe {
+        if BolideBigInt::view(b).is_zero() { return std::ptr::null_mut(); }
+        if let Some((ta, tb)) = small_pair(a, b) {
+            return BolideBigInt::from_i64((ta >> 1) % (tb >> 1));
+        }
+        heap_op(a, b, |a, b| a % b)
+    }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_neg(a: *const BolideBigInt) -> *mut BolideBigInt {
     if a.is_null() { return std::ptr::null_mut(); }
-    let a = unsafe { &*a };
-    BolideBigInt::from_bigint(-&a.inner)
+    unsafe {
+        match BolideBigInt::view(a) {
+            BigValue::Small(v) => BolideBigInt::from_i64(-v),
+            BigValue::Heap(h) => BolideBigInt::from_result(-&h.inner),
+        }
+    }
 }
 
+// ==================== 原地运算（a = a op b）====================
+//
+// 消费 a 的引用并返回结果：小整数直接计算；a 是独占的堆对象时原地修改，
+// 累加循环不再每步分配；否则退回普通运算并释放 a。
+
+/// a 是否可以原地修改（独占的堆对象，且与 b 不是同一个对象）
+#[inline]
+unsafe fn can_update_in_place(a: *mut BolideBigInt, b: *const BolideBigInt) -> bool {
+    !BolideBigInt::is_small(a) && a as *const BolideBigInt != b && (*a).ref_count() == 1
+}
+
+macro_rules! bigint_assign_op {
+    ($name:ident, $small:ident, $fallback:ident, $op:tt) => {
+        #[no_mangle]
+        pub extern "C" fn $name(a: *mut BolideBigInt, b: *const BolideBigInt) -> *mut BolideBigInt {
+            if a.is_null() || b.is_null() {
+                bolide_bigint_release(a);
+                return std::ptr::null_mut();
+            }
+            if let Some(r) = $small(a, b) { return r; }
+            unsafe {
+                if can_update_in_place(a, b) {
+                    let inner = &mut (*a).inner;
+                    match BolideBigInt::view(b) {
+                        BigValue::Small(v) => *inner $op v,
+                        BigValue::Heap(h) => *inner $op &h.inner,
+                    }
+                    return a;
+                }
+            }
+            let result = $fallback(a, b);
+            bolide_bigint_release(a);
+            result
+        }
+    };
+}
+
+bigint_assign_op!(bolide_bigint_add_assign, small_add, bolide_bigint_add, +=);
+bigint_assign_op!(bolide_bigint_sub_assign, small_sub, bolide_bigint_sub, -=);
+bigint_assign_op!(bolide_bigint_mul_assign, small_mul, bolide_bigint_mul, *=);
+
 // ==================== 比较运算 ====================
 
+#[inline]
+fn compare(a: *const BolideBigInt, b: *const BolideBigInt) -> CmpOrdering {
+    if let Some((ta, tb)) = small_pair(a, b) {
+        // 标记值的大小关系与原值一致
+        return ta.cmp(&tb);
+    }
+    unsafe { BolideBigInt::view(a).cmp(&BolideBigInt::view(b)) }
+}
+
 #[no_mangle]
 pub extern "C" fn bolide_bigint_eq(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner == b.inner { 1 } else { 0 }
+    if compare(a, b) == CmpOrdering::Equal { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_ne(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner != b.inner { 1 } else { 0 }
+    if compare(a, b) != CmpOrdering::Equal { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_lt(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner < b.inner { 1 } else { 0 }
+    if compare(a, b) == CmpOrdering::Less { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_le(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner <= b.inner { 1 } else { 0 }
+    if compare(a, b) != CmpOrdering::Greater { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_gt(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner > b.inner { 1 } else { 0 }
+    if compare(a, b) == CmpOrdering::Greater { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_bigint_ge(a: *const BolideBigInt, b: *const BolideBigInt) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let (a, b) = unsafe { (&*a, &*b) };
-    if a.inner >= b.inner { 1 } else { 0 }
+    if compare(a, b) != CmpOrdering::Less { 1 } else { 0 }
 }
 
 // ==================== Debug Stats ====================
@@ -279,7 +491,7 @@ pub extern "C" fn bolide_bigint_ge(a: *const BolideBigInt, b: *const BolideBigIn
 pub extern "C" fn bolide_bigint_debug_stats() {
     let alloc = BIGINT_ALLOC_COUNT.load(Ordering::SeqCst);
     let free = BIGINT_FREE_COUNT.load(Ordering::SeqCst);
-    println!("[BigInt Stats] alloc: {}, free: {}, leak: {}", alloc, free, alloc - free);
+    crate::print::out_println!("[BigInt Stats] alloc: {}, free: {}, leak: {}", alloc, free, alloc - free);
 }
 
 /// 重置统计计数器
@@ -317,12 +529,81 @@ mod tests {
         let b = BolideBigInt::new(50);
         let c = bolide_bigint_add(a, b);
         unsafe {
-            assert_eq!((*c).to_i64(), Some(150));
-            assert_eq!((*c).ref_count(), 1);
+            assert_eq!(BolideBigInt::view(c).to_i64(), Some(150));
+            assert_eq!(bolide_bigint_ref_count(c), 1);
 
             bolide_bigint_release(a);
             bolide_bigint_release(b);
             bolide_bigint_release(c);
         }
     }
+
+    #[test]
+    fn test_small_int_promotion() {
+        let max = bolide_bigint_from_i64(SMALL_MAX);
+        let one = bolide_bigint_from_i64(1);
+        assert!(BolideBigInt::is_small(max) && BolideBigInt::is_small(one));
+
+        // 溢出小整数范围时提升为堆对象
+        let sum = bolide_bigint_add(max, one);
+        assert!(!BolideBigInt::is_small(sum));
+        unsafe { assert_eq!(BolideBigInt::view(sum).to_i64(), Some(SMALL_MAX + 1)); }
+
+        // 结果回到范围内时重新内联
+        let back = bolide_bigint_sub(sum, one);
+        assert_eq!(back, max);
+
+        let min = bolide_bigint_from_i64(SMALL_MIN);
+        let neg = bolide_bigint_from_i64(-1);
+        let prod = bolide_bigint_mul(min, neg);
+        assert!(!BolideBigInt::is_small(prod));
+        unsafe { assert_eq!(BolideBigInt::view(prod).to_string(), (-(SMALL_MIN as i128)).to_string()); }
+        let quot = bolide_bigint_div(min, neg);
+        assert_eq!(bolide_bigint_eq(quot, prod), 1);
+
+        let big = bolide_bigint_from_i64(i64::MAX);
+        assert!(!BolideBigInt::is_small(big));
+        assert_eq!(bolide_bigint_gt(big, max), 1);
+        assert_eq!(bolide_bigint_lt(min, neg), 1);
+
+        let seven = bolide_bigint_from_i64(-7);
+        let two = bolide_bigint_from_i64(2);
+        assert_eq!(bolide_bigint_to_i64(bolide_bigint_div(seven, two)), -3);
+        assert_eq!(bolide_bigint_to_i64(bolide_bigint_rem(seven, two)), -1);
+
+        for p in [sum, prod, quot, big] {
+            bolide_bigint_release(p);
+        }
+    }
+
+    #[test]
+    fn test_add_assign_in_place() {
+        // 先累加到超出小整数范围，之后在同一个堆对象上原地累加
+        let mut acc = bolide_bigint_from_i64(SMALL_MAX);
+        let step = bolide_bigint_from_i64(SMALL_MAX);
+        acc = bolide_bigint_add_assign(acc, step);
+        let heap = acc;
+        for _ in 0..10 {
+            acc = bolide_bigint_add_assign(acc, step);
+        }
+        assert_eq!(acc, heap);
+        unsafe {
+            assert_eq!(BolideBigInt::view(acc).to_string(), (SMALL_MAX as i128 * 12).to_string());
+        }
+
+        // 被共享时不能原地修改
+        bolide_bigint_retain(acc);
+        let next = bolide_bigint_mul_assign(acc, bolide_bigint_from_i64(2));
+        assert_ne!(next, acc);
+        assert_eq!(bolide_bigint_ref_count(acc), 1);
+        unsafe {
+            assert_eq!(BolideBigInt::view(acc).to_string(), (SMALL_MAX as i128 * 12).to_string());
+        }
+
+        let a = bolide_bigint_sub_assign(bolide_bigint_from_i64(10), bolide_bigint_from_i64(3));
+        assert_eq!(bolide_bigint_to_i64(a), 7);
+
+        bolide_bigint_release(acc);
+        bolide_bigint_release(next);
+    }
 }
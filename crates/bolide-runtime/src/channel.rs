@@ -1,157 +1,338 @@
 //! Bolide 通道运行时
 //!
 //! 提供线程安全的通道实现，用于线程间通信
+//!
+//! 带缓冲的通道使用无锁环形队列（多生产者多消费者），无缓冲（无限容量）通道
+//! 使用互斥锁保护的队列。只有在队列满/空需要阻塞时才会用到锁和条件变量，
+//! 发送方通过等待者计数判断是否需要唤醒，没有等待者时不触碰锁。
 
-use std::sync::{Arc, Mutex, Condvar};
+use std::cell::UnsafeCell;
 use std::collections::VecDeque;
+use std::sync::{Arc, Mutex, Condvar};
+use std::sync::atomic::{fence, AtomicBool, AtomicUsize, Ordering};
+
+/// 按缓存行对齐，避免生产者和消费者的位置计数器互相干扰
+#[repr(align(64))]
+struct CachePadded<T>(T);
 
-/// 通道内部状态（单个 Mutex 保护，保证原子性）
-struct ChannelInner {
-    queue: VecDeque<i64>,
-    closed: bool,
+/// 环形队列槽位：seq 表示该槽当前可写（== 位置）或可读（== 位置 + 1）
+struct Slot {
+    seq: AtomicUsize,
+    value: UnsafeCell<i64>,
 }
 
-/// Select 通知器（用于事件驱动的 select）
-pub struct SelectNotifier {
-    condvar: Condvar,
-    mutex: Mutex<()>,
+/// 有界无锁 MPMC 环形队列
+struct RingBuffer {
+    slots: Box<[Slot]>,
+    capacity: usize,
+    /// 下一个写入位置
+    head: CachePadded<AtomicUsize>,
+    /// 下一个读取位置
+    tail: CachePadded<AtomicUsize>,
 }
 
-impl SelectNotifier {
-    pub fn new() -> Self {
+impl RingBuffer {
+    fn new(capacity: usize) -> Self {
+        let slots = (0..capacity)
+            .map(|i| Slot { seq: AtomicUsize::new(i), value: UnsafeCell::new(0) })
+            .collect();
         Self {
-            condvar: Condvar::new(),
-            mutex: Mutex::new(()),
+            slots,
+            capacity,
+            head: CachePadded(AtomicUsize::new(0)),
+            tail: CachePadded(AtomicUsize::new(0)),
         }
     }
 
-    /// 通知所有等待的 select
-    pub fn notify(&self) {
-        let _guard = self.mutex.lock().unwrap();
-        self.condvar.notify_all();
+    fn try_push(&self, value: i64) -> bool {
+        let mut pos = self.head.0.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos % self.capacity];
+            let seq = slot.seq.load(Ordering::Acquire);
+            let diff = (seq as isize).wrapping_sub(pos as isize);
+            if diff == 0 {
+                match self.head.0.compare_exchange_weak(
+                    pos, pos.wrapping_add(1), Ordering::Relaxed, Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        unsafe { *slot.value.get() = value; }
+                        slot.seq.store(pos.wrapping_add(1), Ordering::Release);
+                        return true;
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if diff < 0 {
+                return false;  // 已满
+            } else {
+                pos = self.head.0.load(Ordering::Relaxed);
+            }
+        }
     }
 
-    /// 等待通知（带超时）
-    pub fn wait_timeout(&self, timeout: std::time::Duration) -> bool {
-        let guard = self.mutex.lock().unwrap();
-        let result = self.condvar.wait_timeout(guard, timeout).unwrap();
-        !result.1.timed_out()
+    fn try_pop(&self) -> Option<i64> {
+        let mut pos = self.tail.0.load(Ordering::Relaxed);
+        loop {
+            let slot = &self.slots[pos % self.capacity];
+            let seq = slot.seq.load(Ordering::Acquire);
+            let diff = (seq as isize).wrapping_sub(pos.wrapping_add(1) as isize);
+            if diff == 0 {
+                match self.tail.0.compare_exchange_weak(
+                    pos, pos.wrapping_add(1), Ordering::Relaxed, Ordering::Relaxed,
+                ) {
+                    Ok(_) => {
+                        let value = unsafe { *slot.value.get() };
+                        slot.seq.store(pos.wrapping_add(self.capacity), Ordering::Release);
+                        return Some(value);
+                    }
+                    Err(current) => pos = current,
+                }
+            } else if diff < 0 {
+                return None;  // 为空
+            } else {
+                pos = self.tail.0.load(Ordering::Relaxed);
+            }
+        }
     }
 }
 
-impl Default for SelectNotifier {
-    fn default() -> Self {
-        Self::new()
+/// 通道存储
+enum ChannelQueue {
+    /// 有界: 无锁环形队列
+    Bounded(RingBuffer),
+    /// 无限容量: 互斥锁保护的队列
+    Unbounded(Mutex<VecDeque<i64>>),
+}
+
+impl ChannelQueue {
+    fn try_push(&self, value: i64) -> bool {
+        match self {
+            ChannelQueue::Bounded(ring) => ring.try_push(value),
+            ChannelQueue::Unbounded(queue) => {
+                queue.lock().unwrap().push_back(value);
+                true
+            }
+        }
+    }
+
+    fn try_pop(&self) -> Option<i64> {
+        match self {
+            ChannelQueue::Bounded(ring) => ring.try_pop(),
+            ChannelQueue::Unbounded(queue) => queue.lock().unwrap().pop_front(),
+        }
     }
 }
 
-/// 全局 select 通知器
-static GLOBAL_SELECT_NOTIFIER: once_cell::sync::Lazy<Arc<SelectNotifier>> =
-    once_cell::sync::Lazy::new(|| Arc::new(SelectNotifier::new()));
+/// 单个 select 调用的等待者，只被它所注册的通道唤醒
+struct SelectWaiter {
+    signaled: Mutex<bool>,
+    condvar: Condvar,
+}
+
+impl SelectWaiter {
+    fn new() -> Self {
+        Self {
+            signaled: Mutex::new(false),
+            condvar: Condvar::new(),
+        }
+    }
+
+    fn notify(&self) {
+        *self.signaled.lock().unwrap() = true;
+        self.condvar.notify_one();
+    }
+
+    fn reset(&self) {
+        *self.signaled.lock().unwrap() = false;
+    }
+
+    /// 等待通知，timeout 为 None 时无限等待；返回是否收到通知
+    fn wait(&self, timeout: Option<Duration>) -> bool {
+        let mut signaled = self.signaled.lock().unwrap();
+        match timeout {
+            Some(timeout) => {
+                let deadline = Instant::now() + timeout;
+                while !*signaled {
+                    let remaining = deadline.saturating_duration_since(Instant::now());
+                    if remaining.is_zero() {
+                        return false;
+                    }
+                    signaled = self.condvar.wait_timeout(signaled, remaining).unwrap().0;
+                }
+            }
+            None => {
+                while !*signaled {
+                    signaled = self.condvar.wait(signaled).unwrap();
+                }
+            }
+        }
+        true
+    }
+}
 
 /// 线程安全通道
 pub struct BolideChannel {
-    /// 内部状态（队列 + 关闭标志，原子操作）
-    inner: Mutex<ChannelInner>,
-    /// 条件变量，用于阻塞等待
-    condvar: Condvar,
-    /// 通道容量（0 表示无限）
-    capacity: usize,
-    /// 共享的 select 通知器（用于事件驱动的 select）
-    select_notifier: Arc<SelectNotifier>,
+    queue: ChannelQueue,
+    closed: AtomicBool,
+    /// 阻塞等待用的锁，只在队列满/空时使用
+    park_lock: Mutex<()>,
+    recv_cv: Condvar,
+    send_cv: Condvar,
+    /// 阻塞中的接收方/发送方数量，为 0 时收发双方都不需要加锁唤醒
+    recv_waiters: AtomicUsize,
+    send_waiters: AtomicUsize,
+    /// 当前在此通道上等待的 select
+    selectors: Mutex<Vec<Arc<SelectWaiter>>>,
+    selector_count: AtomicUsize,
 }
 
+unsafe impl Send for BolideChannel {}
+unsafe impl Sync for BolideChannel {}
+
 impl BolideChannel {
-    /// 创建无缓冲通道
-    pub fn new() -> Self {
+    fn with_queue(queue: ChannelQueue) -> Self {
         Self {
-            inner: Mutex::new(ChannelInner {
-                queue: VecDeque::new(),
-                closed: false,
-            }),
-            condvar: Condvar::new(),
-            capacity: 0,
-            select_notifier: Arc::clone(&GLOBAL_SELECT_NOTIFIER),
+            queue,
+            closed: AtomicBool::new(false),
+            park_lock: Mutex::new(()),
+            recv_cv: Condvar::new(),
+            send_cv: Condvar::new(),
+            recv_waiters: AtomicUsize::new(0),
+            send_waiters: AtomicUsize::new(0),
+            selectors: Mutex::new(Vec::new()),
+            selector_count: AtomicUsize::new(0),
         }
     }
 
-    /// 创建带缓冲的通道
+    /// 创建无缓冲通道（容量不限）
+    pub fn new() -> Self {
+        Self::with_queue(ChannelQueue::Unbounded(Mutex::new(VecDeque::new())))
+    }
+
+    /// 创建带缓冲的通道，capacity 为 0 时等同于 new()
     pub fn with_capacity(capacity: usize) -> Self {
-        Self {
-            inner: Mutex::new(ChannelInner {
-                queue: VecDeque::with_capacity(capacity),
-                closed: false,
-            }),
-            condvar: Condvar::new(),
-            capacity,
-            select_notifier: Arc::clone(&GLOBAL_SELECT_NOTIFIER),
+        if capacity == 0 {
+            return Self::new();
+        }
+        Self::with_queue(ChannelQueue::Bounded(RingBuffer::new(capacity)))
+    }
+
+    /// 入队后唤醒一个阻塞的接收方以及在此通道上等待的 select
+    fn wake_receivers(&self) {
+        // 与等待方“先登记计数，再检查队列”的顺序配合，保证不会丢失唤醒
+        fence(Ordering::SeqCst);
+        if self.recv_waiters.load(Ordering::SeqCst) > 0 {
+            let _guard = self.park_lock.lock().unwrap();
+            self.recv_cv.notify_one();
+        }
+        if self.selector_count.load(Ordering::SeqCst) > 0 {
+            for waiter in self.selectors.lock().unwrap().iter() {
+                waiter.notify();
+            }
+        }
+    }
+
+    /// 出队后唤醒一个因队列满而阻塞的发送方
+    fn wake_senders(&self) {
+        fence(Ordering::SeqCst);
+        if self.send_waiters.load(Ordering::SeqCst) > 0 {
+            let _guard = self.park_lock.lock().unwrap();
+            self.send_cv.notify_one();
         }
     }
 
     /// 发送消息（阻塞）
     pub fn send(&self, value: i64) -> bool {
-        let mut inner = self.inner.lock().unwrap();
-
-        // 原子检查关闭状态
-        if inner.closed {
+        if self.closed.load(Ordering::Acquire) {
             return false;
         }
+        if self.queue.try_push(value) {
+            self.wake_receivers();
+            return true;
+        }
 
-        // 如果有容量限制，等待队列有空间
-        if self.capacity > 0 {
-            while inner.queue.len() >= self.capacity {
-                if inner.closed {
-                    return false;
-                }
-                inner = self.condvar.wait(inner).unwrap();
+        // 队列已满，登记后阻塞等待空位
+        let mut guard = self.park_lock.lock().unwrap();
+        self.send_waiters.fetch_add(1, Ordering::SeqCst);
+        let sent = loop {
+            if self.closed.load(Ordering::Acquire) {
+                break false;
+            }
+            if self.queue.try_push(value) {
+                break true;
             }
+            guard = crate::coroutine::blocking(|| self.send_cv.wait(guard).unwrap());
+        };
+        self.send_waiters.fetch_sub(1, Ordering::SeqCst);
+        drop(guard);
+        if sent {
+            self.wake_receivers();
         }
-
-        inner.queue.push_back(value);
-        self.condvar.notify_one();
-        self.select_notifier.notify();  // 通知 select
-        true
+        sent
     }
 
     /// 接收消息（阻塞）
     pub fn recv(&self) -> Option<i64> {
-        let mut inner = self.inner.lock().unwrap();
+        if let Some(value) = self.try_recv() {
+            return Some(value);
+        }
 
-        loop {
-            if let Some(value) = inner.queue.pop_front() {
-                self.condvar.notify_one();
-                return Some(value);
+        let mut guard = self.park_lock.lock().unwrap();
+        self.recv_waiters.fetch_add(1, Ordering::SeqCst);
+        let value = loop {
+            if let Some(value) = self.queue.try_pop() {
+                break Some(value);
             }
-
-            if inner.closed && inner.queue.is_empty() {
-                return None;
+            if self.closed.load(Ordering::Acquire) {
+                // 关闭与最后一次发送竞争时再取一次，保证已入队的消息不丢
+                break self.queue.try_pop();
             }
-
-            inner = self.condvar.wait(inner).unwrap();
+            guard = crate::coroutine::blocking(|| self.recv_cv.wait(guard).unwrap());
+        };
+        self.recv_waiters.fetch_sub(1, Ordering::SeqCst);
+        drop(guard);
+        if value.is_some() {
+            self.wake_senders();
         }
+        value
     }
 
     /// 尝试接收消息（非阻塞）
     pub fn try_recv(&self) -> Option<i64> {
-        let mut inner = self.inner.lock().unwrap();
-        let value = inner.queue.pop_front();
+        let value = self.queue.try_pop();
         if value.is_some() {
-            self.condvar.notify_one();
+            self.wake_senders();
         }
         value
     }
 
     /// 关闭通道
     pub fn close(&self) {
-        let mut inner = self.inner.lock().unwrap();
-        inner.closed = true;
-        self.condvar.notify_all();
-        self.select_notifier.notify();
+        self.closed.store(true, Ordering::SeqCst);
+        {
+            let _guard = self.park_lock.lock().unwrap();
+            self.recv_cv.notify_all();
+            self.send_cv.notify_all();
+        }
+        for waiter in self.selectors.lock().unwrap().iter() {
+            waiter.notify();
+        }
     }
 
     /// 检查通道是否已关闭
     pub fn is_closed(&self) -> bool {
-        self.inner.lock().unwrap().closed
+        self.closed.load(Ordering::Acquire)
+    }
+
+    fn register_selector(&self, waiter: &Arc<SelectWaiter>) {
+        let mut selectors = self.selectors.lock().unwrap();
+        selectors.push(Arc::clone(waiter));
+        self.selector_count.store(selectors.len(), Ordering::SeqCst);
+    }
+
+    fn unregister_selector(&self, waiter: &Arc<SelectWaiter>) {
+        let mut selectors = self.selectors.lock().unwrap();
+        selectors.retain(|w| !Arc::ptr_eq(w, waiter));
+        self.selector_count.store(selectors.len(), Ordering::SeqCst);
     }
 }
 
@@ -172,17 +353,20 @@ pub extern "C" fn bolide_channel_create() -> *mut BolideChannel {
 /// 创建带缓冲的通道
 #[no_mangle]
 pub extern "C" fn bolide_channel_create_buffered(capacity: i64) -> *mut BolideChannel {
-    Box::into_raw(Box::new(BolideChannel::with_capacity(capacity as usize)))
+    Box::into_raw(Box::new(BolideChannel::with_capacity(capacity.max(0) as usize)))
 }
 
 /// 发送消息到通道
 /// 返回 1 表示成功，0 表示失败（通道已关闭）
 #[no_mangle]
 pub extern "C" fn bolide_channel_send(channel: *mut BolideChannel, value: i64) -> i64 {
+    crate::profile::count(&crate::profile::COUNTERS.channel_ops);
     if channel.is_null() {
         return 0;
     }
 
+    // 接收方可能在其他线程立即输出，先刷出本线程缓冲的内容
+    crate::bolide_print_flush();
     let channel = unsafe { &*channel };
     if channel.send(value) { 1 } else { 0 }
 }
@@ -191,10 +375,13 @@ pub extern "C" fn bolide_channel_send(channel: *mut BolideChannel, value: i64) -
 /// 如果通道已关闭且为空，返回 0
 #[no_mangle]
 pub extern "C" fn bolide_channel_recv(channel: *mut BolideChannel) -> i64 {
+    crate::profile::count(&crate::profile::COUNTERS.channel_ops);
     if channel.is_null() {
         return 0;
     }
 
+    // 可能阻塞等待其他线程，先刷出本线程缓冲的输出
+    crate::bolide_print_flush();
     let channel = unsafe { &*channel };
     channel.recv().unwrap_or(0)
 }
@@ -206,6 +393,7 @@ pub extern "C" fn bolide_channel_try_recv(
     channel: *mut BolideChannel,
     success: *mut i64,
 ) -> i64 {
+    crate::profile::count(&crate::profile::COUNTERS.channel_ops);
     if channel.is_null() {
         if !success.is_null() {
             unsafe { *success = 0; }
@@ -277,6 +465,7 @@ pub extern "C" fn bolide_channel_select(
     timeout_ms: i64,
     value: *mut i64,
 ) -> i64 {
+    crate::profile::count(&crate::profile::COUNTERS.channel_ops);
     if channels.is_null() || count <= 0 {
         return -1;
     }
@@ -305,46 +494,137 @@ pub extern "C" fn bolide_channel_select(
         None
     };
 
-    loop {
-        // 尝试从每个 channel 非阻塞接收
+    // 尝试从每个 channel 非阻塞接收
+    let poll = || -> Option<i64> {
         for (idx, ch) in channel_refs.iter().enumerate() {
             if let Some(val) = ch.try_recv() {
                 if !value.is_null() {
                     unsafe { *value = val; }
                 }
-                return idx as i64;
+                return Some(idx as i64);
             }
         }
+        None
+    };
 
-        // 如果有 default 分支，立即返回
-        if has_default {
-            return -2;
-        }
+    if let Some(idx) = poll() {
+        return idx;
+    }
 
-        // 检查超时
-        if let Some(dl) = deadline {
-            if Instant::now() >= dl {
-                return -1;  // 超时
-            }
+    // 如果有 default 分支，立即返回
+    if has_default {
+        return -2;
+    }
+
+    // 在每个 channel 上登记自己的等待者，只有这些 channel 的发送/关闭会唤醒本次 select
+    crate::bolide_print_flush();
+    let waiter = Arc::new(SelectWaiter::new());
+    for ch in &channel_refs {
+        ch.register_selector(&waiter);
+    }
+
+    let result = loop {
+        // 登记之后再检查一次，避免错过登记前到达的消息
+        if let Some(idx) = poll() {
+            break idx;
         }
 
         // 检查是否所有 channel 都已关闭
-        let all_closed = channel_refs.iter().all(|ch| ch.is_closed());
-        if all_closed {
-            return -1;
+        if channel_refs.iter().all(|ch| ch.is_closed()) {
+            break -1;
         }
 
-        // 事件驱动等待：等待任意 channel 有数据
-        let wait_duration = if let Some(dl) = deadline {
-            let remaining = dl.saturating_duration_since(Instant::now());
-            if remaining.is_zero() {
-                return -1;  // 超时
+        let remaining = match deadline {
+            Some(dl) => {
+                let remaining = dl.saturating_duration_since(Instant::now());
+                if remaining.is_zero() {
+                    break -1;  // 超时
+                }
+                Some(remaining)
             }
-            remaining
-        } else {
-            Duration::from_millis(100)  // 无超时时，最多等待 100ms 后重新检查
+            None => None,
         };
 
-        GLOBAL_SELECT_NOTIFIER.wait_timeout(wait_duration);
+        crate::coroutine::blocking(|| waiter.wait(remaining));
+        waiter.reset();
+    };
+
+    for ch in &channel_refs {
+        ch.unregister_selector(&waiter);
+    }
+    result
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::thread;
+
+    #[test]
+    fn test_ring_buffer_capacity() {
+        let ch = BolideChannel::with_capacity(3);
+        assert!(ch.queue.try_push(1));
+        assert!(ch.queue.try_push(2));
+        assert!(ch.queue.try_push(3));
+        assert!(!ch.queue.try_push(4));
+        assert_eq!(ch.try_recv(), Some(1));
+        assert!(ch.queue.try_push(4));
+        assert_eq!(ch.recv(), Some(2));
+        assert_eq!(ch.recv(), Some(3));
+        assert_eq!(ch.recv(), Some(4));
+        assert_eq!(ch.try_recv(), None);
+    }
+
+    #[test]
+    fn test_buffered_mpmc() {
+        let ch = Arc::new(BolideChannel::with_capacity(8));
+        let producers: Vec<_> = (0..4)
+            .map(|p| {
+                let ch = Arc::clone(&ch);
+                thread::spawn(move || {
+                    for i in 0..10_000 {
+                        assert!(ch.send(p * 10_000 + i));
+                    }
+                })
+            })
+            .collect();
+        let consumers: Vec<_> = (0..4)
+            .map(|_| {
+                let ch = Arc::clone(&ch);
+                thread::spawn(move || {
+                    let mut sum = 0i64;
+                    while let Some(v) = ch.recv() {
+                        sum += v;
+                    }
+                    sum
+                })
+            })
+            .collect();
+        for p in producers {
+            p.join().unwrap();
+        }
+        ch.close();
+        let total: i64 = consumers.into_iter().map(|c| c.join().unwrap()).sum();
+        assert_eq!(total, (0..40_000i64).sum());
+    }
+
+    #[test]
+    fn test_select_wakes_on_send() {
+        let a = Box::into_raw(Box::new(BolideChannel::with_capacity(1)));
+        let b = Box::into_raw(Box::new(BolideChannel::new()));
+        let b_addr = b as usize;
+        let sender = thread::spawn(move || {
+            thread::sleep(Duration::from_millis(20));
+            let b = b_addr as *mut BolideChannel;
+            bolide_channel_send(b, 7);
+        });
+        let channels = [a, b];
+        let mut value = 0;
+        let idx = bolide_channel_select(channels.as_ptr(), 2, -1, &mut value);
+        sender.join().unwrap();
+        assert_eq!(idx, 1);
+        assert_eq!(value, 7);
+        bolide_channel_free(a);
+        bolide_channel_free(b);
     }
 }
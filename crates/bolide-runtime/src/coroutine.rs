@@ -2,17 +2,18 @@
 //!
 //! 提供 Hot Future 风格的协程支持
 
+use std::cell::{Cell, UnsafeCell};
+use std::collections::VecDeque;
 use std::sync::{Arc, Mutex, Condvar};
+use std::sync::atomic::{AtomicU8, AtomicUsize, Ordering};
 use std::thread;
+use std::time::Duration;
 use std::os::raw::c_void;
 
 /// 协程状态
-#[derive(Clone, Copy, PartialEq)]
-enum CoroutineState {
-    Running,
-    Completed,
-    Cancelled,
-}
+const STATE_RUNNING: u8 = 0;
+const STATE_COMPLETED: u8 = 1;
+const STATE_CANCELLED: u8 = 2;
 
 /// 协程结果联合体
 #[repr(C)]
@@ -29,95 +30,159 @@ unsafe impl Sync for CoroutineResult {}
 /// 完成回调类型
 type CompletionCallback = Box<dyn Fn() + Send + Sync>;
 
+/// 回调登记号，用于撤销不再需要的回调
+static NEXT_WAITER_ID: AtomicUsize = AtomicUsize::new(0);
+
+/// 协程函数体
+type Body = Box<dyn FnOnce() -> CoroutineResult + Send + 'static>;
+
+/// Future 共享状态（任务与句柄各持有一份）
+struct FutureInner {
+    /// 状态用原子量发布，已完成时读取结果无需加锁
+    state: AtomicU8,
+    /// 仅在 state 由 RUNNING 转为 COMPLETED 之前（持有 waiters 锁时）写入一次
+    result: UnsafeCell<CoroutineResult>,
+    /// 完成或取消时调用的回调（登记号, 回调）
+    waiters: Mutex<Vec<(usize, CompletionCallback)>>,
+    condvar: Condvar,
+    /// 尚未开始执行的函数体；工作线程或等待者谁先取走谁执行
+    body: Mutex<Option<Body>>,
+}
+
 /// 协程 Future
 pub struct BolideFuture {
-    state: Arc<Mutex<CoroutineState>>,
-    result: Arc<Mutex<Option<CoroutineResult>>>,
-    condvar: Arc<Condvar>,
-    on_complete: Arc<Mutex<Option<CompletionCallback>>>,
+    inner: Arc<FutureInner>,
 }
 
 unsafe impl Send for BolideFuture {}
 unsafe impl Sync for BolideFuture {}
+unsafe impl Send for FutureInner {}
+unsafe impl Sync for FutureInner {}
+
+impl FutureInner {
+    fn complete(&self, result: CoroutineResult) {
+        let callbacks = {
+            let mut waiters = self.waiters.lock().unwrap();
+            if self.state.load(Ordering::Relaxed) != STATE_RUNNING {
+                return;
+            }
+            unsafe { *self.result.get() = result; }
+            self.state.store(STATE_COMPLETED, Ordering::Release);
+            self.condvar.notify_all();
+            std::mem::take(&mut *waiters)
+        };
+        // 在锁外调用回调，避免死锁
+        for (_, cb) in callbacks {
+            cb();
+        }
+    }
+
+    fn is_done(&self) -> bool {
+        self.state.load(Ordering::Acquire) != STATE_RUNNING
+    }
+
+    /// 函数体还没被取走时在当前线程执行；已取消的任务不再执行
+    fn run(&self) -> bool {
+        let Some(body) = self.body.lock().unwrap().take() else { return false };
+        if self.is_done() {
+            return true;
+        }
+        let result = body();
+        crate::bolide_print_flush();
+        self.complete(result);
+        true
+    }
+}
 
 impl BolideFuture {
     /// 创建新的 Future
     pub fn new() -> Self {
         Self {
-            state: Arc::new(Mutex::new(CoroutineState::Running)),
-            result: Arc::new(Mutex::new(None)),
-            condvar: Arc::new(Condvar::new()),
-            on_complete: Arc::new(Mutex::new(None)),
+            inner: Arc::new(FutureInner {
+                state: AtomicU8::new(STATE_RUNNING),
+                result: UnsafeCell::new(CoroutineResult { int_val: 0 }),
+                waiters: Mutex::new(Vec::new()),
+                condvar: Condvar::new(),
+                body: Mutex::new(None),
+            }),
         }
     }
 
     /// 设置结果并标记完成
     pub fn complete(&self, result: CoroutineResult) {
-        let callback;
-        {
-            // 锁顺序：on_complete → state（与 on_complete 方法一致）
-            let mut on_complete_guard = self.on_complete.lock().unwrap();
-            let mut state = self.state.lock().unwrap();
-            if *state == CoroutineState::Running {
-                *self.result.lock().unwrap() = Some(result);
-                *state = CoroutineState::Completed;
-                self.condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        // 在锁外调用回调，避免死锁
-        if let Some(cb) = callback {
-            cb();
-        }
+        self.inner.complete(result);
     }
 
-    /// 注册完成回调（如果已完成则立即调用）
-    pub fn on_complete(&self, callback: CompletionCallback) -> bool {
-        // 先设置回调，再检查状态，避免竞态
-        let mut on_complete_guard = self.on_complete.lock().unwrap();
-        let state = self.state.lock().unwrap();
-
-        if *state == CoroutineState::Completed {
-            drop(state);
-            drop(on_complete_guard);
+    /// 注册回调，完成或取消时调用；已经结束则立即调用并返回 None
+    ///
+    /// 返回的登记号可传给 `remove_waiter` 撤销回调
+    pub fn on_complete(&self, callback: CompletionCallback) -> Option<usize> {
+        let mut waiters = self.inner.waiters.lock().unwrap();
+        if self.inner.state.load(Ordering::Acquire) != STATE_RUNNING {
+            drop(waiters);
             callback();
-            true
-        } else if *state == CoroutineState::Running {
-            *on_complete_guard = Some(callback);
-            false
-        } else {
-            false
+            return None;
         }
+        let id = NEXT_WAITER_ID.fetch_add(1, Ordering::Relaxed);
+        waiters.push((id, callback));
+        Some(id)
+    }
+
+    /// 撤销尚未调用的回调
+    pub fn remove_waiter(&self, id: usize) {
+        self.inner.waiters.lock().unwrap().retain(|(waiter, _)| *waiter != id);
     }
 
     /// 等待结果
+    ///
+    /// 被等待的任务还在队列里时直接在当前线程执行它（等待者反正要等它完成），
+    /// 否则阻塞等待。不会顺带执行其他无关任务。
     pub fn await_result(&self) -> Option<CoroutineResult> {
-        let mut state = self.state.lock().unwrap();
-        while *state == CoroutineState::Running {
-            state = self.condvar.wait(state).unwrap();
+        let inner = &self.inner;
+        if !inner.is_done() {
+            // 等待期间其他线程可能继续输出，先刷出本线程缓冲的内容
+            crate::bolide_print_flush();
+            run_inline(inner);
+        }
+        if !inner.is_done() {
+            blocking(|| {
+                let mut guard = inner.waiters.lock().unwrap();
+                while !inner.is_done() {
+                    guard = inner.condvar.wait(guard).unwrap();
+                }
+            });
+        }
+        if inner.state.load(Ordering::Acquire) == STATE_COMPLETED {
+            Some(unsafe { *inner.result.get() })
+        } else {
+            None
         }
-        self.result.lock().unwrap().clone()
     }
 
-    /// 取消协程
+    /// 取消协程，唤醒等待者并调用已登记的回调（select 据此不再等它）
     pub fn cancel(&self) {
-        let mut state = self.state.lock().unwrap();
-        if *state == CoroutineState::Running {
-            *state = CoroutineState::Cancelled;
-            self.condvar.notify_all();
+        let callbacks = {
+            let mut waiters = self.inner.waiters.lock().unwrap();
+            if self.inner.state.load(Ordering::Relaxed) != STATE_RUNNING {
+                return;
+            }
+            self.inner.state.store(STATE_CANCELLED, Ordering::Release);
+            self.inner.condvar.notify_all();
+            std::mem::take(&mut *waiters)
+        };
+        for (_, cb) in callbacks {
+            cb();
         }
     }
 
     /// 检查是否完成
     pub fn is_completed(&self) -> bool {
-        *self.state.lock().unwrap() == CoroutineState::Completed
+        self.inner.state.load(Ordering::Acquire) == STATE_COMPLETED
     }
 
     /// 检查是否取消
     pub fn is_cancelled(&self) -> bool {
-        *self.state.lock().unwrap() == CoroutineState::Cancelled
+        self.inner.state.load(Ordering::Acquire) == STATE_CANCELLED
     }
 }
 
@@ -127,6 +192,173 @@ impl Default for BolideFuture {
     }
 }
 
+// ==================== M:N 调度器 ====================
+//
+// 协程不再一个 async 调用一个 OS 线程，而是作为任务提交到固定数量的工作线程。
+// 任务运行到结束；await（含 scope 退出）等待的任务还没开始时由等待者直接执行，
+// 父协程等待子协程不需要额外线程。只执行被等待的任务本身：无关任务可能阻塞在
+// 只有等待者才会喂数据的 channel 上，嵌套在等待者栈上会造成死锁。
+//
+// 限制：没有栈切换，协程不能挂起。阻塞在 await / select / scope 退出 / channel 上的协程
+// 会一直占住所在的 OS 线程。所有工作线程都阻塞而队列仍有任务时补充工作线程，
+// 补充数量不设上限（设上限会让大规模扇出死锁），同时阻塞的协程有多少就可能有多少个线程，
+// 每个线程预留 WORKER_STACK_SIZE 的虚拟栈空间。补充线程空闲一段时间后自动退出。
+
+type Task = Box<dyn FnOnce() + Send + 'static>;
+
+/// 单个线程上内联执行被等待任务的最大嵌套深度，超过后直接阻塞等待，防止栈溢出
+const MAX_INLINE_DEPTH: usize = 64;
+
+/// 工作线程栈大小：内联执行的任务嵌套在等待者的栈帧之上
+const WORKER_STACK_SIZE: usize = 16 * 1024 * 1024;
+
+/// 补充线程空闲多久后退出
+const SPARE_IDLE_TIMEOUT: Duration = Duration::from_millis(500);
+
+struct Scheduler {
+    queue: Mutex<VecDeque<Task>>,
+    condvar: Condvar,
+    /// 常驻工作线程数
+    core_workers: usize,
+    /// 当前存活的工作线程总数（含补充线程）
+    workers: AtomicUsize,
+    /// 阻塞在等待中、无法执行任务的工作线程数
+    blocked: AtomicUsize,
+    /// 正在等待新任务的空闲线程数
+    idle: AtomicUsize,
+}
+
+thread_local! {
+    /// 当前线程是否为协程工作线程
+    static IS_WORKER: Cell<bool> = Cell::new(false);
+    /// 当前线程上内联执行的任务嵌套深度
+    static INLINE_DEPTH: Cell<usize> = Cell::new(0);
+}
+
+static SCHEDULER: once_cell::sync::Lazy<Arc<Scheduler>> = once_cell::sync::Lazy::new(|| {
+    // 可通过 BOLIDE_COROUTINE_WORKERS 覆盖，默认等于可用 CPU 数
+    let size = std::env::var("BOLIDE_COROUTINE_WORKERS")
+        .ok()
+        .and_then(|v| v.parse::<usize>().ok())
+        .filter(|&n| n > 0)
+        .unwrap_or_else(|| thread::available_parallelism().map(|n| n.get()).unwrap_or(4));
+    let scheduler = Arc::new(Scheduler {
+        queue: Mutex::new(VecDeque::new()),
+        condvar: Condvar::new(),
+        core_workers: size,
+        workers: AtomicUsize::new(0),
+        blocked: AtomicUsize::new(0),
+        idle: AtomicUsize::new(0),
+    });
+    for _ in 0..size {
+        Scheduler::start_worker(&scheduler, false);
+    }
+    scheduler
+});
+
+impl Scheduler {
+    fn start_worker(this: &Arc<Scheduler>, spare: bool) {
+        this.workers.fetch_add(1, Ordering::SeqCst);
+        let sched = Arc::clone(this);
+        let spawned = thread::Builder::new()
+            .name("bolide-coroutine".into())
+            .stack_size(WORKER_STACK_SIZE)
+            .spawn(move || {
+                IS_WORKER.with(|w| w.set(true));
+                sched.worker_loop(spare);
+                sched.workers.fetch_sub(1, Ordering::SeqCst);
+            });
+        if spawned.is_err() {
+            this.workers.fetch_sub(1, Ordering::SeqCst);
+        }
+    }
+
+    fn worker_loop(&self, spare: bool) {
+        loop {
+            let task = {
+                let mut queue = self.queue.lock().unwrap();
+                loop {
+                    if let Some(task) = queue.pop_front() {
+                        break task;
+                    }
+                    self.idle.fetch_add(1, Ordering::SeqCst);
+                    if spare {
+                        let (guard, timeout) = self.condvar.wait_timeout(queue, SPARE_IDLE_TIMEOUT).unwrap();
+                        queue = guard;
+                        self.idle.fetch_sub(1, Ordering::SeqCst);
+                        if timeout.timed_out() && queue.is_empty() {
+                            return;
+                        }
+                    } else {
+                        queue = self.condvar.wait(queue).unwrap();
+                        self.idle.fetch_sub(1, Ordering::SeqCst);
+                    }
+                }
+            };
+            task();
+        }
+    }
+
+    fn submit(this: &Arc<Scheduler>, task: Task) {
+        this.queue.lock().unwrap().push_back(task);
+        if this.idle.load(Ordering::SeqCst) > 0 {
+            this.condvar.notify_one();
+        } else {
+            this.compensate();
+        }
+    }
+
+    /// 所有工作线程都被阻塞且还有待执行任务时补充一个线程（不设上限，见模块说明）
+    fn compensate(self: &Arc<Self>) {
+        if self.blocked.load(Ordering::SeqCst) >= self.workers.load(Ordering::SeqCst)
+            && !self.queue.lock().unwrap().is_empty()
+        {
+            Scheduler::start_worker(self, true);
+        }
+    }
+}
+
+/// 被等待的任务尚未开始时在当前线程执行它，维护嵌套深度
+///
+/// 队列里留下的那一项被工作线程取出时发现函数体已被取走，直接跳过。
+fn run_inline(inner: &FutureInner) {
+    if INLINE_DEPTH.with(|d| d.get()) >= MAX_INLINE_DEPTH {
+        return;
+    }
+    INLINE_DEPTH.with(|d| d.set(d.get() + 1));
+    inner.run();
+    INLINE_DEPTH.with(|d| d.set(d.get() - 1));
+}
+
+/// 标记一段可能长时间阻塞的等待（channel 收发等）
+///
+/// 工作线程进入阻塞前登记，必要时补充线程，保证队列中的任务仍能推进
+pub(crate) fn blocking<R>(f: impl FnOnce() -> R) -> R {
+    if !IS_WORKER.with(|w| w.get()) {
+        return f();
+    }
+    let sched = &*SCHEDULER;
+    sched.blocked.fetch_add(1, Ordering::SeqCst);
+    sched.compensate();
+    let r = f();
+    sched.blocked.fetch_sub(1, Ordering::SeqCst);
+    r
+}
+
+/// 创建 Future 并把任务提交给调度器
+fn spawn_future(body: impl FnOnce() -> CoroutineResult + Send + 'static) -> *mut BolideFuture {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let future = Box::new(BolideFuture::new());
+    *future.inner.body.lock().unwrap() = Some(Box::new(body));
+    let inner = Arc::clone(&future.inner);
+    // 任务可能立即在其他 worker 上开始输出，先刷出调用方缓冲的内容
+    crate::bolide_print_flush();
+    Scheduler::submit(&SCHEDULER, Box::new(move || {
+        inner.run();
+    }));
+    Box::into_raw(future)
+}
+
 // ==================== FFI 导出 ====================
 
 /// 包装函数指针使其可跨线程发送
@@ -139,38 +371,11 @@ unsafe impl Send for SendFnPtr {}
 pub extern "C" fn bolide_coroutine_spawn_int(
     func_ptr: extern "C" fn() -> i64
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn() -> i64 = unsafe { std::mem::transmute(send_fn) };
-        let val = f();
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { int_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { int_val: f() }
+    })
 }
 
 /// 启动协程（返回 float）
@@ -178,38 +383,11 @@ pub extern "C" fn bolide_coroutine_spawn_int(
 pub extern "C" fn bolide_coroutine_spawn_float(
     func_ptr: extern "C" fn() -> f64
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn() -> f64 = unsafe { std::mem::transmute(send_fn) };
-        let val = f();
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { float_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { float_val: f() }
+    })
 }
 
 /// 启动协程（返回指针）
@@ -217,38 +395,11 @@ pub extern "C" fn bolide_coroutine_spawn_float(
 pub extern "C" fn bolide_coroutine_spawn_ptr(
     func_ptr: extern "C" fn() -> *mut c_void
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn() -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
-        let val = f();
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { ptr_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { ptr_val: f() }
+    })
 }
 
 /// 等待协程结果（int）
@@ -300,40 +451,13 @@ pub extern "C" fn bolide_coroutine_spawn_int_with_env(
     func_ptr: extern "C" fn(*mut c_void) -> i64,
     env: *mut c_void,
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let send_env = SendFnPtr(env);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn(*mut c_void) -> i64 = unsafe { std::mem::transmute(send_fn) };
         let e: *mut c_void = unsafe { std::mem::transmute(send_env) };
-        let val = f(e);
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { int_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { int_val: f(e) }
+    })
 }
 
 /// 启动协程（带环境，返回 float）
@@ -342,40 +466,13 @@ pub extern "C" fn bolide_coroutine_spawn_float_with_env(
     func_ptr: extern "C" fn(*mut c_void) -> f64,
     env: *mut c_void,
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let send_env = SendFnPtr(env);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn(*mut c_void) -> f64 = unsafe { std::mem::transmute(send_fn) };
         let e: *mut c_void = unsafe { std::mem::transmute(send_env) };
-        let val = f(e);
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { float_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { float_val: f(e) }
+    })
 }
 
 /// 启动协程（带环境，返回 ptr）
@@ -384,40 +481,13 @@ pub extern "C" fn bolide_coroutine_spawn_ptr_with_env(
     func_ptr: extern "C" fn(*mut c_void) -> *mut c_void,
     env: *mut c_void,
 ) -> *mut BolideFuture {
-    let future = Box::new(BolideFuture::new());
-    let future_ptr = Box::into_raw(future);
-
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let send_env = SendFnPtr(env);
-    let state = unsafe { (*future_ptr).state.clone() };
-    let result = unsafe { (*future_ptr).result.clone() };
-    let condvar = unsafe { (*future_ptr).condvar.clone() };
-    let on_complete = unsafe { (*future_ptr).on_complete.clone() };
-
-    thread::spawn(move || {
+    spawn_future(move || {
         let f: extern "C" fn(*mut c_void) -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
         let e: *mut c_void = unsafe { std::mem::transmute(send_env) };
-        let val = f(e);
-
-        let callback;
-        {
-            let mut on_complete_guard = on_complete.lock().unwrap();
-            let mut s = state.lock().unwrap();
-            if *s == CoroutineState::Running {
-                *result.lock().unwrap() = Some(CoroutineResult { ptr_val: val });
-                *s = CoroutineState::Completed;
-                condvar.notify_all();
-                callback = on_complete_guard.take();
-            } else {
-                callback = None;
-            }
-        }
-        if let Some(cb) = callback {
-            cb();
-        }
-    });
-
-    future_ptr
+        CoroutineResult { ptr_val: f(e) }
+    })
 }
 
 // ==================== Scope 管理 ====================
@@ -450,24 +520,27 @@ pub extern "C" fn bolide_scope_register(future: *mut BolideFuture) {
 /// 退出 scope 并等待所有未完成的 Future
 #[no_mangle]
 pub extern "C" fn bolide_scope_exit() {
-    SCOPE_FUTURES.with(|stack| {
-        if let Some(futures) = stack.borrow_mut().pop() {
-            for future_ptr in futures {
-                if !future_ptr.is_null() {
-                    let future = unsafe { &*future_ptr };
-                    let _ = future.await_result();
-                }
+    // 先弹出再等待：等待期间本线程可能执行其他任务并进入自己的 scope
+    let futures = SCOPE_FUTURES.with(|stack| stack.borrow_mut().pop());
+    if let Some(futures) = futures {
+        for future_ptr in futures {
+            if !future_ptr.is_null() {
+                let future = unsafe { &*future_ptr };
+                let _ = future.await_result();
             }
         }
-    });
+    }
 }
 
 // ==================== Select 支持 ====================
 
 /// Select 上下文 - 用于通知机制
 struct SelectContext {
-    winner: Mutex<Option<usize>>,
+    /// 获胜的索引；所有候选都被取消时为 -1
+    winner: Mutex<Option<i64>>,
     condvar: Condvar,
+    /// 还可能完成的候选数，加上登记期间持有的一份
+    remaining: AtomicUsize,
 }
 
 impl SelectContext {
@@ -475,11 +548,19 @@ impl SelectContext {
         Self {
             winner: Mutex::new(None),
             condvar: Condvar::new(),
+            remaining: AtomicUsize::new(1),
+        }
+    }
+
+    /// 一个候选被取消（或登记结束）：没有候选剩下时以 -1 结束等待
+    fn drop_candidate(&self) {
+        if self.remaining.fetch_sub(1, Ordering::AcqRel) == 1 {
+            self.try_set_winner(-1);
         }
     }
 
     /// 尝试设置获胜者（只有第一个成功）
-    fn try_set_winner(&self, index: usize) -> bool {
+    fn try_set_winner(&self, index: i64) -> bool {
         let mut winner = self.winner.lock().unwrap();
         if winner.is_none() {
             *winner = Some(index);
@@ -490,13 +571,15 @@ impl SelectContext {
         }
     }
 
-    /// 等待获胜者
-    fn wait_winner(&self) -> usize {
-        let mut winner = self.winner.lock().unwrap();
-        while winner.is_none() {
-            winner = self.condvar.wait(winner).unwrap();
-        }
-        winner.unwrap()
+    /// 等待获胜者（计入阻塞线程数，必要时补充工作线程执行候选任务）
+    fn wait_winner(&self) -> i64 {
+        blocking(|| {
+            let mut winner = self.winner.lock().unwrap();
+            while winner.is_none() {
+                winner = self.condvar.wait(winner).unwrap();
+            }
+            winner.unwrap()
+        })
     }
 }
 
@@ -525,32 +608,211 @@ pub extern "C" fn bolide_select_wait_first(
     }
 
     let ctx = Arc::new(SelectContext::new());
-    let mut has_pending = false;
+    let mut registered = Vec::new();
 
-    // 使用回调机制：为每个 Future 注册完成回调
+    // 使用回调机制：为每个 Future 注册回调，完成时设置获胜者，取消时退出候选
     for (i, &future_ptr) in futures_slice.iter().enumerate() {
         if !future_ptr.is_null() {
             let future = unsafe { &*future_ptr };
-            // 再次检查，避免竞态
-            if future.is_completed() {
-                return i as i64;
-            }
-            has_pending = true;
+            ctx.remaining.fetch_add(1, Ordering::AcqRel);
             let ctx_clone = ctx.clone();
-            let idx = i;
-
-            // 注册回调，Future 完成时会自动调用
-            future.on_complete(Box::new(move || {
-                ctx_clone.try_set_winner(idx);
+            let inner = Arc::clone(&future.inner);
+            // 已结束的 Future 会立即调用回调
+            let id = future.on_complete(Box::new(move || {
+                if inner.state.load(Ordering::Acquire) == STATE_COMPLETED {
+                    ctx_clone.try_set_winner(i as i64);
+                } else {
+                    ctx_clone.drop_candidate();
+                }
             }));
+            if let Some(id) = id {
+                registered.push((future, id));
+            }
         }
     }
-
-    if !has_pending {
-        return -1;
-    }
+    ctx.drop_candidate();
 
     // 等待第一个完成（零轮询，纯事件驱动）
-    ctx.wait_winner() as i64
+    crate::bolide_print_flush();
+    let winner = ctx.wait_winner();
+    // 撤销落选者上的回调，否则会一直留到它们完成
+    for (future, id) in registered {
+        future.remove_waiter(id);
+    }
+    winner
 }
 
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    extern "C" fn leaf() -> i64 {
+        1
+    }
+
+    // 在协程内再启动并等待子协程，验证等待者会直接执行还在队列中的子任务
+    extern "C" fn fan_out() -> i64 {
+        let children: Vec<*mut BolideFuture> =
+            (0..32).map(|_| bolide_coroutine_spawn_int(leaf)).collect();
+        let mut sum = 0;
+        for f in children {
+            sum += bolide_coroutine_await_int(f);
+            bolide_coroutine_free(f);
+        }
+        sum
+    }
+
+    #[test]
+    fn test_many_coroutines() {
+        let futures: Vec<*mut BolideFuture> =
+            (0..10_000).map(|_| bolide_coroutine_spawn_int(leaf)).collect();
+        let mut sum = 0;
+        for f in futures {
+            sum += bolide_coroutine_await_int(f);
+            bolide_coroutine_free(f);
+        }
+        assert_eq!(sum, 10_000);
+    }
+
+    #[test]
+    fn test_nested_await() {
+        let futures: Vec<*mut BolideFuture> =
+            (0..256).map(|_| bolide_coroutine_spawn_int(fan_out)).collect();
+        let mut sum = 0;
+        for f in futures {
+            sum += bolide_coroutine_await_int(f);
+            bolide_coroutine_free(f);
+        }
+        assert_eq!(sum, 256 * 32);
+    }
+
+    static HANDOFF: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+
+    extern "C" fn handoff_consumer() -> i64 {
+        crate::bolide_channel_recv(HANDOFF.load(Ordering::SeqCst))
+    }
+
+    // 先等待自己的子协程再发送：等待期间不能把 consumer 嵌套到自己栈上执行
+    extern "C" fn handoff_producer() -> i64 {
+        let child = bolide_coroutine_spawn_int(leaf);
+        let v = bolide_coroutine_await_int(child);
+        bolide_coroutine_free(child);
+        crate::bolide_channel_send(HANDOFF.load(Ordering::SeqCst), 41 + v);
+        0
+    }
+
+    #[test]
+    fn test_await_does_not_run_unrelated_tasks() {
+        HANDOFF.store(crate::bolide_channel_create(), Ordering::SeqCst);
+        let producers: Vec<*mut BolideFuture> =
+            (0..8).map(|_| bolide_coroutine_spawn_int(handoff_producer)).collect();
+        let consumers: Vec<*mut BolideFuture> =
+            (0..8).map(|_| bolide_coroutine_spawn_int(handoff_consumer)).collect();
+        for f in consumers {
+            assert_eq!(bolide_coroutine_await_int(f), 42);
+            bolide_coroutine_free(f);
+        }
+        for f in producers {
+            bolide_coroutine_await_int(f);
+            bolide_coroutine_free(f);
+        }
+    }
+
+    static STARTED: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+    static GO: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+
+    extern "C" fn report_then_wait() -> i64 {
+        crate::bolide_channel_send(STARTED.load(Ordering::SeqCst), 1);
+        crate::bolide_channel_recv(GO.load(Ordering::SeqCst))
+    }
+
+    // 所有协程都开始后才放行：同时阻塞的协程远多于工作线程，补充线程设上限时会死锁
+    #[test]
+    fn test_fan_out_exceeds_spare_limit() {
+        let count = SCHEDULER.core_workers + 300;
+        STARTED.store(crate::bolide_channel_create_buffered(count as i64), Ordering::SeqCst);
+        GO.store(crate::bolide_channel_create_buffered(count as i64), Ordering::SeqCst);
+        let tasks: Vec<*mut BolideFuture> =
+            (0..count).map(|_| bolide_coroutine_spawn_int(report_then_wait)).collect();
+        for _ in 0..count {
+            crate::bolide_channel_recv(STARTED.load(Ordering::SeqCst));
+        }
+        for i in 0..count {
+            crate::bolide_channel_send(GO.load(Ordering::SeqCst), i as i64);
+        }
+        let mut sum = 0;
+        for f in tasks {
+            sum += bolide_coroutine_await_int(f);
+            bolide_coroutine_free(f);
+        }
+        assert_eq!(sum, (0..count as i64).sum::<i64>());
+    }
+
+    static STALL: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+    static STALL_CANCELLED: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+
+    extern "C" fn stall() -> i64 {
+        crate::bolide_channel_recv(STALL.load(Ordering::SeqCst))
+    }
+
+    extern "C" fn stall_cancelled() -> i64 {
+        crate::bolide_channel_recv(STALL_CANCELLED.load(Ordering::SeqCst))
+    }
+
+    #[test]
+    fn test_select_removes_losing_waiters() {
+        STALL.store(crate::bolide_channel_create_buffered(1), Ordering::SeqCst);
+        let slow = bolide_coroutine_spawn_int(stall);
+        for _ in 0..100 {
+            let fast = bolide_coroutine_spawn_int(leaf);
+            let futures = [slow, fast];
+            assert_eq!(bolide_select_wait_first(futures.as_ptr(), 2), 1);
+            bolide_coroutine_free(fast);
+        }
+        assert!(unsafe { &*slow }.inner.waiters.lock().unwrap().is_empty());
+        crate::bolide_channel_send(STALL.load(Ordering::SeqCst), 0);
+        bolide_coroutine_await_int(slow);
+        bolide_coroutine_free(slow);
+    }
+
+    // 候选全部被取消时 select 返回 -1，而不是一直等待
+    #[test]
+    fn test_select_over_cancelled_futures() {
+        // 有缓冲：被取消的任务可能根本没开始，放行时不能阻塞
+        let ch = crate::bolide_channel_create_buffered(2);
+        STALL_CANCELLED.store(ch, Ordering::SeqCst);
+        let a = bolide_coroutine_spawn_int(stall_cancelled);
+        let b = bolide_coroutine_spawn_int(stall_cancelled);
+        let (pa, pb) = (a as usize, b as usize);
+        let canceller = thread::spawn(move || {
+            thread::sleep(Duration::from_millis(20));
+            bolide_coroutine_cancel(pa as *mut BolideFuture);
+            bolide_coroutine_cancel(pb as *mut BolideFuture);
+        });
+        let futures = [a, b];
+        assert_eq!(bolide_select_wait_first(futures.as_ptr(), 2), -1);
+        canceller.join().unwrap();
+        // 已经开始的任务不会被打断，放行它们
+        crate::bolide_channel_send(ch, 0);
+        crate::bolide_channel_send(ch, 0);
+        bolide_coroutine_free(a);
+        bolide_coroutine_free(b);
+    }
+
+    #[test]
+    fn test_select_first() {
+        let futures = [bolide_coroutine_spawn_int(leaf), bolide_coroutine_spawn_int(leaf)];
+        let idx = bolide_select_wait_first(futures.as_ptr(), 2);
+        assert!(idx == 0 || idx == 1);
+        for f in futures {
+            assert_eq!(bolide_coroutine_await_int(f), 1);
+            bolide_coroutine_free(f);
+        }
+    }
+}
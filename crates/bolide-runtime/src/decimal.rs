@@ -28,7 +28,7 @@ pub struct BolideDecimal {
 impl BolideDecimal {
     /// 创建新 Decimal（ref_count = 1）
     pub fn new(value: i64) -> *mut Self {
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -37,11 +37,11 @@ impl BolideDecimal {
                 _padding: [0; 6],
             },
             inner: Decimal::from(value),
-        }))
+        })
     }
 
     pub fn from_f64(value: f64) -> *mut Self {
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -50,11 +50,11 @@ impl BolideDecimal {
                 _padding: [0; 6],
             },
             inner: Decimal::from_f64(value).unwrap_or(Decimal::ZERO),
-        }))
+        })
     }
 
     pub fn from_decimal(inner: Decimal) -> *mut Self {
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -63,7 +63,7 @@ impl BolideDecimal {
                 _padding: [0; 6],
             },
             inner,
-        }))
+        })
     }
 
     pub fn from_str(s: &str) -> Option<*mut Self> {
@@ -102,20 +102,17 @@ impl BolideDecimal {
 
     #[inline]
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     #[inline]
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
@@ -163,7 +160,7 @@ pub extern "C" fn bolide_decimal_release(d: *mut BolideDecimal) {
     if d.is_null() { return; }
     unsafe {
         if (*d).release() {
-            let _ = Box::from_raw(d);
+            crate::slab::free_value(d);
         }
     }
 }
@@ -2,9 +2,18 @@
 //!
 //! BolideDict 使用引用计数管理内存
 //! 键值以 i64 存储（可以是值或指针）
+//!
+//! 存储结构（Swiss table + 插入顺序条目数组）:
+//! - entries: 按插入顺序稠密存放的 {hash, key, value}，删除时留下墓碑，扩容时压实
+//! - 索引表: 开放寻址，每个桶一个控制字节（空 / 已删除 / 哈希高 7 位）和一个
+//!   指向 entries 的 u32 下标；查找时一次比较 8 个控制字节
+//! - int 等按值存放的键用 FxHash 乘法散列；string 键按内容散列和比较，
+//!   哈希缓存在字符串对象头中
+//!
+//! 迭代按插入顺序通过游标（bolide_dict_iter_next / key_at / value_at）直接读取条目，
+//! 不复制整张表。字典持有键和值的引用。
 
 use std::cell::Cell;
-use std::collections::HashMap;
 use std::os::raw::c_void;
 
 use crate::rc::{TypeTag, flags};
@@ -21,21 +30,166 @@ struct RcHeader {
     _padding: [u8; 6],
 }
 
+/// 一组控制字节的宽度
+const GROUP: usize = 8;
+/// 控制字节：空桶
+const EMPTY: u8 = 0xFF;
+/// 控制字节：已删除桶（查找时继续探测）
+const DELETED: u8 = 0x80;
+/// 条目墓碑（有效哈希的最高位总是 0）
+const TOMBSTONE: u64 = u64::MAX;
+/// FxHash 乘数
+const FX_K: u64 = 0x517c_c1b7_2722_0a95;
+/// 最小桶数（不小于一组的宽度，镜像控制字节才有意义）
+const MIN_BUCKETS: usize = 8;
+
+const LO_BITS: u64 = 0x0101_0101_0101_0101;
+const HI_BITS: u64 = 0x8080_8080_8080_8080;
+
+/// 插入顺序条目
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct Entry {
+    hash: u64,
+    key: i64,
+    value: i64,
+}
+
+impl Entry {
+    #[inline]
+    fn is_live(&self) -> bool {
+        self.hash != TOMBSTONE
+    }
+}
+
+/// 哈希高 7 位，存入控制字节
+#[inline]
+fn h2(hash: u64) -> u8 {
+    ((hash >> 56) & 0x7F) as u8
+}
+
+/// 桶数对应的可用容量（负载因子 7/8）
+#[inline]
+fn bucket_capacity(buckets: usize) -> usize {
+    buckets - buckets / 8
+}
+
+/// 容纳 n 个元素所需的桶数
+fn buckets_for(n: usize) -> usize {
+    let mut buckets = MIN_BUCKETS;
+    while bucket_capacity(buckets) < n {
+        buckets *= 2;
+    }
+    buckets
+}
+
+/// 索引表分配大小: u32 下标 + 控制字节（末尾额外镜像一组）
+#[inline]
+fn table_size(buckets: usize) -> usize {
+    buckets * 4 + buckets + GROUP
+}
+
+#[inline]
+unsafe fn load_group(ctrl: *const u8) -> u64 {
+    u64::from_le(std::ptr::read_unaligned(ctrl as *const u64))
+}
+
+/// 组内控制字节等于 tag 的位置（可能有误报，调用方需比较键）
+#[inline]
+fn match_tag(group: u64, tag: u8) -> u64 {
+    let x = group ^ (LO_BITS * tag as u64);
+    x.wrapping_sub(LO_BITS) & !x & HI_BITS
+}
+
+/// 组内空桶位置
+#[inline]
+fn match_empty(group: u64) -> u64 {
+    group & (group << 1) & HI_BITS
+}
+
+/// 组内空桶或已删除桶位置
+#[inline]
+fn match_free(group: u64) -> u64 {
+    group & HI_BITS
+}
+
+/// 增加键/值的引用计数
+fn retain_slot(ty: ElementType, value: i64) {
+    let ptr = value as *mut c_void;
+    if ptr.is_null() { return; }
+    match ty {
+        ElementType::String => unsafe {
+            crate::bolide_string_retain(ptr as *mut BolideString);
+        },
+        ElementType::BigInt => unsafe {
+            crate::bolide_bigint_retain(ptr as *mut BolideBigInt);
+        },
+        ElementType::Decimal => unsafe {
+            crate::bolide_decimal_retain(ptr as *mut BolideDecimal);
+        },
+        ElementType::List => unsafe {
+            crate::bolide_list_retain(ptr as *mut BolideList);
+        },
+        ElementType::Dict => {
+            bolide_dict_retain(ptr as *mut BolideDict);
+        }
+        ElementType::Dynamic => unsafe {
+            crate::bolide_dynamic_retain(ptr as *mut crate::dynamic::BolideDynamic);
+        },
+        _ => {}
+    }
+}
+
+/// 释放键/值的引用计数
+fn release_slot(ty: ElementType, value: i64) {
+    let ptr = value as *mut c_void;
+    if ptr.is_null() { return; }
+    match ty {
+        ElementType::String => {
+            crate::bolide_string_release(ptr as *mut BolideString);
+        }
+        ElementType::BigInt => unsafe {
+            crate::bolide_bigint_release(ptr as *mut BolideBigInt);
+        },
+        ElementType::Decimal => unsafe {
+            crate::bolide_decimal_release(ptr as *mut BolideDecimal);
+        },
+        ElementType::List => unsafe {
+            crate::bolide_list_release(ptr as *mut BolideList);
+        },
+        ElementType::Dict => {
+            bolide_dict_release(ptr as *mut BolideDict);
+        }
+        ElementType::Dynamic => unsafe {
+            crate::bolide_dynamic_release(ptr as *mut crate::dynamic::BolideDynamic);
+        },
+        _ => {}
+    }
+}
+
 /// Bolide 字典类型（带引用计数）
 #[repr(C)]
 pub struct BolideDict {
     header: RcHeader,
-    data: *mut HashMap<i64, i64>,  // 使用 Box 管理的 HashMap
+    entries: *mut Entry,
+    entries_len: usize,    // 已用条目数（含墓碑）
+    entries_cap: usize,
+    slots: *mut u32,       // 索引表起始（ctrl 紧随其后）；未分配时为空
+    ctrl: *mut u8,
+    bucket_mask: usize,
+    growth_left: usize,
     len: usize,
     key_type: ElementType,
     value_type: ElementType,
 }
 
+/// 元素个数字段偏移，编译器据此内联读取字典长度
+pub const DICT_LEN_OFFSET: i32 = std::mem::offset_of!(BolideDict, len) as i32;
+
 impl BolideDict {
     /// 创建新字典（ref_count = 1）
     pub fn new(key_type: ElementType, value_type: ElementType) -> *mut Self {
-        let map = Box::into_raw(Box::new(HashMap::new()));
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -43,75 +197,279 @@ impl BolideDict {
                 flags: Cell::new(0),
                 _padding: [0; 6],
             },
-            data: map,
+            entries: std::ptr::null_mut(),
+            entries_len: 0,
+            entries_cap: 0,
+            slots: std::ptr::null_mut(),
+            ctrl: std::ptr::null_mut(),
+            bucket_mask: 0,
+            growth_left: 0,
             len: 0,
             key_type,
             value_type,
-        }))
+        })
     }
 
     /// 获取引用计数
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     /// 增加引用计数
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     /// 减少引用计数，返回是否应该释放
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        debug_assert!(count > 0, "release on already freed dict");
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
+    }
+
+    /// 把所有 RC 键和值标记为跨线程共享（字典本身已被标记时调用）
+    pub(crate) unsafe fn mark_entries_shared(&self) {
+        let keys_rc = self.key_type.is_rc();
+        let values_rc = self.value_type.is_rc();
+        if !keys_rc && !values_rc {
+            return;
+        }
+        for entry in self.live_entries() {
+            if keys_rc {
+                crate::rc::bolide_value_mark_shared(entry.key as *mut c_void);
+            }
+            if values_rc {
+                crate::rc::bolide_value_mark_shared(entry.value as *mut c_void);
+            }
+        }
+    }
+
+    // ==================== 哈希与查找 ====================
+
+    /// 计算键的哈希（最高位清零，与墓碑区分）
+    #[inline]
+    fn hash_key(&self, key: i64) -> u64 {
+        let raw = match self.key_type {
+            ElementType::String => {
+                let s = key as *const BolideString;
+                if s.is_null() { 0 } else { unsafe { (*s).content_hash() as u64 } }
+            }
+            _ => key as u64,
+        };
+        raw.wrapping_mul(FX_K).rotate_left(26) >> 1
+    }
+
+    /// 键相等：string 按内容比较，其余按位比较
+    #[inline]
+    fn key_eq(&self, a: i64, b: i64) -> bool {
+        if a == b {
+            return true;
+        }
+        match self.key_type {
+            ElementType::String => {
+                let (a, b) = (a as *const BolideString, b as *const BolideString);
+                if a.is_null() || b.is_null() {
+                    return false;
+                }
+                unsafe { (*a).as_bytes() == (*b).as_bytes() }
+            }
+            _ => false,
+        }
+    }
+
+    /// 查找键所在的桶
+    unsafe fn find(&self, hash: u64, key: i64) -> Option<usize> {
+        if self.ctrl.is_null() {
+            return None;
+        }
+        let tag = h2(hash);
+        let mut pos = hash as usize & self.bucket_mask;
+        let mut stride = 0;
+        loop {
+            let group = load_group(self.ctrl.add(pos));
+            let mut matches = match_tag(group, tag);
+            while matches != 0 {
+                let bucket = (pos + matches.trailing_zeros() as usize / 8) & self.bucket_mask;
+                let entry = &*self.entries.add(*self.slots.add(bucket) as usize);
+                if entry.hash == hash && self.key_eq(entry.key, key) {
+                    return Some(bucket);
+                }
+                matches &= matches - 1;
+            }
+            if match_empty(group) != 0 {
+                return None;
+            }
+            stride += GROUP;
+            pos = (pos + stride) & self.bucket_mask;
+        }
+    }
+
+    /// 找到 hash 探测序列上第一个空桶或已删除桶
+    unsafe fn find_insert_slot(&self, hash: u64) -> usize {
+        let mut pos = hash as usize & self.bucket_mask;
+        let mut stride = 0;
+        loop {
+            let free = match_free(load_group(self.ctrl.add(pos)));
+            if free != 0 {
+                return (pos + free.trailing_zeros() as usize / 8) & self.bucket_mask;
+            }
+            stride += GROUP;
+            pos = (pos + stride) & self.bucket_mask;
+        }
+    }
+
+    /// 写控制字节，同时更新末尾的镜像组
+    #[inline]
+    unsafe fn set_ctrl(&mut self, bucket: usize, value: u8) {
+        let mirror = (bucket.wrapping_sub(GROUP) & self.bucket_mask) + GROUP;
+        *self.ctrl.add(bucket) = value;
+        *self.ctrl.add(mirror) = value;
+    }
+
+    #[inline]
+    unsafe fn entry_at(&self, bucket: usize) -> *mut Entry {
+        self.entries.add(*self.slots.add(bucket) as usize)
+    }
+
+    /// 存活条目（按插入顺序）
+    fn live_entries(&self) -> impl Iterator<Item = &Entry> {
+        let entries: &[Entry] = if self.entries.is_null() {
+            &[]
+        } else {
+            unsafe { std::slice::from_raw_parts(self.entries, self.entries_len) }
+        };
+        entries.iter().filter(|e| e.is_live())
+    }
+
+    // ==================== 扩容 ====================
+
+    /// 追加条目，返回下标
+    unsafe fn push_entry(&mut self, entry: Entry) -> usize {
+        if self.entries_len == self.entries_cap {
+            let new_cap = if self.entries_cap == 0 { 4 } else { self.entries_cap * 2 };
+            let size = std::mem::size_of::<Entry>();
+            self.entries = crate::slab::realloc(
+                self.entries as *mut u8, self.entries_cap * size, new_cap * size,
+            ) as *mut Entry;
+            self.entries_cap = new_cap;
+        }
+        let index = self.entries_len;
+        *self.entries.add(index) = entry;
+        self.entries_len += 1;
+        index
     }
 
+    /// 压实条目并按 min_items 重建索引表
+    unsafe fn rehash(&mut self, min_items: usize) {
+        if self.entries_len > self.len {
+            let mut live = 0;
+            for i in 0..self.entries_len {
+                let entry = *self.entries.add(i);
+                if entry.is_live() {
+                    *self.entries.add(live) = entry;
+                    live += 1;
+                }
+            }
+            self.entries_len = live;
+        }
+
+        let buckets = buckets_for(min_items.max(self.len));
+        if !self.slots.is_null() {
+            crate::slab::free(self.slots as *mut u8, table_size(self.bucket_mask + 1));
+        }
+        let table = crate::slab::alloc(table_size(buckets));
+        self.slots = table as *mut u32;
+        self.ctrl = table.add(buckets * 4);
+        self.bucket_mask = buckets - 1;
+        std::ptr::write_bytes(self.ctrl, EMPTY, buckets + GROUP);
+
+        for i in 0..self.entries_len {
+            let hash = (*self.entries.add(i)).hash;
+            let bucket = self.find_insert_slot(hash);
+            self.set_ctrl(bucket, h2(hash));
+            *self.slots.add(bucket) = i as u32;
+        }
+        self.growth_left = bucket_capacity(buckets) - self.entries_len;
+    }
+
+    /// 插入一个确定不存在的键
+    unsafe fn insert_new(&mut self, hash: u64, key: i64, value: i64) {
+        if self.ctrl.is_null() {
+            self.rehash(1);
+        }
+        let mut bucket = self.find_insert_slot(hash);
+        if self.growth_left == 0 && *self.ctrl.add(bucket) == EMPTY {
+            self.rehash(self.len + 1);
+            bucket = self.find_insert_slot(hash);
+        }
+        if *self.ctrl.add(bucket) == EMPTY {
+            self.growth_left -= 1;
+        }
+        let index = self.push_entry(Entry { hash, key, value });
+        self.set_ctrl(bucket, h2(hash));
+        *self.slots.add(bucket) = index as u32;
+        self.len += 1;
+    }
+
+    // ==================== 基本操作 ====================
+
     /// 设置键值对
     pub fn set(&mut self, key: i64, value: i64) {
         unsafe {
-            let map = &mut *self.data;
-            // 如果是覆盖，需要释放旧值
-            if let Some(old_value) = map.insert(key, value) {
+            let hash = self.hash_key(key);
+            // 字典已跨线程共享时，新存入的 RC 键值也要标记（先于 retain，计数从此走原子路径）
+            if crate::rc::is_shared(&self.header.flags) {
+                if self.key_type.is_rc() {
+                    crate::rc::bolide_value_mark_shared(key as *mut c_void);
+                }
+                if self.value_type.is_rc() {
+                    crate::rc::bolide_value_mark_shared(value as *mut c_void);
+                }
+            }
+            // 先 retain 新值再释放旧值，覆盖为同一对象时不会提前释放
+            self.retain_value(value);
+            if let Some(bucket) = self.find(hash, key) {
+                let entry = &mut *self.entry_at(bucket);
+                let old_value = entry.value;
+                entry.value = value;
                 self.release_value(old_value);
             } else {
-                self.len += 1;
+                retain_slot(self.key_type, key);
+                self.insert_new(hash, key, value);
             }
-            // 增加新值的引用计数
-            self.retain_value(value);
         }
     }
 
     /// 获取值（不存在返回 0）
+    #[inline]
     pub fn get(&self, key: i64) -> Option<i64> {
         unsafe {
-            let map = &*self.data;
-            map.get(&key).copied()
+            self.find(self.hash_key(key), key)
+                .map(|bucket| (*self.entry_at(bucket)).value)
         }
     }
 
     /// 检查键是否存在
+    #[inline]
     pub fn contains(&self, key: i64) -> bool {
-        unsafe {
-            let map = &*self.data;
-            map.contains_key(&key)
-        }
+        unsafe { self.find(self.hash_key(key), key).is_some() }
     }
 
     /// 移除键值对，返回值
     pub fn remove(&mut self, key: i64) -> Option<i64> {
         unsafe {
-            let map = &mut *self.data;
-            if let Some(value) = map.remove(&key) {
-                self.len -= 1;
-                // 注意：不释放值，因为我们返回它
-                Some(value)
+            let bucket = self.find(self.hash_key(key), key)?;
+            let index = *self.slots.add(bucket) as usize;
+            let entry = *self.entries.add(index);
+            self.set_ctrl(bucket, DELETED);
+            if index + 1 == self.entries_len {
+                self.entries_len -= 1;
             } else {
-                None
+                (*self.entries.add(index)).hash = TOMBSTONE;
             }
+            self.len -= 1;
+            release_slot(self.key_type, entry.key);
+            // 注意：不释放值，因为我们返回它
+            Some(entry.value)
         }
     }
 
@@ -127,32 +485,42 @@ impl BolideDict {
         self.len == 0
     }
 
-    /// 清空字典
+    /// 清空字典（保留已分配的表）
     pub fn clear(&mut self) {
-        unsafe {
-            let map = &mut *self.data;
-            // 释放所有值的引用
-            for (_, value) in map.drain() {
-                self.release_value(value);
-            }
-            self.len = 0;
+        self.release_entries();
+        self.entries_len = 0;
+        self.len = 0;
+        if !self.ctrl.is_null() {
+            let buckets = self.bucket_mask + 1;
+            unsafe { std::ptr::write_bytes(self.ctrl, EMPTY, buckets + GROUP); }
+            self.growth_left = bucket_capacity(buckets);
         }
     }
 
-    /// 获取所有键
+    /// 获取所有键（插入顺序）
     pub fn keys(&self) -> Vec<i64> {
-        unsafe {
-            let map = &*self.data;
-            map.keys().copied().collect()
-        }
+        self.live_entries().map(|e| e.key).collect()
     }
 
-    /// 获取所有值
+    /// 获取所有值（插入顺序）
     pub fn values(&self) -> Vec<i64> {
-        unsafe {
-            let map = &*self.data;
-            map.values().copied().collect()
+        self.live_entries().map(|e| e.value).collect()
+    }
+
+    /// 从 pos 开始的下一个存活条目下标，没有返回 None
+    #[inline]
+    pub fn next_entry(&self, pos: usize) -> Option<usize> {
+        (pos..self.entries_len).find(|&i| unsafe { (*self.entries.add(i)).is_live() })
+    }
+
+    /// 条目下标处的键值（借用，不增加引用计数）
+    #[inline]
+    pub fn entry(&self, pos: usize) -> Option<(i64, i64)> {
+        if pos >= self.entries_len {
+            return None;
         }
+        let entry = unsafe { *self.entries.add(pos) };
+        if entry.is_live() { Some((entry.key, entry.value)) } else { None }
     }
 
     /// 获取键类型
@@ -179,64 +547,38 @@ impl BolideDict {
 
     /// 增加值的引用计数
     fn retain_value(&self, value: i64) {
-        let ptr = value as *mut c_void;
-        if ptr.is_null() { return; }
-        match self.value_type {
-            ElementType::String => unsafe {
-                crate::bolide_string_retain(ptr as *mut BolideString);
-            },
-            ElementType::BigInt => unsafe {
-                crate::bolide_bigint_retain(ptr as *mut BolideBigInt);
-            },
-            ElementType::Decimal => unsafe {
-                crate::bolide_decimal_retain(ptr as *mut BolideDecimal);
-            },
-            ElementType::List => unsafe {
-                crate::bolide_list_retain(ptr as *mut BolideList);
-            },
-            ElementType::Dynamic => unsafe {
-                crate::bolide_dynamic_retain(ptr as *mut crate::dynamic::BolideDynamic);
-            },
-            _ => {}
-        }
+        retain_slot(self.value_type, value);
     }
 
     /// 释放值的引用计数
     fn release_value(&self, value: i64) {
-        let ptr = value as *mut c_void;
-        if ptr.is_null() { return; }
-        match self.value_type {
-            ElementType::String => unsafe {
-                crate::bolide_string_release(ptr as *mut BolideString);
-            },
-            ElementType::BigInt => unsafe {
-                crate::bolide_bigint_release(ptr as *mut BolideBigInt);
-            },
-            ElementType::Decimal => unsafe {
-                crate::bolide_decimal_release(ptr as *mut BolideDecimal);
-            },
-            ElementType::List => unsafe {
-                crate::bolide_list_release(ptr as *mut BolideList);
-            },
-            ElementType::Dynamic => unsafe {
-                crate::bolide_dynamic_release(ptr as *mut crate::dynamic::BolideDynamic);
-            },
-            _ => {}
+        release_slot(self.value_type, value);
+    }
+
+    /// 释放所有存活条目持有的键和值
+    fn release_entries(&self) {
+        if !self.key_type.is_rc() && !self.value_type.is_rc() {
+            return;
+        }
+        for entry in self.live_entries() {
+            release_slot(self.key_type, entry.key);
+            release_slot(self.value_type, entry.value);
         }
     }
 }
 
 impl Drop for BolideDict {
     fn drop(&mut self) {
+        self.release_entries();
         unsafe {
-            // 释放所有值
-            if !self.data.is_null() {
-                let map = &*self.data;
-                for (_, &value) in map.iter() {
-                    self.release_value(value);
-                }
-                // 释放 HashMap
-                let _ = Box::from_raw(self.data);
+            if !self.entries.is_null() {
+                crate::slab::free(
+                    self.entries as *mut u8,
+                    self.entries_cap * std::mem::size_of::<Entry>(),
+                );
+            }
+            if !self.slots.is_null() {
+                crate::slab::free(self.slots as *mut u8, table_size(self.bucket_mask + 1));
             }
         }
     }
@@ -266,7 +608,7 @@ pub extern "C" fn bolide_dict_release(dict: *mut BolideDict) {
     if dict.is_null() { return; }
     unsafe {
         if (*dict).release() {
-            let _ = Box::from_raw(dict);
+            crate::slab::free_value(dict);
         }
     }
 }
@@ -280,9 +622,11 @@ pub extern "C" fn bolide_dict_clone(dict: *const BolideDict) -> *mut BolideDict
         let new_dict = BolideDict::new(src.key_type, src.value_type);
         let dst = &mut *new_dict;
         
-        let src_map = &*src.data;
-        for (&key, &value) in src_map.iter() {
-            dst.set(key, value);
+        if src.len > 0 {
+            dst.rehash(src.len);
+        }
+        for entry in src.live_entries() {
+            dst.set(entry.key, entry.value);
         }
         
         new_dict
@@ -362,9 +706,8 @@ pub extern "C" fn bolide_dict_values(dict: *const BolideDict) -> *mut BolideList
         let values = d.values();
         let list = crate::list::BolideList::new(d.value_type);
         for value in values {
+            // list_push 会为 RC 值增加引用计数
             crate::bolide_list_push(list, value);
-            // 增加值的引用计数（因为 values() 不增加）
-            d.retain_value(value);
         }
         list
     }
@@ -402,64 +745,96 @@ pub extern "C" fn bolide_dict_mark_moved(dict: *mut BolideDict) {
 /// 打印字典
 #[no_mangle]
 pub extern "C" fn bolide_print_dict(dict: *const BolideDict) {
-    if dict.is_null() {
-        println!("{{}}");
-        return;
-    }
-    unsafe {
-        let d = &*dict;
-        let map = &*d.data;
-        print!("{{");
-        let mut first = true;
-        for (&key, &value) in map.iter() {
-            if !first { print!(", "); }
-            first = false;
-            
-            // 打印键
-            match d.key_type {
-                ElementType::Int => print!("{}", key),
-                ElementType::String => {
-                    let s = key as *const BolideString;
-                    if !s.is_null() {
-                        print!("\"{}\"", (*s).as_str());
-                    } else {
-                        print!("null");
-                    }
+    crate::print::with_out(|out| {
+        if dict.is_null() {
+            out.push_str("{}");
+            out.end_line();
+            return;
+        }
+        unsafe {
+            let d = &*dict;
+            out.push_str("{");
+            let mut first = true;
+            for entry in d.live_entries() {
+                let (key, value) = (entry.key, entry.value);
+                if !first { out.push_str(", "); }
+                first = false;
+
+                // 打印键
+                match d.key_type {
+                    ElementType::String => push_quoted(out, key as *const BolideString),
+                    _ => out.push_int(key),
                 }
-                _ => print!("{}", key),
-            }
-            
-            print!(": ");
-            
-            // 打印值
-            match d.value_type {
-                ElementType::Int => print!("{}", value),
-                ElementType::Float => print!("{}", f64::from_bits(value as u64)),
-                ElementType::Bool => print!("{}", if value != 0 { "true" } else { "false" }),
-                ElementType::String => {
-                    let s = value as *const BolideString;
-                    if !s.is_null() {
-                        print!("\"{}\"", (*s).as_str());
-                    } else {
-                        print!("null");
+
+                out.push_str(": ");
+
+                // 打印值
+                match d.value_type {
+                    ElementType::Float => out.push_float(f64::from_bits(value as u64)),
+                    ElementType::Bool => out.push_bool(value),
+                    ElementType::String => push_quoted(out, value as *const BolideString),
+                    ElementType::Dynamic => {
+                        out.push_str(&crate::dynamic::dynamic_repr(value as *const crate::dynamic::BolideDynamic));
                     }
+                    _ => out.push_int(value),
                 }
-                _ => print!("{}", value),
             }
+            out.push_str("}");
+            out.end_line();
         }
-        println!("}}");
+    });
+}
+
+/// 以带引号形式写出字符串（null 写作 null）
+unsafe fn push_quoted(out: &mut crate::print::OutBuf, s: *const BolideString) {
+    if s.is_null() {
+        out.push_str("null");
+    } else {
+        out.push_str("\"");
+        out.push_bytes((*s).as_bytes());
+        out.push_str("\"");
     }
 }
 
 // ==================== 迭代器支持 (for 循环) ====================
 
 /// 创建字典迭代器（返回键的列表用于迭代）
+///
+/// 会复制全部键；编译器生成的 for 循环使用下面的游标接口。
 #[no_mangle]
 pub extern "C" fn bolide_dict_iter(dict: *const BolideDict) -> *mut BolideList {
     // 使用 keys() 返回的列表进行迭代
     bolide_dict_keys(dict)
 }
 
+/// 游标迭代：返回 pos 及之后第一个存活条目的位置，结束返回 -1
+///
+/// 按插入顺序遍历；循环体中插入新键可能触发压实，此时遍历结果未定义（不会越界）。
+#[no_mangle]
+pub extern "C" fn bolide_dict_iter_next(dict: *const BolideDict, pos: i64) -> i64 {
+    if dict.is_null() || pos < 0 { return -1; }
+    unsafe {
+        match (*dict).next_entry(pos as usize) {
+            Some(next) => next as i64,
+            None => -1,
+        }
+    }
+}
+
+/// 游标位置的键（借用）
+#[no_mangle]
+pub extern "C" fn bolide_dict_key_at(dict: *const BolideDict, pos: i64) -> i64 {
+    if dict.is_null() || pos < 0 { return 0; }
+    unsafe { (*dict).entry(pos as usize).map(|(key, _)| key).unwrap_or(0) }
+}
+
+/// 游标位置的值（借用）
+#[no_mangle]
+pub extern "C" fn bolide_dict_value_at(dict: *const BolideDict, pos: i64) -> i64 {
+    if dict.is_null() || pos < 0 { return 0; }
+    unsafe { (*dict).entry(pos as usize).map(|(_, value)| value).unwrap_or(0) }
+}
+
 // ==================== 测试 ====================
 
 #[cfg(test)]
@@ -491,6 +866,22 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_shared_dict_marks_new_entries() {
+        let dict = BolideDict::new(ElementType::String, ElementType::List);
+        crate::rc::bolide_value_mark_shared(dict as *mut c_void);
+        let key = crate::bolide_string_from_slice(b"k".as_ptr() as *const i8, 1);
+        let value = crate::BolideList::new(ElementType::Int);
+        bolide_dict_set(dict, key as i64, value as i64);
+        unsafe {
+            assert!((*(key as *const crate::rc::RcHeader)).is_shared());
+            assert!((*(value as *const crate::rc::RcHeader)).is_shared());
+        }
+        crate::bolide_string_release(key);
+        crate::bolide_list_release(value);
+        bolide_dict_release(dict);
+    }
+
     #[test]
     fn test_dict_clone() {
         let dict = BolideDict::new(ElementType::Int, ElementType::Int);
@@ -506,4 +897,77 @@ mod tests {
             bolide_dict_release(cloned);
         }
     }
+
+    #[test]
+    fn test_dict_grow_and_remove() {
+        let dict = BolideDict::new(ElementType::Int, ElementType::Int);
+        unsafe {
+            for i in 0..10_000i64 {
+                bolide_dict_set(dict, i * 4096, i);
+            }
+            assert_eq!((*dict).len(), 10_000);
+            for i in (0..10_000i64).step_by(2) {
+                assert_eq!(bolide_dict_remove(dict, i * 4096), i);
+            }
+            assert_eq!((*dict).len(), 5_000);
+            for i in 0..10_000i64 {
+                let expected = if i % 2 == 0 { 0 } else { 1 };
+                assert_eq!(bolide_dict_contains(dict, i * 4096), expected);
+            }
+            // 删除后再插入会复用已删除的桶 / 触发压实
+            for i in 0..10_000i64 {
+                bolide_dict_set(dict, -i - 1, i);
+            }
+            assert_eq!((*dict).len(), 15_000);
+            assert_eq!(bolide_dict_get(dict, -10_000), 9_999);
+            bolide_dict_release(dict);
+        }
+    }
+
+    #[test]
+    fn test_dict_insertion_order() {
+        let dict = BolideDict::new(ElementType::Int, ElementType::Int);
+        unsafe {
+            for key in [30, 10, 20, 40] {
+                bolide_dict_set(dict, key, key * 2);
+            }
+            bolide_dict_remove(dict, 10);
+            bolide_dict_set(dict, 10, 1);
+            bolide_dict_set(dict, 30, 3); // 覆盖不改变位置
+
+            let mut keys = Vec::new();
+            let mut pos = bolide_dict_iter_next(dict, 0);
+            while pos >= 0 {
+                keys.push(bolide_dict_key_at(dict, pos));
+                pos = bolide_dict_iter_next(dict, pos + 1);
+            }
+            assert_eq!(keys, vec![30, 20, 40, 10]);
+            assert_eq!(bolide_dict_get(dict, 30), 3);
+            bolide_dict_release(dict);
+        }
+    }
+
+    #[test]
+    fn test_dict_string_keys_by_content() {
+        let dict = BolideDict::new(ElementType::String, ElementType::Int);
+        unsafe {
+            let k1 = BolideString::new("apple");
+            let k2 = BolideString::new("apple");
+            bolide_dict_set(dict, k1 as i64, 1);
+            // 不同对象、相同内容命中同一个键
+            bolide_dict_set(dict, k2 as i64, 2);
+            assert_eq!((*dict).len(), 1);
+            assert_eq!(bolide_dict_get(dict, k2 as i64), 2);
+            // 字典持有键的引用
+            assert_eq!((*k1).ref_count(), 2);
+            assert_eq!((*k2).ref_count(), 1);
+
+            assert_eq!(bolide_dict_remove(dict, k2 as i64), 2);
+            assert_eq!((*k1).ref_count(), 1);
+
+            crate::bolide_string_release(k1);
+            crate::bolide_string_release(k2);
+            bolide_dict_release(dict);
+        }
+    }
 }
@@ -1,12 +1,70 @@
 //! Bolide Dynamic type with reference counting
 //!
 //! BolideDynamic 是 Python 风格的动态类型，使用引用计数管理内存
+//!
+//! none/bool/int/float 直接编码在指针里，不分配堆对象（堆对象 16 字节对齐，低 3 位总为 0）：
+//! - `xx1`：int，值为 `ptr >> 1`（63 位有符号，超出范围的 int 才装箱）
+//! - `010`：bool，值在第 3 位
+//! - `100`：float，按 Spur SmallFloat64 的方式编码：符号位循环移到最低位，
+//!   指数减去偏移后只保留 8 位（约 1e-38 到 1e38 以及 ±0），其余 float（inf、NaN、更大/更小的值）装箱
+//! - `110`：none
+//! - `000`：堆对象（bigint/decimal/string/list，以及装箱的 int/float）；null 仍表示无效值
+//!
+//! 读取值一律经 `BolideDynamic::view`，不要直接对 Dynamic 指针解引用。
+//! 编译器对 int 立即数的加减乘和比较生成内联快速路径，只有其他情况才调用这里的运行时函数。
 
 use std::cell::Cell;
 
 use crate::rc::{TypeTag, flags};
 use crate::{BolideBigInt, BolideDecimal, BolideString, BolideList};
 
+/// 立即数标记位（低 3 位），编译器据此生成内联快速路径
+pub const DYNAMIC_TAG_MASK: i64 = 0b111;
+/// int 立即数标记（最低位）
+pub const DYNAMIC_INT_TAG: i64 = 0b001;
+/// none 立即数
+pub const DYNAMIC_NONE: i64 = 0b110;
+
+const TAG_MASK: usize = DYNAMIC_TAG_MASK as usize;
+const INT_TAG: usize = DYNAMIC_INT_TAG as usize;
+const BOOL_TAG: usize = 0b010;
+const FLOAT_TAG: usize = 0b100;
+const NONE_VALUE: usize = DYNAMIC_NONE as usize;
+
+/// int 立即数范围
+const INT_MIN: i64 = i64::MIN >> 1;
+const INT_MAX: i64 = i64::MAX >> 1;
+
+/// float 立即数的指数偏移：指数位在 (896, 896 + 255] 内的值可以内联
+const FLOAT_EXP_BIAS: u64 = 896;
+const FLOAT_EXP_OFFSET: u64 = FLOAT_EXP_BIAS << 53;
+
+/// 把 float 编码为立即数，指数超出范围时返回 None
+#[inline]
+fn encode_float(value: f64) -> Option<usize> {
+    // 符号位移到最低位，指数位变为 [53, 64)
+    let rotated = value.to_bits().rotate_left(1);
+    if rotated <= 1 {
+        // ±0
+        return Some((rotated << 3) as usize | FLOAT_TAG);
+    }
+    let exp = rotated >> 53;
+    if exp > FLOAT_EXP_BIAS && exp <= FLOAT_EXP_BIAS + 255 {
+        Some(((rotated - FLOAT_EXP_OFFSET) << 3) as usize | FLOAT_TAG)
+    } else {
+        None
+    }
+}
+
+#[inline]
+fn decode_float(bits: usize) -> f64 {
+    let mut rotated = (bits >> 3) as u64;
+    if rotated > 1 {
+        rotated += FLOAT_EXP_OFFSET;
+    }
+    f64::from_bits(rotated.rotate_right(1))
+}
+
 /// RC 对象头
 #[repr(C)]
 struct RcHeader {
@@ -52,10 +110,72 @@ pub struct BolideDynamic {
     pub data: DynamicData,
 }
 
+/// Dynamic 值视图：解码后的标量，或堆上的 bigint/decimal/string/list
+#[derive(Clone, Copy)]
+pub enum DynValue<'a> {
+    None,
+    Bool(bool),
+    Int(i64),
+    Float(f64),
+    Heap(&'a BolideDynamic),
+}
+
+impl DynValue<'_> {
+    pub fn get_type(&self) -> DynamicType {
+        match self {
+            DynValue::None => DynamicType::None,
+            DynValue::Bool(_) => DynamicType::Bool,
+            DynValue::Int(_) => DynamicType::Int,
+            DynValue::Float(_) => DynamicType::Float,
+            DynValue::Heap(d) => d.tag,
+        }
+    }
+
+    pub fn is_truthy(&self) -> bool {
+        match *self {
+            DynValue::None => false,
+            DynValue::Bool(v) => v,
+            DynValue::Int(v) => v != 0,
+            DynValue::Float(v) => v != 0.0,
+            DynValue::Heap(d) => d.is_truthy(),
+        }
+    }
+
+    pub fn to_int(&self) -> i64 {
+        match *self {
+            DynValue::None => 0,
+            DynValue::Bool(v) => v as i64,
+            DynValue::Int(v) => v,
+            DynValue::Float(v) => v as i64,
+            DynValue::Heap(d) => d.to_int(),
+        }
+    }
+
+    pub fn to_float(&self) -> f64 {
+        match *self {
+            DynValue::None => 0.0,
+            DynValue::Bool(v) => v as i64 as f64,
+            DynValue::Int(v) => v as f64,
+            DynValue::Float(v) => v,
+            DynValue::Heap(d) => d.to_float(),
+        }
+    }
+
+    pub fn to_string_repr(&self) -> String {
+        match *self {
+            DynValue::None => "none".to_string(),
+            DynValue::Bool(v) => v.to_string(),
+            DynValue::Int(v) => v.to_string(),
+            DynValue::Float(v) => v.to_string(),
+            DynValue::Heap(d) => d.to_string_repr(),
+        }
+    }
+}
+
 impl BolideDynamic {
-    /// 创建 None 值
-    pub fn none() -> *mut Self {
-        Box::into_raw(Box::new(Self {
+    /// 分配堆对象（ref_count = 1）
+    fn boxed(tag: DynamicType, data: DynamicData) -> *mut Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -63,107 +183,81 @@ impl BolideDynamic {
                 flags: Cell::new(0),
                 _padding: [0; 6],
             },
-            tag: DynamicType::None,
-            data: DynamicData { none: () },
-        }))
+            tag,
+            data,
+        })
+    }
+
+    /// 创建 None 值
+    pub fn none() -> *mut Self {
+        NONE_VALUE as *mut Self
     }
 
     pub fn from_bool(value: bool) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::Bool,
-            data: DynamicData { bool_val: if value { 1 } else { 0 } },
-        }))
+        (((value as usize) << 3) | BOOL_TAG) as *mut Self
     }
 
+    /// 在立即数范围内时内联，否则分配堆对象
     pub fn from_int(value: i64) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::Int,
-            data: DynamicData { int_val: value },
-        }))
+        if (INT_MIN..=INT_MAX).contains(&value) {
+            ((value << 1) as usize | INT_TAG) as *mut Self
+        } else {
+            Self::boxed(DynamicType::Int, DynamicData { int_val: value })
+        }
     }
 
+    /// 指数在立即数范围内时内联，否则（极大/极小值、inf、NaN）分配堆对象
     pub fn from_float(value: f64) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::Float,
-            data: DynamicData { float_val: value },
-        }))
+        match encode_float(value) {
+            Some(bits) => bits as *mut Self,
+            None => Self::boxed(DynamicType::Float, DynamicData { float_val: value }),
+        }
     }
 
     pub fn from_bigint(ptr: *mut BolideBigInt) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::BigInt,
-            data: DynamicData { bigint_ptr: ptr },
-        }))
+        Self::boxed(DynamicType::BigInt, DynamicData { bigint_ptr: ptr })
     }
 
     pub fn from_decimal(ptr: *mut BolideDecimal) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::Decimal,
-            data: DynamicData { decimal_ptr: ptr },
-        }))
+        Self::boxed(DynamicType::Decimal, DynamicData { decimal_ptr: ptr })
     }
 
     pub fn from_string(ptr: *mut BolideString) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::String,
-            data: DynamicData { string_ptr: ptr },
-        }))
+        Self::boxed(DynamicType::String, DynamicData { string_ptr: ptr })
     }
 
     pub fn from_list(ptr: *mut BolideList) -> *mut Self {
-        Box::into_raw(Box::new(Self {
-            header: RcHeader {
-                strong_count: Cell::new(1),
-                weak_count: Cell::new(1),
-                type_tag: TypeTag::Object,
-                flags: Cell::new(0),
-                _padding: [0; 6],
-            },
-            tag: DynamicType::List,
-            data: DynamicData { list_ptr: ptr },
-        }))
+        Self::boxed(DynamicType::List, DynamicData { list_ptr: ptr })
+    }
+
+    /// 是否为立即数（没有对象头）
+    #[inline]
+    pub fn is_immediate(ptr: *const Self) -> bool {
+        ptr as usize & TAG_MASK != 0
+    }
+
+    /// 读取值；ptr 必须非 null。堆上的 int/float 也解码成标量
+    #[inline]
+    pub unsafe fn view<'a>(ptr: *const Self) -> DynValue<'a> {
+        let bits = ptr as usize;
+        if bits & INT_TAG != 0 {
+            return DynValue::Int((bits as i64) >> 1);
+        }
+        match bits & TAG_MASK {
+            BOOL_TAG => DynValue::Bool(bits >> 3 != 0),
+            FLOAT_TAG => DynValue::Float(decode_float(bits)),
+            NONE_VALUE => DynValue::None,
+            _ => {
+                let d = &*ptr;
+                match d.tag {
+                    DynamicType::None => DynValue::None,
+                    DynamicType::Bool => DynValue::Bool(d.data.bool_val != 0),
+                    DynamicType::Int => DynValue::Int(d.data.int_val),
+                    DynamicType::Float => DynValue::Float(d.data.float_val),
+                    _ => DynValue::Heap(d),
+                }
+            }
+        }
     }
 
     pub fn get_type(&self) -> DynamicType {
@@ -191,7 +285,7 @@ impl BolideDynamic {
             DynamicType::Float => unsafe { self.data.float_val != 0.0 },
             DynamicType::BigInt => unsafe {
                 if self.data.bigint_ptr.is_null() { return false; }
-                !(*self.data.bigint_ptr).is_zero()
+                !BolideBigInt::view(self.data.bigint_ptr).is_zero()
             },
             DynamicType::Decimal => unsafe {
                 if self.data.decimal_ptr.is_null() { return false; }
@@ -216,7 +310,7 @@ impl BolideDynamic {
             DynamicType::Float => unsafe { self.data.float_val as i64 },
             DynamicType::BigInt => unsafe {
                 if self.data.bigint_ptr.is_null() { 0 }
-                else { (*self.data.bigint_ptr).to_i64().unwrap_or(0) }
+                else { BolideBigInt::view(self.data.bigint_ptr).to_i64().unwrap_or(0) }
             },
             DynamicType::Decimal => unsafe {
                 if self.data.decimal_ptr.is_null() { 0 }
@@ -238,7 +332,7 @@ impl BolideDynamic {
             DynamicType::Float => unsafe { self.data.float_val },
             DynamicType::BigInt => unsafe {
                 if self.data.bigint_ptr.is_null() { 0.0 }
-                else { (*self.data.bigint_ptr).to_f64() }
+                else { BolideBigInt::view(self.data.bigint_ptr).to_f64() }
             },
             DynamicType::Decimal => unsafe {
                 if self.data.decimal_ptr.is_null() { 0.0 }
@@ -262,7 +356,7 @@ impl BolideDynamic {
             DynamicType::Float => unsafe { self.data.float_val.to_string() },
             DynamicType::BigInt => unsafe {
                 if self.data.bigint_ptr.is_null() { "null".to_string() }
-                else { (*self.data.bigint_ptr).to_string() }
+                else { BolideBigInt::view(self.data.bigint_ptr).to_string() }
             },
             DynamicType::Decimal => unsafe {
                 if self.data.decimal_ptr.is_null() { "null".to_string() }
@@ -280,20 +374,17 @@ impl BolideDynamic {
 
     #[inline]
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     #[inline]
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
@@ -306,6 +397,18 @@ impl BolideDynamic {
         self.header.flags.set(self.header.flags.get() | flags::MOVED);
     }
 
+    /// 把内部引用的 RC 对象标记为跨线程共享
+    pub(crate) unsafe fn mark_inner_shared(&self) {
+        let inner = match self.tag {
+            DynamicType::BigInt => self.data.bigint_ptr as *mut std::os::raw::c_void,
+            DynamicType::Decimal => self.data.decimal_ptr as *mut std::os::raw::c_void,
+            DynamicType::String => self.data.string_ptr as *mut std::os::raw::c_void,
+            DynamicType::List => self.data.list_ptr as *mut std::os::raw::c_void,
+            _ => return,
+        };
+        crate::rc::bolide_value_mark_shared(inner);
+    }
+
     /// 释放内部数据的引用
     unsafe fn release_inner(&self) {
         match self.tag {
@@ -406,7 +509,7 @@ pub extern "C" fn bolide_dynamic_from_list(ptr: *mut BolideList) -> *mut BolideD
 /// 增加引用计数
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_retain(d: *mut BolideDynamic) -> *mut BolideDynamic {
-    if !d.is_null() {
+    if !d.is_null() && !BolideDynamic::is_immediate(d) {
         unsafe { (*d).retain(); }
     }
     d
@@ -415,19 +518,20 @@ pub extern "C" fn bolide_dynamic_retain(d: *mut BolideDynamic) -> *mut BolideDyn
 /// 减少引用计数
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_release(d: *mut BolideDynamic) {
-    if d.is_null() { return; }
+    if d.is_null() || BolideDynamic::is_immediate(d) { return; }
     unsafe {
         if (*d).release() {
             (*d).release_inner();
-            let _ = Box::from_raw(d);
+            crate::slab::free_value(d);
         }
     }
 }
 
-/// 深拷贝
+/// 深拷贝（立即数按值传递，直接返回）
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_clone(a: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() { return std::ptr::null_mut(); }
+    if BolideDynamic::is_immediate(a) { return a as *mut BolideDynamic; }
     let a = unsafe { &*a };
 
     match a.tag {
@@ -479,145 +583,143 @@ pub extern "C" fn bolide_dynamic_free(d: *mut BolideDynamic) {
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_ref_count(d: *const BolideDynamic) -> u32 {
     if d.is_null() { return 0; }
+    if BolideDynamic::is_immediate(d) { return 1; }
     unsafe { (*d).ref_count() }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_get_type(a: *const BolideDynamic) -> i64 {
     if a.is_null() { return 0; }
-    let a = unsafe { &*a };
-    a.tag as i64
+    unsafe { BolideDynamic::view(a).get_type() as i64 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_is_truthy(a: *const BolideDynamic) -> i64 {
     if a.is_null() { return 0; }
-    let a = unsafe { &*a };
-    if a.is_truthy() { 1 } else { 0 }
+    if unsafe { BolideDynamic::view(a).is_truthy() } { 1 } else { 0 }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_to_int(a: *const BolideDynamic) -> i64 {
     if a.is_null() { return 0; }
-    let a = unsafe { &*a };
-    a.to_int()
+    unsafe { BolideDynamic::view(a).to_int() }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_to_float(a: *const BolideDynamic) -> f64 {
     if a.is_null() { return 0.0; }
-    let a = unsafe { &*a };
-    a.to_float()
+    unsafe { BolideDynamic::view(a).to_float() }
+}
+
+/// 文本表示（null 写作 null）
+pub(crate) fn dynamic_repr(a: *const BolideDynamic) -> String {
+    if a.is_null() { return "null".to_string(); }
+    unsafe { BolideDynamic::view(a).to_string_repr() }
 }
 
 // ==================== 动态算术运算 ====================
+//
+// 两个操作数都是 int 立即数的情况通常已经在生成代码里内联完成，
+// 到这里的是溢出立即数范围、float、混合类型以及堆对象。
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_add(a: *const BolideDynamic, b: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() || b.is_null() { return bolide_dynamic_none(); }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
-
-    match (a.tag, b.tag) {
-        (DynamicType::Int, DynamicType::Int) => unsafe {
-            BolideDynamic::from_int(a.data.int_val + b.data.int_val)
-        },
-        (DynamicType::Float, DynamicType::Float) => unsafe {
-            BolideDynamic::from_float(a.data.float_val + b.data.float_val)
-        },
-        (DynamicType::Int, DynamicType::Float) | (DynamicType::Float, DynamicType::Int) => {
-            BolideDynamic::from_float(a.to_float() + b.to_float())
-        },
-        (DynamicType::BigInt, DynamicType::BigInt) => unsafe {
-            let result = crate::bolide_bigint_add(a.data.bigint_ptr, b.data.bigint_ptr);
-            BolideDynamic::from_bigint(result)
-        },
-        (DynamicType::Decimal, DynamicType::Decimal) => unsafe {
-            let result = crate::bolide_decimal_add(a.data.decimal_ptr, b.data.decimal_ptr);
-            BolideDynamic::from_decimal(result)
-        },
-        (DynamicType::String, DynamicType::String) => unsafe {
-            let result = crate::bolide_string_concat(a.data.string_ptr, b.data.string_ptr);
-            BolideDynamic::from_string(result)
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
+
+    match (a, b) {
+        (DynValue::Int(x), DynValue::Int(y)) => BolideDynamic::from_int(x.wrapping_add(y)),
+        (DynValue::Float(x), DynValue::Float(y)) => BolideDynamic::from_float(x + y),
+        (DynValue::Heap(x), DynValue::Heap(y)) => unsafe {
+            match (x.tag, y.tag) {
+                (DynamicType::BigInt, DynamicType::BigInt) => {
+                    let result = crate::bolide_bigint_add(x.data.bigint_ptr, y.data.bigint_ptr);
+                    BolideDynamic::from_bigint(result)
+                },
+                (DynamicType::Decimal, DynamicType::Decimal) => {
+                    let result = crate::bolide_decimal_add(x.data.decimal_ptr, y.data.decimal_ptr);
+                    BolideDynamic::from_decimal(result)
+                },
+                (DynamicType::String, DynamicType::String) => {
+                    let result = crate::bolide_string_concat(x.data.string_ptr, y.data.string_ptr);
+                    BolideDynamic::from_string(result)
+                },
+                _ => BolideDynamic::from_float(a.to_float() + b.to_float()),
+            }
         },
-        _ => {
-            BolideDynamic::from_float(a.to_float() + b.to_float())
-        }
+        _ => BolideDynamic::from_float(a.to_float() + b.to_float()),
     }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_sub(a: *const BolideDynamic, b: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() || b.is_null() { return bolide_dynamic_none(); }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
-
-    match (a.tag, b.tag) {
-        (DynamicType::Int, DynamicType::Int) => unsafe {
-            BolideDynamic::from_int(a.data.int_val - b.data.int_val)
-        },
-        (DynamicType::Float, DynamicType::Float) => unsafe {
-            BolideDynamic::from_float(a.data.float_val - b.data.float_val)
-        },
-        (DynamicType::BigInt, DynamicType::BigInt) => unsafe {
-            let result = crate::bolide_bigint_sub(a.data.bigint_ptr, b.data.bigint_ptr);
-            BolideDynamic::from_bigint(result)
-        },
-        (DynamicType::Decimal, DynamicType::Decimal) => unsafe {
-            let result = crate::bolide_decimal_sub(a.data.decimal_ptr, b.data.decimal_ptr);
-            BolideDynamic::from_decimal(result)
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
+
+    match (a, b) {
+        (DynValue::Int(x), DynValue::Int(y)) => BolideDynamic::from_int(x.wrapping_sub(y)),
+        (DynValue::Float(x), DynValue::Float(y)) => BolideDynamic::from_float(x - y),
+        (DynValue::Heap(x), DynValue::Heap(y)) => unsafe {
+            match (x.tag, y.tag) {
+                (DynamicType::BigInt, DynamicType::BigInt) => {
+                    let result = crate::bolide_bigint_sub(x.data.bigint_ptr, y.data.bigint_ptr);
+                    BolideDynamic::from_bigint(result)
+                },
+                (DynamicType::Decimal, DynamicType::Decimal) => {
+                    let result = crate::bolide_decimal_sub(x.data.decimal_ptr, y.data.decimal_ptr);
+                    BolideDynamic::from_decimal(result)
+                },
+                _ => BolideDynamic::from_float(a.to_float() - b.to_float()),
+            }
         },
-        _ => {
-            BolideDynamic::from_float(a.to_float() - b.to_float())
-        }
+        _ => BolideDynamic::from_float(a.to_float() - b.to_float()),
     }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_mul(a: *const BolideDynamic, b: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() || b.is_null() { return bolide_dynamic_none(); }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
-
-    match (a.tag, b.tag) {
-        (DynamicType::Int, DynamicType::Int) => unsafe {
-            BolideDynamic::from_int(a.data.int_val * b.data.int_val)
-        },
-        (DynamicType::Float, DynamicType::Float) => unsafe {
-            BolideDynamic::from_float(a.data.float_val * b.data.float_val)
-        },
-        (DynamicType::BigInt, DynamicType::BigInt) => unsafe {
-            let result = crate::bolide_bigint_mul(a.data.bigint_ptr, b.data.bigint_ptr);
-            BolideDynamic::from_bigint(result)
-        },
-        (DynamicType::Decimal, DynamicType::Decimal) => unsafe {
-            let result = crate::bolide_decimal_mul(a.data.decimal_ptr, b.data.decimal_ptr);
-            BolideDynamic::from_decimal(result)
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
+
+    match (a, b) {
+        (DynValue::Int(x), DynValue::Int(y)) => BolideDynamic::from_int(x.wrapping_mul(y)),
+        (DynValue::Float(x), DynValue::Float(y)) => BolideDynamic::from_float(x * y),
+        (DynValue::Heap(x), DynValue::Heap(y)) => unsafe {
+            match (x.tag, y.tag) {
+                (DynamicType::BigInt, DynamicType::BigInt) => {
+                    let result = crate::bolide_bigint_mul(x.data.bigint_ptr, y.data.bigint_ptr);
+                    BolideDynamic::from_bigint(result)
+                },
+                (DynamicType::Decimal, DynamicType::Decimal) => {
+                    let result = crate::bolide_decimal_mul(x.data.decimal_ptr, y.data.decimal_ptr);
+                    BolideDynamic::from_decimal(result)
+                },
+                _ => BolideDynamic::from_float(a.to_float() * b.to_float()),
+            }
         },
-        _ => {
-            BolideDynamic::from_float(a.to_float() * b.to_float())
-        }
+        _ => BolideDynamic::from_float(a.to_float() * b.to_float()),
     }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_div(a: *const BolideDynamic, b: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() || b.is_null() { return bolide_dynamic_none(); }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
 
-    match (a.tag, b.tag) {
-        (DynamicType::Int, DynamicType::Int) => unsafe {
-            if b.data.int_val == 0 { return bolide_dynamic_none(); }
-            BolideDynamic::from_int(a.data.int_val / b.data.int_val)
+    match (a, b) {
+        (DynValue::Int(x), DynValue::Int(y)) => {
+            if y == 0 { return bolide_dynamic_none(); }
+            BolideDynamic::from_int(x.wrapping_div(y))
         },
-        (DynamicType::BigInt, DynamicType::BigInt) => unsafe {
-            let result = crate::bolide_bigint_div(a.data.bigint_ptr, b.data.bigint_ptr);
-            BolideDynamic::from_bigint(result)
-        },
-        (DynamicType::Decimal, DynamicType::Decimal) => unsafe {
-            let result = crate::bolide_decimal_div(a.data.decimal_ptr, b.data.decimal_ptr);
-            BolideDynamic::from_decimal(result)
+        (DynValue::Heap(x), DynValue::Heap(y)) if x.tag == y.tag
+            && matches!(x.tag, DynamicType::BigInt | DynamicType::Decimal) => unsafe {
+            if x.tag == DynamicType::BigInt {
+                let result = crate::bolide_bigint_div(x.data.bigint_ptr, y.data.bigint_ptr);
+                BolideDynamic::from_bigint(result)
+            } else {
+                let result = crate::bolide_decimal_div(x.data.decimal_ptr, y.data.decimal_ptr);
+                BolideDynamic::from_decimal(result)
+            }
         },
         _ => {
             let bf = b.to_float();
@@ -630,22 +732,22 @@ pub extern "C" fn bolide_dynamic_div(a: *const BolideDynamic, b: *const BolideDy
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_neg(a: *const BolideDynamic) -> *mut BolideDynamic {
     if a.is_null() { return bolide_dynamic_none(); }
-    let a = unsafe { &*a };
 
-    match a.tag {
-        DynamicType::Int => unsafe {
-            BolideDynamic::from_int(-a.data.int_val)
-        },
-        DynamicType::Float => unsafe {
-            BolideDynamic::from_float(-a.data.float_val)
-        },
-        DynamicType::BigInt => unsafe {
-            let result = crate::bolide_bigint_neg(a.data.bigint_ptr);
-            BolideDynamic::from_bigint(result)
-        },
-        DynamicType::Decimal => unsafe {
-            let result = crate::bolide_decimal_neg(a.data.decimal_ptr);
-            BolideDynamic::from_decimal(result)
+    match unsafe { BolideDynamic::view(a) } {
+        DynValue::Int(x) => BolideDynamic::from_int(x.wrapping_neg()),
+        DynValue::Float(x) => BolideDynamic::from_float(-x),
+        DynValue::Heap(x) => unsafe {
+            match x.tag {
+                DynamicType::BigInt => {
+                    let result = crate::bolide_bigint_neg(x.data.bigint_ptr);
+                    BolideDynamic::from_bigint(result)
+                },
+                DynamicType::Decimal => {
+                    let result = crate::bolide_decimal_neg(x.data.decimal_ptr);
+                    BolideDynamic::from_decimal(result)
+                },
+                _ => bolide_dynamic_none(),
+            }
         },
         _ => bolide_dynamic_none(),
     }
@@ -657,36 +759,43 @@ pub extern "C" fn bolide_dynamic_neg(a: *const BolideDynamic) -> *mut BolideDyna
 pub extern "C" fn bolide_dynamic_eq(a: *const BolideDynamic, b: *const BolideDynamic) -> i64 {
     if a.is_null() && b.is_null() { return 1; }
     if a.is_null() || b.is_null() { return 0; }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
 
-    if a.tag != b.tag {
+    if a.get_type() != b.get_type() {
         return if (a.to_float() - b.to_float()).abs() < 1e-10 { 1 } else { 0 };
     }
 
-    match a.tag {
-        DynamicType::None => 1,
-        DynamicType::Bool => unsafe { if a.data.bool_val == b.data.bool_val { 1 } else { 0 } },
-        DynamicType::Int => unsafe { if a.data.int_val == b.data.int_val { 1 } else { 0 } },
-        DynamicType::Float => unsafe { if (a.data.float_val - b.data.float_val).abs() < 1e-10 { 1 } else { 0 } },
-        DynamicType::BigInt => unsafe { crate::bolide_bigint_eq(a.data.bigint_ptr, b.data.bigint_ptr) },
-        DynamicType::Decimal => unsafe { crate::bolide_decimal_eq(a.data.decimal_ptr, b.data.decimal_ptr) },
-        DynamicType::String => unsafe { crate::bolide_string_eq(a.data.string_ptr, b.data.string_ptr) },
-        DynamicType::List => 0, // 列表比较暂不实现
+    match (a, b) {
+        (DynValue::None, DynValue::None) => 1,
+        (DynValue::Bool(x), DynValue::Bool(y)) => if x == y { 1 } else { 0 },
+        (DynValue::Int(x), DynValue::Int(y)) => if x == y { 1 } else { 0 },
+        (DynValue::Float(x), DynValue::Float(y)) => if (x - y).abs() < 1e-10 { 1 } else { 0 },
+        (DynValue::Heap(x), DynValue::Heap(y)) => unsafe {
+            match x.tag {
+                DynamicType::BigInt => crate::bolide_bigint_eq(x.data.bigint_ptr, y.data.bigint_ptr),
+                DynamicType::Decimal => crate::bolide_decimal_eq(x.data.decimal_ptr, y.data.decimal_ptr),
+                DynamicType::String => crate::bolide_string_eq(x.data.string_ptr, y.data.string_ptr),
+                _ => 0, // 列表比较暂不实现
+            }
+        },
+        _ => 0,
     }
 }
 
 #[no_mangle]
 pub extern "C" fn bolide_dynamic_lt(a: *const BolideDynamic, b: *const BolideDynamic) -> i64 {
     if a.is_null() || b.is_null() { return 0; }
-    let a = unsafe { &*a };
-    let b = unsafe { &*b };
+    let (a, b) = unsafe { (BolideDynamic::view(a), BolideDynamic::view(b)) };
 
-    match (a.tag, b.tag) {
-        (DynamicType::Int, DynamicType::Int) => unsafe { if a.data.int_val < b.data.int_val { 1 } else { 0 } },
-        (DynamicType::Float, DynamicType::Float) => unsafe { if a.data.float_val < b.data.float_val { 1 } else { 0 } },
-        (DynamicType::BigInt, DynamicType::BigInt) => unsafe { crate::bolide_bigint_lt(a.data.bigint_ptr, b.data.bigint_ptr) },
-        (DynamicType::Decimal, DynamicType::Decimal) => unsafe { crate::bolide_decimal_lt(a.data.decimal_ptr, b.data.decimal_ptr) },
+    match (a, b) {
+        (DynValue::Int(x), DynValue::Int(y)) => if x < y { 1 } else { 0 },
+        (DynValue::Float(x), DynValue::Float(y)) => if x < y { 1 } else { 0 },
+        (DynValue::Heap(x), DynValue::Heap(y)) if x.tag == y.tag && x.tag == DynamicType::BigInt => unsafe {
+            crate::bolide_bigint_lt(x.data.bigint_ptr, y.data.bigint_ptr)
+        },
+        (DynValue::Heap(x), DynValue::Heap(y)) if x.tag == y.tag && x.tag == DynamicType::Decimal => unsafe {
+            crate::bolide_decimal_lt(x.data.decimal_ptr, y.data.decimal_ptr)
+        },
         _ => if a.to_float() < b.to_float() { 1 } else { 0 },
     }
 }
@@ -714,7 +823,9 @@ mod tests {
 
     #[test]
     fn test_dynamic_rc() {
-        let d = BolideDynamic::from_int(42);
+        // 超出立即数范围的 int 装箱
+        let d = BolideDynamic::from_int(i64::MAX);
+        assert!(!BolideDynamic::is_immediate(d));
         unsafe {
             assert_eq!((*d).ref_count(), 1);
 
@@ -724,6 +835,7 @@ mod tests {
             bolide_dynamic_release(d);
             assert_eq!((*d).ref_count(), 1);
 
+            assert_eq!(bolide_dynamic_to_int(d), i64::MAX);
             bolide_dynamic_release(d);
         }
     }
@@ -745,15 +857,13 @@ mod tests {
     fn test_dynamic_clone() {
         let d1 = BolideDynamic::from_int(100);
         let d2 = bolide_dynamic_clone(d1);
-        unsafe {
-            assert_eq!((*d1).to_int(), 100);
-            assert_eq!((*d2).to_int(), 100);
-            assert_eq!((*d1).ref_count(), 1);
-            assert_eq!((*d2).ref_count(), 1);
+        assert_eq!(bolide_dynamic_to_int(d1), 100);
+        assert_eq!(bolide_dynamic_to_int(d2), 100);
+        assert_eq!(bolide_dynamic_ref_count(d1), 1);
+        assert_eq!(bolide_dynamic_ref_count(d2), 1);
 
-            bolide_dynamic_release(d1);
-            bolide_dynamic_release(d2);
-        }
+        bolide_dynamic_release(d1);
+        bolide_dynamic_release(d2);
     }
 
     #[test]
@@ -766,18 +876,61 @@ mod tests {
         let prod = bolide_dynamic_mul(a, b);
         let quot = bolide_dynamic_div(a, b);
 
-        unsafe {
-            assert_eq!((*sum).to_int(), 13);
-            assert_eq!((*diff).to_int(), 7);
-            assert_eq!((*prod).to_int(), 30);
-            assert_eq!((*quot).to_int(), 3);
-
-            bolide_dynamic_release(a);
-            bolide_dynamic_release(b);
-            bolide_dynamic_release(sum);
-            bolide_dynamic_release(diff);
-            bolide_dynamic_release(prod);
-            bolide_dynamic_release(quot);
+        assert_eq!(bolide_dynamic_to_int(sum), 13);
+        assert_eq!(bolide_dynamic_to_int(diff), 7);
+        assert_eq!(bolide_dynamic_to_int(prod), 30);
+        assert_eq!(bolide_dynamic_to_int(quot), 3);
+
+        for d in [a, b, sum, diff, prod, quot] {
+            bolide_dynamic_release(d);
+        }
+    }
+
+    #[test]
+    fn test_dynamic_immediates() {
+        // int：范围内立即数，溢出后装箱
+        for v in [0, 1, -1, INT_MIN, INT_MAX] {
+            let d = BolideDynamic::from_int(v);
+            assert!(BolideDynamic::is_immediate(d));
+            assert_eq!(d as usize as i64 & DYNAMIC_INT_TAG, DYNAMIC_INT_TAG);
+            assert_eq!(bolide_dynamic_to_int(d), v);
+        }
+        let max = BolideDynamic::from_int(INT_MAX);
+        let one = BolideDynamic::from_int(1);
+        let big = bolide_dynamic_add(max, one);
+        assert!(!BolideDynamic::is_immediate(big));
+        assert_eq!(bolide_dynamic_to_int(big), INT_MAX + 1);
+        assert_eq!(bolide_dynamic_get_type(big), DynamicType::Int as i64);
+        bolide_dynamic_release(big);
+
+        // float：常见范围和 ±0 内联，按位还原
+        for v in [1.5, -2.25, 0.0, -0.0, 1e-30, 3.0e38, std::f64::consts::PI] {
+            let d = BolideDynamic::from_float(v);
+            assert!(BolideDynamic::is_immediate(d), "{} should be immediate", v);
+            assert_eq!(bolide_dynamic_to_float(d).to_bits(), v.to_bits());
         }
+        for v in [1e300, -1e-300, f64::INFINITY, f64::NAN, f64::MIN_POSITIVE] {
+            let d = BolideDynamic::from_float(v);
+            assert!(!BolideDynamic::is_immediate(d), "{} should be boxed", v);
+            assert_eq!(bolide_dynamic_to_float(d).to_bits(), v.to_bits());
+            bolide_dynamic_release(d);
+        }
+
+        // bool/none
+        let t = BolideDynamic::from_bool(true);
+        let f = BolideDynamic::from_bool(false);
+        let n = BolideDynamic::none();
+        assert_eq!(bolide_dynamic_is_truthy(t), 1);
+        assert_eq!(bolide_dynamic_is_truthy(f), 0);
+        assert_eq!(bolide_dynamic_get_type(n), DynamicType::None as i64);
+        assert_eq!(dynamic_repr(t), "true");
+        assert_eq!(dynamic_repr(n), "none");
+
+        // 混合运算
+        let x = BolideDynamic::from_int(2);
+        let y = BolideDynamic::from_float(0.5);
+        assert_eq!(bolide_dynamic_to_float(bolide_dynamic_add(x, y)), 2.5);
+        assert_eq!(bolide_dynamic_lt(y, x), 1);
+        assert_eq!(bolide_dynamic_eq(x, BolideDynamic::from_float(2.0)), 1);
     }
 }
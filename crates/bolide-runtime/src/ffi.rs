@@ -1,98 +1,142 @@
 //! FFI 运行时支持
+//!
+//! 库按路径只加载一次，每个符号只查找一次并缓存。JIT 注册 extern 块时通过
+//! `bolide_ffi_resolve_symbols` 一次性解析整个块，生成的代码直接间接调用解析好的地址；
+//! AOT 由链接器绑定 extern 函数。
 
 use std::collections::HashMap;
 use std::ffi::c_void;
-use std::sync::Mutex;
+use std::sync::RwLock;
 use libloading::Library;
 
-/// 全局库缓存
-static LOADED_LIBS: Mutex<Option<HashMap<String, Library>>> = Mutex::new(None);
+use crate::BolideString;
 
-/// 初始化库缓存
-fn init_libs() {
-    let mut libs = LOADED_LIBS.lock().unwrap();
-    if libs.is_none() {
-        *libs = Some(HashMap::new());
+/// 已加载的库及其符号缓存
+struct LoadedLib {
+    lib: Library,
+    /// 符号名 -> 函数地址（每个符号只 dlsym 一次）
+    symbols: HashMap<String, usize>,
+}
+
+/// 全局库缓存：查找只取读锁，多个线程解析符号互不阻塞
+static LOADED_LIBS: RwLock<Option<HashMap<String, LoadedLib>>> = RwLock::new(None);
+
+/// 提供给扩展库的运行时函数表
+///
+/// 库若导出 `bolide_ffi_module_init(const BolideFfiApi*)`，加载时会被调用一次，
+/// 以便库能正确释放 Bolide 回调返回的 RC 对象。C 侧需保持相同布局。
+#[repr(C)]
+pub struct BolideFfiApi {
+    pub version: u32,
+    pub string_retain: extern "C" fn(*mut BolideString) -> *mut BolideString,
+    pub string_release: extern "C" fn(*mut BolideString),
+}
+
+/// 当前函数表版本，新增字段只能追加在末尾
+pub const BOLIDE_FFI_API_VERSION: u32 = 1;
+
+static FFI_API: BolideFfiApi = BolideFfiApi {
+    version: BOLIDE_FFI_API_VERSION,
+    string_retain: crate::bolide_string_retain,
+    string_release: crate::bolide_string_release,
+};
+
+/// 加载库（已加载时直接返回），首次加载时调用可选的模块初始化钩子
+fn load_library(path: &str) -> Result<(), String> {
+    if LOADED_LIBS.read().unwrap().as_ref().map_or(false, |libs| libs.contains_key(path)) {
+        return Ok(());
+    }
+
+    let mut libs = LOADED_LIBS.write().unwrap();
+    let libs = libs.get_or_insert_with(HashMap::new);
+    if libs.contains_key(path) {
+        return Ok(());
+    }
+
+    let lib = unsafe { Library::new(path) }
+        .map_err(|e| format!("Failed to load library: {}", e))?;
+    // 可选的模块初始化钩子
+    unsafe {
+        if let Ok(init) = lib.get::<extern "C" fn(*const BolideFfiApi)>(b"bolide_ffi_module_init") {
+            init(&FFI_API);
+        }
     }
+    libs.insert(path.to_string(), LoadedLib { lib, symbols: HashMap::new() });
+    Ok(())
 }
 
-/// 加载动态库并返回句柄
-#[no_mangle]
-pub extern "C" fn bolide_ffi_load_library(path_ptr: *const i8) -> i64 {
-    init_libs();
+/// 在已加载的库中查找符号，结果缓存在库条目里
+fn lookup_symbol(lib_path: &str, name: &str) -> Result<*const c_void, String> {
+    if let Some(lib) = LOADED_LIBS.read().unwrap().as_ref().and_then(|libs| libs.get(lib_path)) {
+        if let Some(&addr) = lib.symbols.get(name) {
+            return Ok(addr as *const c_void);
+        }
+    }
 
-    let path = unsafe {
-        std::ffi::CStr::from_ptr(path_ptr)
-            .to_str()
-            .unwrap_or("")
-            .to_string()
+    let mut libs = LOADED_LIBS.write().unwrap();
+    let lib = libs.as_mut().and_then(|libs| libs.get_mut(lib_path))
+        .ok_or_else(|| format!("Library not loaded: {}", lib_path))?;
+    if let Some(&addr) = lib.symbols.get(name) {
+        return Ok(addr as *const c_void);
+    }
+    let addr = unsafe {
+        lib.lib.get::<*const c_void>(name.as_bytes())
+            .map(|sym| *sym)
+            .map_err(|e| format!("Symbol '{}' not found: {}", name, e))?
     };
+    lib.symbols.insert(name.to_string(), addr as usize);
+    Ok(addr)
+}
 
-    let mut libs = LOADED_LIBS.lock().unwrap();
-    let libs = libs.as_mut().unwrap();
+/// 一次性解析一个 extern 块的全部符号（JIT 在注册 extern 块时调用）
+///
+/// 库无法加载时返回 Err；否则返回与 names 一一对应的地址，找不到的符号为 None。
+pub fn bolide_ffi_resolve_symbols(lib_path: &str, names: &[&str]) -> Result<Vec<Option<*const c_void>>, String> {
+    load_library(lib_path)?;
+    Ok(names.iter().map(|name| lookup_symbol(lib_path, name).ok()).collect())
+}
 
-    // 如果已加载，返回成功
-    if libs.contains_key(&path) {
-        return 1;
+/// C 字符串参数转换为 &str（null 或非 UTF-8 视为空串）
+unsafe fn c_str<'a>(ptr: *const i8) -> &'a str {
+    if ptr.is_null() {
+        return "";
     }
+    std::ffi::CStr::from_ptr(ptr).to_str().unwrap_or("")
+}
 
-    // 加载库
-    match unsafe { Library::new(&path) } {
-        Ok(lib) => {
-            libs.insert(path, lib);
-            1 // 成功
-        }
+/// 加载动态库并返回句柄
+#[no_mangle]
+pub extern "C" fn bolide_ffi_load_library(path_ptr: *const i8) -> i64 {
+    let path = unsafe { c_str(path_ptr) };
+    match load_library(path) {
+        Ok(()) => 1, // 成功
         Err(e) => {
-            eprintln!("[FFI] Failed to load library: {}", e);
+            eprintln!("[FFI] {}", e);
             0 // 失败
         }
     }
 }
 
-/// 获取函数指针
+/// 获取函数指针（命中缓存时只取一次读锁，不分配内存）
 #[no_mangle]
 pub extern "C" fn bolide_ffi_get_symbol(
     lib_path_ptr: *const i8,
     symbol_name_ptr: *const i8,
 ) -> *const c_void {
-    init_libs();
-
-    let lib_path = unsafe {
-        std::ffi::CStr::from_ptr(lib_path_ptr)
-            .to_str()
-            .unwrap_or("")
-            .to_string()
-    };
-
-    let symbol_name = unsafe {
-        std::ffi::CStr::from_ptr(symbol_name_ptr)
-            .to_str()
-            .unwrap_or("")
-    };
-
-    let libs = LOADED_LIBS.lock().unwrap();
-    let libs = libs.as_ref().unwrap();
-
-    if let Some(lib) = libs.get(&lib_path) {
-        unsafe {
-            match lib.get::<*const c_void>(symbol_name.as_bytes()) {
-                Ok(sym) => *sym,
-                Err(e) => {
-                    eprintln!("[FFI] Symbol '{}' not found: {}", symbol_name, e);
-                    std::ptr::null()
-                }
-            }
+    let (lib_path, symbol_name) = unsafe { (c_str(lib_path_ptr), c_str(symbol_name_ptr)) };
+    match lookup_symbol(lib_path, symbol_name) {
+        Ok(addr) => addr,
+        Err(e) => {
+            eprintln!("[FFI] {}", e);
+            std::ptr::null()
         }
-    } else {
-        eprintln!("[FFI] Library not loaded: {}", lib_path);
-        std::ptr::null()
     }
 }
 
 /// 释放所有加载的库
 #[no_mangle]
 pub extern "C" fn bolide_ffi_cleanup() {
-    let mut libs = LOADED_LIBS.lock().unwrap();
+    let mut libs = LOADED_LIBS.write().unwrap();
     *libs = None;
 }
 
@@ -116,3 +160,24 @@ pub extern "C" fn bolide_map_int(
 ) -> i64 {
     callback(value)
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[cfg(target_os = "linux")]
+    #[test]
+    fn test_resolve_symbols_cached() {
+        let syms = bolide_ffi_resolve_symbols("libc.so.6", &["strlen", "no_such_symbol"]).unwrap();
+        assert!(syms[0].is_some());
+        assert!(syms[1].is_none());
+
+        // C 接口命中同一份缓存
+        let lib = std::ffi::CString::new("libc.so.6").unwrap();
+        let name = std::ffi::CString::new("strlen").unwrap();
+        assert_eq!(bolide_ffi_load_library(lib.as_ptr()), 1);
+        assert_eq!(bolide_ffi_get_symbol(lib.as_ptr(), name.as_ptr()), syms[0].unwrap());
+
+        assert!(bolide_ffi_resolve_symbols("libno_such_library.so", &["f"]).is_err());
+    }
+}
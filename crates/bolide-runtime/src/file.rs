@@ -0,0 +1,395 @@
+//! 文件读写：内存映射的逐行读取与带缓冲的写入
+//!
+//! - `file_open(path)` 打开文件读取：普通文件整体只读映射，其他情况（管道、空文件、映射失败、
+//!   非 unix 平台）按 256 KiB 的块读取
+//! - `file_read_line(f)` 返回下一行（去掉 `\n` / `\r\n`）。行字符串直接借用映射或读取块中的字节，
+//!   不复制，并持有底层存储的一个引用：借用它的字符串都释放后映射/读取块才会回收，
+//!   逐行处理、不保存行的程序内存占用是常数
+//! - `file_create(path)` 创建（截断）文件写入，`file_write` / `file_write_line` 写入 64 KiB 缓冲区，
+//!   `file_flush` 立即写出
+//! - `file_close(f)` 关闭读取或写入句柄，写入句柄先刷出缓冲区。未关闭的写入句柄在进程退出时不会自动刷出
+//!
+//! 打开失败时返回空指针并在 stderr 打印原因；对空句柄的操作什么都不做（`file_eof` 返回 true）。
+
+use std::fs::File;
+use std::io::{BufWriter, Read, Write};
+use std::ops::Range;
+use std::sync::Arc;
+
+use crate::string::BolideString;
+
+/// 块读取模式每次读取的字节数（行更长时按行长加倍）
+const CHUNK_SIZE: usize = 256 * 1024;
+/// 写缓冲区大小
+const WRITE_BUFFER_SIZE: usize = 64 * 1024;
+
+/// 文件内容的底层存储，由行字符串与读取句柄通过 Arc 共享
+///
+/// 创建后内容不再修改：块读取模式读下一块时总是分配新块。
+pub(crate) enum FileBuffer {
+    /// 整个文件的只读映射
+    #[cfg(unix)]
+    Mapped { ptr: *mut u8, len: usize },
+    /// 读取块
+    Chunk(Vec<u8>),
+}
+
+// 映射区只读，可以在线程间共享
+unsafe impl Send for FileBuffer {}
+unsafe impl Sync for FileBuffer {}
+
+impl FileBuffer {
+    #[inline]
+    pub(crate) fn as_bytes(&self) -> &[u8] {
+        match self {
+            #[cfg(unix)]
+            FileBuffer::Mapped { ptr, len } => unsafe { std::slice::from_raw_parts(*ptr, *len) },
+            FileBuffer::Chunk(bytes) => bytes,
+        }
+    }
+
+    /// 把普通文件整体映射到内存，失败时返回 None 由调用方改用块读取
+    #[cfg(unix)]
+    fn map(file: &File) -> Option<Self> {
+        use std::os::unix::io::AsRawFd;
+
+        extern "C" {
+            fn mmap(addr: *mut u8, len: usize, prot: i32, flags: i32, fd: i32, offset: i64) -> *mut u8;
+            fn madvise(addr: *mut u8, len: usize, advice: i32) -> i32;
+        }
+        const PROT_READ: i32 = 1;
+        const MAP_PRIVATE: i32 = 2;
+        const MADV_SEQUENTIAL: i32 = 2;
+
+        let meta = file.metadata().ok()?;
+        let len = usize::try_from(meta.len()).ok()?;
+        if !meta.is_file() || len == 0 {
+            return None;
+        }
+        let ptr = unsafe { mmap(std::ptr::null_mut(), len, PROT_READ, MAP_PRIVATE, file.as_raw_fd(), 0) };
+        if ptr as isize == -1 {
+            return None;
+        }
+        // 顺序扫描：内核加大预读，扫过的页可以尽早回收
+        unsafe { madvise(ptr, len, MADV_SEQUENTIAL); }
+        Some(FileBuffer::Mapped { ptr, len })
+    }
+
+    #[cfg(not(unix))]
+    fn map(_file: &File) -> Option<Self> {
+        None
+    }
+}
+
+impl Drop for FileBuffer {
+    fn drop(&mut self) {
+        #[cfg(unix)]
+        if let FileBuffer::Mapped { ptr, len } = *self {
+            extern "C" {
+                fn munmap(addr: *mut u8, len: usize) -> i32;
+            }
+            unsafe { munmap(ptr, len); }
+        }
+    }
+}
+
+/// 查找字节，一次比较 8 字节
+fn find_byte(needle: u8, haystack: &[u8]) -> Option<usize> {
+    const LO: u64 = 0x0101_0101_0101_0101;
+    const HI: u64 = 0x8080_8080_8080_8080;
+    let pattern = LO * needle as u64;
+    let mut chunks = haystack.chunks_exact(8);
+    let mut offset = 0;
+    for chunk in &mut chunks {
+        let x = u64::from_le_bytes(chunk.try_into().unwrap()) ^ pattern;
+        // 等于 needle 的字节异或后为 0；最低的命中位对应第一个匹配
+        let found = x.wrapping_sub(LO) & !x & HI;
+        if found != 0 {
+            return Some(offset + (found.trailing_zeros() / 8) as usize);
+        }
+        offset += 8;
+    }
+    chunks.remainder().iter().position(|&b| b == needle).map(|i| offset + i)
+}
+
+/// 逐行读取器
+struct LineReader {
+    buffer: Arc<FileBuffer>,
+    /// 下一行在 buffer 中的起点
+    pos: usize,
+    /// 块读取的数据源；映射模式或已读到文件末尾时为 None
+    source: Option<File>,
+}
+
+impl LineReader {
+    fn new(file: File) -> Self {
+        match FileBuffer::map(&file) {
+            Some(mapped) => Self { buffer: Arc::new(mapped), pos: 0, source: None },
+            None => Self { buffer: Arc::new(FileBuffer::Chunk(Vec::new())), pos: 0, source: Some(file) },
+        }
+    }
+
+    /// 确保 pos 之后有一整行，或者数据源已经读完
+    fn fill(&mut self) {
+        while let Some(file) = self.source.as_mut() {
+            let rest = &self.buffer.as_bytes()[self.pos..];
+            if find_byte(b'\n', rest).is_some() {
+                return;
+            }
+            // 旧块可能还被行字符串借用，不能原地修改：把不完整的行搬到新块开头再读
+            let cap = CHUNK_SIZE.max(rest.len() * 2);
+            let mut chunk = Vec::with_capacity(cap);
+            chunk.extend_from_slice(rest);
+            let want = (cap - chunk.len()) as u64;
+            match Read::take(file, want).read_to_end(&mut chunk) {
+                Ok(n) if (n as u64) < want => self.source = None,
+                Ok(_) => {}
+                Err(e) => {
+                    eprintln!("[File] read error: {}", e);
+                    self.source = None;
+                }
+            }
+            self.buffer = Arc::new(FileBuffer::Chunk(chunk));
+            self.pos = 0;
+        }
+    }
+
+    fn at_end(&mut self) -> bool {
+        self.fill();
+        self.pos >= self.buffer.as_bytes().len()
+    }
+
+    /// 下一行在 buffer 中的范围（不含换行符）
+    fn next_line(&mut self) -> Option<Range<usize>> {
+        self.fill();
+        let bytes = self.buffer.as_bytes();
+        if self.pos >= bytes.len() {
+            return None;
+        }
+        let start = self.pos;
+        let (mut end, next) = match find_byte(b'\n', &bytes[start..]) {
+            Some(i) => (start + i, start + i + 1),
+            None => (bytes.len(), bytes.len()),
+        };
+        if end > start && bytes[end - 1] == b'\r' {
+            end -= 1;
+        }
+        self.pos = next;
+        Some(start..end)
+    }
+}
+
+enum FileMode {
+    Read(LineReader),
+    Write(BufWriter<File>),
+}
+
+/// 文件句柄（file_open / file_create 返回，file_close 释放）
+pub struct BolideFile {
+    mode: FileMode,
+}
+
+/// 路径参数转为 &str
+unsafe fn path_of<'a>(path: *const BolideString) -> &'a str {
+    if path.is_null() { "" } else { (*path).as_str() }
+}
+
+fn into_handle(mode: FileMode) -> *mut BolideFile {
+    Box::into_raw(Box::new(BolideFile { mode }))
+}
+
+// ==================== FFI 导出 ====================
+
+/// 打开文件读取，失败时返回空指针
+#[no_mangle]
+pub extern "C" fn bolide_file_open(path: *const BolideString) -> *mut BolideFile {
+    let path = unsafe { path_of(path) };
+    match File::open(path) {
+        Ok(file) => into_handle(FileMode::Read(LineReader::new(file))),
+        Err(e) => {
+            eprintln!("[File] cannot open {}: {}", path, e);
+            std::ptr::null_mut()
+        }
+    }
+}
+
+/// 创建（截断）文件写入，失败时返回空指针
+#[no_mangle]
+pub extern "C" fn bolide_file_create(path: *const BolideString) -> *mut BolideFile {
+    let path = unsafe { path_of(path) };
+    match File::create(path) {
+        Ok(file) => into_handle(FileMode::Write(BufWriter::with_capacity(WRITE_BUFFER_SIZE, file))),
+        Err(e) => {
+            eprintln!("[File] cannot create {}: {}", path, e);
+            std::ptr::null_mut()
+        }
+    }
+}
+
+/// 读取下一行（借用文件内容，不复制）；已到末尾时返回空字符串
+#[no_mangle]
+pub extern "C" fn bolide_file_read_line(f: *mut BolideFile) -> *mut BolideString {
+    if let Some(FileMode::Read(reader)) = unsafe { f.as_mut() }.map(|f| &mut f.mode) {
+        if let Some(range) = reader.next_line() {
+            return BolideString::borrowed(&reader.buffer, range);
+        }
+    }
+    BolideString::new("")
+}
+
+/// 是否已读完所有行（写入句柄和空句柄返回 1）
+#[no_mangle]
+pub extern "C" fn bolide_file_eof(f: *mut BolideFile) -> i64 {
+    match unsafe { f.as_mut() }.map(|f| &mut f.mode) {
+        Some(FileMode::Read(reader)) => reader.at_end() as i64,
+        _ => 1,
+    }
+}
+
+fn write_bytes(f: *mut BolideFile, s: *const BolideString, newline: bool) {
+    if let Some(FileMode::Write(writer)) = unsafe { f.as_mut() }.map(|f| &mut f.mode) {
+        let bytes = if s.is_null() { &[][..] } else { unsafe { (*s).as_bytes() } };
+        let result = writer.write_all(bytes)
+            .and_then(|_| if newline { writer.write_all(b"\n") } else { Ok(()) });
+        if let Err(e) = result {
+            eprintln!("[File] write error: {}", e);
+        }
+    }
+}
+
+/// 写入字符串
+#[no_mangle]
+pub extern "C" fn bolide_file_write(f: *mut BolideFile, s: *const BolideString) {
+    write_bytes(f, s, false);
+}
+
+/// 写入字符串和换行符
+#[no_mangle]
+pub extern "C" fn bolide_file_write_line(f: *mut BolideFile, s: *const BolideString) {
+    write_bytes(f, s, true);
+}
+
+/// 把写缓冲区刷到文件
+#[no_mangle]
+pub extern "C" fn bolide_file_flush(f: *mut BolideFile) {
+    if let Some(FileMode::Write(writer)) = unsafe { f.as_mut() }.map(|f| &mut f.mode) {
+        if let Err(e) = writer.flush() {
+            eprintln!("[File] flush error: {}", e);
+        }
+    }
+}
+
+/// 关闭句柄：写入句柄先刷出缓冲区；读取句柄释放自己对映射的引用（行字符串仍然有效）
+#[no_mangle]
+pub extern "C" fn bolide_file_close(f: *mut BolideFile) {
+    if f.is_null() {
+        return;
+    }
+    bolide_file_flush(f);
+    unsafe {
+        let _ = Box::from_raw(f);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::string::bolide_string_release;
+
+    fn temp_path(name: &str) -> *mut BolideString {
+        let path = std::env::temp_dir().join(format!("bolide_{}_{}", std::process::id(), name));
+        BolideString::new(path.to_str().unwrap())
+    }
+
+    fn read_all_lines(path: *mut BolideString) -> Vec<*mut BolideString> {
+        let f = bolide_file_open(path);
+        assert!(!f.is_null());
+        let mut lines = Vec::new();
+        while bolide_file_eof(f) == 0 {
+            lines.push(bolide_file_read_line(f));
+        }
+        bolide_file_close(f);
+        lines
+    }
+
+    #[test]
+    fn test_find_byte() {
+        let hay = b"0123456789abcdef\nxyz";
+        assert_eq!(find_byte(b'\n', hay), Some(16));
+        assert_eq!(find_byte(b'z', hay), Some(19));
+        assert_eq!(find_byte(b'0', hay), Some(0));
+        assert_eq!(find_byte(b'!', hay), None);
+        assert_eq!(find_byte(0x80, &[0x7f, 0x81, 0x80]), Some(2));
+    }
+
+    #[test]
+    fn test_file_write_then_read_lines() {
+        let path = temp_path("lines.txt");
+        let w = bolide_file_create(path);
+        assert!(!w.is_null());
+        let a = BolideString::new("first");
+        let b = BolideString::new("second\r");
+        bolide_file_write_line(w, a);
+        bolide_file_write_line(w, b);
+        bolide_file_write(w, a);
+        bolide_file_close(w);
+
+        // 行字符串在句柄关闭后依然有效
+        let lines = read_all_lines(path);
+        let text: Vec<&str> = lines.iter().map(|&s| unsafe { (*s).as_str() }).collect();
+        assert_eq!(text, ["first", "second", "first"]);
+        for s in lines {
+            bolide_string_release(s);
+        }
+        bolide_string_release(a);
+        bolide_string_release(b);
+        std::fs::remove_file(unsafe { (*path).as_str() }).unwrap();
+        bolide_string_release(path);
+    }
+
+    #[test]
+    fn test_chunked_reader_long_lines() {
+        // 长度超过一个读取块的行会跨块拼接
+        let long = "x".repeat(CHUNK_SIZE + 10);
+        let content = format!("{}\nshort\n{}", long, long);
+        let mut reader = LineReader {
+            buffer: Arc::new(FileBuffer::Chunk(Vec::new())),
+            pos: 0,
+            source: None,
+        };
+        let path = temp_path("chunked.txt");
+        let path_str = unsafe { (*path).as_str() };
+        std::fs::write(path_str, &content).unwrap();
+        reader.source = Some(File::open(path_str).unwrap());
+
+        let mut lines = Vec::new();
+        while let Some(range) = reader.next_line() {
+            lines.push(BolideString::borrowed(&reader.buffer, range));
+        }
+        assert!(reader.at_end());
+        drop(reader);
+        unsafe {
+            assert_eq!((*lines[0]).as_bytes(), long.as_bytes());
+            assert_eq!((*lines[1]).as_str(), "short");
+            assert_eq!((*lines[2]).len(), long.len());
+        }
+        for s in lines {
+            bolide_string_release(s);
+        }
+        std::fs::remove_file(path_str).unwrap();
+        bolide_string_release(path);
+    }
+
+    #[test]
+    fn test_file_open_missing() {
+        let path = temp_path("missing.txt");
+        let f = bolide_file_open(path);
+        assert!(f.is_null());
+        assert_eq!(bolide_file_eof(f), 1);
+        let line = bolide_file_read_line(f);
+        assert_eq!(unsafe { (*line).len() }, 0);
+        bolide_file_close(f);
+        bolide_string_release(line);
+        bolide_string_release(path);
+    }
+}
@@ -4,6 +4,7 @@
 //!
 //! ## 模块结构
 //! - `rc`: 引用计数内存管理
+//! - `slab`: 小对象分级分配器与 arena 模式
 //! - `string`: 字符串类型
 //! - `bigint`: 任意精度整数
 //! - `decimal`: 任意精度小数
@@ -13,8 +14,11 @@
 //! - `print`: 统一打印功能
 //! - `thread`: 线程和线程池
 //! - `channel`: 线程安全通道
+//! - `file`: 内存映射的逐行读取与带缓冲的文件写入
+//! - `profile`: `--profile` 模式的函数计时与运行时计数
 
 mod rc;
+mod slab;
 mod string;
 mod bigint;
 mod decimal;
@@ -28,8 +32,11 @@ mod object;
 mod coroutine;
 mod tuple;
 mod ffi;
+mod profile;
+mod file;
 
 pub use rc::*;
+pub use slab::{bolide_arena_enter, bolide_arena_exit, bolide_slab_debug_stats};
 pub use string::*;
 pub use bigint::*;
 pub use decimal::*;
@@ -43,6 +50,8 @@ pub use object::*;
 pub use coroutine::*;
 pub use tuple::*;
 pub use ffi::*;
+pub use file::*;
+pub use profile::{bolide_profile_begin, bolide_profile_enter, bolide_profile_exit, bolide_profile_report};
 
 
 use std::alloc::{alloc, dealloc, Layout};
@@ -1,7 +1,8 @@
 //! Bolide List type with reference counting
 //!
 //! BolideList 使用引用计数管理内存
-//! 元素以 i64 存储（可以是值或指针）
+//! 元素以 i64 存储（可以是值或指针）；Float 元素按 f64 位模式存放在同一数组中，
+//! 因此 Int/Float 列表可直接视为连续的 `[i64]` / `[f64]`，由下方的批量内核处理
 
 use std::cell::Cell;
 use std::os::raw::c_void;
@@ -35,6 +36,15 @@ pub enum ElementType {
     Dynamic = 9, // 动态类型
 }
 
+impl ElementType {
+    /// 元素是否为带 RC 头的运行时对象
+    #[inline]
+    pub fn is_rc(self) -> bool {
+        matches!(self, ElementType::String | ElementType::BigInt | ElementType::Decimal
+            | ElementType::List | ElementType::Dict | ElementType::Dynamic)
+    }
+}
+
 
 /// Bolide 列表类型（带引用计数）
 #[repr(C)]
@@ -46,10 +56,14 @@ pub struct BolideList {
     elem_type: ElementType,
 }
 
+/// 字段偏移，编译器据此内联生成 len/下标读写，不经过 FFI 调用
+pub const LIST_DATA_OFFSET: i32 = std::mem::offset_of!(BolideList, data) as i32;
+pub const LIST_LEN_OFFSET: i32 = std::mem::offset_of!(BolideList, len) as i32;
+
 impl BolideList {
     /// 创建新列表（ref_count = 1）
     pub fn new(elem_type: ElementType) -> *mut Self {
-        Box::into_raw(Box::new(Self {
+        crate::slab::alloc_value(Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
@@ -61,7 +75,7 @@ impl BolideList {
             len: 0,
             capacity: 0,
             elem_type,
-        }))
+        })
     }
 
     /// 创建带初始容量的列表
@@ -82,7 +96,7 @@ impl BolideList {
         if capacity > 0 {
             list.reserve(capacity);
         }
-        Box::into_raw(Box::new(list))
+        crate::slab::alloc_value(list)
     }
 
     fn reserve(&mut self, additional: usize) {
@@ -92,15 +106,10 @@ impl BolideList {
         }
 
         let new_cap = new_cap.max(self.capacity * 2).max(8);
-        let layout = std::alloc::Layout::array::<i64>(new_cap).unwrap();
 
-        let new_data = if self.data.is_null() {
-            unsafe { std::alloc::alloc(layout) as *mut i64 }
-        } else {
-            let old_layout = std::alloc::Layout::array::<i64>(self.capacity).unwrap();
-            unsafe {
-                std::alloc::realloc(self.data as *mut u8, old_layout, layout.size()) as *mut i64
-            }
+        // 小数组（<= 32 个元素）走 slab 分级池
+        let new_data = unsafe {
+            crate::slab::realloc(self.data as *mut u8, self.capacity * 8, new_cap * 8) as *mut i64
         };
 
         self.data = new_data;
@@ -120,6 +129,7 @@ impl BolideList {
             self.reserve(1);
         }
         unsafe {
+            self.share_if_needed(value);
             *self.data.add(self.len) = value;
             self.retain_element(value);
         }
@@ -151,6 +161,7 @@ impl BolideList {
                 let p = self.data.add(index);
                 let old = *p;
                 if old != value {
+                    self.share_if_needed(value);
                     self.release_element(old);
                     *p = value;
                     self.retain_element(value);
@@ -164,24 +175,47 @@ impl BolideList {
         self.elem_type
     }
 
+    /// 元素数组视图
+    #[inline]
+    pub fn as_slice(&self) -> &[i64] {
+        if self.data.is_null() {
+            &[]
+        } else {
+            unsafe { std::slice::from_raw_parts(self.data, self.len) }
+        }
+    }
+
+    #[inline]
+    pub fn as_mut_slice(&mut self) -> &mut [i64] {
+        if self.data.is_null() {
+            &mut []
+        } else {
+            unsafe { std::slice::from_raw_parts_mut(self.data, self.len) }
+        }
+    }
+
+    /// Float 列表的 f64 视图（与 i64 槽位大小、对齐相同）
+    #[inline]
+    pub fn as_f64_slice(&self) -> &[f64] {
+        let slots = self.as_slice();
+        unsafe { std::slice::from_raw_parts(slots.as_ptr() as *const f64, slots.len()) }
+    }
+
     // ==================== RC 操作 ====================
 
     #[inline]
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     #[inline]
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     #[inline]
@@ -232,6 +266,24 @@ impl BolideList {
         }
     }
 
+    /// 把所有 RC 元素标记为跨线程共享（列表本身已被标记时调用）
+    pub(crate) unsafe fn mark_elements_shared(&self) {
+        if !self.elem_type.is_rc() {
+            return;
+        }
+        for i in 0..self.len {
+            crate::rc::bolide_value_mark_shared(*self.data.add(i) as *mut c_void);
+        }
+    }
+
+    /// 列表已跨线程共享时，新存入的 RC 元素也要标记（先于 retain，计数从此走原子路径）
+    #[inline]
+    unsafe fn share_if_needed(&self, value: i64) {
+        if self.elem_type.is_rc() && crate::rc::is_shared(&self.header.flags) {
+            crate::rc::bolide_value_mark_shared(value as *mut c_void);
+        }
+    }
+
     /// 增加所有元素的引用计数（用于 clone）
     unsafe fn retain_elements(&self) {
         for i in 0..self.len {
@@ -297,11 +349,10 @@ pub extern "C" fn bolide_list_release(list: *mut BolideList) {
             (*list).release_elements();
             // 释放数据数组
             if !(*list).data.is_null() {
-                let layout = std::alloc::Layout::array::<i64>((*list).capacity).unwrap();
-                std::alloc::dealloc((*list).data as *mut u8, layout);
+                crate::slab::free((*list).data as *mut u8, (*list).capacity * 8);
             }
             // 释放列表本身
-            let _ = Box::from_raw(list);
+            crate::slab::free_value(list);
         }
     }
 }
@@ -425,6 +476,7 @@ pub extern "C" fn bolide_list_insert(list: *mut BolideList, index: usize, value:
         }
         
         // 插入新元素
+        list.share_if_needed(value);
         *list.data.add(index) = value;
         list.len += 1;
         list.retain_element(value);
@@ -512,70 +564,38 @@ pub extern "C" fn bolide_list_extend(list: *mut BolideList, other: *const Bolide
 #[no_mangle]
 pub extern "C" fn bolide_list_contains(list: *const BolideList, value: i64) -> i64 {
     if list.is_null() { return 0; }
-    unsafe {
-        let list = &*list;
-        for i in 0..list.len {
-            if *list.data.add(i) == value {
-                return 1;
-            }
-        }
-        0
-    }
+    unsafe { kernels::find((*list).as_slice(), value).is_some() as i64 }
 }
 
 /// 查找值的第一个索引（找不到返回 -1）
 #[no_mangle]
 pub extern "C" fn bolide_list_index_of(list: *const BolideList, value: i64) -> i64 {
     if list.is_null() { return -1; }
-    unsafe {
-        let list = &*list;
-        for i in 0..list.len {
-            if *list.data.add(i) == value {
-                return i as i64;
-            }
-        }
-        -1
-    }
+    unsafe { kernels::find((*list).as_slice(), value).map_or(-1, |i| i as i64) }
 }
 
 /// 统计值出现的次数
 #[no_mangle]
 pub extern "C" fn bolide_list_count(list: *const BolideList, value: i64) -> i64 {
     if list.is_null() { return 0; }
-    unsafe {
-        let list = &*list;
-        let mut count = 0i64;
-        for i in 0..list.len {
-            if *list.data.add(i) == value {
-                count += 1;
-            }
-        }
-        count
-    }
+    unsafe { kernels::count((*list).as_slice(), value) as i64 }
 }
 
 /// 原地排序（仅支持 Int 和 Float 类型）
+///
+/// Int 使用 LSD 基数排序；Float 先映射为保序的整数键再做基数排序，没有比较分支。
+/// Float 的顺序与 `f64::total_cmp` 一致：负号 NaN 排在最前，正号 NaN 排在最后，
+/// -0.0 排在 0.0 之前
 #[no_mangle]
 pub extern "C" fn bolide_list_sort(list: *mut BolideList) {
     if list.is_null() { return; }
     unsafe {
         let list = &mut *list;
         if list.len <= 1 { return; }
-        
+
         match list.elem_type {
-            ElementType::Int => {
-                // 转换为 slice 并排序
-                let slice = std::slice::from_raw_parts_mut(list.data, list.len);
-                slice.sort();
-            }
-            ElementType::Float => {
-                let slice = std::slice::from_raw_parts_mut(list.data, list.len);
-                slice.sort_by(|a, b| {
-                    let fa = f64::from_bits(*a as u64);
-                    let fb = f64::from_bits(*b as u64);
-                    fa.partial_cmp(&fb).unwrap_or(std::cmp::Ordering::Equal)
-                });
-            }
+            ElementType::Int => kernels::sort_i64(list.as_mut_slice()),
+            ElementType::Float => kernels::sort_f64_bits(list.as_mut_slice()),
             _ => {
                 // 其他类型不支持排序
             }
@@ -583,6 +603,306 @@ pub extern "C" fn bolide_list_sort(list: *mut BolideList) {
     }
 }
 
+// ==================== 数值归约 ====================
+
+/// Int 列表求和（溢出时回绕）
+#[no_mangle]
+pub extern "C" fn bolide_list_sum_int(list: *const BolideList) -> i64 {
+    if list.is_null() { return 0; }
+    unsafe { kernels::sum_i64((*list).as_slice()) }
+}
+
+/// Float 列表求和
+#[no_mangle]
+pub extern "C" fn bolide_list_sum_float(list: *const BolideList) -> f64 {
+    if list.is_null() { return 0.0; }
+    unsafe { kernels::sum_f64((*list).as_f64_slice()) }
+}
+
+/// Int 列表最小值（空列表返回 0）
+#[no_mangle]
+pub extern "C" fn bolide_list_min_int(list: *const BolideList) -> i64 {
+    if list.is_null() { return 0; }
+    unsafe { kernels::min_i64((*list).as_slice()).unwrap_or(0) }
+}
+
+/// Int 列表最大值（空列表返回 0）
+#[no_mangle]
+pub extern "C" fn bolide_list_max_int(list: *const BolideList) -> i64 {
+    if list.is_null() { return 0; }
+    unsafe { kernels::max_i64((*list).as_slice()).unwrap_or(0) }
+}
+
+/// Float 列表最小值（NaN 被忽略；空列表返回 0.0，全为 NaN 时返回 NaN）
+#[no_mangle]
+pub extern "C" fn bolide_list_min_float(list: *const BolideList) -> f64 {
+    if list.is_null() { return 0.0; }
+    unsafe { kernels::min_f64((*list).as_f64_slice()).unwrap_or(0.0) }
+}
+
+/// Float 列表最大值（NaN 被忽略；空列表返回 0.0，全为 NaN 时返回 NaN）
+#[no_mangle]
+pub extern "C" fn bolide_list_max_float(list: *const BolideList) -> f64 {
+    if list.is_null() { return 0.0; }
+    unsafe { kernels::max_f64((*list).as_f64_slice()).unwrap_or(0.0) }
+}
+
+/// Int 列表点积（按较短的长度计算）
+#[no_mangle]
+pub extern "C" fn bolide_list_dot_int(a: *const BolideList, b: *const BolideList) -> i64 {
+    if a.is_null() || b.is_null() { return 0; }
+    unsafe { kernels::dot_i64((*a).as_slice(), (*b).as_slice()) }
+}
+
+/// Float 列表点积（按较短的长度计算）
+#[no_mangle]
+pub extern "C" fn bolide_list_dot_float(a: *const BolideList, b: *const BolideList) -> f64 {
+    if a.is_null() || b.is_null() { return 0.0; }
+    unsafe { kernels::dot_f64((*a).as_f64_slice(), (*b).as_f64_slice()) }
+}
+
+/// 批量内核
+///
+/// 以 LANES 个元素为一组、用定长数组做多路累加，循环体没有跨元素的依赖，
+/// 编译器会展开为 SSE/AVX/NEON 向量指令，不需要依赖特定指令集
+mod kernels {
+    const LANES: usize = 8;
+
+    /// 查找第一个相等元素：先按组判断是否命中，命中后再在组内定位
+    pub fn find(s: &[i64], v: i64) -> Option<usize> {
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for (ci, c) in chunks.enumerate() {
+            let mut hit = false;
+            for &x in c {
+                hit |= x == v;
+            }
+            if hit {
+                return c.iter().position(|&x| x == v).map(|i| ci * LANES + i);
+            }
+        }
+        let base = s.len() - tail.len();
+        tail.iter().position(|&x| x == v).map(|i| base + i)
+    }
+
+    pub fn count(s: &[i64], v: i64) -> usize {
+        let mut acc = [0usize; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] += (c[i] == v) as usize;
+            }
+        }
+        acc.iter().sum::<usize>() + tail.iter().filter(|&&x| x == v).count()
+    }
+
+    pub fn sum_i64(s: &[i64]) -> i64 {
+        let mut acc = [0i64; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] = acc[i].wrapping_add(c[i]);
+            }
+        }
+        let mut total = acc.iter().fold(0i64, |a, &b| a.wrapping_add(b));
+        for &x in tail {
+            total = total.wrapping_add(x);
+        }
+        total
+    }
+
+    /// 多路累加，结果与逐个相加在舍入上可能略有差别（误差通常更小）
+    pub fn sum_f64(s: &[f64]) -> f64 {
+        let mut acc = [0.0f64; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] += c[i];
+            }
+        }
+        acc.iter().sum::<f64>() + tail.iter().sum::<f64>()
+    }
+
+    pub fn min_i64(s: &[i64]) -> Option<i64> {
+        let first = *s.first()?;
+        let mut acc = [first; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] = acc[i].min(c[i]);
+            }
+        }
+        Some(acc.iter().chain(tail).copied().fold(first, i64::min))
+    }
+
+    pub fn max_i64(s: &[i64]) -> Option<i64> {
+        let first = *s.first()?;
+        let mut acc = [first; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] = acc[i].max(c[i]);
+            }
+        }
+        Some(acc.iter().chain(tail).copied().fold(first, i64::max))
+    }
+
+    /// 第一个非 NaN 元素，作为 min/max 累加器的初值；全为 NaN 时返回 NaN
+    fn first_non_nan(s: &[f64]) -> Option<f64> {
+        s.iter().copied().find(|x| !x.is_nan()).or_else(|| s.first().copied())
+    }
+
+    /// 比较写成选择形式（对应 minpd/maxpd）：NaN 与任何值比较都为假，
+    /// 只要初值不是 NaN，NaN 元素就会被跳过
+    pub fn min_f64(s: &[f64]) -> Option<f64> {
+        let first = first_non_nan(s)?;
+        let mut acc = [first; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] = if c[i] < acc[i] { c[i] } else { acc[i] };
+            }
+        }
+        Some(acc.iter().chain(tail).copied().fold(first, |m, x| if x < m { x } else { m }))
+    }
+
+    pub fn max_f64(s: &[f64]) -> Option<f64> {
+        let first = first_non_nan(s)?;
+        let mut acc = [first; LANES];
+        let chunks = s.chunks_exact(LANES);
+        let tail = chunks.remainder();
+        for c in chunks {
+            for i in 0..LANES {
+                acc[i] = if c[i] > acc[i] { c[i] } else { acc[i] };
+            }
+        }
+        Some(acc.iter().chain(tail).copied().fold(first, |m, x| if x > m { x } else { m }))
+    }
+
+    pub fn dot_i64(a: &[i64], b: &[i64]) -> i64 {
+        let n = a.len().min(b.len());
+        let (a, b) = (&a[..n], &b[..n]);
+        let mut acc = [0i64; LANES];
+        let split = n - n % LANES;
+        for (ca, cb) in a[..split].chunks_exact(LANES).zip(b[..split].chunks_exact(LANES)) {
+            for i in 0..LANES {
+                acc[i] = acc[i].wrapping_add(ca[i].wrapping_mul(cb[i]));
+            }
+        }
+        let mut total = acc.iter().fold(0i64, |x, &y| x.wrapping_add(y));
+        for i in split..n {
+            total = total.wrapping_add(a[i].wrapping_mul(b[i]));
+        }
+        total
+    }
+
+    pub fn dot_f64(a: &[f64], b: &[f64]) -> f64 {
+        let n = a.len().min(b.len());
+        let (a, b) = (&a[..n], &b[..n]);
+        let mut acc = [0.0f64; LANES];
+        let split = n - n % LANES;
+        for (ca, cb) in a[..split].chunks_exact(LANES).zip(b[..split].chunks_exact(LANES)) {
+            for i in 0..LANES {
+                acc[i] += ca[i] * cb[i];
+            }
+        }
+        let mut total: f64 = acc.iter().sum();
+        for i in split..n {
+            total += a[i] * b[i];
+        }
+        total
+    }
+
+    /// 小于该长度时直接用标准库的排序
+    const RADIX_MIN_LEN: usize = 64;
+
+    /// 对 u64 键做 LSD 基数排序（每趟 8 位，所有键该字节相同的趟会被跳过）
+    fn radix_sort_u64(keys: &mut [u64]) {
+        if keys.len() < RADIX_MIN_LEN {
+            keys.sort_unstable();
+            return;
+        }
+        let mut buf = vec![0u64; keys.len()];
+        let mut hist = [[0usize; 256]; 8];
+        for &k in keys.iter() {
+            for (pass, h) in hist.iter_mut().enumerate() {
+                h[((k >> (pass * 8)) & 0xFF) as usize] += 1;
+            }
+        }
+        let n = keys.len();
+        let mut src_is_keys = true;
+        for (pass, h) in hist.iter().enumerate() {
+            let shift = pass * 8;
+            if h.iter().any(|&c| c == n) {
+                continue;
+            }
+            let mut offsets = [0usize; 256];
+            let mut sum = 0;
+            for (o, &c) in offsets.iter_mut().zip(h.iter()) {
+                *o = sum;
+                sum += c;
+            }
+            let (src, dst): (&[u64], &mut [u64]) = if src_is_keys {
+                (&*keys, &mut buf[..])
+            } else {
+                (&buf[..], &mut *keys)
+            };
+            for &k in src {
+                let b = ((k >> shift) & 0xFF) as usize;
+                dst[offsets[b]] = k;
+                offsets[b] += 1;
+            }
+            src_is_keys = !src_is_keys;
+        }
+        if !src_is_keys {
+            keys.copy_from_slice(&buf);
+        }
+    }
+
+    const SIGN: u64 = 1 << 63;
+
+    pub fn sort_i64(s: &mut [i64]) {
+        // 翻转符号位后，有符号顺序等于无符号顺序
+        let keys: &mut [u64] = unsafe { std::slice::from_raw_parts_mut(s.as_mut_ptr() as *mut u64, s.len()) };
+        for k in keys.iter_mut() {
+            *k ^= SIGN;
+        }
+        radix_sort_u64(keys);
+        for k in keys.iter_mut() {
+            *k ^= SIGN;
+        }
+    }
+
+    /// f64 位模式 -> 保序的 u64 键：正数翻转符号位，负数按位取反
+    #[inline]
+    fn f64_key(bits: u64) -> u64 {
+        bits ^ ((((bits as i64) >> 63) as u64) | SIGN)
+    }
+
+    #[inline]
+    fn f64_from_key(key: u64) -> u64 {
+        key ^ ((key >> 63).wrapping_sub(1) | SIGN)
+    }
+
+    /// 对以 i64 槽位存放的 f64 排序
+    pub fn sort_f64_bits(s: &mut [i64]) {
+        let keys: &mut [u64] = unsafe { std::slice::from_raw_parts_mut(s.as_mut_ptr() as *mut u64, s.len()) };
+        for k in keys.iter_mut() {
+            *k = f64_key(*k);
+        }
+        radix_sort_u64(keys);
+        for k in keys.iter_mut() {
+            *k = f64_from_key(*k);
+        }
+    }
+}
+
 /// 切片（返回新列表）
 #[no_mangle]
 pub extern "C" fn bolide_list_slice(list: *const BolideList, start: i64, end: i64) -> *mut BolideList {
@@ -647,33 +967,39 @@ pub extern "C" fn bolide_list_last(list: *const BolideList) -> i64 {
 /// 打印列表
 #[no_mangle]
 pub extern "C" fn bolide_print_list(list: *const BolideList) {
-    if list.is_null() {
-        println!("[]");
-        return;
-    }
-    unsafe {
-        let list = &*list;
-        print!("[");
-        for i in 0..list.len {
-            if i > 0 { print!(", "); }
-            let val = *list.data.add(i);
-            match list.elem_type {
-                ElementType::Int => print!("{}", val),
-                ElementType::Float => print!("{}", f64::from_bits(val as u64)),
-                ElementType::Bool => print!("{}", if val != 0 { "true" } else { "false" }),
-                ElementType::String => {
-                    let s = val as *const crate::BolideString;
-                    if !s.is_null() {
-                        print!("\"{}\"", (*s).as_str());
-                    } else {
-                        print!("null");
+    crate::print::with_out(|out| {
+        if list.is_null() {
+            out.push_str("[]");
+            out.end_line();
+            return;
+        }
+        unsafe {
+            let list = &*list;
+            out.push_str("[");
+            for i in 0..list.len {
+                if i > 0 { out.push_str(", "); }
+                let val = *list.data.add(i);
+                match list.elem_type {
+                    ElementType::Int => out.push_int(val),
+                    ElementType::Float => out.push_float(f64::from_bits(val as u64)),
+                    ElementType::Bool => out.push_bool(val),
+                    ElementType::String => {
+                        let s = val as *const crate::BolideString;
+                        if !s.is_null() {
+                            out.push_str("\"");
+                            out.push_bytes((*s).as_bytes());
+                            out.push_str("\"");
+                        } else {
+                            out.push_str("null");
+                        }
                     }
+                    _ => { let _ = std::fmt::Write::write_fmt(out, format_args!("0x{:x}", val)); }
                 }
-                _ => print!("0x{:x}", val),
             }
+            out.push_str("]");
+            out.end_line();
         }
-        println!("]");
-    }
+    });
 }
 
 // ==================== 测试 ====================
@@ -699,6 +1025,59 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_inline_offsets() {
+        // 模拟生成代码按偏移直接读写
+        let list = BolideList::new(ElementType::Int);
+        bolide_list_push(list, 7);
+        bolide_list_push(list, 9);
+        unsafe {
+            let base = list as *mut u8;
+            assert_eq!(*(base.add(LIST_LEN_OFFSET as usize) as *const usize), 2);
+            let data = *(base.add(LIST_DATA_OFFSET as usize) as *const *mut i64);
+            assert_eq!(*data.add(1), 9);
+
+            let strong = base.add(crate::rc::RC_STRONG_OFFSET as usize) as *mut u32;
+            assert_eq!(*strong, 1);
+            *strong += 1;
+            assert_eq!((*list).ref_count(), 2);
+            *strong -= 1;
+
+            let flags = *base.add(crate::rc::RC_FLAGS_OFFSET as usize);
+            assert_eq!(flags & crate::rc::flags::SHARED, 0);
+            crate::rc::bolide_value_mark_shared(list as *mut c_void);
+            let flags = *base.add(crate::rc::RC_FLAGS_OFFSET as usize);
+            assert_ne!(flags & crate::rc::flags::SHARED, 0);
+
+            bolide_list_release(list);
+        }
+    }
+
+    #[test]
+    fn test_shared_list_marks_new_elements() {
+        let list = BolideList::new(ElementType::String);
+        crate::rc::bolide_value_mark_shared(list as *mut c_void);
+        let pushed = crate::bolide_string_from_slice(b"a".as_ptr() as *const i8, 1);
+        let inserted = crate::bolide_string_from_slice(b"b".as_ptr() as *const i8, 1);
+        let replaced = crate::bolide_string_from_slice(b"c".as_ptr() as *const i8, 1);
+        bolide_list_push(list, pushed as i64);
+        bolide_list_insert(list, 0, inserted as i64);
+        bolide_list_set(list, 1, replaced as i64);
+        for s in [pushed, inserted, replaced] {
+            unsafe { assert!((*(s as *const crate::rc::RcHeader)).is_shared()); }
+            crate::bolide_string_release(s);
+        }
+
+        // 未共享的列表不标记元素
+        let local = BolideList::new(ElementType::String);
+        let s = crate::bolide_string_from_slice(b"d".as_ptr() as *const i8, 1);
+        bolide_list_push(local, s as i64);
+        unsafe { assert!(!(*(s as *const crate::rc::RcHeader)).is_shared()); }
+        crate::bolide_string_release(s);
+        bolide_list_release(local);
+        bolide_list_release(list);
+    }
+
     #[test]
     fn test_list_operations() {
         let list = BolideList::new(ElementType::Int);
@@ -760,4 +1139,72 @@ mod tests {
             bolide_list_release(cloned);
         }
     }
+
+    #[test]
+    fn test_int_kernels() {
+        let list = BolideList::new(ElementType::Int);
+        unsafe {
+            let values: Vec<i64> = (0..1000).map(|i| (i * 7919) % 1009 - 500).collect();
+            for &v in &values {
+                bolide_list_push(list, v);
+            }
+            assert_eq!(bolide_list_sum_int(list), values.iter().sum::<i64>());
+            assert_eq!(bolide_list_min_int(list), *values.iter().min().unwrap());
+            assert_eq!(bolide_list_max_int(list), *values.iter().max().unwrap());
+            assert_eq!(bolide_list_dot_int(list, list), values.iter().map(|v| v * v).sum::<i64>());
+            assert_eq!(bolide_list_index_of(list, values[997]), 997);
+            assert_eq!(bolide_list_count(list, values[3]), values.iter().filter(|&&v| v == values[3]).count() as i64);
+            assert_eq!(bolide_list_contains(list, 99999), 0);
+
+            bolide_list_sort(list);
+            let mut expected = values.clone();
+            expected.sort();
+            assert_eq!((*list).as_slice(), &expected[..]);
+
+            bolide_list_release(list);
+        }
+    }
+
+    #[test]
+    fn test_float_kernels() {
+        let list = BolideList::new(ElementType::Float);
+        unsafe {
+            let values: Vec<f64> = (0..300).map(|i| ((i * 37) % 101) as f64 * 0.5 - 20.0).collect();
+            for &v in values.iter().chain([-0.0, f64::INFINITY, f64::NEG_INFINITY].iter()) {
+                bolide_list_push(list, v.to_bits() as i64);
+            }
+            assert_eq!(bolide_list_max_float(list), f64::INFINITY);
+            assert_eq!(bolide_list_min_float(list), f64::NEG_INFINITY);
+
+            bolide_list_sort(list);
+            let sorted = (*list).as_f64_slice();
+            assert!(sorted.windows(2).all(|w| w[0] <= w[1]));
+            assert_eq!(sorted[0], f64::NEG_INFINITY);
+            assert_eq!(*sorted.last().unwrap(), f64::INFINITY);
+
+            bolide_list_release(list);
+        }
+
+        let small = BolideList::new(ElementType::Float);
+        unsafe {
+            for v in [1.5f64, 2.0, 3.5] {
+                bolide_list_push(small, v.to_bits() as i64);
+            }
+            assert_eq!(bolide_list_sum_float(small), 7.0);
+            assert_eq!(bolide_list_dot_float(small, small), 1.5 * 1.5 + 4.0 + 3.5 * 3.5);
+            bolide_list_release(small);
+        }
+    }
+
+    #[test]
+    fn test_float_min_max_skip_nan() {
+        let mut values = vec![f64::NAN, 3.0, f64::NAN, -1.0];
+        values.extend((0..20).map(|i| i as f64));
+        values.push(f64::NAN);
+        assert_eq!(kernels::min_f64(&values), Some(-1.0));
+        assert_eq!(kernels::max_f64(&values), Some(19.0));
+        assert!(kernels::min_f64(&[f64::NAN, f64::NAN]).unwrap().is_nan());
+        assert!(kernels::max_f64(&[f64::NAN]).unwrap().is_nan());
+        assert_eq!(kernels::min_f64(&[]), None);
+    }
 }
@@ -2,28 +2,35 @@
 //!
 //! 提供类实例的内存管理
 
-use std::alloc::{alloc, dealloc, Layout};
-use std::sync::atomic::{AtomicUsize, Ordering};
+use std::os::raw::c_void;
+use std::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
 
 /// 对象头部结构（每个对象都有）
 #[repr(C)]
 pub struct ObjectHeader {
     pub ref_count: AtomicUsize,
     pub data_size: usize,  // 数据部分大小
+    /// 字段布局表（编译器为每个类生成的静态数据），为空表示没有 RC 字段
+    pub layout: *const u32,
+    /// 已被 object_mark_shared 访问过，防止对象环无限递归
+    pub shared: AtomicBool,
 }
 
+/// 布局表条目的最低位：1 表示字段是类对象，0 表示带 RC 头的运行时值
+pub const LAYOUT_FIELD_OBJECT: u32 = 1;
+
 const HEADER_SIZE: usize = std::mem::size_of::<ObjectHeader>();
 
 /// 分配对象内存
 /// size: 对象数据大小（不含头部）
+/// layout: 字段布局表，格式为 [条目数, (偏移 << 1 | 是否类对象)...]，可以为空
 /// 返回: 指向对象数据的指针（头部在前面）
 #[no_mangle]
-pub extern "C" fn object_alloc(size: usize) -> *mut u8 {
+pub extern "C" fn object_alloc(size: usize, layout: *const u32) -> *mut u8 {
     let total_size = HEADER_SIZE + size;
-    let layout = Layout::from_size_align(total_size, 8).unwrap();
 
     unsafe {
-        let ptr = alloc(layout);
+        let ptr = crate::slab::alloc(total_size);
         if ptr.is_null() {
             panic!("Object allocation failed");
         }
@@ -32,6 +39,8 @@ pub extern "C" fn object_alloc(size: usize) -> *mut u8 {
         let header = ptr as *mut ObjectHeader;
         (*header).ref_count = AtomicUsize::new(1);
         (*header).data_size = size;
+        (*header).layout = layout;
+        (*header).shared = AtomicBool::new(false);
 
         // 返回数据部分的指针
         ptr.add(HEADER_SIZE)
@@ -65,8 +74,7 @@ pub extern "C" fn object_release(data_ptr: *mut u8) {
             // 引用计数为0，释放内存
             let data_size = (*header).data_size;
             let total_size = HEADER_SIZE + data_size;
-            let layout = Layout::from_size_align(total_size, 8).unwrap();
-            dealloc(header_ptr, layout);
+            crate::slab::free(header_ptr, total_size);
         }
     }
 }
@@ -79,3 +87,100 @@ pub extern "C" fn object_clone(data_ptr: *mut u8) -> *mut u8 {
     }
     data_ptr
 }
+
+/// 把对象的 RC 字段标记为跨线程共享
+///
+/// 对象自身的计数已经是原子的，但 list/dict 等字段仍是线程内计数，
+/// 跨线程传递对象前需要沿布局表递归标记；每个对象只访问一次。
+#[no_mangle]
+pub extern "C" fn object_mark_shared(data_ptr: *mut u8) {
+    if data_ptr.is_null() {
+        return;
+    }
+    unsafe {
+        let header = &*(data_ptr.sub(HEADER_SIZE) as *const ObjectHeader);
+        if header.layout.is_null() || header.shared.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        let count = *header.layout as usize;
+        let entries = std::slice::from_raw_parts(header.layout.add(1), count);
+        for &entry in entries {
+            let field = *(data_ptr.add((entry >> 1) as usize) as *const *mut u8);
+            if entry & LAYOUT_FIELD_OBJECT != 0 {
+                object_mark_shared(field);
+            } else {
+                crate::rc::bolide_value_mark_shared(field as *mut c_void);
+            }
+        }
+    }
+}
+
+/// 向对象的 RC 字段存入新值后调用：对象已跨线程共享时，新值也要标记
+///
+/// is_object 非 0 表示字段是类对象。未共享的对象只读一次标志就返回。
+#[no_mangle]
+pub extern "C" fn object_share_field(data_ptr: *mut u8, value: *mut u8, is_object: i64) {
+    if data_ptr.is_null() {
+        return;
+    }
+    unsafe {
+        let header = &*(data_ptr.sub(HEADER_SIZE) as *const ObjectHeader);
+        if !header.shared.load(Ordering::Acquire) {
+            return;
+        }
+    }
+    if is_object != 0 {
+        object_mark_shared(value);
+    } else {
+        crate::rc::bolide_value_mark_shared(value as *mut c_void);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_object_mark_shared_walks_fields() {
+        // class Node { name: str, next: Node }
+        static LAYOUT: [u32; 3] = [2, 0, (8 << 1) | LAYOUT_FIELD_OBJECT];
+        let name = crate::bolide_string_from_slice(b"node".as_ptr() as *const i8, 4);
+        let a = object_alloc(16, LAYOUT.as_ptr());
+        let b = object_alloc(16, LAYOUT.as_ptr());
+        unsafe {
+            *(a as *mut *mut crate::BolideString) = name;
+            *(a.add(8) as *mut *mut u8) = b;
+            *(b as *mut *mut crate::BolideString) = std::ptr::null_mut();
+            // 对象环：访问标志保证只遍历一次
+            *(b.add(8) as *mut *mut u8) = a;
+        }
+        object_mark_shared(a);
+        unsafe {
+            let header = &*(name as *const crate::rc::RcHeader);
+            assert!(!header.mark_shared());
+        }
+        crate::bolide_string_release(name);
+        object_release(a);
+        object_release(b);
+    }
+
+    #[test]
+    fn test_object_share_field_after_marking() {
+        static LAYOUT: [u32; 2] = [1, 0];
+        let obj = object_alloc(8, LAYOUT.as_ptr());
+        unsafe { *(obj as *mut *mut crate::BolideString) = std::ptr::null_mut(); }
+        let before = crate::bolide_string_from_slice(b"x".as_ptr() as *const i8, 1);
+        object_share_field(obj, before as *mut u8, 0);
+        unsafe { assert!(!(*(before as *const crate::rc::RcHeader)).is_shared()); }
+
+        object_mark_shared(obj);
+        let after = crate::bolide_string_from_slice(b"y".as_ptr() as *const i8, 1);
+        unsafe { *(obj as *mut *mut crate::BolideString) = after; }
+        object_share_field(obj, after as *mut u8, 0);
+        unsafe { assert!((*(after as *const crate::rc::RcHeader)).is_shared()); }
+
+        crate::bolide_string_release(before);
+        crate::bolide_string_release(after);
+        object_release(obj);
+    }
+}
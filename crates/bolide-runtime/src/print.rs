@@ -3,27 +3,221 @@
 //! 所有打印相关的函数集中在这里，提供清晰的 API:
 //! - `bolide_print_*`: 各类型的打印函数
 //! - 内部使用各类型的 to_string 方法
+//!
+//! 输出先写入线程本地缓冲区，不经过全局 stdout 锁：
+//! - stdout 是终端时每行刷新（与 println! 行为一致），否则攒满 OUT_FLUSH_THRESHOLD 再写出
+//! - `bolide_print_flush`、线程池/协程任务结束、读取输入前以及进程退出时刷新
+//! - 跨线程交接时刷新当前线程：spawn / 通道发送之前，join / await / recv 等待之前，
+//!   保证重定向到文件时各线程的输出仍按因果顺序出现
+//! - 整数和浮点数直接格式化进缓冲区，不产生临时 String
+
+use std::cell::RefCell;
+use std::fmt::Write as _;
+use std::io::{IsTerminal, Write};
+use std::sync::{Once, OnceLock};
+
+use crate::{BigValue, BolideBigInt, BolideDecimal, BolideDynamic, BolideString};
+
+/// 非终端输出的刷新阈值
+const OUT_FLUSH_THRESHOLD: usize = 16 * 1024;
+
+/// 线程本地输出缓冲区
+pub(crate) struct OutBuf {
+    buf: Vec<u8>,
+}
+
+impl OutBuf {
+    fn new() -> Self {
+        Self { buf: Vec::with_capacity(OUT_FLUSH_THRESHOLD + 256) }
+    }
+
+    #[inline]
+    pub(crate) fn push_bytes(&mut self, bytes: &[u8]) {
+        self.buf.extend_from_slice(bytes);
+    }
+
+    #[inline]
+    pub(crate) fn push_str(&mut self, s: &str) {
+        self.buf.extend_from_slice(s.as_bytes());
+    }
+
+    /// 整数转十进制，写入栈上的临时数组后拷入缓冲区
+    pub(crate) fn push_int(&mut self, value: i64) {
+        let mut digits = [0u8; 20];
+        let mut pos = digits.len();
+        let mut n = value.unsigned_abs();
+        loop {
+            pos -= 1;
+            digits[pos] = b'0' + (n % 10) as u8;
+            n /= 10;
+            if n == 0 {
+                break;
+            }
+        }
+        if value < 0 {
+            self.buf.push(b'-');
+        }
+        self.buf.extend_from_slice(&digits[pos..]);
+    }
+
+    /// 浮点数格式与 `{}` 一致，直接格式化进缓冲区
+    pub(crate) fn push_float(&mut self, value: f64) {
+        let _ = write!(self, "{}", value);
+    }
+
+    #[inline]
+    pub(crate) fn push_bool(&mut self, value: i64) {
+        self.push_str(if value != 0 { "true" } else { "false" });
+    }
+
+    /// 结束一行：终端上立即刷新，否则按阈值刷新
+    #[inline]
+    pub(crate) fn end_line(&mut self) {
+        self.buf.push(b'\n');
+        if stdout_is_tty() || self.buf.len() >= OUT_FLUSH_THRESHOLD {
+            self.flush();
+        }
+    }
+
+    /// 不换行输出后按阈值刷新
+    #[inline]
+    fn maybe_flush(&mut self) {
+        if self.buf.len() >= OUT_FLUSH_THRESHOLD {
+            self.flush();
+        }
+    }
+
+    /// 写出缓冲区内容（只在这里获取一次 stdout 锁）
+    pub(crate) fn flush(&mut self) {
+        if self.buf.is_empty() {
+            return;
+        }
+        #[cfg(test)]
+        if let Some(captured) = CAPTURE.lock().unwrap().as_mut() {
+            captured.extend_from_slice(&self.buf);
+            self.buf.clear();
+            return;
+        }
+        let stdout = std::io::stdout();
+        let mut lock = stdout.lock();
+        let _ = lock.write_all(&self.buf);
+        let _ = lock.flush();
+        self.buf.clear();
+    }
+}
+
+impl std::fmt::Write for OutBuf {
+    #[inline]
+    fn write_str(&mut self, s: &str) -> std::fmt::Result {
+        self.push_str(s);
+        Ok(())
+    }
+}
+
+impl Drop for OutBuf {
+    fn drop(&mut self) {
+        self.flush();
+    }
+}
+
+thread_local! {
+    static OUT: RefCell<OutBuf> = RefCell::new(OutBuf::new());
+}
+
+/// 测试用：非空时所有刷新写入这里，并按非终端（管道）模式缓冲
+#[cfg(test)]
+static CAPTURE: std::sync::Mutex<Option<Vec<u8>>> = std::sync::Mutex::new(None);
+
+/// stdout 是否为终端（进程内只检测一次）
+fn stdout_is_tty() -> bool {
+    #[cfg(test)]
+    if CAPTURE.lock().unwrap().is_some() {
+        return false;
+    }
+    static IS_TTY: OnceLock<bool> = OnceLock::new();
+    *IS_TTY.get_or_init(|| std::io::stdout().is_terminal())
+}
+
+/// 主线程的线程本地析构在进程退出时不保证执行，用 atexit 兜底刷新
+fn register_exit_flush() {
+    static REGISTER: Once = Once::new();
+    REGISTER.call_once(|| {
+        extern "C" {
+            fn atexit(callback: extern "C" fn()) -> i32;
+        }
+        extern "C" fn flush_at_exit() {
+            bolide_print_flush();
+        }
+        unsafe { atexit(flush_at_exit); }
+    });
+}
+
+/// 经线程本地缓冲区输出一行（运行时内部替代 println!，与 bolide_print_* 保持先后顺序）
+macro_rules! out_println {
+    ($($arg:tt)*) => {
+        $crate::print::with_out(|out| {
+            let _ = ::std::fmt::Write::write_fmt(out, format_args!($($arg)*));
+            out.end_line();
+        })
+    };
+}
+pub(crate) use out_println;
 
-use crate::{BolideBigInt, BolideDecimal, BolideDynamic, BolideString};
+/// 在当前线程的输出缓冲区上执行 f
+///
+/// 线程本地存储已销毁（线程退出中）或缓冲区正被占用时，使用临时缓冲区并立即写出。
+pub(crate) fn with_out<R>(f: impl FnOnce(&mut OutBuf) -> R) -> R {
+    register_exit_flush();
+    let mut f = Some(f);
+    let result = OUT.try_with(|out| {
+        out.try_borrow_mut().ok().map(|mut out| (f.take().unwrap())(&mut out))
+    });
+    match result {
+        Ok(Some(r)) => r,
+        _ => {
+            let mut out = OutBuf { buf: Vec::new() };
+            (f.take().unwrap())(&mut out)
+        }
+    }
+}
+
+/// 刷新当前线程的输出缓冲区
+#[no_mangle]
+pub extern "C" fn bolide_print_flush() {
+    let _ = OUT.try_with(|out| {
+        if let Ok(mut out) = out.try_borrow_mut() {
+            out.flush();
+        }
+    });
+}
 
 // ==================== 基本类型打印 ====================
 
 /// 打印整数
 #[no_mangle]
 pub extern "C" fn bolide_print_int(value: i64) {
-    println!("{}", value);
+    with_out(|out| {
+        out.push_int(value);
+        out.end_line();
+    });
 }
 
 /// 打印浮点数
 #[no_mangle]
 pub extern "C" fn bolide_print_float(value: f64) {
-    println!("{}", value);
+    with_out(|out| {
+        out.push_float(value);
+        out.end_line();
+    });
 }
 
 /// 打印布尔值
 #[no_mangle]
 pub extern "C" fn bolide_print_bool(value: i64) {
-    println!("{}", if value != 0 { "true" } else { "false" });
+    with_out(|out| {
+        out.push_bool(value);
+        out.end_line();
+    });
 }
 
 // ==================== 复合类型打印 ====================
@@ -31,45 +225,53 @@ pub extern "C" fn bolide_print_bool(value: i64) {
 /// 打印 BigInt
 #[no_mangle]
 pub extern "C" fn bolide_print_bigint(ptr: *const BolideBigInt) {
-    if ptr.is_null() {
-        println!("null");
-        return;
-    }
-    let value = unsafe { &*ptr };
-    println!("{}", value.to_string());
+    with_out(|out| {
+        if ptr.is_null() {
+            out.push_str("null");
+        } else {
+            match unsafe { BolideBigInt::view(ptr) } {
+                BigValue::Small(v) => out.push_int(v),
+                BigValue::Heap(h) => out.push_str(&h.to_string()),
+            }
+        }
+        out.end_line();
+    });
 }
 
 /// 打印 Decimal
 #[no_mangle]
 pub extern "C" fn bolide_print_decimal(ptr: *const BolideDecimal) {
-    if ptr.is_null() {
-        println!("null");
-        return;
-    }
-    let value = unsafe { &*ptr };
-    println!("{}", value.to_string());
+    with_out(|out| {
+        if ptr.is_null() {
+            out.push_str("null");
+        } else {
+            let value = unsafe { &*ptr };
+            out.push_str(&value.to_string());
+        }
+        out.end_line();
+    });
 }
 
 /// 打印 String
 #[no_mangle]
 pub extern "C" fn bolide_print_string(ptr: *const BolideString) {
-    if ptr.is_null() {
-        println!("null");
-        return;
-    }
-    let value = unsafe { &*ptr };
-    println!("{}", value.as_str());
+    with_out(|out| {
+        if ptr.is_null() {
+            out.push_str("null");
+        } else {
+            out.push_bytes(unsafe { (*ptr).as_bytes() });
+        }
+        out.end_line();
+    });
 }
 
 /// 打印 Dynamic (自动识别类型)
 #[no_mangle]
 pub extern "C" fn bolide_print_dynamic(ptr: *const BolideDynamic) {
-    if ptr.is_null() {
-        println!("null");
-        return;
-    }
-    let value = unsafe { &*ptr };
-    println!("{}", value.to_string_repr());
+    with_out(|out| {
+        out.push_str(&crate::dynamic::dynamic_repr(ptr));
+        out.end_line();
+    });
 }
 
 // ==================== 辅助函数 ====================
@@ -77,19 +279,25 @@ pub extern "C" fn bolide_print_dynamic(ptr: *const BolideDynamic) {
 /// 打印换行
 #[no_mangle]
 pub extern "C" fn bolide_println() {
-    println!();
+    with_out(|out| out.end_line());
 }
 
 /// 打印整数不换行
 #[no_mangle]
 pub extern "C" fn bolide_print_int_inline(value: i64) {
-    print!("{}", value);
+    with_out(|out| {
+        out.push_int(value);
+        out.maybe_flush();
+    });
 }
 
 /// 打印浮点数不换行
 #[no_mangle]
 pub extern "C" fn bolide_print_float_inline(value: f64) {
-    print!("{}", value);
+    with_out(|out| {
+        out.push_float(value);
+        out.maybe_flush();
+    });
 }
 
 // ==================== 输入函数 ====================
@@ -97,7 +305,8 @@ pub extern "C" fn bolide_print_float_inline(value: f64) {
 /// 读取用户输入（无提示）
 #[no_mangle]
 pub extern "C" fn bolide_input() -> *mut BolideString {
-    use std::io::{self, BufRead, Write};
+    use std::io::{self, BufRead};
+    bolide_print_flush();
     io::stdout().flush().ok();
     let mut input = String::new();
     io::stdin().lock().read_line(&mut input).ok();
@@ -109,14 +318,95 @@ pub extern "C" fn bolide_input() -> *mut BolideString {
 /// 读取用户输入（带提示）
 #[no_mangle]
 pub extern "C" fn bolide_input_prompt(prompt: *const BolideString) -> *mut BolideString {
-    use std::io::{self, BufRead, Write};
+    use std::io::{self, BufRead};
     if !prompt.is_null() {
         let prompt_str = unsafe { &*prompt };
-        print!("{}", prompt_str.as_str());
-        io::stdout().flush().ok();
+        with_out(|out| out.push_bytes(prompt_str.as_bytes()));
     }
+    bolide_print_flush();
+    io::stdout().flush().ok();
     let mut input = String::new();
     io::stdin().lock().read_line(&mut input).ok();
     let trimmed = input.trim_end_matches(&['\r', '\n'][..]);
     BolideString::new(trimmed)
 }
+
+// ==================== 测试 ====================
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_push_int() {
+        let mut out = OutBuf { buf: Vec::new() };
+        for value in [0, 7, -7, 1234567890, i64::MAX, i64::MIN] {
+            out.buf.clear();
+            out.push_int(value);
+            assert_eq!(out.buf, value.to_string().into_bytes());
+        }
+        out.buf.clear();
+    }
+
+    #[test]
+    fn test_push_float_matches_display() {
+        let mut out = OutBuf { buf: Vec::new() };
+        for value in [0.0, 1.5, -2.25, 4.0, 1e300, f64::NAN] {
+            out.buf.clear();
+            out.push_float(value);
+            assert_eq!(out.buf, format!("{}", value).into_bytes());
+        }
+        out.buf.clear();
+    }
+
+    extern "C" fn print_in_thread() -> i64 {
+        bolide_print_int(70_002);
+        0
+    }
+
+    extern "C" fn print_in_coroutine() -> i64 {
+        bolide_print_int(70_004);
+        0
+    }
+
+    static CHANNEL: std::sync::atomic::AtomicPtr<crate::BolideChannel> =
+        std::sync::atomic::AtomicPtr::new(std::ptr::null_mut());
+
+    extern "C" fn recv_then_print() -> i64 {
+        let v = crate::bolide_channel_recv(CHANNEL.load(std::sync::atomic::Ordering::SeqCst));
+        bolide_print_int(v + 1);
+        0
+    }
+
+    #[test]
+    fn test_pipe_mode_keeps_cross_thread_order() {
+        *CAPTURE.lock().unwrap() = Some(Vec::new());
+
+        bolide_print_int(70_001);
+        let t = crate::bolide_thread_spawn_int(print_in_thread);
+        crate::bolide_thread_join_int(t);
+        crate::bolide_thread_handle_free(t);
+
+        bolide_print_int(70_003);
+        let f = crate::bolide_coroutine_spawn_int(print_in_coroutine);
+        crate::bolide_coroutine_await_int(f);
+        crate::bolide_coroutine_free(f);
+
+        CHANNEL.store(crate::bolide_channel_create(), std::sync::atomic::Ordering::SeqCst);
+        let t = crate::bolide_thread_spawn_int(recv_then_print);
+        bolide_print_int(70_005);
+        crate::bolide_channel_send(CHANNEL.load(std::sync::atomic::Ordering::SeqCst), 70_005);
+        crate::bolide_thread_join_int(t);
+        crate::bolide_thread_handle_free(t);
+
+        bolide_print_int(70_007);
+        bolide_print_flush();
+
+        let captured = CAPTURE.lock().unwrap().take().unwrap();
+        let lines: Vec<&str> = std::str::from_utf8(&captured).unwrap()
+            .lines()
+            .filter(|l| l.starts_with("700"))
+            .collect();
+        assert_eq!(lines, ["70001", "70002", "70003", "70004", "70005", "70006", "70007"]);
+    }
+}
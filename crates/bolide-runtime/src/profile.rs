@@ -0,0 +1,192 @@
+//! 性能剖析：`--profile` 编译模式的计数器与报告
+//!
+//! - 函数计数：编译器在每个函数入口调用 `bolide_profile_enter(slot)` 记录一次调用并取得起始时间戳，
+//!   每个返回点调用 `bolide_profile_exit(slot, start)` 累加耗时（包含被调函数，递归调用会重复计入）
+//! - 运行时计数：分配、引用计数增减、通道收发、线程/任务创建。剖析未开启时每处只多一次 Relaxed 读
+//! - main 入口调用 `bolide_profile_begin` 注册函数名表并开启计数，进程退出时把报告打印到 stderr
+//!
+//! 时间戳在 x86_64 上是 rdtsc 周期数，报告时按整段运行的墙钟时间换算成毫秒；其他平台直接用纳秒。
+
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::{Once, OnceLock};
+use std::time::Instant;
+
+/// 运行时事件计数器
+pub(crate) struct Counters {
+    pub(crate) allocs: AtomicU64,
+    pub(crate) retains: AtomicU64,
+    pub(crate) releases: AtomicU64,
+    pub(crate) channel_ops: AtomicU64,
+    pub(crate) spawns: AtomicU64,
+}
+
+pub(crate) static COUNTERS: Counters = Counters {
+    allocs: AtomicU64::new(0),
+    retains: AtomicU64::new(0),
+    releases: AtomicU64::new(0),
+    channel_ops: AtomicU64::new(0),
+    spawns: AtomicU64::new(0),
+};
+
+/// 是否已开启剖析
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// 剖析开启时计数一次
+#[inline]
+pub(crate) fn count(counter: &AtomicU64) {
+    if ENABLED.load(Ordering::Relaxed) {
+        counter.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// 单个函数的统计
+struct FuncStats {
+    calls: AtomicU64,
+    ticks: AtomicU64,
+}
+
+/// 一次运行的剖析状态（由 bolide_profile_begin 创建）
+struct Profile {
+    names: Vec<String>,
+    funcs: Box<[FuncStats]>,
+    start_ticks: u64,
+    start_time: Instant,
+}
+
+static PROFILE: OnceLock<Profile> = OnceLock::new();
+
+/// 当前时间戳
+#[inline]
+fn now_ticks() -> u64 {
+    #[cfg(target_arch = "x86_64")]
+    {
+        unsafe { std::arch::x86_64::_rdtsc() }
+    }
+    #[cfg(not(target_arch = "x86_64"))]
+    {
+        static EPOCH: OnceLock<Instant> = OnceLock::new();
+        EPOCH.get_or_init(Instant::now).elapsed().as_nanos() as u64
+    }
+}
+
+/// 开始剖析：names 是以换行分隔的函数名表，第 i 行对应槽位 i
+///
+/// 重复调用只有第一次生效。
+#[no_mangle]
+pub extern "C" fn bolide_profile_begin(names: *const u8, len: i64) {
+    let names = if names.is_null() || len <= 0 {
+        Vec::new()
+    } else {
+        let bytes = unsafe { std::slice::from_raw_parts(names, len as usize) };
+        String::from_utf8_lossy(bytes).split('\n').map(str::to_string).collect()
+    };
+    let mut created = false;
+    PROFILE.get_or_init(|| {
+        created = true;
+        let funcs = names.iter()
+            .map(|_| FuncStats { calls: AtomicU64::new(0), ticks: AtomicU64::new(0) })
+            .collect();
+        Profile { names, funcs, start_ticks: now_ticks(), start_time: Instant::now() }
+    });
+    if created {
+        ENABLED.store(true, Ordering::Relaxed);
+        register_exit_report();
+    }
+}
+
+/// 函数入口：记录一次调用，返回起始时间戳
+#[no_mangle]
+pub extern "C" fn bolide_profile_enter(slot: i64) -> i64 {
+    if let Some(stats) = PROFILE.get().and_then(|p| p.funcs.get(slot as usize)) {
+        stats.calls.fetch_add(1, Ordering::Relaxed);
+    }
+    now_ticks() as i64
+}
+
+/// 函数返回：累加从 start 到现在的耗时
+#[no_mangle]
+pub extern "C" fn bolide_profile_exit(slot: i64, start: i64) {
+    let end = now_ticks();
+    if let Some(stats) = PROFILE.get().and_then(|p| p.funcs.get(slot as usize)) {
+        stats.ticks.fetch_add(end.wrapping_sub(start as u64), Ordering::Relaxed);
+    }
+}
+
+fn register_exit_report() {
+    static REGISTER: Once = Once::new();
+    REGISTER.call_once(|| {
+        extern "C" {
+            fn atexit(callback: extern "C" fn()) -> i32;
+        }
+        extern "C" fn report_at_exit() {
+            bolide_profile_report();
+        }
+        unsafe { atexit(report_at_exit); }
+    });
+}
+
+/// 把剖析报告打印到 stderr（只打印一次，进程退出时自动调用）
+#[no_mangle]
+pub extern "C" fn bolide_profile_report() {
+    static REPORTED: AtomicBool = AtomicBool::new(false);
+    let Some(profile) = PROFILE.get() else { return };
+    if REPORTED.swap(true, Ordering::Relaxed) {
+        return;
+    }
+    // 先刷出程序输出，报告跟在后面
+    crate::bolide_print_flush();
+
+    let elapsed = profile.start_time.elapsed();
+    let ticks = now_ticks().wrapping_sub(profile.start_ticks).max(1);
+    let ns_per_tick = elapsed.as_nanos() as f64 / ticks as f64;
+    let total_ms = elapsed.as_secs_f64() * 1e3;
+
+    let mut rows: Vec<(&str, u64, f64)> = profile.names.iter().zip(profile.funcs.iter())
+        .map(|(name, stats)| {
+            let calls = stats.calls.load(Ordering::Relaxed);
+            let ms = stats.ticks.load(Ordering::Relaxed) as f64 * ns_per_tick / 1e6;
+            (name.as_str(), calls, ms)
+        })
+        .filter(|&(_, calls, _)| calls > 0)
+        .collect();
+    rows.sort_by(|a, b| b.2.total_cmp(&a.2));
+
+    eprintln!("[Profile] total: {:.3} ms", total_ms);
+    eprintln!("[Profile] {:<32} {:>12} {:>12} {:>12} {:>7}", "function", "calls", "total ms", "avg us", "%");
+    for (name, calls, ms) in rows {
+        let avg_us = ms * 1e3 / calls as f64;
+        let percent = if total_ms > 0.0 { ms / total_ms * 100.0 } else { 0.0 };
+        eprintln!("[Profile] {:<32} {:>12} {:>12.3} {:>12.3} {:>6.1}%", name, calls, ms, avg_us, percent);
+    }
+    let c = &COUNTERS;
+    eprintln!("[Profile] allocs: {}, retains: {}, releases: {}, channel ops: {}, spawns: {}",
+        c.allocs.load(Ordering::Relaxed), c.retains.load(Ordering::Relaxed),
+        c.releases.load(Ordering::Relaxed), c.channel_ops.load(Ordering::Relaxed),
+        c.spawns.load(Ordering::Relaxed));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_profile_slots() {
+        let names = "main\nfib";
+        bolide_profile_begin(names.as_ptr(), names.len() as i64);
+        let start = bolide_profile_enter(1);
+        bolide_profile_exit(1, start);
+        bolide_profile_enter(1);
+        // 越界槽位直接忽略
+        let start = bolide_profile_enter(9);
+        bolide_profile_exit(9, start);
+
+        let profile = PROFILE.get().unwrap();
+        assert_eq!(profile.names, ["main", "fib"]);
+        assert_eq!(profile.funcs[0].calls.load(Ordering::Relaxed), 0);
+        assert_eq!(profile.funcs[1].calls.load(Ordering::Relaxed), 2);
+
+        let before = COUNTERS.spawns.load(Ordering::Relaxed);
+        count(&COUNTERS.spawns);
+        assert!(COUNTERS.spawns.load(Ordering::Relaxed) > before);
+    }
+}
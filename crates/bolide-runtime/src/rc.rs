@@ -5,8 +5,15 @@
 //! - 弱引用 (BolideWeak): 不持有对象，用于打破循环引用
 //!
 //! spawn 使用 move 语义：传入数据后原变量失效
+//!
+//! 计数默认是普通读写（线程内对象）。编译器对跨线程传递的值（spawn / async 参数、
+//! 通道发送的值）调用 `bolide_value_mark_shared`（类对象用 `object_mark_shared`）
+//! 打上 SHARED 标志，之后该对象及其包含的对象改用原子指令增减计数。
+//! 之后存入已共享的列表/字典/对象字段的值在存入时标记；spawn 函数直接访问的
+//! 全局变量不经过参数，由编译器在赋值时标记。
 
 use std::cell::Cell;
+use std::sync::atomic::{fence, AtomicU32, AtomicU8, Ordering};
 use std::marker::PhantomData;
 use std::os::raw::c_void;
 use std::ptr::NonNull;
@@ -55,6 +62,7 @@ pub struct RcHeader {
     /// 标志位
     /// - bit 0: 是否已标记为待释放
     /// - bit 1: 是否被 spawn move
+    /// - bit 2: 是否跨线程共享（计数使用原子指令）
     pub flags: Cell<u8>,
     /// 填充对齐
     _padding: [u8; 6],
@@ -64,6 +72,77 @@ pub struct RcHeader {
 pub mod flags {
     pub const DROPPING: u8 = 0b0000_0001;
     pub const MOVED: u8 = 0b0000_0010;
+    pub const SHARED: u8 = 0b0000_0100;
+}
+
+/// 对象头字段偏移，编译器据此生成内联的计数增减（各类型对象头与 RcHeader 布局相同）
+pub const RC_STRONG_OFFSET: i32 = std::mem::offset_of!(RcHeader, strong_count) as i32;
+pub const RC_FLAGS_OFFSET: i32 = std::mem::offset_of!(RcHeader, flags) as i32;
+
+// ==================== 计数操作（线程内 / 共享） ====================
+//
+// 各类型的对象头（string/list/dict/...）与 RcHeader 布局相同，统一通过这些函数增减
+// 计数：未共享的对象走普通读写，共享对象把同一块内存当作原子量操作。
+
+#[inline]
+fn atomic_u32(cell: &Cell<u32>) -> &AtomicU32 {
+    unsafe { &*(cell.as_ptr() as *const AtomicU32) }
+}
+
+#[inline]
+fn atomic_u8(cell: &Cell<u8>) -> &AtomicU8 {
+    unsafe { &*(cell.as_ptr() as *const AtomicU8) }
+}
+
+/// 对象是否已跨线程共享
+#[inline]
+pub(crate) fn is_shared(f: &Cell<u8>) -> bool {
+    atomic_u8(f).load(Ordering::Relaxed) & flags::SHARED != 0
+}
+
+/// 设置共享标志，返回是否为首次设置
+#[inline]
+pub(crate) fn mark_shared(f: &Cell<u8>) -> bool {
+    atomic_u8(f).fetch_or(flags::SHARED, Ordering::Relaxed) & flags::SHARED == 0
+}
+
+#[inline]
+pub(crate) fn count_inc(count: &Cell<u32>, f: &Cell<u8>) {
+    crate::profile::count(&crate::profile::COUNTERS.retains);
+    if is_shared(f) {
+        atomic_u32(count).fetch_add(1, Ordering::Relaxed);
+    } else {
+        count.set(count.get() + 1);
+    }
+}
+
+/// 减少计数，返回是否归零
+#[inline]
+pub(crate) fn count_dec(count: &Cell<u32>, f: &Cell<u8>) -> bool {
+    crate::profile::count(&crate::profile::COUNTERS.releases);
+    if is_shared(f) {
+        if atomic_u32(count).fetch_sub(1, Ordering::Release) == 1 {
+            // 保证其他线程对对象的写入在释放前可见
+            fence(Ordering::Acquire);
+            true
+        } else {
+            false
+        }
+    } else {
+        let c = count.get();
+        debug_assert!(c > 0, "refcount underflow");
+        count.set(c - 1);
+        c == 1
+    }
+}
+
+#[inline]
+pub(crate) fn count_get(count: &Cell<u32>, f: &Cell<u8>) -> u32 {
+    if is_shared(f) {
+        atomic_u32(count).load(Ordering::Acquire)
+    } else {
+        count.get()
+    }
 }
 
 impl RcHeader {
@@ -82,53 +161,57 @@ impl RcHeader {
     /// 增加强引用计数
     #[inline]
     pub fn inc_strong(&self) {
-        let count = self.strong_count.get();
-        debug_assert!(count > 0, "inc_strong on dropped object");
-        self.strong_count.set(count + 1);
+        debug_assert!(self.strong_count() > 0, "inc_strong on dropped object");
+        count_inc(&self.strong_count, &self.flags);
     }
 
     /// 减少强引用计数，返回是否应该释放数据
     #[inline]
     pub fn dec_strong(&self) -> bool {
-        let count = self.strong_count.get();
-        debug_assert!(count > 0, "dec_strong underflow");
-        self.strong_count.set(count - 1);
-        count == 1
+        count_dec(&self.strong_count, &self.flags)
     }
 
     /// 获取强引用计数
     #[inline]
     pub fn strong_count(&self) -> u32 {
-        self.strong_count.get()
+        count_get(&self.strong_count, &self.flags)
     }
 
     /// 增加弱引用计数
     #[inline]
     pub fn inc_weak(&self) {
-        let count = self.weak_count.get();
-        self.weak_count.set(count + 1);
+        count_inc(&self.weak_count, &self.flags);
     }
 
     /// 减少弱引用计数，返回是否应该释放头部
     #[inline]
     pub fn dec_weak(&self) -> bool {
-        let count = self.weak_count.get();
-        debug_assert!(count > 0, "dec_weak underflow");
-        self.weak_count.set(count - 1);
-        count == 1
+        count_dec(&self.weak_count, &self.flags)
     }
 
     /// 获取弱引用计数
     #[inline]
     pub fn weak_count(&self) -> u32 {
         // 返回实际弱引用数（减去隐式的 1）
-        self.weak_count.get() - if self.strong_count.get() > 0 { 1 } else { 0 }
+        count_get(&self.weak_count, &self.flags) - if self.is_alive() { 1 } else { 0 }
     }
 
     /// 检查对象是否仍然存活
     #[inline]
     pub fn is_alive(&self) -> bool {
-        self.strong_count.get() > 0
+        self.strong_count() > 0
+    }
+
+    /// 标记为跨线程共享，之后计数改用原子指令
+    #[inline]
+    pub fn mark_shared(&self) -> bool {
+        mark_shared(&self.flags)
+    }
+
+    /// 检查是否跨线程共享
+    #[inline]
+    pub fn is_shared(&self) -> bool {
+        is_shared(&self.flags)
     }
 
     /// 标记为已 move（spawn 使用）
@@ -359,11 +442,7 @@ pub extern "C" fn bolide_rc_release(ptr: BolideRcPtr, type_tag: u8) {
             // 减少隐式弱引用
             if header.dec_weak() {
                 // 释放头部
-                let layout = std::alloc::Layout::from_size_align(
-                    std::mem::size_of::<RcHeader>() + get_type_size(type_tag),
-                    16
-                ).unwrap();
-                std::alloc::dealloc(header_ptr as *mut u8, layout);
+                crate::slab::free(header_ptr as *mut u8, alloc_size(header, type_tag));
             }
         }
     }
@@ -411,11 +490,7 @@ pub extern "C" fn bolide_weak_release(ptr: BolideWeakPtr, type_tag: u8) {
 
         if header.dec_weak() {
             // 释放头部
-            let layout = std::alloc::Layout::from_size_align(
-                std::mem::size_of::<RcHeader>() + get_type_size(type_tag),
-                16
-            ).unwrap();
-            std::alloc::dealloc(header_ptr as *mut u8, layout);
+            crate::slab::free(header_ptr as *mut u8, alloc_size(header, type_tag));
         }
     }
 }
@@ -468,6 +543,45 @@ pub extern "C" fn bolide_rc_mark_moved(ptr: BolideRcPtr) {
     }
 }
 
+/// 标记 bolide_rc_alloc 分配的对象为跨线程共享
+#[no_mangle]
+pub extern "C" fn bolide_rc_mark_shared(ptr: BolideRcPtr) {
+    if ptr.is_null() {
+        return;
+    }
+    unsafe {
+        let header = &*((ptr as *mut RcHeader).sub(1));
+        header.mark_shared();
+    }
+}
+
+/// 标记运行时值（string/bigint/decimal/list/dict/dynamic，对象头在指针处）为跨线程共享
+///
+/// 容器会递归标记其中的 RC 元素；已经标记过的对象直接返回，因此循环引用也只访问一次。
+/// 类实例没有 RcHeader，由 object.rs 的 `object_mark_shared` 沿字段布局表调用这里；
+/// 内联小整数 bigint（指针最低位为 1）和 dynamic 立即数（低 3 位非 0）没有对象头。
+#[no_mangle]
+pub extern "C" fn bolide_value_mark_shared(ptr: *mut c_void) {
+    if ptr.is_null() || ptr as usize & crate::dynamic::DYNAMIC_TAG_MASK as usize != 0 {
+        return;
+    }
+    unsafe {
+        let header = &*(ptr as *const RcHeader);
+        if !header.mark_shared() {
+            return;
+        }
+        match header.type_tag {
+            // 借用字符串的缓冲区在 as_cstr 时会被原地替换，共享前先复制成自有的
+            TypeTag::String => (*(ptr as *mut crate::BolideString)).make_owned(),
+            TypeTag::List => (*(ptr as *mut crate::BolideList)).mark_elements_shared(),
+            TypeTag::Dict => (*(ptr as *mut crate::dict::BolideDict)).mark_entries_shared(),
+            // dynamic 值的对象头使用 Object 标签
+            TypeTag::Object => (*(ptr as *mut crate::dynamic::BolideDynamic)).mark_inner_shared(),
+            _ => {}
+        }
+    }
+}
+
 // ==================== 内部辅助函数 ====================
 
 /// 根据类型标签释放数据
@@ -491,6 +605,16 @@ unsafe fn drop_by_type(ptr: *mut c_void, type_tag: u8) {
     }
 }
 
+/// bolide_rc_alloc 记录的分配大小；没有记录时按类型估算
+fn alloc_size(header: &RcHeader, type_tag: u8) -> usize {
+    let mut recorded = [0u8; 4];
+    recorded.copy_from_slice(&header._padding[..4]);
+    match u32::from_ne_bytes(recorded) {
+        0 => std::mem::size_of::<RcHeader>() + get_type_size(type_tag),
+        size => size as usize,
+    }
+}
+
 /// 获取类型的数据大小
 fn get_type_size(type_tag: u8) -> usize {
     match type_tag {
@@ -512,22 +636,25 @@ pub extern "C" fn bolide_rc_alloc(size: i64, type_tag: u8) -> BolideRcPtr {
     }
 
     let total_size = std::mem::size_of::<RcHeader>() + size as usize;
-    let layout = std::alloc::Layout::from_size_align(total_size, 16).unwrap();
 
     unsafe {
-        let ptr = std::alloc::alloc(layout);
+        let ptr = crate::slab::alloc(total_size);
         if ptr.is_null() {
             return std::ptr::null_mut();
         }
 
-        // 初始化头部
+        // 初始化头部，填充区记录分配大小（释放时按同样大小归还 slab）
         let header = ptr as *mut RcHeader;
+        let mut padding = [0u8; 6];
+        if let Ok(recorded) = u32::try_from(total_size) {
+            padding[..4].copy_from_slice(&recorded.to_ne_bytes());
+        }
         std::ptr::write(header, RcHeader {
             strong_count: Cell::new(1),
             weak_count: Cell::new(1),
             type_tag: std::mem::transmute(type_tag),
             flags: Cell::new(0),
-            _padding: [0; 6],
+            _padding: padding,
         });
 
         // 返回数据部分的指针
@@ -565,6 +692,32 @@ mod tests {
         assert!(weak.upgrade().is_none());
     }
 
+    #[test]
+    fn test_shared_counts() {
+        let rc = BolideRc::new(7i64, TypeTag::BigInt);
+        assert!(!rc.header().is_shared());
+        assert!(rc.header().mark_shared());
+        assert!(!rc.header().mark_shared());
+
+        let clones: Vec<_> = (0..4)
+            .map(|_| {
+                let cloned = rc.clone();
+                let addr = cloned.as_ptr() as usize;
+                std::mem::forget(cloned);
+                std::thread::spawn(move || {
+                    let local = unsafe { BolideRc::from_ptr(addr as *mut i64) };
+                    for _ in 0..1000 {
+                        drop(local.clone());
+                    }
+                })
+            })
+            .collect();
+        for t in clones {
+            t.join().unwrap();
+        }
+        assert_eq!(rc.strong_count(), 1);
+    }
+
     #[test]
     fn test_move_flag() {
         let rc = BolideRc::new(999i64, TypeTag::BigInt);
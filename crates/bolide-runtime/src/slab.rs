@@ -0,0 +1,623 @@
+//! 小对象分配器
+//!
+//! 运行时对象（string/list/dict/bigint/decimal/dynamic、bolide_rc_alloc 与类实例）
+//! 体积小、分配频繁，统一走这里：
+//! - 按大小分级（16..256 字节），每个线程持有各级的空闲链表，分配/释放不加锁
+//! - 内存以 64 KiB 对齐的 chunk 为单位向系统申请，chunk 头部记录类型
+//! - 超过 256 字节的请求直接交给系统分配器
+//! - arena 模式：`bolide_arena_enter` 之后的分配在当前 chunk 上顺序切分，释放只减少
+//!   chunk 的存活计数；arena 退出且计数归零时整个 chunk 被回收复用。
+//!   逃出 arena 的对象仍然有效，只是会让所在 chunk 晚些回收
+//!
+//! 释放时必须传入与分配时相同的大小，用于区分小对象与系统分配的大对象。
+//! 在其他线程释放的块进入释放线程的空闲链表；本地链表超过 `SPILL_BYTES` 时多出的部分、
+//! 以及线程退出时的整条链表交给全局，分配线程的本地链表用尽时会先接手这些块。
+//! slab chunk 不归还给系统。
+
+use std::alloc::{alloc as sys_alloc, dealloc as sys_dealloc, handle_alloc_error, Layout};
+use std::cell::UnsafeCell;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex};
+
+use once_cell::sync::Lazy;
+
+/// chunk 大小（同时也是对齐）
+const CHUNK_SIZE: usize = 64 * 1024;
+/// chunk 头部占用（保持块 16 字节对齐）
+const CHUNK_HEADER: usize = 64;
+/// 块对齐
+const ALIGN: usize = 16;
+/// 由分级池处理的最大请求
+pub(crate) const MAX_SMALL: usize = 256;
+/// 分级大小
+const CLASS_SIZES: [usize; NUM_CLASSES] = [16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256];
+const NUM_CLASSES: usize = 12;
+/// 单级本地空闲链表的上限（字节）；超过时把较旧的一半交给全局，
+/// 否则生产者/消费者线程间的释放会让消费者的链表无限增长
+const SPILL_BYTES: usize = 256 * 1024;
+
+const KIND_SLAB: usize = 1;
+const KIND_ARENA: usize = 2;
+
+#[repr(C)]
+struct ChunkHeader {
+    kind: usize,
+    /// arena chunk 的存活块数（+1 表示 arena 仍在使用）
+    live: AtomicUsize,
+}
+
+#[repr(C)]
+struct FreeNode {
+    next: *mut FreeNode,
+}
+
+#[inline]
+fn class_index(size: usize) -> usize {
+    if size <= 128 {
+        (size.max(1) + 15) / 16 - 1
+    } else {
+        8 + (size - 129) / 32
+    }
+}
+
+#[inline]
+fn spill_limit(class: usize) -> usize {
+    SPILL_BYTES / CLASS_SIZES[class]
+}
+
+#[inline]
+fn chunk_of(ptr: *mut u8) -> *mut ChunkHeader {
+    (ptr as usize & !(CHUNK_SIZE - 1)) as *mut ChunkHeader
+}
+
+#[inline]
+fn large_layout(size: usize) -> Layout {
+    Layout::from_size_align(size, ALIGN).unwrap()
+}
+
+// ==================== 统计 ====================
+
+/// 单个线程池的计数（只由所属线程写入，读取方汇总）
+struct PoolStats {
+    allocs: [AtomicU64; NUM_CLASSES],
+    frees: [AtomicU64; NUM_CLASSES],
+    large_allocs: AtomicU64,
+    large_frees: AtomicU64,
+    arena_allocs: AtomicU64,
+    chunks: AtomicU64,
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+impl PoolStats {
+    const fn new() -> Self {
+        Self {
+            allocs: [ZERO; NUM_CLASSES],
+            frees: [ZERO; NUM_CLASSES],
+            large_allocs: ZERO,
+            large_frees: ZERO,
+            arena_allocs: ZERO,
+            chunks: ZERO,
+        }
+    }
+
+    /// 所属线程独占写入，不需要原子读改写
+    #[inline]
+    fn bump(counter: &AtomicU64) {
+        counter.store(counter.load(Ordering::Relaxed) + 1, Ordering::Relaxed);
+    }
+
+    fn fold_into(&self, totals: &mut StatsTotals) {
+        for i in 0..NUM_CLASSES {
+            totals.allocs[i] += self.allocs[i].load(Ordering::Relaxed);
+            totals.frees[i] += self.frees[i].load(Ordering::Relaxed);
+        }
+        totals.large_allocs += self.large_allocs.load(Ordering::Relaxed);
+        totals.large_frees += self.large_frees.load(Ordering::Relaxed);
+        totals.arena_allocs += self.arena_allocs.load(Ordering::Relaxed);
+        totals.chunks += self.chunks.load(Ordering::Relaxed);
+    }
+}
+
+#[derive(Default, Clone)]
+struct StatsTotals {
+    allocs: [u64; NUM_CLASSES],
+    frees: [u64; NUM_CLASSES],
+    large_allocs: u64,
+    large_frees: u64,
+    arena_allocs: u64,
+    chunks: u64,
+}
+
+/// 各线程的统计；退出的线程折算进 retired
+struct StatsRegistry {
+    live: Vec<Arc<PoolStats>>,
+    retired: StatsTotals,
+}
+
+static REGISTRY: Lazy<Mutex<StatsRegistry>> = Lazy::new(|| {
+    Mutex::new(StatsRegistry { live: Vec::new(), retired: StatsTotals::default() })
+});
+
+/// 线程局部池不可用时（线程析构阶段）的计数，多个线程可能同时写入
+static GLOBAL_STATS: PoolStats = PoolStats::new();
+
+// ==================== 全局共享部分 ====================
+
+/// 退出线程留下或本地溢出的空闲链表（按级别，每项是一条链的头和长度）
+struct Orphans {
+    chains: [Vec<(usize, usize)>; NUM_CLASSES],
+}
+
+static ORPHANS: Lazy<Mutex<Orphans>> = Lazy::new(|| {
+    Mutex::new(Orphans { chains: Default::default() })
+});
+
+/// 已回收的 arena chunk，可再次作为任意类型的 chunk 使用
+static FREE_CHUNKS: Mutex<Vec<usize>> = Mutex::new(Vec::new());
+
+/// 申请一个新 chunk（优先复用已回收的）
+fn new_chunk(kind: usize) -> *mut ChunkHeader {
+    let recycled = FREE_CHUNKS.lock().unwrap().pop();
+    let chunk = match recycled {
+        Some(addr) => addr as *mut ChunkHeader,
+        None => {
+            let layout = Layout::from_size_align(CHUNK_SIZE, CHUNK_SIZE).unwrap();
+            let ptr = unsafe { sys_alloc(layout) };
+            if ptr.is_null() {
+                handle_alloc_error(layout);
+            }
+            ptr as *mut ChunkHeader
+        }
+    };
+    unsafe {
+        std::ptr::write(chunk, ChunkHeader { kind, live: AtomicUsize::new(1) });
+    }
+    chunk
+}
+
+/// 减少 arena chunk 的存活计数，归零时回收
+#[inline]
+unsafe fn arena_chunk_release(chunk: *mut ChunkHeader) {
+    if (*chunk).live.fetch_sub(1, Ordering::AcqRel) == 1 {
+        FREE_CHUNKS.lock().unwrap().push(chunk as usize);
+    }
+}
+
+/// 把一整个 chunk 切成某一级的空闲链表
+unsafe fn carve_chunk(chunk: *mut ChunkHeader, class: usize) -> *mut FreeNode {
+    let size = CLASS_SIZES[class];
+    let base = chunk as *mut u8;
+    let mut head: *mut FreeNode = std::ptr::null_mut();
+    let mut offset = CHUNK_HEADER + (CHUNK_SIZE - CHUNK_HEADER) / size * size;
+    while offset > CHUNK_HEADER {
+        offset -= size;
+        let node = base.add(offset) as *mut FreeNode;
+        (*node).next = head;
+        head = node;
+    }
+    head
+}
+
+/// 线程局部池不可用时的分配：从全局链表取，或者切一个新 chunk
+unsafe fn global_alloc(class: usize) -> *mut u8 {
+    let mut orphans = ORPHANS.lock().unwrap();
+    let (head, len) = match orphans.chains[class].pop() {
+        Some((addr, len)) => (addr as *mut FreeNode, len),
+        None => {
+            GLOBAL_STATS.chunks.fetch_add(1, Ordering::Relaxed);
+            let size = CLASS_SIZES[class];
+            (carve_chunk(new_chunk(KIND_SLAB), class), (CHUNK_SIZE - CHUNK_HEADER) / size)
+        }
+    };
+    let next = (*head).next;
+    if !next.is_null() {
+        orphans.chains[class].push((next as usize, len - 1));
+    }
+    GLOBAL_STATS.allocs[class].fetch_add(1, Ordering::Relaxed);
+    head as *mut u8
+}
+
+unsafe fn global_free(ptr: *mut u8, class: usize) {
+    let node = ptr as *mut FreeNode;
+    (*node).next = std::ptr::null_mut();
+    ORPHANS.lock().unwrap().chains[class].push((node as usize, 1));
+    GLOBAL_STATS.frees[class].fetch_add(1, Ordering::Relaxed);
+}
+
+// ==================== 线程局部池 ====================
+
+struct Pool {
+    free: [*mut FreeNode; NUM_CLASSES],
+    free_len: [usize; NUM_CLASSES],
+    /// 当前 slab chunk 中尚未切分的区域
+    bump: *mut u8,
+    bump_end: *mut u8,
+    /// arena 嵌套深度与当前 arena chunk
+    arena_depth: u32,
+    arena_chunk: *mut ChunkHeader,
+    arena_bump: *mut u8,
+    arena_end: *mut u8,
+    stats: Arc<PoolStats>,
+}
+
+impl Pool {
+    fn new() -> Self {
+        let stats = Arc::new(PoolStats::new());
+        REGISTRY.lock().unwrap().live.push(stats.clone());
+        Self {
+            free: [std::ptr::null_mut(); NUM_CLASSES],
+            free_len: [0; NUM_CLASSES],
+            bump: std::ptr::null_mut(),
+            bump_end: std::ptr::null_mut(),
+            arena_depth: 0,
+            arena_chunk: std::ptr::null_mut(),
+            arena_bump: std::ptr::null_mut(),
+            arena_end: std::ptr::null_mut(),
+            stats,
+        }
+    }
+
+    #[inline]
+    unsafe fn alloc(&mut self, class: usize) -> *mut u8 {
+        if self.arena_depth > 0 {
+            return self.arena_alloc(class);
+        }
+        PoolStats::bump(&self.stats.allocs[class]);
+        let head = self.free[class];
+        if !head.is_null() {
+            self.free[class] = (*head).next;
+            self.free_len[class] -= 1;
+            return head as *mut u8;
+        }
+        self.alloc_slow(class)
+    }
+
+    #[cold]
+    unsafe fn alloc_slow(&mut self, class: usize) -> *mut u8 {
+        // 先接手其他线程留下的空闲链表
+        if let Some((addr, len)) = ORPHANS.lock().unwrap().chains[class].pop() {
+            let head = addr as *mut FreeNode;
+            self.free[class] = (*head).next;
+            self.free_len[class] = len - 1;
+            return head as *mut u8;
+        }
+        let size = CLASS_SIZES[class];
+        if (self.bump_end as usize) - (self.bump as usize) < size {
+            let chunk = new_chunk(KIND_SLAB);
+            PoolStats::bump(&self.stats.chunks);
+            self.bump = (chunk as *mut u8).add(CHUNK_HEADER);
+            self.bump_end = (chunk as *mut u8).add(CHUNK_SIZE);
+        }
+        let ptr = self.bump;
+        self.bump = ptr.add(size);
+        ptr
+    }
+
+    #[inline]
+    unsafe fn arena_alloc(&mut self, class: usize) -> *mut u8 {
+        let size = CLASS_SIZES[class];
+        if (self.arena_end as usize) - (self.arena_bump as usize) < size {
+            // 旧 chunk 不再切分，交出 arena 持有的那一份计数
+            if !self.arena_chunk.is_null() {
+                arena_chunk_release(self.arena_chunk);
+            }
+            let chunk = new_chunk(KIND_ARENA);
+            PoolStats::bump(&self.stats.chunks);
+            self.arena_chunk = chunk;
+            self.arena_bump = (chunk as *mut u8).add(CHUNK_HEADER);
+            self.arena_end = (chunk as *mut u8).add(CHUNK_SIZE);
+        }
+        PoolStats::bump(&self.stats.arena_allocs);
+        (*self.arena_chunk).live.fetch_add(1, Ordering::Relaxed);
+        let ptr = self.arena_bump;
+        self.arena_bump = ptr.add(size);
+        ptr
+    }
+
+    #[inline]
+    unsafe fn free(&mut self, ptr: *mut u8, class: usize) {
+        let chunk = chunk_of(ptr);
+        if (*chunk).kind == KIND_ARENA {
+            arena_chunk_release(chunk);
+            return;
+        }
+        PoolStats::bump(&self.stats.frees[class]);
+        let node = ptr as *mut FreeNode;
+        (*node).next = self.free[class];
+        self.free[class] = node;
+        self.free_len[class] += 1;
+        if self.free_len[class] > spill_limit(class) {
+            self.spill(class);
+        }
+    }
+
+    /// 保留链表前一半（最近释放、最可能还在缓存里），其余交给全局
+    #[cold]
+    unsafe fn spill(&mut self, class: usize) {
+        let keep = spill_limit(class) / 2;
+        let mut tail = self.free[class];
+        for _ in 1..keep {
+            tail = (*tail).next;
+        }
+        let rest = (*tail).next;
+        (*tail).next = std::ptr::null_mut();
+        ORPHANS.lock().unwrap().chains[class].push((rest as usize, self.free_len[class] - keep));
+        self.free_len[class] = keep;
+    }
+
+    unsafe fn arena_exit(&mut self) {
+        if self.arena_depth == 0 {
+            return;
+        }
+        self.arena_depth -= 1;
+        if self.arena_depth == 0 && !self.arena_chunk.is_null() {
+            arena_chunk_release(self.arena_chunk);
+            self.arena_chunk = std::ptr::null_mut();
+            self.arena_bump = std::ptr::null_mut();
+            self.arena_end = std::ptr::null_mut();
+        }
+    }
+}
+
+impl Drop for Pool {
+    fn drop(&mut self) {
+        unsafe {
+            if !self.arena_chunk.is_null() {
+                arena_chunk_release(self.arena_chunk);
+            }
+            let mut orphans = ORPHANS.lock().unwrap();
+            for (class, head) in self.free.iter().enumerate() {
+                if !head.is_null() {
+                    orphans.chains[class].push((*head as usize, self.free_len[class]));
+                }
+            }
+        }
+        let mut registry = REGISTRY.lock().unwrap();
+        let StatsRegistry { live, retired } = &mut *registry;
+        self.stats.fold_into(retired);
+        live.retain(|s| !Arc::ptr_eq(s, &self.stats));
+    }
+}
+
+thread_local! {
+    static POOL: UnsafeCell<Pool> = UnsafeCell::new(Pool::new());
+}
+
+// ==================== 运行时内部接口 ====================
+
+/// 分配 size 字节（16 字节对齐）
+#[inline]
+pub(crate) fn alloc(size: usize) -> *mut u8 {
+    crate::profile::count(&crate::profile::COUNTERS.allocs);
+    if size > MAX_SMALL {
+        GLOBAL_STATS.large_allocs.fetch_add(1, Ordering::Relaxed);
+        let layout = large_layout(size);
+        let ptr = unsafe { sys_alloc(layout) };
+        if ptr.is_null() {
+            handle_alloc_error(layout);
+        }
+        return ptr;
+    }
+    let class = class_index(size);
+    unsafe {
+        POOL.try_with(|p| (*p.get()).alloc(class))
+            .unwrap_or_else(|_| global_alloc(class))
+    }
+}
+
+/// 释放 alloc 得到的内存，size 必须与分配时一致
+#[inline]
+pub(crate) unsafe fn free(ptr: *mut u8, size: usize) {
+    if ptr.is_null() {
+        return;
+    }
+    if size > MAX_SMALL {
+        GLOBAL_STATS.large_frees.fetch_add(1, Ordering::Relaxed);
+        sys_dealloc(ptr, large_layout(size));
+        return;
+    }
+    let class = class_index(size);
+    if POOL.try_with(|p| (*p.get()).free(ptr, class)).is_err() {
+        let chunk = chunk_of(ptr);
+        if (*chunk).kind == KIND_ARENA {
+            arena_chunk_release(chunk);
+        } else {
+            global_free(ptr, class);
+        }
+    }
+}
+
+/// 调整大小；同一级别内直接返回原指针
+pub(crate) unsafe fn realloc(ptr: *mut u8, old_size: usize, new_size: usize) -> *mut u8 {
+    if ptr.is_null() {
+        return alloc(new_size);
+    }
+    if old_size <= MAX_SMALL && new_size <= MAX_SMALL
+        && class_index(old_size) == class_index(new_size)
+    {
+        return ptr;
+    }
+    if old_size > MAX_SMALL && new_size > MAX_SMALL {
+        GLOBAL_STATS.large_allocs.fetch_add(1, Ordering::Relaxed);
+        GLOBAL_STATS.large_frees.fetch_add(1, Ordering::Relaxed);
+        let new_ptr = std::alloc::realloc(ptr, large_layout(old_size), new_size);
+        if new_ptr.is_null() {
+            handle_alloc_error(large_layout(new_size));
+        }
+        return new_ptr;
+    }
+    let new_ptr = alloc(new_size);
+    std::ptr::copy_nonoverlapping(ptr, new_ptr, old_size.min(new_size));
+    free(ptr, old_size);
+    new_ptr
+}
+
+/// 分配并写入一个值（替代 Box::into_raw(Box::new(v))）
+#[inline]
+pub(crate) fn alloc_value<T>(value: T) -> *mut T {
+    debug_assert!(std::mem::align_of::<T>() <= ALIGN);
+    let ptr = alloc(std::mem::size_of::<T>().max(1)) as *mut T;
+    unsafe { std::ptr::write(ptr, value) };
+    ptr
+}
+
+/// 析构并释放 alloc_value 得到的值
+#[inline]
+pub(crate) unsafe fn free_value<T>(ptr: *mut T) {
+    if ptr.is_null() {
+        return;
+    }
+    std::ptr::drop_in_place(ptr);
+    free(ptr as *mut u8, std::mem::size_of::<T>().max(1));
+}
+
+// ==================== FFI 接口 ====================
+
+/// 进入 arena 模式（可嵌套）：之后当前线程的小对象分配在 arena chunk 上顺序切分
+#[no_mangle]
+pub extern "C" fn bolide_arena_enter() {
+    let _ = POOL.try_with(|p| unsafe { (*p.get()).arena_depth += 1 });
+}
+
+/// 退出 arena 模式：最外层退出后，块全部释放的 chunk 会被回收
+#[no_mangle]
+pub extern "C" fn bolide_arena_exit() {
+    let _ = POOL.try_with(|p| unsafe { (*p.get()).arena_exit() });
+}
+
+fn collect_stats() -> StatsTotals {
+    let registry = REGISTRY.lock().unwrap();
+    let mut totals = registry.retired.clone();
+    for stats in &registry.live {
+        stats.fold_into(&mut totals);
+    }
+    GLOBAL_STATS.fold_into(&mut totals);
+    totals
+}
+
+/// 打印分配器统计（所有线程汇总）
+#[no_mangle]
+pub extern "C" fn bolide_slab_debug_stats() {
+    let totals = collect_stats();
+    for (i, size) in CLASS_SIZES.iter().enumerate() {
+        let (alloc, free) = (totals.allocs[i], totals.frees[i]);
+        if alloc == 0 && free == 0 {
+            continue;
+        }
+        // 跨线程释放时，某个线程的释放数可能多于分配数，只看汇总结果
+        crate::print::out_println!("[Slab Stats] class {}: alloc: {}, free: {}, live: {}",
+            size, alloc, free, alloc as i64 - free as i64);
+    }
+    crate::print::out_println!("[Slab Stats] large: alloc: {}, free: {}, live: {}",
+        totals.large_allocs, totals.large_frees,
+        totals.large_allocs as i64 - totals.large_frees as i64);
+    crate::print::out_println!("[Slab Stats] arena alloc: {}, chunks: {} ({} KiB)",
+        totals.arena_allocs, totals.chunks, totals.chunks * (CHUNK_SIZE as u64 / 1024));
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_class_index() {
+        assert_eq!(class_index(1), 0);
+        assert_eq!(class_index(16), 0);
+        assert_eq!(class_index(17), 1);
+        assert_eq!(class_index(128), 7);
+        assert_eq!(class_index(129), 8);
+        assert_eq!(class_index(256), 11);
+        for size in 1..=MAX_SMALL {
+            assert!(CLASS_SIZES[class_index(size)] >= size);
+        }
+    }
+
+    #[test]
+    fn test_reuse_free_list() {
+        let a = alloc(40);
+        assert_eq!(a as usize % ALIGN, 0);
+        unsafe { free(a, 40) };
+        let b = alloc(48);
+        assert_eq!(a, b);
+        unsafe { free(b, 48) };
+    }
+
+    #[test]
+    fn test_large_and_realloc() {
+        unsafe {
+            let p = alloc(24);
+            *(p as *mut u64) = 0xABCD;
+            let q = realloc(p, 24, 1024);
+            assert_eq!(*(q as *mut u64), 0xABCD);
+            let r = realloc(q, 1024, 8);
+            assert_eq!(*(r as *mut u64), 0xABCD);
+            free(r, 8);
+        }
+    }
+
+    #[test]
+    fn test_arena_recycles_chunk() {
+        bolide_arena_enter();
+        let ptrs: Vec<_> = (0..100).map(|_| alloc(32)).collect();
+        let chunk = chunk_of(ptrs[0]);
+        unsafe { assert_eq!((*chunk).kind, KIND_ARENA) };
+        bolide_arena_exit();
+        // 逃出 arena 的对象依然可用，全部释放后 chunk 被回收
+        let (last, rest) = ptrs.split_last().unwrap();
+        for &p in rest {
+            unsafe {
+                *(p as *mut u64) = 1;
+                free(p, 32);
+            }
+        }
+        unsafe {
+            assert_eq!((*chunk).live.load(Ordering::Acquire), 1);
+            free(*last, 32);
+        }
+    }
+
+    #[test]
+    fn test_cross_thread_free() {
+        let addrs: Vec<usize> = (0..1000).map(|_| alloc(64) as usize).collect();
+        std::thread::spawn(move || {
+            for a in addrs {
+                unsafe { free(a as *mut u8, 64) };
+            }
+        })
+        .join()
+        .unwrap();
+        // 释放线程退出后其空闲链表进入全局，可被再次分配
+        let p = alloc(64);
+        unsafe { free(p, 64) };
+    }
+
+    #[test]
+    fn test_remote_frees_return_to_allocator() {
+        // 生产者分配、消费者释放：消费者溢出的块应回到生产者，chunk 数保持有界
+        let (to_consumer, from_producer) = std::sync::mpsc::channel::<Vec<usize>>();
+        let (ack, acked) = std::sync::mpsc::channel::<()>();
+        let consumer = std::thread::spawn(move || {
+            for batch in from_producer {
+                for a in batch {
+                    unsafe { free(a as *mut u8, 96) };
+                }
+                ack.send(()).unwrap();
+            }
+        });
+        let chunks = std::thread::spawn(move || {
+            for _ in 0..50 {
+                let batch: Vec<usize> = (0..10_000).map(|_| alloc(96) as usize).collect();
+                to_consumer.send(batch).unwrap();
+                acked.recv().unwrap();
+            }
+            POOL.with(|p| unsafe { (*p.get()).stats.clone() }).chunks.load(Ordering::Relaxed)
+        })
+        .join()
+        .unwrap();
+        consumer.join().unwrap();
+        // 没有回流时约需 50 * 10000 * 96 / 64K ≈ 730 个 chunk
+        assert!(chunks < 60, "producer carved {} chunks", chunks);
+    }
+}
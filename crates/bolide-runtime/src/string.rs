@@ -4,27 +4,41 @@
 //! - 创建时 strong_count = 1
 //! - clone 时 strong_count += 1（浅拷贝）
 //! - drop 时 strong_count -= 1，归零时释放
-
-use std::ffi::{CStr, CString};
+//!
+//! 字符缓冲区按 capacity 从 slab 分配（末尾保留 NUL，便于 FFI）。
+//! 借用字符串（`file_read_line` 返回的行）直接指向文件映射/读取块，不以 NUL 结尾，
+//! 通过 owner 持有底层存储的引用；需要原地修改、传给 C 或标记为跨线程共享时
+//! 先复制成自有缓冲区，因此借用字符串只会被所属线程访问。
+//! strong_count 为 1 时 `bolide_string_append` 原地追加；多段拼接由
+//! `BolideStringBuilder` 预留总长度后一次分配完成。
+
+use std::ffi::CStr;
 use std::os::raw::c_char;
 use std::cell::{Cell, RefCell};
 use std::collections::HashMap;
+use std::ops::Range;
+use std::sync::Arc;
+use std::sync::atomic::{AtomicU32, Ordering};
 
 thread_local! {
     // String interner for literals (stores raw pointers with Strong RC=1 owned by interner)
     static STRING_LITERALS: RefCell<HashMap<String, *mut BolideString>> = RefCell::new(HashMap::new());
 }
 
+use crate::file::FileBuffer;
 use crate::rc::{TypeTag, flags};
 
 /// RC 对象头（与 rc.rs 中保持一致）
+///
+/// 字符串把填充区的后 4 字节用作内容哈希缓存（字典键查找用），0 表示尚未计算。
 #[repr(C)]
 struct RcHeader {
     strong_count: Cell<u32>,
     weak_count: Cell<u32>,
     type_tag: TypeTag,
     flags: Cell<u8>,
-    _padding: [u8; 6],
+    _padding: [u8; 2],
+    hash: Cell<u32>,
 }
 
 /// Bolide 字符串类型（带引用计数）
@@ -32,13 +46,15 @@ struct RcHeader {
 /// 内存布局:
 /// ```text
 /// +------------------+
-/// | RcHeader (16B)   |  引用计数头
+/// | RcHeader (16B)   |  引用计数头（含哈希缓存）
 /// +------------------+
-/// | data: *mut char  |  C 字符串指针
+/// | data: *mut char  |  C 字符串指针（自有缓冲区以 NUL 结尾）
 /// +------------------+
 /// | len: usize       |  字符串长度
 /// +------------------+
-/// | capacity: usize  |  分配容量
+/// | capacity: usize  |  缓冲区容量（含 NUL），借用字符串为 0
+/// +------------------+
+/// | owner: *const _  |  借用字符串的底层存储（Arc::into_raw），自有字符串为空
 /// +------------------+
 /// ```
 #[repr(C)]
@@ -47,43 +63,135 @@ pub struct BolideString {
     data: *mut c_char,
     len: usize,
     capacity: usize,
+    owner: *const FileBuffer,
 }
 
+/// 长度字段偏移，编译器据此内联读取字符串长度
+pub const STRING_LEN_OFFSET: i32 = std::mem::offset_of!(BolideString, len) as i32;
+
 impl BolideString {
     /// 创建新字符串（strong_count = 1）
     pub fn new(s: &str) -> *mut Self {
-        let c_string = CString::new(s).unwrap();
-        let len = s.len();
+        Self::from_bytes(s.as_bytes())
+    }
+
+    /// 从字节创建新字符串（调用方保证是合法 UTF-8）
+    fn from_bytes(bytes: &[u8]) -> *mut Self {
+        let len = bytes.len();
+        let data = alloc_buffer(len + 1);
+        unsafe {
+            std::ptr::copy_nonoverlapping(bytes.as_ptr(), data, len);
+            *data.add(len) = 0;
+        }
+        Self::from_raw_parts(data, len, len + 1)
+    }
+
+    /// 用已填好（NUL 结尾）的缓冲区创建字符串，接管缓冲区所有权
+    fn from_raw_parts(data: *mut u8, len: usize, capacity: usize) -> *mut Self {
         let string = Self {
             header: RcHeader {
                 strong_count: Cell::new(1),
                 weak_count: Cell::new(1),
                 type_tag: TypeTag::String,
                 flags: Cell::new(0),
-                _padding: [0; 6],
+                _padding: [0; 2],
+                hash: Cell::new(0),
             },
-            data: c_string.into_raw(),
+            data: data as *mut c_char,
             len,
-            capacity: len + 1,
+            capacity,
+            owner: std::ptr::null(),
         };
-        Box::into_raw(Box::new(string))
+        crate::slab::alloc_value(string)
+    }
+
+    /// 借用 owner 中 range 范围的字节创建字符串（不复制），字符串持有 owner 的一个引用
+    ///
+    /// 不是合法 UTF-8 时按有损转换复制一份。
+    pub(crate) fn borrowed(owner: &Arc<FileBuffer>, range: Range<usize>) -> *mut Self {
+        let bytes = &owner.as_bytes()[range];
+        if std::str::from_utf8(bytes).is_err() {
+            return Self::new(&String::from_utf8_lossy(bytes));
+        }
+        let string = Self::from_raw_parts(bytes.as_ptr() as *mut u8, bytes.len(), 0);
+        unsafe { (*string).owner = Arc::into_raw(owner.clone()); }
+        string
+    }
+
+    #[inline]
+    fn is_borrowed(&self) -> bool {
+        !self.owner.is_null()
+    }
+
+    /// 借用字符串复制成自有的 NUL 结尾缓冲区，并放开对底层存储的引用
+    ///
+    /// 会修改字符串本身，只能在独占访问时调用（所属线程内，或标记共享之前）。
+    pub(crate) unsafe fn make_owned(&mut self) {
+        if !self.is_borrowed() {
+            return;
+        }
+        let data = alloc_buffer(self.len + 1);
+        std::ptr::copy_nonoverlapping(self.data as *const u8, data, self.len);
+        *data.add(self.len) = 0;
+        drop(Arc::from_raw(self.owner));
+        self.owner = std::ptr::null();
+        self.data = data as *mut c_char;
+        self.capacity = self.len + 1;
+    }
+
+    /// 原地追加字节（调用方保证独占：strong_count 为 1）
+    ///
+    /// 容量不足时按倍数扩容；bytes 可以指向自身内容（s + s）。
+    unsafe fn append_in_place(&mut self, bytes: *const u8, add: usize) {
+        let needed = self.len + add + 1;
+        let self_alias = bytes == self.data as *const u8;
+        if needed > self.capacity {
+            let new_cap = needed.max(self.capacity * 2);
+            self.data = crate::slab::realloc(self.data as *mut u8, self.capacity, new_cap) as *mut c_char;
+            self.capacity = new_cap;
+        }
+        let src = if self_alias { self.data as *const u8 } else { bytes };
+        let dst = (self.data as *mut u8).add(self.len);
+        std::ptr::copy_nonoverlapping(src, dst, add);
+        self.len += add;
+        *(self.data as *mut u8).add(self.len) = 0;
+        // 内容变了，作废哈希缓存
+        self.header.hash.set(0);
     }
 
     /// 获取字符串内容
     pub fn as_str(&self) -> &str {
+        std::str::from_utf8(self.as_bytes()).unwrap_or("")
+    }
+
+    /// 获取字节内容（不含结尾的 NUL）
+    #[inline]
+    pub fn as_bytes(&self) -> &[u8] {
         if self.data.is_null() {
-            return "";
-        }
-        unsafe {
-            let c_str = CStr::from_ptr(self.data);
-            c_str.to_str().unwrap_or("")
+            return &[];
         }
+        unsafe { std::slice::from_raw_parts(self.data as *const u8, self.len) }
     }
 
     pub fn len(&self) -> usize {
         self.len
     }
 
+    /// 内容哈希，首次计算后缓存在对象头中
+    ///
+    /// 共享字符串可能被多个线程同时读取，缓存按原子量读写（各线程算出的值相同）。
+    #[inline]
+    pub fn content_hash(&self) -> u32 {
+        let cache = unsafe { &*(self.header.hash.as_ptr() as *const AtomicU32) };
+        let cached = cache.load(Ordering::Relaxed);
+        if cached != 0 {
+            return cached;
+        }
+        let hash = hash_bytes(self.as_bytes());
+        cache.store(hash, Ordering::Relaxed);
+        hash
+    }
+
     pub fn is_empty(&self) -> bool {
         self.len == 0
     }
@@ -93,24 +201,19 @@ impl BolideString {
     /// 增加引用计数
     #[inline]
     pub fn retain(&self) {
-        let count = self.header.strong_count.get();
-        debug_assert!(count > 0, "retain on dropped string");
-        self.header.strong_count.set(count + 1);
+        crate::rc::count_inc(&self.header.strong_count, &self.header.flags);
     }
 
     /// 减少引用计数，返回是否应该释放
     #[inline]
     pub fn release(&self) -> bool {
-        let count = self.header.strong_count.get();
-        debug_assert!(count > 0, "release underflow");
-        self.header.strong_count.set(count - 1);
-        count == 1
+        crate::rc::count_dec(&self.header.strong_count, &self.header.flags)
     }
 
     /// 获取引用计数
     #[inline]
     pub fn ref_count(&self) -> u32 {
-        self.header.strong_count.get()
+        crate::rc::count_get(&self.header.strong_count, &self.header.flags)
     }
 
     /// 检查是否已被 move
@@ -127,13 +230,76 @@ impl BolideString {
 
     /// 释放内部数据（仅当 strong_count 归零时调用）
     unsafe fn drop_data(&mut self) {
-        if !self.data.is_null() {
-            let _ = CString::from_raw(self.data);
+        if self.is_borrowed() {
+            drop(Arc::from_raw(self.owner));
+            self.owner = std::ptr::null();
+            self.data = std::ptr::null_mut();
+        } else if !self.data.is_null() {
+            crate::slab::free(self.data as *mut u8, self.capacity);
             self.data = std::ptr::null_mut();
         }
     }
 }
 
+/// 分配字符缓冲区
+#[inline]
+fn alloc_buffer(capacity: usize) -> *mut u8 {
+    crate::slab::alloc(capacity)
+}
+
+// ==================== StringBuilder ====================
+
+/// 字符串构建器：按需倍增的字节缓冲区，finish 时把缓冲区直接交给新字符串
+///
+/// 编译器把 `a + b + c + ...` 这类拼接链降级为: 预留总长度 → 逐段 append → finish，
+/// 整条链只分配一次字符缓冲区。
+#[repr(C)]
+pub struct BolideStringBuilder {
+    data: *mut u8,
+    len: usize,
+    capacity: usize,
+}
+
+impl BolideStringBuilder {
+    /// 确保还能再写入 add 字节（外加结尾 NUL）
+    fn reserve(&mut self, add: usize) {
+        let needed = self.len + add + 1;
+        if needed > self.capacity {
+            let new_cap = needed.max(self.capacity * 2);
+            self.data = unsafe { crate::slab::realloc(self.data, self.capacity, new_cap) };
+            self.capacity = new_cap;
+        }
+    }
+
+    /// 追加字节
+    pub fn push_bytes(&mut self, bytes: &[u8]) {
+        self.reserve(bytes.len());
+        unsafe {
+            std::ptr::copy_nonoverlapping(bytes.as_ptr(), self.data.add(self.len), bytes.len());
+        }
+        self.len += bytes.len();
+    }
+}
+
+/// FxHash 风格的字节哈希，折叠为非零 u32
+fn hash_bytes(bytes: &[u8]) -> u32 {
+    const K: u64 = 0x517c_c1b7_2722_0a95;
+    let mut h: u64 = bytes.len() as u64;
+    let mut chunks = bytes.chunks_exact(8);
+    for chunk in &mut chunks {
+        let word = u64::from_le_bytes(chunk.try_into().unwrap());
+        h = (h.rotate_left(5) ^ word).wrapping_mul(K);
+    }
+    let rest = chunks.remainder();
+    if !rest.is_empty() {
+        let mut tail = [0u8; 8];
+        tail[..rest.len()].copy_from_slice(rest);
+        h = (h.rotate_left(5) ^ u64::from_le_bytes(tail)).wrapping_mul(K);
+    }
+    let folded = (h ^ (h >> 32)) as u32;
+    if folded == 0 { 1 } else { folded }
+}
+
 // ==================== FFI 导出 ====================
 
 /// 创建新字符串
@@ -200,7 +366,7 @@ pub extern "C" fn bolide_string_release(s: *mut BolideString) {
         if (*s).release() {
             // 引用计数归零，释放数据
             (*s).drop_data();
-            let _ = Box::from_raw(s);
+            crate::slab::free_value(s);
         }
     }
 }
@@ -242,10 +408,72 @@ pub extern "C" fn bolide_string_ref_count(s: *const BolideString) -> u32 {
 /// 字符串拼接（返回新字符串，ref_count = 1）
 #[no_mangle]
 pub extern "C" fn bolide_string_concat(a: *const BolideString, b: *const BolideString) -> *mut BolideString {
-    let a_str = if a.is_null() { "" } else { unsafe { (*a).as_str() } };
-    let b_str = if b.is_null() { "" } else { unsafe { (*b).as_str() } };
-    let result = format!("{}{}", a_str, b_str);
-    BolideString::new(&result)
+    let a_bytes = if a.is_null() { &[][..] } else { unsafe { (*a).as_bytes() } };
+    let b_bytes = if b.is_null() { &[][..] } else { unsafe { (*b).as_bytes() } };
+    let len = a_bytes.len() + b_bytes.len();
+    let data = alloc_buffer(len + 1);
+    unsafe {
+        std::ptr::copy_nonoverlapping(a_bytes.as_ptr(), data, a_bytes.len());
+        std::ptr::copy_nonoverlapping(b_bytes.as_ptr(), data.add(a_bytes.len()), b_bytes.len());
+        *data.add(len) = 0;
+    }
+    BolideString::from_raw_parts(data, len, len + 1)
+}
+
+/// 追加拼接 `a = a + b`：消费 a 的一个引用，返回结果字符串的引用
+///
+/// a 独占（strong_count 为 1）且不是借用字符串时原地追加并返回 a，否则创建新字符串并释放 a。
+#[no_mangle]
+pub extern "C" fn bolide_string_append(a: *mut BolideString, b: *const BolideString) -> *mut BolideString {
+    if a.is_null() {
+        return bolide_string_concat(a, b);
+    }
+    unsafe {
+        if (*a).ref_count() == 1 && !(*a).is_borrowed() {
+            if !b.is_null() {
+                (*a).append_in_place((*b).data as *const u8, (*b).len);
+            }
+            return a;
+        }
+        let result = bolide_string_concat(a, b);
+        bolide_string_release(a);
+        result
+    }
+}
+
+/// 创建字符串构建器，预留 capacity 字节
+#[no_mangle]
+pub extern "C" fn bolide_string_builder_new(capacity: i64) -> *mut BolideStringBuilder {
+    let capacity = capacity.max(0) as usize + 1;
+    crate::slab::alloc_value(BolideStringBuilder {
+        data: alloc_buffer(capacity),
+        len: 0,
+        capacity,
+    })
+}
+
+/// 追加一个字符串
+#[no_mangle]
+pub extern "C" fn bolide_string_builder_append(sb: *mut BolideStringBuilder, s: *const BolideString) {
+    if sb.is_null() || s.is_null() {
+        return;
+    }
+    unsafe { (*sb).push_bytes((*s).as_bytes()); }
+}
+
+/// 结束构建：缓冲区交给新字符串（ref_count = 1），构建器被释放
+#[no_mangle]
+pub extern "C" fn bolide_string_builder_finish(sb: *mut BolideStringBuilder) -> *mut BolideString {
+    if sb.is_null() {
+        return BolideString::new("");
+    }
+    unsafe {
+        let builder = &mut *sb;
+        *builder.data.add(builder.len) = 0;
+        let result = BolideString::from_raw_parts(builder.data, builder.len, builder.capacity);
+        crate::slab::free_value(sb);
+        result
+    }
 }
 
 /// 字符串比较
@@ -307,7 +535,7 @@ pub extern "C" fn bolide_string_from_bigint(ptr: *const crate::BolideBigInt) ->
     if ptr.is_null() {
         return BolideString::new("0");
     }
-    let bigint = unsafe { &*ptr };
+    let bigint = unsafe { crate::BolideBigInt::view(ptr) };
     BolideString::new(&bigint.to_string())
 }
 
@@ -349,12 +577,19 @@ pub fn bolide_string_from_rust(s: &str) -> *mut BolideString {
 }
 
 /// 获取 BolideString 的 C 字符串指针（用于 FFI）
+///
+/// 借用字符串没有结尾 NUL，先原地复制成自有缓冲区（内容不变）。借用字符串在
+/// 跨线程共享前已经由 `bolide_value_mark_shared` 转成自有缓冲区，这里的修改只会
+/// 发生在所属线程内。
 #[no_mangle]
-pub extern "C" fn bolide_string_as_cstr(s: *const BolideString) -> *const c_char {
+pub extern "C" fn bolide_string_as_cstr(s: *mut BolideString) -> *const c_char {
     if s.is_null() {
         return std::ptr::null();
     }
-    unsafe { (*s).data }
+    unsafe {
+        (*s).make_owned();
+        (*s).data
+    }
 }
 
 // ==================== 测试 ====================
@@ -411,6 +646,121 @@ mod tests {
         }
     }
 
+    #[test]
+    fn test_string_append_in_place() {
+        let a = BolideString::new("ab");
+        let b = BolideString::new("cd");
+        unsafe {
+            let hash_before = (*a).content_hash();
+            let r = bolide_string_append(a, b);
+            assert_eq!(r, a); // 独占时原地追加
+            assert_eq!((*r).as_str(), "abcd");
+            assert_ne!((*r).content_hash(), hash_before);
+            // s = s + s
+            let r = bolide_string_append(r, r);
+            assert_eq!((*r).as_str(), "abcdabcd");
+
+            // 被共享时不能原地修改
+            bolide_string_retain(r);
+            let r2 = bolide_string_append(r, b);
+            assert_ne!(r2, r);
+            assert_eq!((*r).as_str(), "abcdabcd");
+            assert_eq!((*r).ref_count(), 1);
+            assert_eq!((*r2).as_str(), "abcdabcdcd");
+
+            bolide_string_release(r);
+            bolide_string_release(r2);
+            bolide_string_release(b);
+        }
+    }
+
+    #[test]
+    fn test_string_builder() {
+        let parts = ["x = ", "42", ", y = ", "7"];
+        let strings: Vec<_> = parts.iter().map(|p| BolideString::new(p)).collect();
+        let total: usize = parts.iter().map(|p| p.len()).sum();
+        let sb = bolide_string_builder_new(total as i64);
+        for &s in &strings {
+            bolide_string_builder_append(sb, s);
+        }
+        let result = bolide_string_builder_finish(sb);
+        unsafe {
+            assert_eq!((*result).as_str(), "x = 42, y = 7");
+            assert_eq!((*result).len(), total);
+            bolide_string_release(result);
+            for s in strings {
+                bolide_string_release(s);
+            }
+        }
+        // 容量不足时自动扩容
+        let sb = bolide_string_builder_new(0);
+        let piece = BolideString::new("0123456789");
+        for _ in 0..100 {
+            bolide_string_builder_append(sb, piece);
+        }
+        let result = bolide_string_builder_finish(sb);
+        unsafe {
+            assert_eq!((*result).len(), 1000);
+            bolide_string_release(result);
+            bolide_string_release(piece);
+        }
+    }
+
+    #[test]
+    fn test_string_content_hash() {
+        let a = BolideString::new("dict-key-123");
+        let b = BolideString::new("dict-key-123");
+        let c = BolideString::new("dict-key-124");
+        unsafe {
+            assert_eq!((*a).content_hash(), (*b).content_hash());
+            assert_ne!((*a).content_hash(), (*c).content_hash());
+            // 第二次读取命中缓存
+            assert_eq!((*a).content_hash(), (*a).content_hash());
+            assert_eq!((*a).as_bytes(), b"dict-key-123");
+            bolide_string_release(a);
+            bolide_string_release(b);
+            bolide_string_release(c);
+        }
+    }
+
+    #[test]
+    fn test_string_borrowed() {
+        let owner = Arc::new(FileBuffer::Chunk(b"abc\ndef\n\xff".to_vec()));
+        let s = BolideString::borrowed(&owner, 4..7);
+        unsafe {
+            assert_eq!((*s).as_str(), "def");
+            assert_eq!(Arc::strong_count(&owner), 2);
+            // 借用字符串不能原地追加
+            let b = BolideString::new("!");
+            let r = bolide_string_append(s, b);
+            assert_ne!(r, s);
+            assert_eq!((*r).as_str(), "def!");
+            assert_eq!(Arc::strong_count(&owner), 1);
+
+            // 传给 C 前复制成 NUL 结尾的自有缓冲区
+            let t = BolideString::borrowed(&owner, 0..3);
+            let c = bolide_string_as_cstr(t);
+            assert_eq!(CStr::from_ptr(c).to_str().unwrap(), "abc");
+            assert_eq!(Arc::strong_count(&owner), 1);
+
+            // 非法 UTF-8 直接复制
+            let u = BolideString::borrowed(&owner, 8..9);
+            assert_eq!((*u).as_str(), "\u{fffd}");
+            assert_eq!(Arc::strong_count(&owner), 1);
+
+            // 标记共享前复制成自有缓冲区，其他线程不会再修改它
+            let v = BolideString::borrowed(&owner, 0..3);
+            assert_eq!(Arc::strong_count(&owner), 2);
+            crate::rc::bolide_value_mark_shared(v as *mut std::os::raw::c_void);
+            assert_eq!(Arc::strong_count(&owner), 1);
+            assert_eq!((*v).as_str(), "abc");
+
+            for x in [r, b, t, u, v] {
+                bolide_string_release(x);
+            }
+        }
+    }
+
     #[test]
     fn test_string_move_flag() {
         let s = BolideString::new("movable");
@@ -3,8 +3,9 @@
 //! 提供线程创建、线程池和 Future 支持
 //! 使用 trampoline 方案，运行时只处理无参函数
 
+use std::cell::{Cell, UnsafeCell};
 use std::sync::{Arc, Mutex, Condvar};
-use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::atomic::{fence, AtomicBool, AtomicIsize, AtomicPtr, AtomicUsize, Ordering};
 use std::thread::{self, JoinHandle};
 use std::collections::VecDeque;
 use std::os::raw::c_void;
@@ -38,68 +39,296 @@ pub struct BolideThreadHandle {
 unsafe impl Send for BolideThreadHandle {}
 unsafe impl Sync for BolideThreadHandle {}
 
+// ==================== 工作窃取线程池 ====================
+//
+// 每个工作线程有自己的 Chase-Lev 双端队列：本线程从底部压入/弹出（LIFO，缓存友好），
+// 其他线程从顶部窃取（FIFO）。池外线程提交的任务进入全局注入队列，工作线程
+// 一次取走一批放进自己的队列，再由空闲线程窃取分散。
+
+type Job = Box<dyn FnOnce() + Send + 'static>;
+
+/// 队列槽位中存放的是 Box<Job> 的裸指针（瘦指针，可原子读写）
+type JobPtr = *mut Job;
+
+/// 每个双端队列的初始容量（2 的幂，满时翻倍）
+const DEQUE_INITIAL_CAPACITY: usize = 64;
+
+/// 从注入队列一次最多搬运的任务数
+const INJECTOR_BATCH: usize = 32;
+
+struct DequeBuffer {
+    mask: usize,
+    slots: Box<[AtomicPtr<Job>]>,
+}
+
+impl DequeBuffer {
+    fn alloc(capacity: usize) -> *mut DequeBuffer {
+        let slots = (0..capacity).map(|_| AtomicPtr::new(std::ptr::null_mut())).collect();
+        Box::into_raw(Box::new(DequeBuffer { mask: capacity - 1, slots }))
+    }
+
+    fn capacity(&self) -> usize {
+        self.mask + 1
+    }
+
+    fn get(&self, index: isize) -> JobPtr {
+        self.slots[index as usize & self.mask].load(Ordering::Relaxed)
+    }
+
+    fn put(&self, index: isize, job: JobPtr) {
+        self.slots[index as usize & self.mask].store(job, Ordering::Relaxed);
+    }
+}
+
+/// Chase-Lev 工作窃取双端队列（push/pop 仅限所属线程，steal 可在任意线程调用）
+struct WorkDeque {
+    top: AtomicIsize,
+    bottom: AtomicIsize,
+    buffer: AtomicPtr<DequeBuffer>,
+    /// 扩容后被替换的旧缓冲区：窃取者可能仍在读取，延迟到队列销毁时释放
+    retired: Mutex<Vec<*mut DequeBuffer>>,
+}
+
+impl WorkDeque {
+    fn new() -> Self {
+        Self {
+            top: AtomicIsize::new(0),
+            bottom: AtomicIsize::new(0),
+            buffer: AtomicPtr::new(DequeBuffer::alloc(DEQUE_INITIAL_CAPACITY)),
+            retired: Mutex::new(Vec::new()),
+        }
+    }
+
+    fn push(&self, job: JobPtr) {
+        let b = self.bottom.load(Ordering::Relaxed);
+        let t = self.top.load(Ordering::Acquire);
+        let mut buf = self.buffer.load(Ordering::Relaxed);
+        unsafe {
+            if b - t >= (*buf).capacity() as isize {
+                buf = self.grow(buf, t, b);
+            }
+            (*buf).put(b, job);
+        }
+        fence(Ordering::Release);
+        self.bottom.store(b + 1, Ordering::Relaxed);
+    }
+
+    unsafe fn grow(&self, old: *mut DequeBuffer, t: isize, b: isize) -> *mut DequeBuffer {
+        let new = DequeBuffer::alloc((*old).capacity() * 2);
+        for i in t..b {
+            (*new).put(i, (*old).get(i));
+        }
+        self.buffer.store(new, Ordering::Release);
+        self.retired.lock().unwrap().push(old);
+        new
+    }
+
+    fn pop(&self) -> Option<JobPtr> {
+        let b = self.bottom.load(Ordering::Relaxed) - 1;
+        let buf = self.buffer.load(Ordering::Relaxed);
+        self.bottom.store(b, Ordering::Relaxed);
+        fence(Ordering::SeqCst);
+        let t = self.top.load(Ordering::Relaxed);
+        if t > b {
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            return None;
+        }
+        let job = unsafe { (*buf).get(b) };
+        if t == b {
+            // 只剩最后一个，与窃取者竞争
+            let won = self.top
+                .compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok();
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            if !won {
+                return None;
+            }
+        }
+        Some(job)
+    }
+
+    fn steal(&self) -> Option<JobPtr> {
+        let t = self.top.load(Ordering::Acquire);
+        fence(Ordering::SeqCst);
+        let b = self.bottom.load(Ordering::Acquire);
+        if t >= b {
+            return None;
+        }
+        let buf = self.buffer.load(Ordering::Acquire);
+        let job = unsafe { (*buf).get(t) };
+        if self.top
+            .compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed)
+            .is_err()
+        {
+            return None;
+        }
+        Some(job)
+    }
+}
+
+impl Drop for WorkDeque {
+    fn drop(&mut self) {
+        let t = *self.top.get_mut();
+        let b = *self.bottom.get_mut();
+        let buf = *self.buffer.get_mut();
+        unsafe {
+            for i in t..b {
+                drop(Box::from_raw((*buf).get(i)));
+            }
+            drop(Box::from_raw(buf));
+            for old in self.retired.get_mut().unwrap().drain(..) {
+                drop(Box::from_raw(old));
+            }
+        }
+    }
+}
+
+/// 线程池共享状态
+struct PoolShared {
+    deques: Vec<WorkDeque>,
+    injector: Mutex<VecDeque<JobPtr>>,
+    /// 已提交但尚未被取走的任务数（提交与取走之间可能短暂为负）
+    pending: AtomicIsize,
+    sleepers: AtomicUsize,
+    sleep_lock: Mutex<()>,
+    sleep_cv: Condvar,
+    shutdown: AtomicBool,
+}
+
+unsafe impl Send for PoolShared {}
+unsafe impl Sync for PoolShared {}
+
+thread_local! {
+    /// 当前线程所属的线程池及其工作线程编号（池外线程为空指针）
+    static CURRENT_WORKER: Cell<(*const PoolShared, usize)> = Cell::new((std::ptr::null(), 0));
+}
+
+impl PoolShared {
+    fn submit(&self, job: Job) {
+        let ptr: JobPtr = Box::into_raw(Box::new(job));
+        let (pool, index) = CURRENT_WORKER.with(|c| c.get());
+        if std::ptr::eq(pool, self) {
+            self.deques[index].push(ptr);
+        } else {
+            self.injector.lock().unwrap().push_back(ptr);
+        }
+        self.pending.fetch_add(1, Ordering::SeqCst);
+        // 与 worker_loop 中先登记 sleepers 再检查 pending 的顺序配合，不会丢失唤醒
+        if self.sleepers.load(Ordering::SeqCst) > 0 {
+            let _guard = self.sleep_lock.lock().unwrap();
+            self.sleep_cv.notify_one();
+        }
+    }
+
+    /// 依次尝试: 本地队列 → 注入队列（整批搬运） → 窃取其他线程
+    fn find_job(&self, index: usize) -> Option<JobPtr> {
+        if let Some(job) = self.deques[index].pop() {
+            return Some(job);
+        }
+        {
+            let mut injector = self.injector.lock().unwrap();
+            if let Some(job) = injector.pop_front() {
+                let batch = injector.len().min(INJECTOR_BATCH);
+                for _ in 0..batch {
+                    if let Some(extra) = injector.pop_front() {
+                        self.deques[index].push(extra);
+                    }
+                }
+                return Some(job);
+            }
+        }
+        let n = self.deques.len();
+        for k in 1..n {
+            if let Some(job) = self.deques[(index + k) % n].steal() {
+                return Some(job);
+            }
+        }
+        None
+    }
+
+    /// 在当前线程执行一个已取出的任务
+    fn run_job(&self, job: JobPtr) {
+        self.pending.fetch_sub(1, Ordering::SeqCst);
+        let job = unsafe { Box::from_raw(job) };
+        job();
+    }
+
+    fn worker_loop(&self, index: usize) {
+        loop {
+            if let Some(job) = self.find_job(index) {
+                self.run_job(job);
+                continue;
+            }
+            if self.pending.load(Ordering::SeqCst) > 0 {
+                // 任务已计数但尚未可见（或窃取竞争失败），稍后重试
+                thread::yield_now();
+                continue;
+            }
+            if self.shutdown.load(Ordering::SeqCst) {
+                return;
+            }
+            let mut guard = self.sleep_lock.lock().unwrap();
+            self.sleepers.fetch_add(1, Ordering::SeqCst);
+            while self.pending.load(Ordering::SeqCst) <= 0 && !self.shutdown.load(Ordering::SeqCst) {
+                guard = self.sleep_cv.wait(guard).unwrap();
+            }
+            self.sleepers.fetch_sub(1, Ordering::SeqCst);
+        }
+    }
+}
+
+/// 默认线程池大小：可用并行度
+fn default_pool_size() -> usize {
+    thread::available_parallelism().map(|n| n.get()).unwrap_or(4)
+}
+
 /// 线程池
 pub struct BolideThreadPool {
     workers: Vec<Worker>,
-    sender: Arc<Mutex<VecDeque<Job>>>,
-    condvar: Arc<Condvar>,
-    shutdown: Arc<Mutex<bool>>,
+    shared: Arc<PoolShared>,
 }
 
-type Job = Box<dyn FnOnce() -> ThreadResult + Send + 'static>;
-
 struct Worker {
     thread: Option<JoinHandle<()>>,
 }
 
 impl BolideThreadPool {
+    /// 创建线程池，size 为 0 时按可用并行度确定大小
     pub fn new(size: usize) -> Self {
-        let sender: Arc<Mutex<VecDeque<Job>>> = Arc::new(Mutex::new(VecDeque::new()));
-        let condvar = Arc::new(Condvar::new());
-        let shutdown = Arc::new(Mutex::new(false));
+        let size = if size == 0 { default_pool_size() } else { size };
+        let shared = Arc::new(PoolShared {
+            deques: (0..size).map(|_| WorkDeque::new()).collect(),
+            injector: Mutex::new(VecDeque::new()),
+            pending: AtomicIsize::new(0),
+            sleepers: AtomicUsize::new(0),
+            sleep_lock: Mutex::new(()),
+            sleep_cv: Condvar::new(),
+            shutdown: AtomicBool::new(false),
+        });
 
         let mut workers = Vec::with_capacity(size);
-
-        for _ in 0..size {
-            let sender = Arc::clone(&sender);
-            let condvar = Arc::clone(&condvar);
-            let shutdown = Arc::clone(&shutdown);
-
+        for index in 0..size {
+            let shared = Arc::clone(&shared);
             let thread = thread::spawn(move || {
-                loop {
-                    let job = {
-                        let mut queue = sender.lock().unwrap();
-                        while queue.is_empty() {
-                            if *shutdown.lock().unwrap() {
-                                return;
-                            }
-                            queue = condvar.wait(queue).unwrap();
-                        }
-                        queue.pop_front()
-                    };
-
-                    if let Some(job) = job {
-                        job();
-                    }
-                }
+                CURRENT_WORKER.with(|c| c.set((Arc::as_ptr(&shared), index)));
+                shared.worker_loop(index);
+                CURRENT_WORKER.with(|c| c.set((std::ptr::null(), 0)));
             });
-
             workers.push(Worker {
                 thread: Some(thread),
             });
         }
 
-        BolideThreadPool {
-            workers,
-            sender,
-            condvar,
-            shutdown,
-        }
+        BolideThreadPool { workers, shared }
     }
 
+    /// 关闭线程池：已提交的任务会全部执行完后工作线程才退出
     pub fn shutdown(&mut self) {
-        *self.shutdown.lock().unwrap() = true;
-        self.condvar.notify_all();
+        self.shared.shutdown.store(true, Ordering::SeqCst);
+        {
+            let _guard = self.shared.sleep_lock.lock().unwrap();
+            self.shared.sleep_cv.notify_all();
+        }
 
         for worker in &mut self.workers {
             if let Some(thread) = worker.thread.take() {
@@ -115,11 +344,70 @@ impl Drop for BolideThreadPool {
     }
 }
 
+/// 线程池任务的完成状态
+struct PoolTaskState {
+    done: AtomicBool,
+    taken: AtomicBool,
+    /// 在 done 置位之前写入一次
+    result: UnsafeCell<ThreadResult>,
+    lock: Mutex<()>,
+    condvar: Condvar,
+}
+
+unsafe impl Send for PoolTaskState {}
+unsafe impl Sync for PoolTaskState {}
+
+impl PoolTaskState {
+    fn new() -> Self {
+        Self {
+            done: AtomicBool::new(false),
+            taken: AtomicBool::new(false),
+            result: UnsafeCell::new(ThreadResult { int_val: 0 }),
+            lock: Mutex::new(()),
+            condvar: Condvar::new(),
+        }
+    }
+
+    fn complete(&self, result: ThreadResult) {
+        unsafe { *self.result.get() = result; }
+        let _guard = self.lock.lock().unwrap();
+        self.done.store(true, Ordering::Release);
+        self.condvar.notify_all();
+    }
+
+    /// 等待完成；在线程池工作线程上等待时先执行池中的其他任务
+    fn wait(&self) -> Option<ThreadResult> {
+        if !self.done.load(Ordering::Acquire) {
+            // 等待前刷出本线程的输出，之后执行的其他任务不会抢到它前面
+            crate::bolide_print_flush();
+            let (pool, index) = CURRENT_WORKER.with(|c| c.get());
+            if !pool.is_null() {
+                let pool = unsafe { &*pool };
+                while !self.done.load(Ordering::Acquire) {
+                    match pool.find_job(index) {
+                        Some(job) => pool.run_job(job),
+                        None => break,
+                    }
+                }
+            }
+            let mut guard = self.lock.lock().unwrap();
+            while !self.done.load(Ordering::Acquire) {
+                guard = self.condvar.wait(guard).unwrap();
+            }
+        }
+        // 结果只交出一次（指针结果的所有权转移给调用方）
+        if self.taken.swap(true, Ordering::AcqRel) {
+            None
+        } else {
+            Some(unsafe { *self.result.get() })
+        }
+    }
+}
+
 /// 线程池任务句柄
 #[repr(C)]
 pub struct BolidePoolHandle {
-    result: Arc<Mutex<Option<ThreadResult>>>,
-    completed: Arc<(Mutex<bool>, Condvar)>,
+    state: Arc<PoolTaskState>,
 }
 
 unsafe impl Send for BolidePoolHandle {}
@@ -127,13 +415,25 @@ unsafe impl Sync for BolidePoolHandle {}
 
 // ==================== 线程 spawn FFI ====================
 
+/// 创建普通线程：先刷出调用方缓冲的输出，线程结束前刷出自己的，
+/// 保证 spawn 之前、线程内、join 之后的输出按先后顺序出现
+fn spawn_thread(body: impl FnOnce() -> ThreadResult + Send + 'static) -> JoinHandle<ThreadResult> {
+    crate::bolide_print_flush();
+    thread::spawn(move || {
+        let res = body();
+        crate::bolide_print_flush();
+        res
+    })
+}
+
 /// 创建新线程执行返回 int 的无参函数
 #[no_mangle]
 pub extern "C" fn bolide_thread_spawn_int(func_ptr: extern "C" fn() -> i64) -> *mut BolideThreadHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn() -> i64 = unsafe { std::mem::transmute(send_fn) };
         ThreadResult { int_val: f() }
     });
@@ -152,7 +452,8 @@ pub extern "C" fn bolide_thread_spawn_float(func_ptr: extern "C" fn() -> f64) ->
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn() -> f64 = unsafe { std::mem::transmute(send_fn) };
         ThreadResult { float_val: f() }
     });
@@ -171,7 +472,8 @@ pub extern "C" fn bolide_thread_spawn_ptr(func_ptr: extern "C" fn() -> *mut c_vo
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn() -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
         ThreadResult { ptr_val: f() }
     });
@@ -196,7 +498,8 @@ pub extern "C" fn bolide_thread_spawn_int_with_env(
     let env_addr = env as usize;
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn(*mut c_void) -> i64 = unsafe { std::mem::transmute(send_fn) };
         let env_ptr = env_addr as *mut c_void;
         ThreadResult { int_val: f(env_ptr) }
@@ -220,7 +523,8 @@ pub extern "C" fn bolide_thread_spawn_float_with_env(
     let env_addr = env as usize;
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn(*mut c_void) -> f64 = unsafe { std::mem::transmute(send_fn) };
         let env_ptr = env_addr as *mut c_void;
         ThreadResult { float_val: f(env_ptr) }
@@ -244,7 +548,8 @@ pub extern "C" fn bolide_thread_spawn_ptr_with_env(
     let env_addr = env as usize;
     let cancelled = Arc::new(AtomicBool::new(false));
 
-    let handle = thread::spawn(move || {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let handle = spawn_thread(move || {
         let f: extern "C" fn(*mut c_void) -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
         let env_ptr = env_addr as *mut c_void;
         ThreadResult { ptr_val: f(env_ptr) }
@@ -269,6 +574,7 @@ pub extern "C" fn bolide_thread_join_int(handle: *mut BolideThreadHandle) -> i64
 
     if !handle.has_result {
         if let Some(join_handle) = handle.handle.take() {
+            crate::bolide_print_flush();
             match join_handle.join() {
                 Ok(result) => {
                     handle.result = result;
@@ -293,6 +599,7 @@ pub extern "C" fn bolide_thread_join_float(handle: *mut BolideThreadHandle) -> f
 
     if !handle.has_result {
         if let Some(join_handle) = handle.handle.take() {
+            crate::bolide_print_flush();
             match join_handle.join() {
                 Ok(result) => {
                     handle.result = result;
@@ -317,6 +624,7 @@ pub extern "C" fn bolide_thread_join_ptr(handle: *mut BolideThreadHandle) -> *mu
 
     if !handle.has_result {
         if let Some(join_handle) = handle.handle.take() {
+            crate::bolide_print_flush();
             match join_handle.join() {
                 Ok(result) => {
                     handle.result = result;
@@ -363,171 +671,86 @@ pub extern "C" fn bolide_thread_is_cancelled(handle: *const BolideThreadHandle)
 
 // ==================== 线程池 FFI ====================
 
-struct SendPtr(*mut BolideThreadPool);
-unsafe impl Send for SendPtr {}
-unsafe impl Sync for SendPtr {}
+/// 当前线程池上下文（pool 块内的 spawn 提交到这里）
+static POOL_CONTEXT: AtomicPtr<BolideThreadPool> = AtomicPtr::new(std::ptr::null_mut());
 
-static POOL_CONTEXT: Mutex<Option<SendPtr>> = Mutex::new(None);
-
-/// 创建线程池
+/// 创建线程池，size <= 0 时按可用并行度确定大小
 #[no_mangle]
 pub extern "C" fn bolide_pool_create(size: i64) -> *mut BolideThreadPool {
-    let pool = BolideThreadPool::new(size as usize);
+    let pool = BolideThreadPool::new(if size > 0 { size as usize } else { 0 });
     Box::into_raw(Box::new(pool))
 }
 
 /// 设置当前线程池上下文
 #[no_mangle]
 pub extern "C" fn bolide_pool_enter(pool: *mut BolideThreadPool) {
-    let mut ctx = POOL_CONTEXT.lock().unwrap();
-    *ctx = Some(SendPtr(pool));
+    POOL_CONTEXT.store(pool, Ordering::SeqCst);
 }
 
 /// 清除当前线程池上下文
 #[no_mangle]
 pub extern "C" fn bolide_pool_exit() {
-    let mut ctx = POOL_CONTEXT.lock().unwrap();
-    *ctx = None;
+    POOL_CONTEXT.store(std::ptr::null_mut(), Ordering::SeqCst);
 }
 
 /// 检查是否在线程池上下文中
 #[no_mangle]
 pub extern "C" fn bolide_pool_is_active() -> i64 {
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if ctx.is_some() { 1 } else { 0 }
+    if POOL_CONTEXT.load(Ordering::SeqCst).is_null() { 0 } else { 1 }
+}
+
+/// 提交任务到当前线程池；不在线程池上下文中时创建普通线程
+fn pool_spawn(body: impl FnOnce() -> ThreadResult + Send + 'static) -> *mut BolidePoolHandle {
+    crate::profile::count(&crate::profile::COUNTERS.spawns);
+    let state = Arc::new(PoolTaskState::new());
+    let task_state = Arc::clone(&state);
+    let job = move || {
+        let res = body();
+        // 任务结束前刷出本线程缓冲的输出，保证 await 返回后可见
+        crate::bolide_print_flush();
+        task_state.complete(res);
+    };
+
+    // 任务可能立即在其他线程开始输出，先刷出调用方缓冲的内容
+    crate::bolide_print_flush();
+    let pool = POOL_CONTEXT.load(Ordering::SeqCst);
+    if !pool.is_null() {
+        unsafe { (*pool).shared.submit(Box::new(job)); }
+    } else {
+        thread::spawn(job);
+    }
+
+    Box::into_raw(Box::new(BolidePoolHandle { state }))
 }
 
 /// 在线程池中执行返回 int 的任务
 #[no_mangle]
 pub extern "C" fn bolide_pool_spawn_int(func_ptr: extern "C" fn() -> i64) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn() -> i64 = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { int_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        // 不在线程池上下文中，创建普通线程
-        thread::spawn(move || {
-            let f: extern "C" fn() -> i64 = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { int_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn() -> i64 = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { int_val: f() }
+    })
 }
 
 /// 在线程池中执行返回 float 的任务
 #[no_mangle]
 pub extern "C" fn bolide_pool_spawn_float(func_ptr: extern "C" fn() -> f64) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn() -> f64 = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { float_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        thread::spawn(move || {
-            let f: extern "C" fn() -> f64 = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { float_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn() -> f64 = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { float_val: f() }
+    })
 }
 
 /// 在线程池中执行返回指针的任务
 #[no_mangle]
 pub extern "C" fn bolide_pool_spawn_ptr(func_ptr: extern "C" fn() -> *mut c_void) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn() -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { ptr_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        thread::spawn(move || {
-            let f: extern "C" fn() -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
-            let res = ThreadResult { ptr_val: f() };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn() -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { ptr_val: f() }
+    })
 }
 
 // ==================== 带环境的线程池 spawn FFI ====================
@@ -540,46 +763,10 @@ pub extern "C" fn bolide_pool_spawn_int_with_env(
 ) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let env_addr = env as usize;
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn(*mut c_void) -> i64 = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { int_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        thread::spawn(move || {
-            let f: extern "C" fn(*mut c_void) -> i64 = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { int_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn(*mut c_void) -> i64 = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { int_val: f(env_addr as *mut c_void) }
+    })
 }
 
 /// 在线程池中执行带环境的返回 float 的任务
@@ -590,46 +777,10 @@ pub extern "C" fn bolide_pool_spawn_float_with_env(
 ) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let env_addr = env as usize;
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn(*mut c_void) -> f64 = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { float_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        thread::spawn(move || {
-            let f: extern "C" fn(*mut c_void) -> f64 = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { float_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn(*mut c_void) -> f64 = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { float_val: f(env_addr as *mut c_void) }
+    })
 }
 
 /// 在线程池中执行带环境的返回指针的任务
@@ -640,46 +791,10 @@ pub extern "C" fn bolide_pool_spawn_ptr_with_env(
 ) -> *mut BolidePoolHandle {
     let send_fn = SendFnPtr(func_ptr as *const c_void);
     let env_addr = env as usize;
-
-    let result: Arc<Mutex<Option<ThreadResult>>> = Arc::new(Mutex::new(None));
-    let completed = Arc::new((Mutex::new(false), Condvar::new()));
-
-    let result_clone = Arc::clone(&result);
-    let completed_clone = Arc::clone(&completed);
-
-    let ctx = POOL_CONTEXT.lock().unwrap();
-    if let Some(ref send_ptr) = *ctx {
-        let pool = unsafe { &*send_ptr.0 };
-
-        let job = Box::new(move || {
-            let f: extern "C" fn(*mut c_void) -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { ptr_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-            res
-        });
-
-        {
-            let mut queue = pool.sender.lock().unwrap();
-            queue.push_back(job);
-        }
-        pool.condvar.notify_one();
-    } else {
-        thread::spawn(move || {
-            let f: extern "C" fn(*mut c_void) -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
-            let env_ptr = env_addr as *mut c_void;
-            let res = ThreadResult { ptr_val: f(env_ptr) };
-            *result_clone.lock().unwrap() = Some(res);
-            let (lock, cvar) = &*completed_clone;
-            *lock.lock().unwrap() = true;
-            cvar.notify_all();
-        });
-    }
-
-    Box::into_raw(Box::new(BolidePoolHandle { result, completed }))
+    pool_spawn(move || {
+        let f: extern "C" fn(*mut c_void) -> *mut c_void = unsafe { std::mem::transmute(send_fn) };
+        ThreadResult { ptr_val: f(env_addr as *mut c_void) }
+    })
 }
 
 /// 等待线程池任务完成并获取 int 结果
@@ -688,16 +803,8 @@ pub extern "C" fn bolide_pool_join_int(handle: *mut BolidePoolHandle) -> i64 {
     if handle.is_null() {
         return 0;
     }
-
     let handle = unsafe { &*handle };
-    let (lock, cvar) = &*handle.completed;
-
-    let mut completed = lock.lock().unwrap();
-    while !*completed {
-        completed = cvar.wait(completed).unwrap();
-    }
-
-    match handle.result.lock().unwrap().take() {
+    match handle.state.wait() {
         Some(res) => unsafe { res.int_val },
         None => 0,
     }
@@ -709,16 +816,8 @@ pub extern "C" fn bolide_pool_join_float(handle: *mut BolidePoolHandle) -> f64 {
     if handle.is_null() {
         return 0.0;
     }
-
     let handle = unsafe { &*handle };
-    let (lock, cvar) = &*handle.completed;
-
-    let mut completed = lock.lock().unwrap();
-    while !*completed {
-        completed = cvar.wait(completed).unwrap();
-    }
-
-    match handle.result.lock().unwrap().take() {
+    match handle.state.wait() {
         Some(res) => unsafe { res.float_val },
         None => 0.0,
     }
@@ -730,16 +829,8 @@ pub extern "C" fn bolide_pool_join_ptr(handle: *mut BolidePoolHandle) -> *mut c_
     if handle.is_null() {
         return std::ptr::null_mut();
     }
-
     let handle = unsafe { &*handle };
-    let (lock, cvar) = &*handle.completed;
-
-    let mut completed = lock.lock().unwrap();
-    while !*completed {
-        completed = cvar.wait(completed).unwrap();
-    }
-
-    match handle.result.lock().unwrap().take() {
+    match handle.state.wait() {
         Some(res) => unsafe { res.ptr_val },
         None => std::ptr::null_mut(),
     }
@@ -765,3 +856,50 @@ pub extern "C" fn bolide_pool_destroy(pool: *mut BolideThreadPool) {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::atomic::AtomicI64;
+
+    static COUNTER: AtomicI64 = AtomicI64::new(0);
+
+    extern "C" fn bump() -> i64 {
+        COUNTER.fetch_add(1, Ordering::SeqCst) + 1
+    }
+
+    #[test]
+    fn test_deque_push_pop_steal() {
+        let deque = WorkDeque::new();
+        let make = |v: i64| -> JobPtr { Box::into_raw(Box::new(Box::new(move || { let _ = v; }) as Job)) };
+        for i in 0..(DEQUE_INITIAL_CAPACITY as i64 * 3) {
+            deque.push(make(i));
+        }
+        let mut taken = 0;
+        while let Some(job) = deque.steal() {
+            unsafe { drop(Box::from_raw(job)); }
+            taken += 1;
+            if taken == 10 { break; }
+        }
+        while let Some(job) = deque.pop() {
+            unsafe { drop(Box::from_raw(job)); }
+            taken += 1;
+        }
+        assert_eq!(taken, DEQUE_INITIAL_CAPACITY * 3);
+        assert!(deque.steal().is_none());
+    }
+
+    #[test]
+    fn test_pool_runs_all_jobs() {
+        let pool = bolide_pool_create(0);
+        bolide_pool_enter(pool);
+        let handles: Vec<*mut BolidePoolHandle> = (0..10_000).map(|_| bolide_pool_spawn_int(bump)).collect();
+        bolide_pool_exit();
+        for h in handles {
+            assert!(bolide_pool_join_int(h) > 0);
+            bolide_pool_handle_free(h);
+        }
+        bolide_pool_destroy(pool);
+        assert!(COUNTER.load(Ordering::SeqCst) >= 10_000);
+    }
+}
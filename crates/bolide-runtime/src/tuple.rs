@@ -99,7 +99,7 @@ pub extern "C" fn bolide_tuple_free(ptr: *mut BolideTuple) {
 pub extern "C" fn bolide_tuple_debug_stats() {
     let alloc = TUPLE_ALLOC_COUNT.load(Ordering::SeqCst);
     let free = TUPLE_FREE_COUNT.load(Ordering::SeqCst);
-    println!("[Tuple Stats] alloc: {}, free: {}, leak: {}", alloc, free, alloc - free);
+    crate::print::out_println!("[Tuple Stats] alloc: {}, free: {}, leak: {}", alloc, free, alloc - free);
 }
 
 // ==================== 元素访问 ====================
@@ -156,22 +156,26 @@ pub extern "C" fn bolide_tuple_len(ptr: *const BolideTuple) -> usize {
 /// 打印元组 (简单版本，所有元素作为 i64 打印)
 #[no_mangle]
 pub extern "C" fn bolide_print_tuple(ptr: *const BolideTuple) {
-    if ptr.is_null() {
-        println!("()");
-        return;
-    }
-
-    unsafe {
-        let len = (*ptr).len;
-        let data = (*ptr).data_ptr();
+    crate::print::with_out(|out| {
+        if ptr.is_null() {
+            out.push_str("()");
+            out.end_line();
+            return;
+        }
 
-        print!("(");
-        for i in 0..len {
-            if i > 0 {
-                print!(", ");
+        unsafe {
+            let len = (*ptr).len;
+            let data = (*ptr).data_ptr();
+
+            out.push_str("(");
+            for i in 0..len {
+                if i > 0 {
+                    out.push_str(", ");
+                }
+                out.push_int(*data.add(i));
             }
-            print!("{}", *data.add(i));
+            out.push_str(")");
+            out.end_line();
         }
-        println!(")");
-    }
+    });
 }
@@ -16,6 +16,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
 
 // ============================================================
 // 内部状态
@@ -29,10 +30,170 @@ static int g_base_dpi = 96;
 static int g_initialized = 0;
 
 // ============================================================
-// 回调存储
+// Bolide 运行时接口
 // ============================================================
 
-#define MAX_CALLBACKS 256
+// RC 对象头（与 rc.rs 中 #[repr(C)] 定义保持一致）
+typedef struct {
+    uint32_t strong_count;
+    uint32_t weak_count;
+    uint8_t type_tag;
+    uint8_t flags;
+    uint8_t padding[6];
+} BolideRcHeader;
+
+// BolideList 的内存布局（与 list.rs 保持一致）
+typedef struct {
+    BolideRcHeader header;
+    int64_t* data;
+    size_t len;
+    size_t capacity;
+    uint8_t elem_type;
+} BolideListView;
+
+// BolideString 的内存布局（与 string.rs 保持一致）
+typedef struct {
+    BolideRcHeader header;
+    char* data;
+    size_t len;
+    size_t capacity;
+} BolideStringView;
+
+// 运行时函数表（与 ffi.rs 中 BolideFfiApi 保持一致）
+typedef struct {
+    uint32_t version;
+    void* (*string_retain)(void* s);
+    void (*string_release)(void* s);
+} BolideFfiApi;
+
+static const BolideFfiApi* g_ffi_api = NULL;
+
+// 库被 Bolide 运行时加载时调用
+GUI_API void bolide_ffi_module_init(const BolideFfiApi* api) {
+    g_ffi_api = api;
+}
+
+// 释放 Bolide 回调返回的字符串（调用方持有一个引用）
+static void release_bolide_string(void* s) {
+    if (s && g_ffi_api && g_ffi_api->string_release) {
+        g_ffi_api->string_release(s);
+    }
+}
+
+// ============================================================
+// 句柄索引表（开放寻址哈希，按 (句柄, 类型) 查找，自动扩容）
+// 删除的条目留下墓碑，保持探测链不断；插入时复用墓碑，扩容时清除
+// ============================================================
+
+typedef struct {
+    void* key;
+    int type;
+    void* value;
+} HandleMapEntry;
+
+typedef struct {
+    HandleMapEntry* entries;
+    int capacity;   // 2 的幂，0 表示尚未分配
+    int count;
+    int tombstones;
+} HandleMap;
+
+// 墓碑键：指向一个静态变量，不会与任何句柄或定时器 id 相同
+static char handle_map_tombstone_tag;
+#define HANDLE_MAP_TOMBSTONE ((void*)&handle_map_tombstone_tag)
+
+static unsigned int handle_map_hash(void* key, int type) {
+    uintptr_t h = (uintptr_t)key >> 3;
+    h ^= (uintptr_t)type * 0x9E3779B9u;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 15;
+    return (unsigned int)h;
+}
+
+static void* handle_map_get(const HandleMap* map, void* key, int type) {
+    if (map->capacity == 0 || !key) return NULL;
+    unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int i = handle_map_hash(key, type) & mask;
+    while (map->entries[i].key) {
+        if (map->entries[i].key == key && map->entries[i].type == type) {
+            return map->entries[i].value;
+        }
+        i = (i + 1) & mask;
+    }
+    return NULL;
+}
+
+// 写入 key 所在的槽位；key 不存在时优先复用探测链上的第一个墓碑
+// 返回 0 表示覆盖已有条目，1 表示新建于空槽，2 表示新建于墓碑
+static int handle_map_insert_slot(HandleMapEntry* entries, int capacity,
+                                  void* key, int type, void* value) {
+    unsigned int mask = (unsigned int)capacity - 1;
+    unsigned int i = handle_map_hash(key, type) & mask;
+    HandleMapEntry* tomb = NULL;
+    while (entries[i].key && !(entries[i].key == key && entries[i].type == type)) {
+        if (!tomb && entries[i].key == HANDLE_MAP_TOMBSTONE) tomb = &entries[i];
+        i = (i + 1) & mask;
+    }
+    HandleMapEntry* slot = &entries[i];
+    int result = slot->key ? 0 : 1;
+    if (result && tomb) {
+        slot = tomb;
+        result = 2;
+    }
+    slot->key = key;
+    slot->type = type;
+    slot->value = value;
+    return result;
+}
+
+// 插入或覆盖，成功返回 1
+static int handle_map_put(HandleMap* map, void* key, int type, void* value) {
+    if (!key) return 0;
+    // 负载因子（含墓碑）保持在 1/2 以下；墓碑较多时按原容量重建即可
+    if ((map->count + map->tombstones + 1) * 2 > map->capacity) {
+        int new_capacity = map->capacity ? map->capacity : 64;
+        while ((map->count + 1) * 3 > new_capacity) new_capacity *= 2;
+        HandleMapEntry* entries = (HandleMapEntry*)calloc(new_capacity, sizeof(HandleMapEntry));
+        if (!entries) return 0;
+        for (int i = 0; i < map->capacity; i++) {
+            void* k = map->entries[i].key;
+            if (k && k != HANDLE_MAP_TOMBSTONE) {
+                handle_map_insert_slot(entries, new_capacity, k,
+                                       map->entries[i].type, map->entries[i].value);
+            }
+        }
+        free(map->entries);
+        map->entries = entries;
+        map->capacity = new_capacity;
+        map->tombstones = 0;
+    }
+    int result = handle_map_insert_slot(map->entries, map->capacity, key, type, value);
+    if (result) map->count++;
+    if (result == 2) map->tombstones--;
+    return 1;
+}
+
+// 删除条目，存在时返回 1
+static int handle_map_remove(HandleMap* map, void* key, int type) {
+    if (map->capacity == 0 || !key) return 0;
+    unsigned int mask = (unsigned int)map->capacity - 1;
+    unsigned int i = handle_map_hash(key, type) & mask;
+    while (map->entries[i].key) {
+        if (map->entries[i].key == key && map->entries[i].type == type) {
+            map->entries[i].key = HANDLE_MAP_TOMBSTONE;
+            map->entries[i].value = NULL;
+            map->count--;
+            map->tombstones++;
+            return 1;
+        }
+        i = (i + 1) & mask;
+    }
+    return 0;
+}
+
+// ============================================================
+// 回调存储
+// ============================================================
 
 typedef enum {
     CB_CLICK,
@@ -48,32 +209,63 @@ typedef enum {
     CB_RESIZE
 } CallbackType;
 
-typedef struct {
-    HWND hwnd;
-    CallbackType type;
-    void* callback;
-} CallbackEntry;
-
-static CallbackEntry g_callbacks[MAX_CALLBACKS];
-static int g_callback_count = 0;
-
-// 定时器
-#define MAX_TIMERS 32
-typedef struct {
-    UINT_PTR id;
-    void (*callback)(void);
-} TimerEntry;
+static HandleMap g_callbacks = {0};
 
-static TimerEntry g_timers[MAX_TIMERS];
-static int g_timer_count = 0;
+// 定时器: id -> 回调，WM_TIMER 按 id 直接查找
+static HandleMap g_timers = {0};
 static UINT_PTR g_timer_id_counter = 1;
 
-// 文本缓冲区
-static char g_text_buffer[8192];
-static wchar_t g_wtext_buffer[4096];
+// 帧调度: 后台线程用高精度可等待定时器（或 DwmFlush 跟随垂直同步）计时，
+// 每帧向主窗口投递一条 WM_BOLIDE_FRAME，帧回调始终在 UI 线程上执行
+#define WM_BOLIDE_FRAME (WM_APP + 2)
+#define FRAME_DEFAULT_INTERVAL_US 16667
 
-// 画布数据
-#define MAX_CANVAS 32
+typedef struct {
+    HWND canvas;
+    void (*callback)(int64_t);   // 参数为距上一帧的微秒数
+    int64_t last_us;
+} FrameEntry;
+
+static FrameEntry* g_frames = NULL;
+static int g_frame_count = 0;
+static int g_frame_capacity = 0;
+static int g_frame_dispatching = 0;             // 正在派发帧回调，期间只做标记不做压缩
+static HANDLE g_frame_thread = NULL;
+static HANDLE g_frame_wake = NULL;              // 有帧回调注册时唤醒计时线程
+static volatile LONG g_frame_active = 0;
+static volatile LONG g_frame_posted = 0;        // 已投递但尚未处理的帧消息，防止堆积
+static volatile LONG g_frame_interval_us = FRAME_DEFAULT_INTERVAL_US;  // <= 0 表示跟随垂直同步
+
+// 跨线程投递: 工作线程无锁压栈，UI 线程在一条 WM_BOLIDE_POST 中一次取走全部
+#define WM_BOLIDE_POST (WM_APP + 3)
+
+typedef struct PostNode {
+    void (*callback)(int64_t);
+    int64_t arg;
+    struct PostNode* next;
+} PostNode;
+
+static PostNode* volatile g_post_top = NULL;    // 后进先出栈顶，取出后反转为投递顺序
+static volatile LONG g_post_wake_failed = 0;    // PostMessage 失败时由消息循环兜底处理
+
+// 线程局部存储
+#ifdef _MSC_VER
+    #define GUI_THREAD_LOCAL __declspec(thread)
+#else
+    #define GUI_THREAD_LOCAL __thread
+#endif
+
+// GDI 对象缓存项，按 (颜色, 线宽, 线型) 查找
+#define GDI_CACHE_SIZE 16
+typedef struct {
+    HGDIOBJ obj;        // NULL 表示空槽
+    COLORREF color;
+    int width;
+    int style;
+    unsigned int last_used;
+} GdiCacheEntry;
+
+// 画布数据（每个画布单独分配，指针存放在窗口的 GWLP_USERDATA 中）
 typedef struct {
     HWND hwnd;
     HDC memDC;
@@ -81,10 +273,21 @@ typedef struct {
     HBITMAP oldBitmap;
     int width;
     int height;
+    uint32_t* pixels;   // DIB 模式下的像素缓冲区（0x00RRGGBB，自上而下），否则为 NULL
+    int stride;         // 每行字节数
+    RECT dirty;         // 自上次刷新以来被修改区域的并集
+    int has_dirty;
+    int pixels_exposed; // 已通过 gui_canvas_pixels 交出像素指针，调用方可随时直接写入
+    GdiCacheEntry pens[GDI_CACHE_SIZE];     // 画笔缓存（LRU）
+    GdiCacheEntry brushes[GDI_CACHE_SIZE];  // 画刷缓存（LRU）
+    unsigned int gdi_clock;
+    // 状态式绘制 API 当前选择的画笔/画刷（按键值保存，绘制时从缓存取得）
+    int pen_color, pen_width, pen_style;
+    int brush_color;    // < 0 表示不填充
 } CanvasData;
 
-static CanvasData g_canvas[MAX_CANVAS];
-static int g_canvas_count = 0;
+// 重绘模式: 0 = 同步 (UpdateWindow 立即重绘)，1 = 延迟合并到下一轮消息循环
+static int g_deferred_repaint = 0;
 
 // 菜单回调
 #define MAX_MENU_CALLBACKS 128
@@ -104,70 +307,284 @@ typedef enum {
     LAYOUT_GRID     // 网格布局
 } LayoutType;
 
-#define MAX_LAYOUT_CHILDREN 64
-typedef struct {
+typedef struct Layout {
     HWND parent;
     LayoutType type;
     int margin;      // 外边距
     int spacing;     // 子控件间距
     int grid_cols;   // 网格列数（仅用于 GRID）
-    HWND children[MAX_LAYOUT_CHILDREN];
+    HWND* children;  // 按需扩容
     int child_count;
+    int child_capacity;
+    int dirty;       // 已请求重新布局但尚未执行
+    struct Layout* next;  // 同一父窗口下的下一个布局
 } Layout;
 
-#define MAX_LAYOUTS 32
-static Layout g_layouts[MAX_LAYOUTS];
-static int g_layout_count = 0;
+// 延迟布局消息: 在消息循环的下一轮统一执行
+#define WM_BOLIDE_LAYOUT (WM_APP + 1)
+
+static void relayout_window(HWND parent, int only_dirty);
+static void run_frame_callbacks(void);
+static void drain_posted(void);
+
+// 虚拟列表: 行文本只在可见行需要绘制时才转换，数据可以来自 Bolide list<str>
+// 或按行号返回字符串的回调
+typedef struct {
+    HWND hwnd;
+    BolideListView* source;      // list<str>，由 Bolide 侧持有，需在控件存续期间保持存活
+    void* (*text_cb)(int64_t);   // 返回 BolideString*，调用方获得一个引用
+    int count;
+} VirtualList;
+
+static HandleMap g_vlists = {0};
+static void vlist_fill_text(VirtualList* vl, int row, wchar_t* out, int cap);
+
+// 父窗口 -> 该窗口的布局链表头
+static HandleMap g_layouts = {0};
 
 // ============================================================
 // 工具函数
 // ============================================================
 
-static wchar_t* utf8_to_utf16(const char* utf8) {
+static VirtualList* find_vlist(HWND hwnd) {
+    return (VirtualList*)handle_map_get(&g_vlists, hwnd, 0);
+}
+
+// ------------------------------------------------------------
+// 文本转换
+// 短字符串直接在调用方栈上转换；长字符串使用每线程的临时内存池(按栈顺序分配，
+// 重入安全)，全程不调用 malloc/free，并且只做一次转换。
+// ------------------------------------------------------------
+
+#define WTEXT_INLINE_CAP 256
+#define SCRATCH_MIN_CHUNK (64 * 1024)
+
+typedef struct ScratchChunk {
+    struct ScratchChunk* prev;
+    size_t size;
+    size_t used;
+    // 数据紧随其后
+} ScratchChunk;
+
+static GUI_THREAD_LOCAL ScratchChunk* t_scratch = NULL;
+static GUI_THREAD_LOCAL ScratchChunk* t_scratch_spare = NULL;
+
+typedef struct {
+    ScratchChunk* chunk;
+    size_t used;
+} ScratchMark;
+
+static ScratchMark scratch_mark(void) {
+    ScratchMark m;
+    m.chunk = t_scratch;
+    m.used = t_scratch ? t_scratch->used : 0;
+    return m;
+}
+
+static void* scratch_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (!t_scratch || t_scratch->used + size > t_scratch->size) {
+        ScratchChunk* chunk = NULL;
+        if (t_scratch_spare && t_scratch_spare->size >= size) {
+            chunk = t_scratch_spare;
+            t_scratch_spare = NULL;
+        } else {
+            size_t chunk_size = SCRATCH_MIN_CHUNK;
+            if (t_scratch && t_scratch->size * 2 > chunk_size) chunk_size = t_scratch->size * 2;
+            if (size > chunk_size) chunk_size = size;
+            chunk = (ScratchChunk*)malloc(sizeof(ScratchChunk) + chunk_size);
+            if (!chunk) return NULL;
+            chunk->size = chunk_size;
+        }
+        chunk->used = 0;
+        chunk->prev = t_scratch;
+        t_scratch = chunk;
+    }
+    void* p = (char*)(t_scratch + 1) + t_scratch->used;
+    t_scratch->used += size;
+    return p;
+}
+
+// 回退到 mark 时的位置；已经回退过的 mark 再次回退是无操作
+static void scratch_reset(ScratchMark m) {
+    ScratchChunk* c = t_scratch;
+    while (c && c != m.chunk) c = c->prev;
+    if (c != m.chunk) return;
+
+    while (t_scratch != m.chunk) {
+        ScratchChunk* top = t_scratch;
+        t_scratch = top->prev;
+        // 保留一个最大的空闲块供下次使用
+        if (!t_scratch_spare || t_scratch_spare->size < top->size) {
+            free(t_scratch_spare);
+            t_scratch_spare = top;
+        } else {
+            free(top);
+        }
+    }
+    if (t_scratch && m.used < t_scratch->used) t_scratch->used = m.used;
+}
+
+typedef struct {
+    const wchar_t* str;
+    int len;              // 不含结尾 0
+    int in_scratch;
+    ScratchMark mark;
+    wchar_t inline_buf[WTEXT_INLINE_CAP];
+} WText;
+
+// UTF-8 -> UTF-16。len < 0 时按 0 结尾计算长度。utf8 为 NULL 时返回 NULL
+static const wchar_t* wtext_from_utf8(WText* wt, const char* utf8, int len) {
+    wt->str = NULL;
+    wt->len = 0;
+    wt->in_scratch = 0;
     if (!utf8) return NULL;
-    int len = MultiByteToWideChar(CP_UTF8, 0, utf8, -1, NULL, 0);
-    wchar_t* utf16 = (wchar_t*)malloc(len * sizeof(wchar_t));
-    if (utf16) {
-        MultiByteToWideChar(CP_UTF8, 0, utf8, -1, utf16, len);
+    if (len < 0) len = (int)strlen(utf8);
+
+    // UTF-16 代码单元数不会超过 UTF-8 字节数，按上界准备缓冲区即可一次转换
+    wchar_t* out = wt->inline_buf;
+    if (len + 1 > WTEXT_INLINE_CAP) {
+        wt->mark = scratch_mark();
+        out = (wchar_t*)scratch_alloc(((size_t)len + 1) * sizeof(wchar_t));
+        if (!out) {
+            wt->inline_buf[0] = L'\0';
+            wt->str = wt->inline_buf;
+            return wt->str;
+        }
+        wt->in_scratch = 1;
     }
-    return utf16;
+
+    int n = len > 0 ? MultiByteToWideChar(CP_UTF8, 0, utf8, len, out, len) : 0;
+    out[n] = L'\0';
+    wt->str = out;
+    wt->len = n;
+    return out;
+}
+
+// 直接从 BolideString 转换，长度取自字符串头，不需要 strlen
+static const wchar_t* wtext_from_bolide(WText* wt, const void* bolide_str) {
+    const BolideStringView* bs = (const BolideStringView*)bolide_str;
+    if (!bs) {
+        wt->str = NULL;
+        wt->len = 0;
+        wt->in_scratch = 0;
+        return NULL;
+    }
+    return wtext_from_utf8(wt, bs->data ? bs->data : "", bs->data ? (int)bs->len : 0);
 }
 
-static char* utf16_to_utf8(const wchar_t* utf16) {
-    if (!utf16) return NULL;
-    int len = WideCharToMultiByte(CP_UTF8, 0, utf16, -1, NULL, 0, NULL, NULL);
-    char* utf8 = (char*)malloc(len);
-    if (utf8) {
-        WideCharToMultiByte(CP_UTF8, 0, utf16, -1, utf8, len, NULL, NULL);
+static void wtext_release(WText* wt) {
+    if (wt->in_scratch) {
+        scratch_reset(wt->mark);
+        wt->in_scratch = 0;
     }
-    return utf8;
 }
 
-static void register_callback(HWND hwnd, CallbackType type, void* callback) {
-    if (g_callback_count < MAX_CALLBACKS) {
-        g_callbacks[g_callback_count].hwnd = hwnd;
-        g_callbacks[g_callback_count].type = type;
-        g_callbacks[g_callback_count].callback = callback;
-        g_callback_count++;
+// 以 "\0\0" 结尾的多段字符串（如文件过滤器）的字节长度，含最后的两个 0
+static int utf8_multi_len(const char* s) {
+    const char* p = s;
+    while (p[0] || p[1]) p++;
+    return (int)(p - s) + 2;
+}
+
+// 返回给 Bolide 的 UTF-8 文本缓冲区（每线程一份，按需增长，下次调用前有效）
+static GUI_THREAD_LOCAL char* t_text_out = NULL;
+static GUI_THREAD_LOCAL size_t t_text_out_cap = 0;
+
+static char* text_out_reserve(size_t size) {
+    if (size > t_text_out_cap) {
+        size_t cap = t_text_out_cap ? t_text_out_cap : 256;
+        while (cap < size) cap *= 2;
+        char* buf = (char*)realloc(t_text_out, cap);
+        if (!buf) return NULL;
+        t_text_out = buf;
+        t_text_out_cap = cap;
     }
+    return t_text_out;
+}
+
+static const char* text_out_empty(void) {
+    char* out = text_out_reserve(1);
+    if (!out) return "";
+    out[0] = '\0';
+    return out;
+}
+
+// UTF-16 -> UTF-8，wlen 为代码单元数（不含结尾 0）
+static const char* text_out_from_utf16(const wchar_t* w, int wlen) {
+    if (!w || wlen <= 0) return text_out_empty();
+    // 每个 UTF-16 代码单元最多 3 个 UTF-8 字节
+    size_t cap = (size_t)wlen * 3 + 1;
+    char* out = text_out_reserve(cap);
+    if (!out) return "";
+    int n = WideCharToMultiByte(CP_UTF8, 0, w, wlen, out, (int)cap - 1, NULL, NULL);
+    out[n > 0 ? n : 0] = '\0';
+    return out;
+}
+
+// 读取窗口文本为 UTF-8，长度不受限制
+static const char* window_text_utf8(HWND hwnd) {
+    int wlen = GetWindowTextLengthW(hwnd);
+    if (wlen <= 0) return text_out_empty();
+
+    ScratchMark mark = scratch_mark();
+    wchar_t* wbuf = (wchar_t*)scratch_alloc(((size_t)wlen + 1) * sizeof(wchar_t));
+    if (!wbuf) return text_out_empty();
+    int got = GetWindowTextW(hwnd, wbuf, wlen + 1);
+    const char* result = text_out_from_utf16(wbuf, got);
+    scratch_reset(mark);
+    return result;
+}
+
+// 同一控件重复注册同类回调时，以最后一次为准
+static void register_callback(HWND hwnd, CallbackType type, void* callback) {
+    handle_map_put(&g_callbacks, hwnd, (int)type, callback);
 }
 
 static void* find_callback(HWND hwnd, CallbackType type) {
-    for (int i = 0; i < g_callback_count; i++) {
-        if (g_callbacks[i].hwnd == hwnd && g_callbacks[i].type == type) {
-            return g_callbacks[i].callback;
-        }
-    }
-    return NULL;
+    return handle_map_get(&g_callbacks, hwnd, (int)type);
 }
 
 static CanvasData* find_canvas(HWND hwnd) {
-    for (int i = 0; i < g_canvas_count; i++) {
-        if (g_canvas[i].hwnd == hwnd) {
-            return &g_canvas[i];
-        }
+    if (!hwnd) return NULL;
+    return (CanvasData*)GetWindowLongPtrW(hwnd, GWLP_USERDATA);
+}
+
+// 将 [left, right) x [top, bottom) 并入画布的脏区域
+static void canvas_mark_dirty(CanvasData* cd, int left, int top, int right, int bottom) {
+    if (left > right) { int t = left; left = right; right = t; }
+    if (top > bottom) { int t = top; top = bottom; bottom = t; }
+    if (left < 0) left = 0;
+    if (top < 0) top = 0;
+    if (right > cd->width) right = cd->width;
+    if (bottom > cd->height) bottom = cd->height;
+    if (left >= right || top >= bottom) return;
+
+    if (!cd->has_dirty) {
+        cd->dirty.left = left;
+        cd->dirty.top = top;
+        cd->dirty.right = right;
+        cd->dirty.bottom = bottom;
+        cd->has_dirty = 1;
+        return;
     }
-    return NULL;
+    if (left < cd->dirty.left) cd->dirty.left = left;
+    if (top < cd->dirty.top) cd->dirty.top = top;
+    if (right > cd->dirty.right) cd->dirty.right = right;
+    if (bottom > cd->dirty.bottom) cd->dirty.bottom = bottom;
+}
+
+static void canvas_mark_all_dirty(CanvasData* cd) {
+    canvas_mark_dirty(cd, 0, 0, cd->width, cd->height);
+}
+
+// 取出待重绘区域并清空脏标记；交出过像素指针的画布无法跟踪写入，每次都整幅重绘
+static int canvas_take_dirty(CanvasData* cd, RECT* out) {
+    if (cd->pixels_exposed) canvas_mark_all_dirty(cd);
+    if (!cd->has_dirty) return 0;
+    *out = cd->dirty;
+    cd->has_dirty = 0;
+    return 1;
 }
 
 static HFONT create_scaled_font(int dpi) {
@@ -183,6 +600,8 @@ static HFONT create_scaled_font(int dpi) {
 // 画布窗口过程
 // ============================================================
 
+static void canvas_gdi_cache_clear(CanvasData* cd);
+
 static LRESULT CALLBACK CanvasWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
         case WM_PAINT: {
@@ -190,13 +609,29 @@ static LRESULT CALLBACK CanvasWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM
             HDC hdc = BeginPaint(hwnd, &ps);
             CanvasData* cd = find_canvas(hwnd);
             if (cd && cd->memDC) {
-                BitBlt(hdc, 0, 0, cd->width, cd->height, cd->memDC, 0, 0, SRCCOPY);
+                // 只拷贝需要重绘的区域
+                RECT* rc = &ps.rcPaint;
+                BitBlt(hdc, rc->left, rc->top, rc->right - rc->left, rc->bottom - rc->top,
+                       cd->memDC, rc->left, rc->top, SRCCOPY);
             }
             EndPaint(hwnd, &ps);
             return 0;
         }
         case WM_ERASEBKGND:
             return 1;
+        case WM_NCDESTROY: {
+            // 释放画布资源
+            CanvasData* cd = find_canvas(hwnd);
+            if (cd) {
+                SetWindowLongPtrW(hwnd, GWLP_USERDATA, 0);
+                canvas_gdi_cache_clear(cd);
+                SelectObject(cd->memDC, cd->oldBitmap);
+                DeleteObject(cd->memBitmap);
+                DeleteDC(cd->memDC);
+                free(cd);
+            }
+            break;
+        }
         case WM_MOUSEMOVE: {
             void (*cb)(int, int) = (void (*)(int, int))find_callback(hwnd, CB_MOUSE_MOVE);
             if (cb) {
@@ -286,6 +721,27 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
             }
             break;
         }
+        case WM_NOTIFY: {
+            NMHDR* nm = (NMHDR*)lParam;
+            VirtualList* vl = nm ? find_vlist(nm->hwndFrom) : NULL;
+            if (!vl) break;
+            if (nm->code == LVN_GETDISPINFOW) {
+                NMLVDISPINFOW* di = (NMLVDISPINFOW*)lParam;
+                if (di->item.mask & LVIF_TEXT) {
+                    vlist_fill_text(vl, di->item.iItem, di->item.pszText, di->item.cchTextMax);
+                }
+                return 0;
+            }
+            if (nm->code == LVN_ITEMCHANGED) {
+                NMLISTVIEW* lv = (NMLISTVIEW*)lParam;
+                if ((lv->uChanged & LVIF_STATE) &&
+                    (lv->uNewState & LVIS_SELECTED) && !(lv->uOldState & LVIS_SELECTED)) {
+                    void (*cb)(void) = (void (*)(void))find_callback(nm->hwndFrom, CB_SELECT);
+                    if (cb) cb();
+                }
+            }
+            break;
+        }
         case WM_HSCROLL:
         case WM_VSCROLL: {
             HWND ctrl = (HWND)lParam;
@@ -296,14 +752,26 @@ static LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lPara
             break;
         }
         case WM_TIMER: {
-            for (int i = 0; i < g_timer_count; i++) {
-                if (g_timers[i].id == wParam && g_timers[i].callback) {
-                    g_timers[i].callback();
-                }
-            }
+            void (*cb)(void) = (void (*)(void))handle_map_get(&g_timers, (void*)wParam, 0);
+            if (cb) cb();
             break;
         }
+        case WM_BOLIDE_POST:
+            drain_posted();
+            return 0;
+        case WM_BOLIDE_FRAME:
+            // 先清除标记，回调耗时超过一帧时计时线程最多再排队一条
+            InterlockedExchange(&g_frame_posted, 0);
+            run_frame_callbacks();
+            return 0;
+        case WM_BOLIDE_LAYOUT:
+            relayout_window(hwnd, 1);
+            return 0;
         case WM_SIZE: {
+            // 窗口尺寸变化时重新计算所有布局
+            if (wParam != SIZE_MINIMIZED) {
+                relayout_window(hwnd, 0);
+            }
             void (*cb)(int, int) = (void (*)(int, int))find_callback(hwnd, CB_RESIZE);
             if (cb) {
                 cb(LOWORD(lParam), HIWORD(lParam));
@@ -443,6 +911,10 @@ GUI_API void gui_run(void) {
     while (GetMessage(&msg, NULL, 0, 0)) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
+        if (g_post_wake_failed) {
+            InterlockedExchange(&g_post_wake_failed, 0);
+            drain_posted();
+        }
     }
 }
 
@@ -455,7 +927,8 @@ GUI_API void gui_quit(void) {
 // ============================================================
 
 GUI_API void* gui_window(const char* title, int width, int height) {
-    wchar_t* wtitle = utf8_to_utf16(title);
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title, -1);
 
     // 获取系统 DPI 进行缩放
     HDC hdc = GetDC(NULL);
@@ -479,7 +952,7 @@ GUI_API void* gui_window(const char* title, int width, int height) {
         NULL, NULL, g_hInstance, NULL
     );
 
-    free(wtitle);
+    wtext_release(&wtitle_buf);
 
     if (g_main_window == NULL) {
         g_main_window = hwnd;
@@ -500,15 +973,14 @@ GUI_API void gui_close(void* hwnd) {
 }
 
 GUI_API void gui_set_title(void* hwnd, const char* title) {
-    wchar_t* wtitle = utf8_to_utf16(title);
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title, -1);
     SetWindowTextW((HWND)hwnd, wtitle);
-    free(wtitle);
+    wtext_release(&wtitle_buf);
 }
 
 GUI_API const char* gui_get_title(void* hwnd) {
-    GetWindowTextW((HWND)hwnd, g_wtext_buffer, 4096);
-    WideCharToMultiByte(CP_UTF8, 0, g_wtext_buffer, -1, g_text_buffer, sizeof(g_text_buffer), NULL, NULL);
-    return g_text_buffer;
+    return window_text_utf8((HWND)hwnd);
 }
 
 GUI_API void gui_set_position(void* hwnd, int x, int y) {
@@ -564,16 +1036,18 @@ static HWND create_control(const wchar_t* className, const wchar_t* text, DWORD
 }
 
 GUI_API void* gui_button(void* parent, const char* text, int x, int y, int w, int h) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     HWND btn = create_control(L"BUTTON", wtext, BS_PUSHBUTTON, (HWND)parent, x, y, w, h);
-    free(wtext);
+    wtext_release(&wtext_buf);
     return btn;
 }
 
 GUI_API void* gui_label(void* parent, const char* text, int x, int y, int w, int h) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     HWND label = create_control(L"STATIC", wtext, SS_LEFT, (HWND)parent, x, y, w, h);
-    free(wtext);
+    wtext_release(&wtext_buf);
     return label;
 }
 
@@ -598,9 +1072,10 @@ GUI_API void* gui_password(void* parent, int x, int y, int w, int h) {
 // ============================================================
 
 GUI_API void* gui_checkbox(void* parent, const char* text, int x, int y, int w, int h) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     HWND chk = create_control(L"BUTTON", wtext, BS_AUTOCHECKBOX, (HWND)parent, x, y, w, h);
-    free(wtext);
+    wtext_release(&wtext_buf);
     return chk;
 }
 
@@ -613,11 +1088,12 @@ GUI_API void gui_checkbox_set(void* handle, int checked) {
 }
 
 GUI_API void* gui_radio(void* parent, const char* text, int x, int y, int w, int h, int group_start) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     DWORD style = BS_AUTORADIOBUTTON;
     if (group_start) style |= WS_GROUP;
     HWND radio = create_control(L"BUTTON", wtext, style, (HWND)parent, x, y, w, h);
-    free(wtext);
+    wtext_release(&wtext_buf);
     return radio;
 }
 
@@ -674,15 +1150,24 @@ GUI_API void* gui_listbox(void* parent, int x, int y, int w, int h) {
 }
 
 GUI_API void gui_listbox_add(void* handle, const char* text) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
+    SendMessageW((HWND)handle, LB_ADDSTRING, 0, (LPARAM)wtext);
+    wtext_release(&wtext_buf);
+}
+
+GUI_API void gui_listbox_add_str(void* handle, void* text) {
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_bolide(&wtext_buf, text);
     SendMessageW((HWND)handle, LB_ADDSTRING, 0, (LPARAM)wtext);
-    free(wtext);
+    wtext_release(&wtext_buf);
 }
 
 GUI_API void gui_listbox_insert(void* handle, int index, const char* text) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     SendMessageW((HWND)handle, LB_INSERTSTRING, index, (LPARAM)wtext);
-    free(wtext);
+    wtext_release(&wtext_buf);
 }
 
 GUI_API void gui_listbox_remove(void* handle, int index) {
@@ -709,57 +1194,32 @@ GUI_API const char* gui_listbox_get_text(void* handle, int index) {
     // 检查 index 是否有效
     int count = (int)SendMessage((HWND)handle, LB_GETCOUNT, 0, 0);
     if (index < 0 || index >= count) {
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
+        return text_out_empty();
     }
 
     // 获取文本长度（不包含 null terminator）
     int len = (int)SendMessageW((HWND)handle, LB_GETTEXTLEN, index, 0);
-    if (len == LB_ERR || len < 0) {
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
-    }
-
-    // 如果长度为 0，返回空字符串
-    if (len == 0) {
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
-    }
-
-    // 确保缓冲区足够大（需要 len + 1 个字符来存储 null terminator）
-    if (len >= 4095) {
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
+    if (len == LB_ERR || len <= 0) {
+        return text_out_empty();
     }
 
-    // 分配临时缓冲区
-    wchar_t* temp_buffer = (wchar_t*)malloc((len + 1) * sizeof(wchar_t));
+    ScratchMark mark = scratch_mark();
+    wchar_t* temp_buffer = (wchar_t*)scratch_alloc(((size_t)len + 1) * sizeof(wchar_t));
     if (!temp_buffer) {
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
+        return text_out_empty();
     }
 
     // 获取文本
-    int result = (int)SendMessageW((HWND)handle, LB_GETTEXT, index, (LPARAM)temp_buffer);
-    if (result == LB_ERR || result != len) {
-        free(temp_buffer);
-        g_text_buffer[0] = '\0';
-        return g_text_buffer;
-    }
-
-    // 确保以 null 结尾
-    temp_buffer[len] = L'\0';
-
-    // 转换为 UTF-8
-    int utf8_len = WideCharToMultiByte(CP_UTF8, 0, temp_buffer, -1, NULL, 0, NULL, NULL);
-    if (utf8_len > 0 && utf8_len <= sizeof(g_text_buffer)) {
-        WideCharToMultiByte(CP_UTF8, 0, temp_buffer, -1, g_text_buffer, sizeof(g_text_buffer), NULL, NULL);
+    const char* result;
+    int got = (int)SendMessageW((HWND)handle, LB_GETTEXT, index, (LPARAM)temp_buffer);
+    if (got == LB_ERR || got != len) {
+        result = text_out_empty();
     } else {
-        g_text_buffer[0] = '\0';
+        result = text_out_from_utf16(temp_buffer, len);
     }
 
-    free(temp_buffer);
-    return g_text_buffer;
+    scratch_reset(mark);
+    return result;
 }
 
 GUI_API void* gui_combobox(void* parent, int x, int y, int w, int h) {
@@ -770,9 +1230,17 @@ GUI_API void* gui_combobox(void* parent, int x, int y, int w, int h) {
 }
 
 GUI_API void gui_combobox_add(void* handle, const char* text) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
+    SendMessageW((HWND)handle, CB_ADDSTRING, 0, (LPARAM)wtext);
+    wtext_release(&wtext_buf);
+}
+
+GUI_API void gui_combobox_add_str(void* handle, void* text) {
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_bolide(&wtext_buf, text);
     SendMessageW((HWND)handle, CB_ADDSTRING, 0, (LPARAM)wtext);
-    free(wtext);
+    wtext_release(&wtext_buf);
 }
 
 GUI_API void gui_combobox_clear(void* handle) {
@@ -791,20 +1259,136 @@ GUI_API int gui_combobox_count(void* handle) {
     return (int)SendMessage((HWND)handle, CB_GETCOUNT, 0, 0);
 }
 
+// ============================================================
+// 虚拟列表 (LVS_OWNERDATA)
+// ============================================================
+
+static int vlist_row_count(VirtualList* vl) {
+    if (vl->source) return (int)vl->source->len;
+    return vl->count;
+}
+
+// 把第 row 行文本直接转换到列表控件提供的缓冲区，不做堆分配
+static void vlist_fill_text(VirtualList* vl, int row, wchar_t* out, int cap) {
+    if (!out || cap <= 0) return;
+    out[0] = L'\0';
+    if (row < 0) return;
+
+    BolideStringView* str = NULL;
+    int owned = 0;
+    if (vl->source) {
+        if ((size_t)row < vl->source->len) {
+            str = (BolideStringView*)(intptr_t)vl->source->data[row];
+        }
+    } else if (vl->text_cb && row < vl->count) {
+        str = (BolideStringView*)vl->text_cb(row);
+        owned = 1;
+    }
+
+    if (str && str->data && str->len > 0) {
+        int n = MultiByteToWideChar(CP_UTF8, 0, str->data, (int)str->len, out, cap - 1);
+        if (n <= 0) {
+            // 超出缓冲区: 截取前 cap - 1 个字节（UTF-16 单元数不会多于字节数）
+            n = MultiByteToWideChar(CP_UTF8, 0, str->data, cap - 1, out, cap - 1);
+        }
+        out[n > 0 ? n : 0] = L'\0';
+    }
+
+    if (owned) release_bolide_string(str);
+}
+
+GUI_API void* gui_vlist(void* parent, int x, int y, int w, int h) {
+    VirtualList* vl = (VirtualList*)calloc(1, sizeof(VirtualList));
+    if (!vl) return NULL;
+
+    HWND hwnd = create_control(WC_LISTVIEWW, L"",
+        LVS_REPORT | LVS_OWNERDATA | LVS_NOCOLUMNHEADER | LVS_SINGLESEL | LVS_SHOWSELALWAYS | WS_BORDER,
+        (HWND)parent, x, y, w, h);
+    if (!hwnd) {
+        free(vl);
+        return NULL;
+    }
+    SendMessageW(hwnd, LVM_SETEXTENDEDLISTVIEWSTYLE, 0,
+        LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER);
+
+    // 单列，占满客户区宽度
+    RECT rc;
+    GetClientRect(hwnd, &rc);
+    LVCOLUMNW col = {0};
+    col.mask = LVCF_WIDTH;
+    col.cx = rc.right - rc.left;
+    SendMessageW(hwnd, LVM_INSERTCOLUMNW, 0, (LPARAM)&col);
+
+    vl->hwnd = hwnd;
+    if (!handle_map_put(&g_vlists, hwnd, 0, vl)) {
+        DestroyWindow(hwnd);
+        free(vl);
+        return NULL;
+    }
+    return hwnd;
+}
+
+// 以 Bolide list<str> 作为数据源，行数取自列表长度
+GUI_API void gui_vlist_set_source(void* handle, void* list) {
+    VirtualList* vl = find_vlist((HWND)handle);
+    if (!vl) return;
+    vl->source = (BolideListView*)list;
+    vl->text_cb = NULL;
+    SendMessageW(vl->hwnd, LVM_SETITEMCOUNT, vlist_row_count(vl), LVSICF_NOSCROLL);
+    InvalidateRect(vl->hwnd, NULL, FALSE);
+}
+
+// 以回调作为数据源: callback(row) 返回该行文本
+GUI_API void gui_vlist_on_text(void* handle, void* (*callback)(int64_t)) {
+    VirtualList* vl = find_vlist((HWND)handle);
+    if (!vl) return;
+    vl->text_cb = callback;
+    vl->source = NULL;
+    InvalidateRect(vl->hwnd, NULL, FALSE);
+}
+
+GUI_API void gui_vlist_set_count(void* handle, int count) {
+    VirtualList* vl = find_vlist((HWND)handle);
+    if (!vl) return;
+    vl->count = count < 0 ? 0 : count;
+    SendMessageW(vl->hwnd, LVM_SETITEMCOUNT, vlist_row_count(vl), LVSICF_NOSCROLL);
+}
+
+GUI_API int gui_vlist_count(void* handle) {
+    VirtualList* vl = find_vlist((HWND)handle);
+    return vl ? vlist_row_count(vl) : 0;
+}
+
+// 数据源内容变化后调用: 同步行数并重绘可见行
+GUI_API void gui_vlist_refresh(void* handle) {
+    VirtualList* vl = find_vlist((HWND)handle);
+    if (!vl) return;
+    SendMessageW(vl->hwnd, LVM_SETITEMCOUNT, vlist_row_count(vl), LVSICF_NOSCROLL);
+    InvalidateRect(vl->hwnd, NULL, FALSE);
+}
+
+GUI_API int gui_vlist_get_selected(void* handle) {
+    return (int)SendMessageW((HWND)handle, LVM_GETNEXTITEM, (WPARAM)-1, LVNI_SELECTED);
+}
+
+GUI_API void gui_vlist_set_selected(void* handle, int index) {
+    LVITEMW item = {0};
+    item.stateMask = LVIS_SELECTED | LVIS_FOCUSED;
+    item.state = LVIS_SELECTED | LVIS_FOCUSED;
+    SendMessageW((HWND)handle, LVM_SETITEMSTATE, (WPARAM)index, (LPARAM)&item);
+    SendMessageW((HWND)handle, LVM_ENSUREVISIBLE, (WPARAM)index, FALSE);
+}
+
 // ============================================================
 // 通用控件操作
 // ============================================================
 
 GUI_API const char* gui_get_text(void* handle) {
-    GetWindowTextW((HWND)handle, g_wtext_buffer, 4096);
-    WideCharToMultiByte(CP_UTF8, 0, g_wtext_buffer, -1, g_text_buffer, sizeof(g_text_buffer), NULL, NULL);
-    return g_text_buffer;
+    return window_text_utf8((HWND)handle);
 }
 
-GUI_API void gui_set_text(void* handle, const char* text) {
-    wchar_t* wtext = utf8_to_utf16(text);
-    SetWindowTextW((HWND)handle, wtext);
-    free(wtext);
+static void set_text_w(HWND handle, const wchar_t* wtext) {
+    SetWindowTextW(handle, wtext);
 
     // 获取父窗口并重绘该控件区域
     HWND parent = GetParent((HWND)handle);
@@ -824,7 +1408,20 @@ GUI_API void gui_set_text(void* handle, const char* text) {
 
     // 同时重绘控件本身
     InvalidateRect((HWND)handle, NULL, TRUE);
-    UpdateWindow((HWND)handle);
+    if (!g_deferred_repaint) UpdateWindow((HWND)handle);
+}
+
+GUI_API void gui_set_text(void* handle, const char* text) {
+    WText wtext_buf;
+    set_text_w((HWND)handle, wtext_from_utf8(&wtext_buf, text, -1));
+    wtext_release(&wtext_buf);
+}
+
+// 直接接收 BolideString*，省去 strlen 与 C 字符串转换
+GUI_API void gui_set_text_str(void* handle, void* text) {
+    WText wtext_buf;
+    set_text_w((HWND)handle, wtext_from_bolide(&wtext_buf, text));
+    wtext_release(&wtext_buf);
 }
 
 GUI_API void gui_enable(void* handle, int enabled) {
@@ -843,9 +1440,7 @@ GUI_API void gui_focus(void* handle) {
 // 画布
 // ============================================================
 
-GUI_API void* gui_canvas(void* parent, int x, int y, int w, int h) {
-    if (g_canvas_count >= MAX_CANVAS) return NULL;
-    
+static void* create_canvas(void* parent, int x, int y, int w, int h, int use_dib) {
     int dpi = gui_get_dpi(parent);
     int sx = MulDiv(x, dpi, 96);
     int sy = MulDiv(y, dpi, 96);
@@ -861,11 +1456,31 @@ GUI_API void* gui_canvas(void* parent, int x, int y, int w, int h) {
     );
     
     if (!hwnd) return NULL;
+
+    CanvasData* cd = (CanvasData*)calloc(1, sizeof(CanvasData));
+    if (!cd) {
+        DestroyWindow(hwnd);
+        return NULL;
+    }
     
     // 创建内存 DC 和位图
     HDC screenDC = GetDC(hwnd);
     HDC memDC = CreateCompatibleDC(screenDC);
-    HBITMAP memBitmap = CreateCompatibleBitmap(screenDC, sw, sh);
+    HBITMAP memBitmap = NULL;
+    void* bits = NULL;
+    if (use_dib) {
+        // 32 位自上而下 DIB，像素可直接读写
+        BITMAPINFO bmi = {0};
+        bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth = sw;
+        bmi.bmiHeader.biHeight = -sh;
+        bmi.bmiHeader.biPlanes = 1;
+        bmi.bmiHeader.biBitCount = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+        memBitmap = CreateDIBSection(screenDC, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    } else {
+        memBitmap = CreateCompatibleBitmap(screenDC, sw, sh);
+    }
     HBITMAP oldBitmap = (HBITMAP)SelectObject(memDC, memBitmap);
     ReleaseDC(hwnd, screenDC);
     
@@ -876,17 +1491,32 @@ GUI_API void* gui_canvas(void* parent, int x, int y, int w, int h) {
     DeleteObject(whiteBrush);
     
     // 保存画布数据
-    CanvasData* cd = &g_canvas[g_canvas_count++];
     cd->hwnd = hwnd;
     cd->memDC = memDC;
     cd->memBitmap = memBitmap;
     cd->oldBitmap = oldBitmap;
     cd->width = sw;
     cd->height = sh;
+    cd->pixels = (uint32_t*)bits;
+    cd->stride = sw * 4;
+    cd->pen_color = 0;
+    cd->pen_width = 1;
+    cd->pen_style = PS_SOLID;
+    cd->brush_color = -1;
+    SetWindowLongPtrW(hwnd, GWLP_USERDATA, (LONG_PTR)cd);
     
     return hwnd;
 }
 
+GUI_API void* gui_canvas(void* parent, int x, int y, int w, int h) {
+    return create_canvas(parent, x, y, w, h, 0);
+}
+
+// 创建以 DIB Section 为后备缓冲的画布，支持直接访问像素
+GUI_API void* gui_canvas_dib(void* parent, int x, int y, int w, int h) {
+    return create_canvas(parent, x, y, w, h, 1);
+}
+
 static COLORREF rgb_from_int(int color) {
     // 从 0xRRGGBB 转换为 COLORREF (0x00BBGGRR)
     int r = (color >> 16) & 0xFF;
@@ -895,19 +1525,77 @@ static COLORREF rgb_from_int(int color) {
     return RGB(r, g, b);
 }
 
+// ------------------------------------------------------------
+// GDI 对象缓存: 每个画布缓存最近使用的画笔和画刷，避免每次绘制都创建/删除
+// ------------------------------------------------------------
+
+static GdiCacheEntry* gdi_cache_lookup(CanvasData* cd, GdiCacheEntry* cache,
+                                       COLORREF color, int width, int style) {
+    GdiCacheEntry* victim = &cache[0];
+    for (int i = 0; i < GDI_CACHE_SIZE; i++) {
+        GdiCacheEntry* e = &cache[i];
+        if (e->obj && e->color == color && e->width == width && e->style == style) {
+            e->last_used = ++cd->gdi_clock;
+            return e;
+        }
+        // 优先使用空槽，否则淘汰最久未使用的
+        if (!e->obj) {
+            if (victim->obj) victim = e;
+        } else if (victim->obj && e->last_used < victim->last_used) {
+            victim = e;
+        }
+    }
+    if (victim->obj) {
+        // 被淘汰的对象可能仍选入 DC 中，先换成库存对象再删除
+        SelectObject(cd->memDC, GetStockObject(NULL_PEN));
+        SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
+        DeleteObject(victim->obj);
+        victim->obj = NULL;
+    }
+    victim->color = color;
+    victim->width = width;
+    victim->style = style;
+    victim->last_used = ++cd->gdi_clock;
+    return victim;
+}
+
+static HPEN canvas_pen(CanvasData* cd, int color, int width, int style) {
+    if (style == PS_NULL) return (HPEN)GetStockObject(NULL_PEN);
+    if (width < 1) width = 1;
+    COLORREF c = rgb_from_int(color);
+    GdiCacheEntry* e = gdi_cache_lookup(cd, cd->pens, c, width, style);
+    if (!e->obj) e->obj = CreatePen(style, width, c);
+    return (HPEN)e->obj;
+}
+
+static HBRUSH canvas_brush(CanvasData* cd, int color) {
+    if (color < 0) return (HBRUSH)GetStockObject(NULL_BRUSH);
+    COLORREF c = rgb_from_int(color);
+    GdiCacheEntry* e = gdi_cache_lookup(cd, cd->brushes, c, 0, 0);
+    if (!e->obj) e->obj = CreateSolidBrush(c);
+    return (HBRUSH)e->obj;
+}
+
+static void canvas_gdi_cache_clear(CanvasData* cd) {
+    SelectObject(cd->memDC, GetStockObject(NULL_PEN));
+    SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
+    for (int i = 0; i < GDI_CACHE_SIZE; i++) {
+        if (cd->pens[i].obj) DeleteObject(cd->pens[i].obj);
+        if (cd->brushes[i].obj) DeleteObject(cd->brushes[i].obj);
+        cd->pens[i].obj = NULL;
+        cd->brushes[i].obj = NULL;
+    }
+}
+
 GUI_API void gui_canvas_rect(void* handle, int x, int y, int w, int h, int color) {
     CanvasData* cd = find_canvas((HWND)handle);
     if (!cd) return;
     
-    HPEN pen = CreatePen(PS_SOLID, 1, rgb_from_int(color));
-    HPEN oldPen = (HPEN)SelectObject(cd->memDC, pen);
-    HBRUSH oldBrush = (HBRUSH)SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
+    SelectObject(cd->memDC, canvas_pen(cd, color, 1, PS_SOLID));
+    SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
     
     Rectangle(cd->memDC, x, y, x + w, y + h);
-    
-    SelectObject(cd->memDC, oldPen);
-    SelectObject(cd->memDC, oldBrush);
-    DeleteObject(pen);
+    canvas_mark_dirty(cd, x, y, x + w, y + h);
 }
 
 GUI_API void gui_canvas_fill_rect(void* handle, int x, int y, int w, int h, int color) {
@@ -915,67 +1603,144 @@ GUI_API void gui_canvas_fill_rect(void* handle, int x, int y, int w, int h, int
     if (!cd) return;
     
     RECT rc = {x, y, x + w, y + h};
-    HBRUSH brush = CreateSolidBrush(rgb_from_int(color));
-    FillRect(cd->memDC, &rc, brush);
-    DeleteObject(brush);
+    FillRect(cd->memDC, &rc, canvas_brush(cd, color));
+    canvas_mark_dirty(cd, x, y, x + w, y + h);
 }
 
 GUI_API void gui_canvas_line(void* handle, int x1, int y1, int x2, int y2, int color) {
     CanvasData* cd = find_canvas((HWND)handle);
     if (!cd) return;
     
-    HPEN pen = CreatePen(PS_SOLID, 1, rgb_from_int(color));
-    HPEN oldPen = (HPEN)SelectObject(cd->memDC, pen);
+    SelectObject(cd->memDC, canvas_pen(cd, color, 1, PS_SOLID));
     
     MoveToEx(cd->memDC, x1, y1, NULL);
     LineTo(cd->memDC, x2, y2);
-    
-    SelectObject(cd->memDC, oldPen);
-    DeleteObject(pen);
+    canvas_mark_dirty(cd, min(x1, x2), min(y1, y2), max(x1, x2) + 1, max(y1, y2) + 1);
 }
 
 GUI_API void gui_canvas_circle(void* handle, int cx, int cy, int r, int color) {
     CanvasData* cd = find_canvas((HWND)handle);
     if (!cd) return;
     
-    HPEN pen = CreatePen(PS_SOLID, 1, rgb_from_int(color));
-    HPEN oldPen = (HPEN)SelectObject(cd->memDC, pen);
-    HBRUSH oldBrush = (HBRUSH)SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
+    SelectObject(cd->memDC, canvas_pen(cd, color, 1, PS_SOLID));
+    SelectObject(cd->memDC, GetStockObject(NULL_BRUSH));
     
     Ellipse(cd->memDC, cx - r, cy - r, cx + r, cy + r);
-    
-    SelectObject(cd->memDC, oldPen);
-    SelectObject(cd->memDC, oldBrush);
-    DeleteObject(pen);
+    canvas_mark_dirty(cd, cx - r, cy - r, cx + r + 1, cy + r + 1);
 }
 
 GUI_API void gui_canvas_fill_circle(void* handle, int cx, int cy, int r, int color) {
     CanvasData* cd = find_canvas((HWND)handle);
     if (!cd) return;
     
-    HBRUSH brush = CreateSolidBrush(rgb_from_int(color));
-    HBRUSH oldBrush = (HBRUSH)SelectObject(cd->memDC, brush);
-    HPEN oldPen = (HPEN)SelectObject(cd->memDC, GetStockObject(NULL_PEN));
+    SelectObject(cd->memDC, canvas_brush(cd, color));
+    SelectObject(cd->memDC, GetStockObject(NULL_PEN));
     
     Ellipse(cd->memDC, cx - r, cy - r, cx + r, cy + r);
-    
-    SelectObject(cd->memDC, oldPen);
-    SelectObject(cd->memDC, oldBrush);
-    DeleteObject(brush);
+    canvas_mark_dirty(cd, cx - r, cy - r, cx + r + 1, cy + r + 1);
 }
 
-GUI_API void gui_canvas_text(void* handle, const char* text, int x, int y, int color) {
+// ------------------------------------------------------------
+// 状态式绘制: 先选择画笔/画刷，后续图元重复使用
+// ------------------------------------------------------------
+
+// style: PS_SOLID(0) / PS_DASH(1) / PS_DOT(2) / PS_DASHDOT(3) / PS_NULL(5，不描边)
+GUI_API void gui_canvas_set_pen(void* handle, int color, int width, int style) {
     CanvasData* cd = find_canvas((HWND)handle);
     if (!cd) return;
-    
-    wchar_t* wtext = utf8_to_utf16(text);
+    cd->pen_color = color;
+    cd->pen_width = width < 1 ? 1 : width;
+    cd->pen_style = style;
+}
+
+// color < 0 表示不填充
+GUI_API void gui_canvas_set_brush(void* handle, int color) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+    cd->brush_color = color;
+}
+
+static void canvas_select_state(CanvasData* cd) {
+    // 先取齐两个对象再选入: 查找画刷时的淘汰会把已选入的画笔换成库存对象
+    HPEN pen = canvas_pen(cd, cd->pen_color, cd->pen_width, cd->pen_style);
+    HBRUSH brush = canvas_brush(cd, cd->brush_color);
+    SelectObject(cd->memDC, pen);
+    SelectObject(cd->memDC, brush);
+}
+
+// 描边扩展量（线宽的一半，向上取整）
+static int canvas_pen_pad(CanvasData* cd) {
+    return cd->pen_style == PS_NULL ? 0 : (cd->pen_width + 1) / 2;
+}
+
+GUI_API void gui_canvas_draw_line(void* handle, int x1, int y1, int x2, int y2) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+
+    SelectObject(cd->memDC, canvas_pen(cd, cd->pen_color, cd->pen_width, cd->pen_style));
+    MoveToEx(cd->memDC, x1, y1, NULL);
+    LineTo(cd->memDC, x2, y2);
+    int pad = canvas_pen_pad(cd);
+    canvas_mark_dirty(cd, min(x1, x2) - pad, min(y1, y2) - pad,
+                      max(x1, x2) + pad + 1, max(y1, y2) + pad + 1);
+}
+
+GUI_API void gui_canvas_draw_rect(void* handle, int x, int y, int w, int h) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+
+    canvas_select_state(cd);
+    Rectangle(cd->memDC, x, y, x + w, y + h);
+    int pad = canvas_pen_pad(cd);
+    canvas_mark_dirty(cd, x - pad, y - pad, x + w + pad, y + h + pad);
+}
+
+GUI_API void gui_canvas_draw_circle(void* handle, int cx, int cy, int r) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+
+    canvas_select_state(cd);
+    Ellipse(cd->memDC, cx - r, cy - r, cx + r, cy + r);
+    int pad = canvas_pen_pad(cd);
+    canvas_mark_dirty(cd, cx - r - pad, cy - r - pad, cx + r + pad + 1, cy + r + pad + 1);
+}
+
+static void canvas_text_w(CanvasData* cd, const WText* wt, int x, int y, int color) {
+    const wchar_t* wtext = wt->str;
+    if (!wtext) return;
     SetTextColor(cd->memDC, rgb_from_int(color));
     SetBkMode(cd->memDC, TRANSPARENT);
     
     if (g_hFont) SelectObject(cd->memDC, g_hFont);
-    TextOutW(cd->memDC, x, y, wtext, (int)wcslen(wtext));
-    
-    free(wtext);
+    int len = wt->len;
+    TextOutW(cd->memDC, x, y, wtext, len);
+
+    SIZE extent;
+    if (GetTextExtentPoint32W(cd->memDC, wtext, len, &extent)) {
+        canvas_mark_dirty(cd, x, y, x + extent.cx, y + extent.cy);
+    } else {
+        canvas_mark_all_dirty(cd);
+    }
+}
+
+GUI_API void gui_canvas_text(void* handle, const char* text, int x, int y, int color) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+
+    WText wtext_buf;
+    wtext_from_utf8(&wtext_buf, text, -1);
+    canvas_text_w(cd, &wtext_buf, x, y, color);
+    wtext_release(&wtext_buf);
+}
+
+GUI_API void gui_canvas_text_str(void* handle, void* text, int x, int y, int color) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) return;
+
+    WText wtext_buf;
+    wtext_from_bolide(&wtext_buf, text);
+    canvas_text_w(cd, &wtext_buf, x, y, color);
+    wtext_release(&wtext_buf);
 }
 
 GUI_API void gui_canvas_clear(void* handle, int color) {
@@ -983,14 +1748,259 @@ GUI_API void gui_canvas_clear(void* handle, int color) {
     if (!cd) return;
     
     RECT rc = {0, 0, cd->width, cd->height};
-    HBRUSH brush = CreateSolidBrush(rgb_from_int(color));
-    FillRect(cd->memDC, &rc, brush);
-    DeleteObject(brush);
+    FillRect(cd->memDC, &rc, canvas_brush(cd, color));
+    canvas_mark_all_dirty(cd);
+}
+
+// ============================================================
+// 画布批量绘制
+// ============================================================
+
+// 命令缓冲区格式: 每条命令占 GUI_CMD_STRIDE 个 int64 槽位
+//   [op, a, b, c, d, color]
+//   LINE:        a=x1 b=y1 c=x2 d=y2
+//   RECT/FILL:   a=x  b=y  c=w  d=h
+//   CIRCLE/FILL: a=cx b=cy c=r  d=未使用
+#define GUI_CMD_STRIDE 6
+
+typedef enum {
+    GUI_CMD_LINE = 1,
+    GUI_CMD_RECT = 2,
+    GUI_CMD_FILL_RECT = 3,
+    GUI_CMD_CIRCLE = 4,
+    GUI_CMD_FILL_CIRCLE = 5
+} CanvasCmdOp;
+
+typedef struct {
+    int color;
+    int index;
+} CanvasCmdKey;
+
+static int compare_cmd_key(const void* a, const void* b) {
+    const CanvasCmdKey* ka = (const CanvasCmdKey*)a;
+    const CanvasCmdKey* kb = (const CanvasCmdKey*)b;
+    if (ka->color != kb->color) return ka->color < kb->color ? -1 : 1;
+    // 同色命令保持提交顺序
+    return ka->index - kb->index;
+}
+
+// 批量回放绘制命令，按颜色排序后每种颜色只取一次画笔/画刷
+// 注意: 不同颜色之间的绘制顺序不保证，需要严格叠放顺序时请分批提交
+// 返回实际绘制的命令数
+GUI_API int gui_canvas_submit(void* handle, const int64_t* cmds, int count) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd || !cmds || count <= 0) return 0;
+
+    CanvasCmdKey* keys = (CanvasCmdKey*)malloc(count * sizeof(CanvasCmdKey));
+    if (!keys) return 0;
+    for (int i = 0; i < count; i++) {
+        keys[i].color = (int)cmds[i * GUI_CMD_STRIDE + 5];
+        keys[i].index = i;
+    }
+    qsort(keys, count, sizeof(CanvasCmdKey), compare_cmd_key);
+
+    HDC dc = cd->memDC;
+    HPEN pen = NULL;
+    HBRUSH brush = NULL;
+    int current_color = 0;
+    int drawn = 0;
+
+    for (int i = 0; i < count; i++) {
+        const int64_t* cmd = &cmds[keys[i].index * GUI_CMD_STRIDE];
+        int op = (int)cmd[0];
+        int a = (int)cmd[1];
+        int b = (int)cmd[2];
+        int c = (int)cmd[3];
+        int d = (int)cmd[4];
+
+        // 颜色变化时才重新从缓存取 GDI 对象
+        if (i == 0 || keys[i].color != current_color) {
+            pen = NULL;
+            brush = NULL;
+            current_color = keys[i].color;
+        }
+
+        switch (op) {
+            case GUI_CMD_LINE:
+            case GUI_CMD_RECT:
+            case GUI_CMD_CIRCLE:
+                if (!pen) pen = canvas_pen(cd, current_color, 1, PS_SOLID);
+                SelectObject(dc, pen);
+                SelectObject(dc, GetStockObject(NULL_BRUSH));
+                if (op == GUI_CMD_LINE) {
+                    MoveToEx(dc, a, b, NULL);
+                    LineTo(dc, c, d);
+                    canvas_mark_dirty(cd, min(a, c), min(b, d), max(a, c) + 1, max(b, d) + 1);
+                } else if (op == GUI_CMD_RECT) {
+                    Rectangle(dc, a, b, a + c, b + d);
+                    canvas_mark_dirty(cd, a, b, a + c, b + d);
+                } else {
+                    Ellipse(dc, a - c, b - c, a + c, b + c);
+                    canvas_mark_dirty(cd, a - c, b - c, a + c + 1, b + c + 1);
+                }
+                drawn++;
+                break;
+            case GUI_CMD_FILL_RECT: {
+                if (!brush) brush = canvas_brush(cd, current_color);
+                RECT rc = {a, b, a + c, b + d};
+                FillRect(dc, &rc, brush);
+                canvas_mark_dirty(cd, a, b, a + c, b + d);
+                drawn++;
+                break;
+            }
+            case GUI_CMD_FILL_CIRCLE:
+                if (!brush) brush = canvas_brush(cd, current_color);
+                SelectObject(dc, GetStockObject(NULL_PEN));
+                SelectObject(dc, brush);
+                Ellipse(dc, a - c, b - c, a + c, b + c);
+                canvas_mark_dirty(cd, a - c, b - c, a + c + 1, b + c + 1);
+                drawn++;
+                break;
+            default:
+                break;
+        }
+    }
+
+    free(keys);
+    return drawn;
+}
+
+// 直接提交 Bolide list<int>（长度需为 GUI_CMD_STRIDE 的整数倍）
+GUI_API int gui_canvas_submit_list(void* handle, void* list) {
+    BolideListView* view = (BolideListView*)list;
+    if (!view || !view->data) return 0;
+    return gui_canvas_submit(handle, view->data, (int)(view->len / GUI_CMD_STRIDE));
+}
+
+// ============================================================
+// 画布像素访问
+// ============================================================
+
+GUI_API int gui_canvas_width(void* handle) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    return cd ? cd->width : 0;
 }
 
+GUI_API int gui_canvas_height(void* handle) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    return cd ? cd->height : 0;
+}
+
+// 返回像素缓冲区指针（仅 DIB 画布），调用前会刷新挂起的 GDI 绘制
+// 调用方可以保存指针逐帧写入：此后每次 refresh/invalidate 都整幅重绘
+GUI_API void* gui_canvas_pixels(void* handle) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd || !cd->pixels) return NULL;
+    GdiFlush();
+    cd->pixels_exposed = 1;
+    return cd->pixels;
+}
+
+GUI_API int gui_canvas_stride(void* handle) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    return (cd && cd->pixels) ? cd->stride : 0;
+}
+
+// 一次性拷贝调用方的 32 位像素缓冲区 (0x00RRGGBB) 到画布
+// src_stride 为每行字节数，传 0 表示紧密排列 (width * 4)
+GUI_API void gui_canvas_blit(void* handle, const void* src, int src_stride) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd || !src) return;
+    if (src_stride <= 0) src_stride = cd->width * 4;
+    canvas_mark_all_dirty(cd);
+
+    if (cd->pixels) {
+        GdiFlush();
+        const uint8_t* in = (const uint8_t*)src;
+        uint8_t* out = (uint8_t*)cd->pixels;
+        int row_bytes = cd->width * 4;
+        if (src_stride == cd->stride) {
+            memcpy(out, in, (size_t)cd->stride * cd->height);
+        } else {
+            for (int y = 0; y < cd->height; y++) {
+                memcpy(out + (size_t)y * cd->stride, in + (size_t)y * src_stride, row_bytes);
+            }
+        }
+        return;
+    }
+
+    // 兼容位图画布: 通过 SetDIBitsToDevice 一次写入
+    BITMAPINFO bmi = {0};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = src_stride / 4;
+    bmi.bmiHeader.biHeight = -cd->height;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    SetDIBitsToDevice(cd->memDC, 0, 0, cd->width, cd->height,
+                      0, 0, 0, cd->height, src, &bmi, DIB_RGB_COLORS);
+}
+
+// 从 Bolide list<int> 写入整帧像素，每个元素为 0xRRGGBB，按行排列
+// 元素不足时只写入已有部分
+GUI_API void gui_canvas_blit_list(void* handle, void* list) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    BolideListView* view = (BolideListView*)list;
+    if (!cd || !view || !view->data) return;
+
+    size_t total = (size_t)cd->width * cd->height;
+    size_t n = view->len < total ? view->len : total;
+    canvas_mark_all_dirty(cd);
+
+    if (cd->pixels) {
+        GdiFlush();
+        const int64_t* in = view->data;
+        for (int y = 0; y < cd->height && n > 0; y++) {
+            uint32_t* row = (uint32_t*)((uint8_t*)cd->pixels + (size_t)y * cd->stride);
+            size_t cols = n < (size_t)cd->width ? n : (size_t)cd->width;
+            for (size_t x = 0; x < cols; x++) {
+                row[x] = (uint32_t)in[x] & 0x00FFFFFFu;
+            }
+            in += cols;
+            n -= cols;
+        }
+        return;
+    }
+
+    uint32_t* tmp = (uint32_t*)calloc(total, sizeof(uint32_t));
+    if (!tmp) return;
+    for (size_t i = 0; i < n; i++) {
+        tmp[i] = (uint32_t)view->data[i] & 0x00FFFFFFu;
+    }
+    gui_canvas_blit(handle, tmp, cd->width * 4);
+    free(tmp);
+}
+
+// 只使脏区域失效；同步模式下立即重绘，延迟模式下由消息循环合并
 GUI_API void gui_canvas_refresh(void* handle) {
-    InvalidateRect((HWND)handle, NULL, FALSE);
-    UpdateWindow((HWND)handle);
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) {
+        InvalidateRect((HWND)handle, NULL, FALSE);
+        if (!g_deferred_repaint) UpdateWindow((HWND)handle);
+        return;
+    }
+    RECT dirty;
+    if (!canvas_take_dirty(cd, &dirty)) return;
+
+    InvalidateRect((HWND)handle, &dirty, FALSE);
+    if (!g_deferred_repaint) UpdateWindow((HWND)handle);
+}
+
+// 非阻塞刷新: 只标记失效区域，WM_PAINT 在消息队列空闲时合并投递
+GUI_API void gui_canvas_invalidate(void* handle) {
+    CanvasData* cd = find_canvas((HWND)handle);
+    if (!cd) {
+        InvalidateRect((HWND)handle, NULL, FALSE);
+        return;
+    }
+    RECT dirty;
+    if (!canvas_take_dirty(cd, &dirty)) return;
+    InvalidateRect((HWND)handle, &dirty, FALSE);
+}
+
+// 设置全局重绘模式: deferred 非 0 时 gui_canvas_refresh 和 gui_set_text 不再同步重绘
+GUI_API void gui_set_deferred_repaint(int deferred) {
+    g_deferred_repaint = deferred ? 1 : 0;
 }
 
 // ============================================================
@@ -998,11 +2008,13 @@ GUI_API void gui_canvas_refresh(void* handle) {
 // ============================================================
 
 GUI_API int gui_msgbox(void* parent, const char* title, const char* message, int flags) {
-    wchar_t* wtitle = utf8_to_utf16(title);
-    wchar_t* wmessage = utf8_to_utf16(message);
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title, -1);
+    WText wmessage_buf;
+    const wchar_t* wmessage = wtext_from_utf8(&wmessage_buf, message, -1);
     int result = MessageBoxW((HWND)parent, wmessage, wtitle, flags);
-    free(wtitle);
-    free(wmessage);
+    wtext_release(&wtitle_buf);
+    wtext_release(&wmessage_buf);
     return result;
 }
 
@@ -1010,8 +2022,11 @@ static char g_file_buffer[MAX_PATH * 2];
 
 GUI_API const char* gui_open_file(void* parent, const char* filter, const char* title) {
     wchar_t wfilename[MAX_PATH] = {0};
-    wchar_t* wfilter = utf8_to_utf16(filter ? filter : "All Files\0*.*\0");
-    wchar_t* wtitle = utf8_to_utf16(title ? title : "Open File");
+    WText wfilter_buf;
+    const wchar_t* wfilter = wtext_from_utf8(&wfilter_buf, filter ? filter : "All Files\0*.*\0",
+        utf8_multi_len(filter ? filter : "All Files\0*.*\0"));
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title ? title : "Open File", -1);
     
     OPENFILENAMEW ofn = {0};
     ofn.lStructSize = sizeof(ofn);
@@ -1028,15 +2043,18 @@ GUI_API const char* gui_open_file(void* parent, const char* filter, const char*
         g_file_buffer[0] = '\0';
     }
     
-    free(wfilter);
-    free(wtitle);
+    wtext_release(&wfilter_buf);
+    wtext_release(&wtitle_buf);
     return g_file_buffer;
 }
 
 GUI_API const char* gui_save_file(void* parent, const char* filter, const char* title) {
     wchar_t wfilename[MAX_PATH] = {0};
-    wchar_t* wfilter = utf8_to_utf16(filter ? filter : "All Files\0*.*\0");
-    wchar_t* wtitle = utf8_to_utf16(title ? title : "Save File");
+    WText wfilter_buf;
+    const wchar_t* wfilter = wtext_from_utf8(&wfilter_buf, filter ? filter : "All Files\0*.*\0",
+        utf8_multi_len(filter ? filter : "All Files\0*.*\0"));
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title ? title : "Save File", -1);
     
     OPENFILENAMEW ofn = {0};
     ofn.lStructSize = sizeof(ofn);
@@ -1053,8 +2071,8 @@ GUI_API const char* gui_save_file(void* parent, const char* filter, const char*
         g_file_buffer[0] = '\0';
     }
     
-    free(wfilter);
-    free(wtitle);
+    wtext_release(&wfilter_buf);
+    wtext_release(&wtitle_buf);
     return g_file_buffer;
 }
 
@@ -1068,7 +2086,8 @@ static int CALLBACK BrowseFolderCallback(HWND hwnd, UINT uMsg, LPARAM lParam, LP
 
 GUI_API const char* gui_select_folder(void* parent, const char* title) {
     wchar_t wpath[MAX_PATH] = {0};
-    wchar_t* wtitle = utf8_to_utf16(title ? title : "Select Folder");
+    WText wtitle_buf;
+    const wchar_t* wtitle = wtext_from_utf8(&wtitle_buf, title ? title : "Select Folder", -1);
     
     BROWSEINFOW bi = {0};
     bi.hwndOwner = (HWND)parent;
@@ -1084,7 +2103,7 @@ GUI_API const char* gui_select_folder(void* parent, const char* title) {
         g_file_buffer[0] = '\0';
     }
     
-    free(wtitle);
+    wtext_release(&wtitle_buf);
     return g_file_buffer;
 }
 
@@ -1138,7 +2157,8 @@ GUI_API void* gui_menubar(void* window) {
 }
 
 GUI_API void* gui_menu(void* menubar, const char* text) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     HMENU menu = CreatePopupMenu();
     AppendMenuW((HMENU)menubar, MF_POPUP, (UINT_PTR)menu, wtext);
 
@@ -1148,12 +2168,13 @@ GUI_API void* gui_menu(void* menubar, const char* text) {
         DrawMenuBar(hwnd);
     }
 
-    free(wtext);
+    wtext_release(&wtext_buf);
     return menu;
 }
 
 GUI_API void* gui_menu_item(void* menu, const char* text, void (*callback)(void)) {
-    wchar_t* wtext = utf8_to_utf16(text);
+    WText wtext_buf;
+    const wchar_t* wtext = wtext_from_utf8(&wtext_buf, text, -1);
     int id = g_menu_id++;
     AppendMenuW((HMENU)menu, MF_STRING, id, wtext);
     
@@ -1163,7 +2184,7 @@ GUI_API void* gui_menu_item(void* menu, const char* text, void (*callback)(void)
         g_menu_callback_count++;
     }
     
-    free(wtext);
+    wtext_release(&wtext_buf);
     return (void*)(intptr_t)id;
 }
 
@@ -1176,31 +2197,221 @@ GUI_API void gui_menu_separator(void* menu) {
 // ============================================================
 
 GUI_API int gui_set_timer(int interval_ms, void (*callback)(void)) {
-    if (g_main_window == NULL || g_timer_count >= MAX_TIMERS) {
+    if (g_main_window == NULL) {
         return 0;
     }
     UINT_PTR id = g_timer_id_counter++;
+    if (!handle_map_put(&g_timers, (void*)id, 0, (void*)callback)) {
+        return 0;
+    }
     SetTimer(g_main_window, id, interval_ms, NULL);
-    g_timers[g_timer_count].id = id;
-    g_timers[g_timer_count].callback = callback;
-    g_timer_count++;
     return (int)id;
 }
 
 GUI_API void gui_kill_timer(int timer_id) {
-    if (g_main_window == NULL) return;
+    if (g_main_window == NULL || timer_id <= 0) return;
     KillTimer(g_main_window, (UINT_PTR)timer_id);
-    for (int i = 0; i < g_timer_count; i++) {
-        if (g_timers[i].id == (UINT_PTR)timer_id) {
-            for (int j = i; j < g_timer_count - 1; j++) {
-                g_timers[j] = g_timers[j + 1];
+    // 已投递的 WM_TIMER 查不到回调会直接忽略
+    handle_map_remove(&g_timers, (void*)(UINT_PTR)timer_id, 0);
+}
+
+// ============================================================
+// 跨线程投递
+// ============================================================
+
+// 可在任意线程调用: callback(arg) 稍后在 UI 线程上执行，成功返回 1
+GUI_API int gui_post(void (*callback)(int64_t), int64_t arg) {
+    if (!callback || !g_main_window) return 0;
+    PostNode* node = (PostNode*)malloc(sizeof(PostNode));
+    if (!node) return 0;
+    node->callback = callback;
+    node->arg = arg;
+
+    PostNode* top;
+    do {
+        top = g_post_top;
+        node->next = top;
+    } while (InterlockedCompareExchangePointer((PVOID volatile*)&g_post_top, node, top) != top);
+
+    // 只有把空栈变为非空的那次投递需要唤醒，其余的会被同一次取出带走
+    if (top == NULL && !PostMessageW(g_main_window, WM_BOLIDE_POST, 0, 0)) {
+        InterlockedExchange(&g_post_wake_failed, 1);
+    }
+    return 1;
+}
+
+// UI 线程: 整体取出待处理项，按投递顺序执行
+static void drain_posted(void) {
+    PostNode* list = (PostNode*)InterlockedExchangePointer((PVOID volatile*)&g_post_top, NULL);
+    PostNode* ordered = NULL;
+    while (list) {
+        PostNode* next = list->next;
+        list->next = ordered;
+        ordered = list;
+        list = next;
+    }
+    while (ordered) {
+        PostNode* next = ordered->next;
+        ordered->callback(ordered->arg);
+        free(ordered);
+        ordered = next;
+    }
+}
+
+// ============================================================
+// 帧调度
+// ============================================================
+
+typedef HRESULT (WINAPI *DwmFlushFunc)(void);
+
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+static int64_t frame_now_us(void) {
+    static LARGE_INTEGER freq = {0};
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (int64_t)(now.QuadPart / freq.QuadPart) * 1000000 +
+           (int64_t)(now.QuadPart % freq.QuadPart) * 1000000 / freq.QuadPart;
+}
+
+static DWORD WINAPI frame_thread_proc(LPVOID param) {
+    (void)param;
+    // 高精度定时器需要 Windows 10 1803+，否则退回普通可等待定时器
+    HANDLE timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                          TIMER_ALL_ACCESS);
+    if (!timer) timer = CreateWaitableTimerW(NULL, FALSE, NULL);
+
+    DwmFlushFunc dwm_flush = NULL;
+    HMODULE dwmapi = LoadLibraryW(L"dwmapi.dll");
+    if (dwmapi) dwm_flush = (DwmFlushFunc)GetProcAddress(dwmapi, "DwmFlush");
+
+    int64_t next = frame_now_us();
+    for (;;) {
+        if (!g_frame_active) {
+            WaitForSingleObject(g_frame_wake, INFINITE);
+            next = frame_now_us();
+            continue;
+        }
+
+        LONG interval = g_frame_interval_us;
+        int waited = 0;
+        if (interval <= 0 && dwm_flush) {
+            // 跟随合成器的垂直同步；DWM 关闭或失败时退回固定间隔
+            waited = SUCCEEDED(dwm_flush());
+            next = frame_now_us();
+        }
+        if (!waited) {
+            if (interval <= 0) interval = FRAME_DEFAULT_INTERVAL_US;
+            // 按绝对时间推进截止点，避免误差逐帧累积
+            next += interval;
+            int64_t wait = next - frame_now_us();
+            if (wait < -(int64_t)interval) {
+                // 落后超过一帧时重新对齐，不补帧
+                next = frame_now_us();
+            } else if (wait > 0) {
+                if (timer) {
+                    LARGE_INTEGER due;
+                    due.QuadPart = -wait * 10;   // 100ns 为单位，负数表示相对时间
+                    SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE);
+                    WaitForSingleObject(timer, INFINITE);
+                } else {
+                    Sleep((DWORD)(wait / 1000));
+                }
             }
-            g_timer_count--;
-            break;
         }
+
+        if (InterlockedCompareExchange(&g_frame_posted, 1, 0) == 0) {
+            if (!g_main_window || !PostMessageW(g_main_window, WM_BOLIDE_FRAME, 0, 0)) {
+                InterlockedExchange(&g_frame_posted, 0);
+            }
+        }
+    }
+    return 0;
+}
+
+static void frame_update_active(void) {
+    InterlockedExchange(&g_frame_active, g_frame_count > 0);
+    if (g_frame_count > 0 && g_frame_wake) SetEvent(g_frame_wake);
+}
+
+static void run_frame_callbacks(void) {
+    int64_t now = frame_now_us();
+    g_frame_dispatching = 1;
+    // 回调中可能注册新的帧回调（追加到末尾，本帧不执行）或注销（置空）
+    int count = g_frame_count;
+    for (int i = 0; i < count; i++) {
+        FrameEntry* entry = &g_frames[i];
+        if (!entry->callback) continue;
+        int64_t elapsed = now - entry->last_us;
+        entry->last_us = now;
+        entry->callback(elapsed);
+        // 回调可能导致 g_frames 扩容，重新取地址
+        entry = &g_frames[i];
+        // 同步呈现本帧，避免连续的帧消息让 WM_PAINT 一直得不到处理
+        CanvasData* cd = find_canvas(entry->canvas);
+        RECT dirty;
+        if (cd && canvas_take_dirty(cd, &dirty)) {
+            InvalidateRect(entry->canvas, &dirty, FALSE);
+            UpdateWindow(entry->canvas);
+        }
+    }
+    g_frame_dispatching = 0;
+
+    int n = 0;
+    for (int i = 0; i < g_frame_count; i++) {
+        if (g_frames[i].callback && IsWindow(g_frames[i].canvas)) {
+            g_frames[n++] = g_frames[i];
+        }
+    }
+    if (n != g_frame_count) {
+        g_frame_count = n;
+        frame_update_active();
     }
 }
 
+// 为画布注册每帧回调，callback 为 NULL 时注销；同一画布重复注册会替换旧回调
+GUI_API void gui_on_frame(void* handle, void (*callback)(int64_t)) {
+    HWND hwnd = (HWND)handle;
+    for (int i = 0; i < g_frame_count; i++) {
+        if (g_frames[i].canvas == hwnd) {
+            g_frames[i].callback = callback;
+            if (callback) return;
+            if (!g_frame_dispatching) {
+                g_frames[i] = g_frames[--g_frame_count];
+                frame_update_active();
+            }
+            return;
+        }
+    }
+    if (!callback) return;
+
+    if (g_frame_count == g_frame_capacity) {
+        int new_capacity = g_frame_capacity ? g_frame_capacity * 2 : 8;
+        FrameEntry* frames = (FrameEntry*)realloc(g_frames, new_capacity * sizeof(FrameEntry));
+        if (!frames) return;
+        g_frames = frames;
+        g_frame_capacity = new_capacity;
+    }
+    g_frames[g_frame_count].canvas = hwnd;
+    g_frames[g_frame_count].callback = callback;
+    g_frames[g_frame_count].last_us = frame_now_us();
+    g_frame_count++;
+
+    if (!g_frame_thread) {
+        g_frame_wake = CreateEventW(NULL, FALSE, FALSE, NULL);
+        g_frame_thread = CreateThread(NULL, 0, frame_thread_proc, NULL, 0, NULL);
+    }
+    frame_update_active();
+}
+
+// 设置目标帧率；fps <= 0 表示跟随显示器刷新（DwmFlush）
+GUI_API void gui_set_frame_rate(int fps) {
+    InterlockedExchange(&g_frame_interval_us, fps > 0 ? 1000000 / fps : 0);
+}
+
 // ============================================================
 // 事件回调
 // ============================================================
@@ -1254,16 +2465,36 @@ GUI_API void gui_on_resize(void* handle, void (*callback)(int, int)) {
 // ============================================================
 
 static Layout* find_layout(HWND parent) {
-    for (int i = 0; i < g_layout_count; i++) {
-        if (g_layouts[i].parent == parent) {
-            return &g_layouts[i];
-        }
+    return (Layout*)handle_map_get(&g_layouts, parent, 0);
+}
+
+static Layout* create_layout(HWND parent, LayoutType type, int cols, int margin, int spacing) {
+    Layout* layout = (Layout*)calloc(1, sizeof(Layout));
+    if (!layout) return NULL;
+
+    layout->parent = parent;
+    layout->type = type;
+    layout->margin = margin;
+    layout->spacing = spacing;
+    layout->grid_cols = cols;
+    layout->child_count = 0;
+
+    // 挂到同一父窗口的布局链表尾部
+    Layout* head = find_layout(parent);
+    if (head) {
+        while (head->next) head = head->next;
+        head->next = layout;
+    } else if (!handle_map_put(&g_layouts, parent, 0, layout)) {
+        free(layout);
+        return NULL;
     }
-    return NULL;
+    return layout;
 }
 
 static void apply_layout(Layout* layout) {
-    if (!layout || layout->child_count == 0) return;
+    if (!layout) return;
+    layout->dirty = 0;
+    if (layout->child_count == 0) return;
 
     RECT rect;
     GetClientRect(layout->parent, &rect);
@@ -1273,6 +2504,16 @@ static void apply_layout(Layout* layout) {
     int content_width = width - 2 * layout->margin;
     int content_height = height - 2 * layout->margin;
 
+    // 批量移动子控件，一次性提交，避免逐个重绘
+    HDWP hdwp = BeginDeferWindowPos(layout->child_count);
+    UINT pos_flags = SWP_NOZORDER | SWP_NOACTIVATE;
+
+#define LAYOUT_MOVE(child, x, y, w, h) \
+    do { \
+        if (hdwp) hdwp = DeferWindowPos(hdwp, (child), NULL, (x), (y), (w), (h), pos_flags); \
+        if (!hdwp) SetWindowPos((child), NULL, (x), (y), (w), (h), pos_flags); \
+    } while (0)
+
     if (layout->type == LAYOUT_VBOX) {
         // 垂直布局
         int total_spacing = (layout->child_count - 1) * layout->spacing;
@@ -1280,10 +2521,7 @@ static void apply_layout(Layout* layout) {
         int y = layout->margin;
 
         for (int i = 0; i < layout->child_count; i++) {
-            SetWindowPos(layout->children[i], NULL,
-                        layout->margin, y,
-                        content_width, child_height,
-                        SWP_NOZORDER);
+            LAYOUT_MOVE(layout->children[i], layout->margin, y, content_width, child_height);
             y += child_height + layout->spacing;
         }
     }
@@ -1294,10 +2532,7 @@ static void apply_layout(Layout* layout) {
         int x = layout->margin;
 
         for (int i = 0; i < layout->child_count; i++) {
-            SetWindowPos(layout->children[i], NULL,
-                        x, layout->margin,
-                        child_width, content_height,
-                        SWP_NOZORDER);
+            LAYOUT_MOVE(layout->children[i], x, layout->margin, child_width, content_height);
             x += child_width + layout->spacing;
         }
     }
@@ -1318,74 +2553,78 @@ static void apply_layout(Layout* layout) {
             int x = layout->margin + col * (cell_width + layout->spacing);
             int y = layout->margin + row * (cell_height + layout->spacing);
 
-            SetWindowPos(layout->children[i], NULL,
-                        x, y, cell_width, cell_height,
-                        SWP_NOZORDER);
+            LAYOUT_MOVE(layout->children[i], x, y, cell_width, cell_height);
+        }
+    }
+
+#undef LAYOUT_MOVE
+
+    if (hdwp) EndDeferWindowPos(hdwp);
+}
+
+// 重新布局父窗口下的所有布局；only_dirty 为真时只处理待更新的布局
+static void relayout_window(HWND parent, int only_dirty) {
+    for (Layout* layout = find_layout(parent); layout; layout = layout->next) {
+        if (!only_dirty || layout->dirty) {
+            apply_layout(layout);
         }
     }
 }
 
+// 标记布局待更新，并在消息循环下一轮统一执行
+static void schedule_layout(Layout* layout) {
+    if (layout->dirty) return;
+    layout->dirty = 1;
+    PostMessageW(layout->parent, WM_BOLIDE_LAYOUT, 0, 0);
+}
+
 // ============================================================
 // 布局管理器 - API 函数
 // ============================================================
 
 // 创建垂直布局
 GUI_API void* gui_vbox(void* parent, int margin, int spacing) {
-    if (g_layout_count >= MAX_LAYOUTS) return NULL;
-
-    Layout* layout = &g_layouts[g_layout_count++];
-    layout->parent = (HWND)parent;
-    layout->type = LAYOUT_VBOX;
-    layout->margin = margin;
-    layout->spacing = spacing;
-    layout->grid_cols = 0;
-    layout->child_count = 0;
-
-    return layout;
+    return create_layout((HWND)parent, LAYOUT_VBOX, 0, margin, spacing);
 }
 
 // 创建水平布局
 GUI_API void* gui_hbox(void* parent, int margin, int spacing) {
-    if (g_layout_count >= MAX_LAYOUTS) return NULL;
-
-    Layout* layout = &g_layouts[g_layout_count++];
-    layout->parent = (HWND)parent;
-    layout->type = LAYOUT_HBOX;
-    layout->margin = margin;
-    layout->spacing = spacing;
-    layout->grid_cols = 0;
-    layout->child_count = 0;
-
-    return layout;
+    return create_layout((HWND)parent, LAYOUT_HBOX, 0, margin, spacing);
 }
 
 // 创建网格布局
 GUI_API void* gui_grid(void* parent, int cols, int margin, int spacing) {
-    if (g_layout_count >= MAX_LAYOUTS) return NULL;
-
-    Layout* layout = &g_layouts[g_layout_count++];
-    layout->parent = (HWND)parent;
-    layout->type = LAYOUT_GRID;
-    layout->margin = margin;
-    layout->spacing = spacing;
-    layout->grid_cols = cols;
-    layout->child_count = 0;
-
-    return layout;
+    return create_layout((HWND)parent, LAYOUT_GRID, cols, margin, spacing);
 }
 
-// 添加子控件到布局
+// 添加子控件到布局（布局延迟到 gui_layout_commit 或下一轮消息循环执行）
 GUI_API void gui_layout_add(void* layout_ptr, void* child) {
     Layout* layout = (Layout*)layout_ptr;
-    if (!layout || layout->child_count >= MAX_LAYOUT_CHILDREN) return;
+    if (!layout || !child) return;
+
+    if (layout->child_count >= layout->child_capacity) {
+        int new_capacity = layout->child_capacity ? layout->child_capacity * 2 : 16;
+        HWND* children = (HWND*)realloc(layout->children, new_capacity * sizeof(HWND));
+        if (!children) return;
+        layout->children = children;
+        layout->child_capacity = new_capacity;
+    }
 
     layout->children[layout->child_count++] = (HWND)child;
-    apply_layout(layout);
+    schedule_layout(layout);
 }
 
-// 应用布局（手动触发）
+// 应用布局（手动触发，立即执行）
 GUI_API void gui_layout_apply(void* layout_ptr) {
     apply_layout((Layout*)layout_ptr);
 }
 
+// 如有待处理的变更则立即执行布局
+GUI_API void gui_layout_commit(void* layout_ptr) {
+    Layout* layout = (Layout*)layout_ptr;
+    if (layout && layout->dirty) {
+        apply_layout(layout);
+    }
+}
+
 #endif // _WIN32